@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Benchmarks of graph evaluation and table I/O hot
+# paths. Builds synthetic graphs, does not need
+# plugins, MapInfo or display.
+#
+#-------------------------------------------------
+
+QT       += core gui widgets
+
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+
+TARGET = PiriBench
+TEMPLATE = app
+
+SOURCES += main.cpp
+
+INCLUDEPATH = $$PWD/../libs/PiriLib/source
+
+win32:CONFIG(release, debug|release): LIBS += -L$$PWD/../libs/PiriLib/libs/ -lPiriLib
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$PWD/../libs/PiriLib/libs/ -lPiriLibd
+else:unix: LIBS += -L$$PWD/../libs/PiriLib/libs/ -lPiriLib
+
+INCLUDEPATH += $$PWD/../libs/PiriLib/libs
+DEPENDPATH += $$PWD/../libs/PiriLib/libs
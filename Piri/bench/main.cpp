@@ -0,0 +1,375 @@
+#include <stdlib.h>
+#include <new>
+#include <algorithm>
+#include <functional>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "interfaces.h"
+#include "op.h"
+#include "knobs.h"
+#include "graphmodel.h"
+#include "nativebackend.h"
+#include "tabreader.h"
+#include "topology.h"
+
+/*
+ * Benchmarks of graph evaluation and table I/O hot paths.
+ *
+ * Synthetic graphs of given shape are built from benchmark op, so no
+ * plugins are needed. Every benchmark is calibrated to run at least
+ * 10 ms per sample and median of samples is reported, so numbers stay
+ * stable between runs. Allocations are counted per op.
+ */
+
+static QTextStream out(stdout);
+static QTextStream err(stderr);
+
+/*
+ * Allocation counting. On glibc malloc is replaced, so allocations of Qt
+ * containers are counted too. Elsewhere only operator new is counted.
+ */
+static qint64 allocCount = 0;
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size)
+{
+    allocCount++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    allocCount++;
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    allocCount++;
+    return __libc_realloc(p, size);
+}
+}
+#else
+void *operator new(size_t size)
+{
+    allocCount++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+#endif
+
+/*
+ * Benchmark op. Generates MapBasic select like real ops and passes its
+ * main input through in native run.
+ */
+static constexpr OpDescriptor sourceDescriptor = { "Input", "BenchSource", "Benchmark source.", 0, 0, OP_SCHEMA_SOURCE, 0, 0 };
+static constexpr OpDescriptor stepDescriptor = { "Other", "BenchStep", "Benchmark step.", 1, 2, OP_SCHEMA_INPUT, 0, 0 };
+static OpDescriptor mergeDescriptor = { "Other", "BenchMerge", "Benchmark merge.", 1, 2, OP_SCHEMA_INPUT, 0, 0 };
+
+class BenchOp : public OpInterfaceMI, public OpInterfaceNative, public Op
+{
+public:
+    BenchOp(const OpDescriptor *descriptor) : myDescriptor(descriptor), query("Select * From input0"), factor(1) {}
+
+    OpInterfaceMI* create() { return new BenchOp(myDescriptor); }
+    const OpDescriptor* descriptor() { return myDescriptor; }
+
+    void knobs(KnobCallback *f)
+    {
+        String_knob(f, &query, "Query");
+        Integer_knob(f, &factor, "Factor");
+    }
+
+    QString engine()
+    {
+        QString command = query;
+        if (hasInput(0))
+            command.replace("input0", "_" + getInputHash(0).toHex());
+        return command + " Into _" + getHash().toHex();
+    }
+
+    TablePtr run(QList<TablePtr> inputs)
+    {
+        if (myDescriptor->maxInputs == 0)
+            return TablePtr(new Table("source"));
+        return inputs.value(0);
+    }
+
+private:
+    const OpDescriptor *myDescriptor;
+    QString query;
+    int factor;
+};
+
+/*!
+ * \brief Add benchmark node with knob callback to model.
+ * \param model Model
+ * \param descriptor Descriptor of node op.
+ * \param name Node name
+ * \return Node id
+ */
+static int addNode(GraphModel *model, const OpDescriptor *descriptor, QString name)
+{
+    BenchOp *op = new BenchOp(descriptor);
+    int id = model->addNode(op, name);
+    KnobCallback *callback = new KnobCallback();
+    op->setCallback(callback);
+    op->knobs(callback);
+    model->setCallback(id, callback);
+    return id;
+}
+
+/*!
+ * \brief Build chain source -> step -> step ...
+ * \param model Model to fill.
+ * \param length Number of nodes.
+ * \return Id of last node.
+ */
+static int buildChain(GraphModel *model, int length)
+{
+    int last = addNode(model, &sourceDescriptor, "Source");
+    for (int i = 1; i < length; i++)
+    {
+        int id = addNode(model, &stepDescriptor, QString("Step%1").arg(i));
+        model->setInput(id, 0, last);
+        last = id;
+    }
+    return last;
+}
+
+/*!
+ * \brief Build many sources joined into one merge node.
+ * \param model Model to fill.
+ * \param width Number of sources.
+ * \return Id of merge node.
+ */
+static int buildFanIn(GraphModel *model, int width)
+{
+    mergeDescriptor.maxInputs = width;
+    int merge = addNode(model, &mergeDescriptor, "Merge");
+    for (int i = 0; i < width; i++)
+        model->setInput(merge, i, addNode(model, &sourceDescriptor, QString("Source%1").arg(i)));
+    return merge;
+}
+
+/*!
+ * \brief Build diamonds, every diamond splits node in two and joins them.
+ * \param model Model to fill.
+ * \param count Number of diamonds.
+ * \return Id of last join node.
+ */
+static int buildDiamonds(GraphModel *model, int count)
+{
+    int top = addNode(model, &sourceDescriptor, "Source");
+    for (int i = 0; i < count; i++)
+    {
+        int left = addNode(model, &stepDescriptor, QString("Left%1").arg(i));
+        int right = addNode(model, &stepDescriptor, QString("Right%1").arg(i));
+        int join = addNode(model, &stepDescriptor, QString("Join%1").arg(i));
+        model->setInput(left, 0, top);
+        model->setInput(right, 0, top);
+        model->setInput(join, 0, left);
+        model->setInput(join, 1, right);
+        top = join;
+    }
+    return top;
+}
+
+/*!
+ * \brief Runs benchmarks and prints results.
+ */
+class BenchRunner
+{
+public:
+    BenchRunner(QString filter, int samples) : myFilter(filter), mySamples(qMax(3, samples)) {}
+
+    /*!
+     * \brief Run one benchmark.
+     *
+     * Iterations are doubled until one sample takes at least 10 ms. Then
+     * samples are taken and median time per op is reported with median
+     * absolute deviation in percent.
+     * \param name Benchmark name
+     * \param f Benchmark body, one op.
+     */
+    void run(QString name, std::function<void()> f)
+    {
+        if (!myFilter.isEmpty() && !name.contains(myFilter, Qt::CaseInsensitive))
+            return;
+
+        qint64 iterations = 1;
+        QElapsedTimer timer;
+        f();
+        for (;;)
+        {
+            timer.start();
+            for (qint64 i = 0; i < iterations; i++)
+                f();
+            if (timer.nsecsElapsed() >= 10000000 || iterations >= (Q_INT64_C(1) << 30))
+                break;
+            iterations *= 2;
+        }
+
+        QVector<double> times;
+        qint64 allocs = 0;
+        for (int s = 0; s < mySamples; s++)
+        {
+            qint64 allocStart = allocCount;
+            timer.start();
+            for (qint64 i = 0; i < iterations; i++)
+                f();
+            times << double(timer.nsecsElapsed()) / iterations;
+            allocs += allocCount - allocStart;
+        }
+
+        std::sort(times.begin(), times.end());
+        double median = times.at(times.count() / 2);
+        QVector<double> deviations;
+        foreach (double t, times)
+            deviations << qAbs(t - median);
+        std::sort(deviations.begin(), deviations.end());
+        double mad = median > 0 ? 100.0 * deviations.at(deviations.count() / 2) / median : 0.0;
+
+        out << QString("%1 %2 ns/op  %3%  %4 allocs/op  %5 iterations")
+               .arg(name, -32)
+               .arg(median, 14, 'f', 1)
+               .arg(QString::number(mad, 'f', 1).prepend(QChar(0xb1)), 6)
+               .arg(double(allocs) / (iterations * mySamples), 12, 'f', 1)
+               .arg(iterations, 10)
+            << endl;
+    }
+
+private:
+    QString myFilter; /*!< Only benchmarks with this in name are run. */
+    int mySamples; /*!< Number of samples per benchmark. */
+};
+
+/*!
+ * \brief Run graph benchmarks on one model.
+ * \param bench Runner
+ * \param shape Shape name, prefix of benchmark names.
+ * \param model Model
+ * \param target Node that is evaluated.
+ */
+static void benchGraph(BenchRunner *bench, QString shape, GraphModel *model, int target)
+{
+    NativeBackend backend;
+    KnobCallback *callback = model->node(0).callback;
+    int factor = 0;
+
+    bench->run(shape + "/upstream", [&]() { model->upstream(target); });
+    bench->run(shape + "/hash", [&]() { model->hash(target); });
+    bench->run(shape + "/commands", [&]() { model->commands(target); });
+    bench->run(shape + "/knob", [&]() {
+        callback->setValue("Factor", ++factor);
+        model->hash(target);
+    });
+    bench->run(shape + "/evaluate", [&]() { model->evaluate(target, &backend); });
+}
+
+static int usage()
+{
+    err << "Usage: PiriBench [-chain <nodes>] [-width <inputs>] [-diamonds <count>]" << endl
+        << "                 [-data <dir with .TAB files>] [-samples <n>] [filter]" << endl;
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int chain = 200;
+    int width = 200;
+    int diamonds = 50;
+    int samples = 9;
+    QString dataPath = QDir::currentPath() + "/asustus";
+    QString filter;
+    QStringList all = app.arguments();
+    for (int i = 1; i < all.count(); i++)
+    {
+        if (all.at(i) == "-chain" && i + 1 < all.count())
+            chain = all.at(++i).toInt();
+        else if (all.at(i) == "-width" && i + 1 < all.count())
+            width = all.at(++i).toInt();
+        else if (all.at(i) == "-diamonds" && i + 1 < all.count())
+            diamonds = all.at(++i).toInt();
+        else if (all.at(i) == "-data" && i + 1 < all.count())
+            dataPath = all.at(++i);
+        else if (all.at(i) == "-samples" && i + 1 < all.count())
+            samples = all.at(++i).toInt();
+        else if (all.at(i).startsWith("-") || !filter.isEmpty())
+            return usage();
+        else
+            filter = all.at(i);
+    }
+    if (chain < 1 || width < 1 || diamonds < 1)
+        return usage();
+
+    BenchRunner bench(filter, samples);
+
+    GraphModel chainModel;
+    benchGraph(&bench, QString("chain%1").arg(chain), &chainModel, buildChain(&chainModel, chain));
+    GraphModel fanInModel;
+    benchGraph(&bench, QString("fanin%1").arg(width), &fanInModel, buildFanIn(&fanInModel, width));
+    GraphModel diamondModel;
+    benchGraph(&bench, QString("diamond%1").arg(diamonds), &diamondModel, buildDiamonds(&diamondModel, diamonds));
+
+    QDir data(dataPath);
+    QStringList tables = data.entryList(QStringList() << "*.TAB" << "*.tab", QDir::Files, QDir::Name);
+    if (tables.isEmpty())
+        err << "No tables in " << dataPath << ", table benchmarks skipped" << endl;
+    foreach (QString name, tables) {
+        QString path = data.filePath(name);
+        QString base = QFileInfo(name).completeBaseName();
+        bench.run("read/" + base, [&]() {
+            TabReader reader(path);
+            if (!reader.read())
+                qFatal("%s", qPrintable(reader.getError()));
+        });
+        bench.run("stream/" + base, [&]() {
+            TabReader reader(path);
+            if (!reader.open())
+                qFatal("%s", qPrintable(reader.getError()));
+            do {
+                reader.readBatch(STREAM_BATCH_ROWS);
+            } while (!reader.atEnd());
+        });
+        TablePtr table = TabReader(path).read();
+        if (table && table->hasGeometry())
+        {
+            bench.run("topology/" + base, [&]() {
+                Topology topology;
+                topology.build(table.data());
+                topology.simplify(100);
+            });
+        }
+    }
+    return 0;
+}
@@ -4,10 +4,19 @@
 #
 #-------------------------------------------------
 
-QT       += core gui axcontainer
+QT       += core gui concurrent
+
+win32: QT += axcontainer
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+CONFIG   += c++11
+
+# partMetrics() loops are OpenMP SIMD loops. sqrt() does not set errno,
+# so loops that take it can be vectorized too.
+win32-msvc*: QMAKE_CXXFLAGS += -openmp:experimental
+else: QMAKE_CXXFLAGS += -fopenmp-simd -fno-math-errno
+
 TARGET = PiriLib
 TEMPLATE = lib
 
@@ -21,9 +30,27 @@ SOURCES += pirilib.cpp \
     knobcallback.cpp \
     op.cpp \
     edge.cpp \
-    miconnect.cpp \
     knobs.cpp \
-    searchdialog.cpp
+    searchdialog.cpp \
+    messagelog.cpp \
+    pluginmanifest.cpp \
+    knobpanel.cpp \
+    table.cpp \
+    tabreader.cpp \
+    csvwriter.cpp \
+    tabwriter.cpp \
+    mifwriter.cpp \
+    shapereader.cpp \
+    shapewriter.cpp \
+    nativebackend.cpp \
+    graphfile.cpp \
+    graphmodel.cpp \
+    hasher.cpp \
+    resultcache.cpp \
+    tablestream.cpp \
+    evalprofiler.cpp \
+    geometry.cpp \
+    topology.cpp
 
 
 HEADERS += pirilib.h\
@@ -36,7 +63,30 @@ HEADERS += pirilib.h\
     knobcallback.h \
     op.h \
     edge.h \
-    miconnect.h \
     knobs.h \
-    searchdialog.h
+    searchdialog.h \
+    messagelog.h \
+    pluginmanifest.h \
+    opdescriptor.h \
+    knobpanel.h \
+    table.h \
+    tabreader.h \
+    csvwriter.h \
+    tabwriter.h \
+    mifwriter.h \
+    shapereader.h \
+    shapewriter.h \
+    nativebackend.h \
+    graphfile.h \
+    graphmodel.h \
+    hasher.h \
+    resultcache.h \
+    tablestream.h \
+    evalprofiler.h \
+    geometry.h \
+    topology.h
+
+# MapInfo connection uses ActiveX, other platforms only have native backend
+win32: SOURCES += miconnect.cpp
+win32: HEADERS += miconnect.h
 
@@ -0,0 +1,179 @@
+#include "csvwriter.h"
+
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+
+
+/*!
+ * \brief CSV writer constructor.
+ *
+ * Writes native table as UTF-8 CSV. If table has geometry, it is written
+ * to last column named WKT.
+ * \param fileName Path of output file.
+ */
+CsvWriter::CsvWriter(QString fileName)
+{
+    myFileName = fileName;
+    myRowCount = 0;
+}
+
+/*!
+ * \brief Convert geometry to well known text.
+ *
+ * Region rings are written as one polygon. Same as in MapInfo, ring that
+ * is inside other ring is a hole.
+ * \param type Geometry type, see GEOMETRY_TYPE_* in pirilib.h
+ * \param geometry Geometry
+ * \return Geometry as WKT, empty string if there is no geometry.
+ */
+QString CsvWriter::toWkt(int type, const Geometry &geometry)
+{
+    if (type == GEOMETRY_TYPE_NONE || geometry.isEmpty())
+        return QString();
+
+    QString wkt;
+    QTextStream out(&wkt);
+    out.setRealNumberPrecision(15);
+
+    if (type == GEOMETRY_TYPE_POINT)
+    {
+        QPointF p = geometry.first().value(0);
+        out << "POINT (" << p.x() << " " << p.y() << ")";
+        return wkt;
+    }
+
+    if (type == GEOMETRY_TYPE_REGION)
+        out << "POLYGON (";
+    else if (geometry.count() > 1)
+        out << "MULTILINESTRING (";
+    else
+        out << "LINESTRING ";
+
+    for (int i = 0; i < geometry.count(); i++)
+    {
+        const QPolygonF &part = geometry.at(i);
+        if (i > 0)
+            out << ", ";
+        out << "(";
+        for (int v = 0; v < part.count(); v++)
+        {
+            if (v > 0)
+                out << ", ";
+            out << part.at(v).x() << " " << part.at(v).y();
+        }
+        // WKT rings are closed
+        if (type == GEOMETRY_TYPE_REGION && !part.isEmpty() && !part.isClosed())
+            out << ", " << part.first().x() << " " << part.first().y();
+        out << ")";
+    }
+
+    if (type == GEOMETRY_TYPE_REGION || geometry.count() > 1)
+        out << ")";
+    out.flush();
+    return wkt;
+}
+
+/*!
+ * \brief Write header line.
+ * \param out Output
+ * \param table Table, only columns are used.
+ * \param geometry Is WKT column written?
+ */
+void CsvWriter::writeHeader(QTextStream &out, const Table *table, bool geometry)
+{
+    QStringList header;
+    for (int c = 0; c < table->columnCount(); c++)
+        header << table->column(c).name;
+    if (geometry)
+        header << "WKT";
+    out << header.join(",") << "\n";
+}
+
+/*!
+ * \brief Write all rows of table.
+ * \param out Output
+ * \param table Table
+ * \param geometry Is WKT column written?
+ */
+void CsvWriter::writeRows(QTextStream &out, const Table *table, bool geometry)
+{
+    for (int r = 0; r < table->rowCount(); r++)
+    {
+        for (int c = 0; c < table->columnCount(); c++)
+        {
+            if (c > 0)
+                out << ",";
+            if (table->column(c).type == COLUMN_TYPE_STRING)
+            {
+                QString s = table->toString(r, c);
+                s.replace("\"", "\"\"");
+                out << "\"" << s << "\"";
+            } else {
+                out << table->toString(r, c);
+            }
+        }
+        if (geometry)
+        {
+            if (table->columnCount() > 0)
+                out << ",";
+            out << "\"" << toWkt(table->geometryType(r), table->geometry(r)) << "\"";
+        }
+        out << "\n";
+    }
+    myRowCount += table->rowCount();
+}
+
+/*!
+ * \brief Write table.
+ * \param table Table to write.
+ * \return True on success, see getError() otherwise.
+ */
+bool CsvWriter::write(TablePtr table)
+{
+    return write(TableStreamPtr(new TableSliceStream(table, qMax(1, table->rowCount()))));
+}
+
+/*!
+ * \brief Write table from stream, one batch at a time.
+ *
+ * WKT column is written if first batch has geometry, so whole table does
+ * not have to be in memory.
+ * \param stream Stream to write.
+ * \return True on success, see getError() otherwise.
+ */
+bool CsvWriter::write(TableStreamPtr stream)
+{
+    myRowCount = 0;
+    QFile file(myFileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+    {
+        myError = "Can not write " + myFileName;
+        return false;
+    }
+
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    TablePtr batch = stream->next();
+    bool geometry = batch && batch->hasGeometry();
+    if (batch)
+        writeHeader(out, batch.data(), geometry);
+    while (batch)
+    {
+        writeRows(out, batch.data(), geometry);
+        batch = stream->next();
+    }
+    if (stream->hasError())
+    {
+        myError = stream->getError();
+        return false;
+    }
+
+    out.flush();
+    if (file.error() != QFile::NoError)
+    {
+        myError = "Can not write " + myFileName;
+        return false;
+    }
+    return true;
+}
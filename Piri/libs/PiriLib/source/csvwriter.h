@@ -0,0 +1,33 @@
+#ifndef CSVWRITER_H
+#define CSVWRITER_H
+
+#include <QString>
+
+#include "pirilib.h"
+#include "table.h"
+#include "tablestream.h"
+
+class QTextStream;
+
+class PIRILIBSHARED_EXPORT CsvWriter
+{
+public:
+    CsvWriter(QString fileName);
+
+    bool write(TablePtr table);
+    bool write(TableStreamPtr stream);
+    int getRowCount() { return myRowCount; }
+    QString getError() { return myError; }
+
+    static QString toWkt(int type, const Geometry &geometry);
+
+private:
+    void writeHeader(QTextStream &out, const Table *table, bool geometry);
+    void writeRows(QTextStream &out, const Table *table, bool geometry);
+
+    QString myFileName; /*!< Path of output file. */
+    int myRowCount; /*!< Number of rows written. */
+    QString myError; /*!< Last error. */
+};
+
+#endif // CSVWRITER_H
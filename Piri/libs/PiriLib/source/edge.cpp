@@ -1,6 +1,7 @@
 #include "edge.h"
 #include "node.h"
 #include "nodegraph.h"
+#include "graphmodel.h"
 
 #include <math.h>
 
@@ -14,7 +15,8 @@ static double TwoPi = 2.0 * Pi;
 /*!
  * \brief Edge constructor.
  *
- * Creates new edge between source and destination nodes.
+ * Creates new edge between source and destination nodes. Edge becomes
+ * next input of destination node.
  * \param sourceNode Source node, higher in hierarchy
  * \param destNode Destination node, lower in hierarchy
  * \param eType Edge type
@@ -33,12 +35,30 @@ Edge::Edge(Node *sourceNode, Node *destNode, int eType)
     hovered = 0;
     //destNode->getParent()->getParent()->logMessage("Node constructor");
 
+    myInput = 0;
+    foreach (Edge *e, dest->edges())
+    {
+        if (e->destNode() == dest)
+            myInput++;
+    }
+
     if (source)
         source->addEdge(this, 0);
     dest->addEdge(this, 0);
+    updateModel();
     adjust();
 }
 
+/*!
+ * \brief Updates destination node input in graph model.
+ */
+void Edge::updateModel()
+{
+    if (!dest)
+        return;
+    dest->getParent()->getModel()->setInput(dest->getId(), myInput, source ? source->getId() : -1);
+}
+
 /*!
  * \brief Get source node.
  * \return Source node
@@ -159,6 +179,7 @@ void Edge::disconnect()
 {
     source->removeEdge(this);
     source = 0;
+    updateModel();
     adjust();
 }
 
@@ -198,6 +219,7 @@ void Edge::setSourceNode(Node *node)
     source = node;
     if (node)
         node->addEdge(this, EDGE_NOT_MAINEDGE);
+    updateModel();
     adjust();
 }
 
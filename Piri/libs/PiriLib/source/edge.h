@@ -29,6 +29,7 @@ public:
     QPointF getSourcePoint();
     void setSourcePoint(QPointF point);
     void setSourceNode(Node *node);
+    int getInput() const { return myInput; }
     //void setDestNode(Node *node);
     void setDragged(int drag);
     int hovered;
@@ -38,7 +39,10 @@ protected:
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
 
 private:
+    void updateModel();
+
     Node *source, *dest;
+    int myInput; /*!< Input number of destination node, 0 is main input. */
     int dragged;
     QPointF sourcePoint;
     QPointF destPoint;
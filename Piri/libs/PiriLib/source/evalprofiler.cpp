@@ -0,0 +1,279 @@
+#include "evalprofiler.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <algorithm>
+
+
+/*!
+ * \brief Evaluation profiler constructor.
+ *
+ * Profiler records how long every node takes in evaluation, how many rows
+ * go in and out of it and if its result came from cache. Steps can be
+ * nested, for example stream of node pulls batches from input nodes.
+ * Nested time is left out of node time, so slow nodes stand out.
+ */
+EvalProfiler::EvalProfiler()
+{
+    myTimer.start();
+}
+
+/*!
+ * \brief Remove all records and start timing from zero.
+ */
+void EvalProfiler::clear()
+{
+    myEvents.clear();
+    myStack.clear();
+    myNodes.clear();
+    myTimer.restart();
+}
+
+/*!
+ * \brief Get totals of node, new entry is made if needed.
+ * \param node Node id
+ * \return Totals
+ */
+NodeProfile& EvalProfiler::entry(int node)
+{
+    QHash<int, NodeProfile>::iterator i = myNodes.find(node);
+    if (i == myNodes.end())
+    {
+        NodeProfile p;
+        p.time = 0;
+        p.calls = 0;
+        p.rowsIn = 0;
+        p.rowsOut = 0;
+        p.bytesIn = 0;
+        p.bytesOut = 0;
+        p.cache = PROFILE_CACHE_NONE;
+        i = myNodes.insert(node, p);
+    }
+    return i.value();
+}
+
+/*!
+ * \brief Start timed step of node. Every begin() needs matching end().
+ * \param node Node id
+ * \param name Node name
+ * \param op Op name
+ * \param phase Step name
+ */
+void EvalProfiler::begin(int node, const QString &name, const QString &op, const QString &phase)
+{
+    NodeProfile &p = entry(node);
+    p.name = name;
+    p.op = op;
+
+    ProfileEvent e;
+    e.node = node;
+    e.phase = phase;
+    e.start = myTimer.nsecsElapsed();
+    e.duration = 0;
+    myEvents << e;
+
+    Frame f;
+    f.event = myEvents.count() - 1;
+    f.nested = 0;
+    myStack << f;
+}
+
+/*!
+ * \brief End innermost timed step.
+ */
+void EvalProfiler::end()
+{
+    if (myStack.isEmpty())
+        return;
+    Frame f = myStack.takeLast();
+    ProfileEvent &e = myEvents[f.event];
+    e.duration = myTimer.nsecsElapsed() - e.start;
+
+    NodeProfile &p = entry(e.node);
+    p.time += e.duration - f.nested;
+    p.calls++;
+    if (!myStack.isEmpty())
+        myStack.last().nested += e.duration;
+}
+
+/*!
+ * \brief Add rows that node read and made.
+ * \param node Node id
+ * \param rowsIn Rows read from inputs.
+ * \param rowsOut Rows in result.
+ * \param bytesIn Estimated size of input rows.
+ * \param bytesOut Estimated size of result rows.
+ */
+void EvalProfiler::addRows(int node, qint64 rowsIn, qint64 rowsOut, qint64 bytesIn, qint64 bytesOut)
+{
+    NodeProfile &p = entry(node);
+    p.rowsIn += rowsIn;
+    p.rowsOut += rowsOut;
+    p.bytesIn += bytesIn;
+    p.bytesOut += bytesOut;
+}
+
+/*!
+ * \brief Set cache state of node.
+ * \param node Node id
+ * \param state See PROFILE_CACHE_* in pirilib.h
+ */
+void EvalProfiler::setCache(int node, int state)
+{
+    entry(node).cache = state;
+}
+
+/*!
+ * \brief Get time of all nodes.
+ * \return Time in ns.
+ */
+qint64 EvalProfiler::getTotalTime() const
+{
+    qint64 total = 0;
+    foreach (const NodeProfile &p, myNodes)
+        total += p.time;
+    return total;
+}
+
+static bool slowerThan(const NodeProfile &a, const NodeProfile &b)
+{
+    return a.time > b.time;
+}
+
+/*!
+ * \brief Get totals of all nodes as text, slowest node first.
+ * \return One line per node.
+ */
+QString EvalProfiler::summary() const
+{
+    static const char *cacheNames[] = { "", "hit", "miss" };
+    QList<NodeProfile> nodes = myNodes.values();
+    std::sort(nodes.begin(), nodes.end(), slowerThan);
+
+    QStringList lines;
+    lines << QString("%1 %2 %3 %4 %5 %6")
+             .arg("node", -20).arg("op", -12).arg("ms", 10).arg("rows in", 10).arg("rows out", 10).arg("cache");
+    foreach (const NodeProfile &p, nodes) {
+        lines << QString("%1 %2 %3 %4 %5 %6")
+                 .arg(p.name.left(20), -20).arg(p.op.left(12), -12)
+                 .arg(p.time / 1000000.0, 10, 'f', 2)
+                 .arg(p.rowsIn, 10).arg(p.rowsOut, 10)
+                 .arg(cacheNames[qBound(0, p.cache, 2)]);
+    }
+    return lines.join("\n");
+}
+
+/*!
+ * \brief Write steps as Chrome trace JSON.
+ *
+ * File can be opened in chrome://tracing or Perfetto. Every step is one
+ * complete event, node totals are in event arguments.
+ * \param fileName Path of output file.
+ * \return True on success, see getError() otherwise.
+ */
+bool EvalProfiler::writeChromeTrace(QString fileName)
+{
+    static const char *cacheNames[] = { "none", "hit", "miss" };
+    QJsonArray events;
+    foreach (const ProfileEvent &e, myEvents) {
+        NodeProfile p = myNodes.value(e.node);
+        QJsonObject args;
+        args.insert("node", e.node);
+        args.insert("op", p.op);
+        args.insert("nodeMs", p.time / 1000000.0);
+        args.insert("rowsIn", double(p.rowsIn));
+        args.insert("rowsOut", double(p.rowsOut));
+        args.insert("bytesIn", double(p.bytesIn));
+        args.insert("bytesOut", double(p.bytesOut));
+        args.insert("cache", QString(cacheNames[qBound(0, p.cache, 2)]));
+
+        QJsonObject event;
+        event.insert("name", p.name);
+        event.insert("cat", e.phase);
+        event.insert("ph", QString("X"));
+        event.insert("ts", e.start / 1000.0);
+        event.insert("dur", e.duration / 1000.0);
+        event.insert("pid", 1);
+        event.insert("tid", 1);
+        event.insert("args", args);
+        events.append(event);
+    }
+    QJsonObject root;
+    root.insert("traceEvents", events);
+    root.insert("displayTimeUnit", QString("ms"));
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0)
+    {
+        myError = "Can not write " + fileName;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Read times file, empty object if there is none.
+ * \param fileName Times file
+ * \return Node times of every graph, keyed by graph path.
+ */
+static QJsonObject readTimes(QString fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QJsonObject();
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+/*!
+ * \brief Keep node times of this run for execution plans of later runs.
+ *
+ * Times are kept by node name under graph path, so one file holds times
+ * of many graphs. Nodes whose result came from cache keep time of run
+ * where they were last run.
+ * \param fileName Times file
+ * \param graph Absolute path of graph file.
+ * \return True if file was written.
+ */
+bool EvalProfiler::saveTimes(QString fileName, QString graph)
+{
+    QJsonObject root = readTimes(fileName);
+    QJsonObject times = root.value(graph).toObject();
+    foreach (const NodeProfile &p, myNodes) {
+        if (p.cache != PROFILE_CACHE_HIT)
+            times.insert(p.name, p.time / 1000000.0);
+    }
+    root.insert(graph, times);
+
+    QFileInfo info(fileName);
+    if (!info.dir().exists())
+        info.dir().mkpath(".");
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || file.write(QJsonDocument(root).toJson()) < 0)
+    {
+        myError = "Can not write " + fileName;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Read node times of earlier runs of graph, see savedTime().
+ * \param fileName Times file
+ * \param graph Absolute path of graph file.
+ * \return True if graph had saved times.
+ */
+bool EvalProfiler::loadTimes(QString fileName, QString graph)
+{
+    mySavedTimes.clear();
+    QJsonObject times = readTimes(fileName).value(graph).toObject();
+    foreach (QString name, times.keys())
+        mySavedTimes.insert(name, times.value(name).toDouble());
+    return !times.isEmpty();
+}
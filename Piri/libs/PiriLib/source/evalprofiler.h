@@ -0,0 +1,80 @@
+#ifndef EVALPROFILER_H
+#define EVALPROFILER_H
+
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QElapsedTimer>
+
+#include "pirilib.h"
+
+/*!
+ * \brief One timed step of node evaluation.
+ */
+struct ProfileEvent {
+    int node; /*!< Node id. */
+    QString phase; /*!< Step, for example "engine", "run" or "stream". */
+    qint64 start; /*!< Start in ns from start of evaluation. */
+    qint64 duration; /*!< Duration in ns, nested steps included. */
+};
+
+/*!
+ * \brief Totals of one node in evaluation.
+ */
+struct NodeProfile {
+    QString name; /*!< Node name. */
+    QString op; /*!< Op name. */
+    qint64 time; /*!< Time in ns, time of nested nodes left out. */
+    int calls; /*!< Number of timed steps. */
+    qint64 rowsIn; /*!< Rows read from inputs. */
+    qint64 rowsOut; /*!< Rows in result. */
+    qint64 bytesIn; /*!< Estimated size of input rows. */
+    qint64 bytesOut; /*!< Estimated size of result rows. */
+    int cache; /*!< Cache state, see PROFILE_CACHE_* in pirilib.h */
+};
+
+class PIRILIBSHARED_EXPORT EvalProfiler
+{
+public:
+    EvalProfiler();
+
+    void clear();
+    void begin(int node, const QString &name, const QString &op, const QString &phase);
+    void end();
+    void addRows(int node, qint64 rowsIn, qint64 rowsOut, qint64 bytesIn, qint64 bytesOut);
+    void setCache(int node, int state);
+
+    bool contains(int node) const { return myNodes.contains(node); }
+    NodeProfile node(int node) const { return myNodes.value(node); }
+    QList<int> nodeIds() const { return myNodes.keys(); }
+    QList<ProfileEvent> getEvents() const { return myEvents; }
+    qint64 getTotalTime() const;
+    QString summary() const;
+
+    bool writeChromeTrace(QString fileName);
+    bool saveTimes(QString fileName, QString graph);
+    bool loadTimes(QString fileName, QString graph);
+    double savedTime(const QString &name) const { return mySavedTimes.value(name, -1.0); }
+    QString getError() { return myError; }
+
+private:
+    NodeProfile& entry(int node);
+
+    /*!
+     * \brief Step in progress.
+     */
+    struct Frame {
+        int event; /*!< Index of event in myEvents. */
+        qint64 nested; /*!< Time of nested steps. */
+    };
+
+    QElapsedTimer myTimer; /*!< Started when profiler is cleared. */
+    QList<ProfileEvent> myEvents; /*!< Steps in start order. */
+    QVector<Frame> myStack; /*!< Steps in progress, innermost last. */
+    QHash<int, NodeProfile> myNodes; /*!< Totals by node id. */
+    QHash<QString, double> mySavedTimes; /*!< Node times in ms from earlier runs, by node name. */
+    QString myError; /*!< Last error. */
+};
+
+#endif // EVALPROFILER_H
@@ -0,0 +1,236 @@
+#include "geometry.h"
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+
+/*!
+ * \brief Get bits of coordinate, negative zero is same as zero.
+ * \param v Coordinate
+ * \return Bits
+ */
+static quint64 coordBits(double v)
+{
+    if (v == 0.0)
+        v = 0.0;
+    quint64 bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+/*!
+ * \brief Get key of point for exact vertex matching.
+ *
+ * Neighbours in MapInfo coverage layers share vertices exactly, so
+ * shared vertices are found without tolerance.
+ * \param p Point
+ * \return Key
+ */
+PointKey pointKey(const QPointF &p)
+{
+    return PointKey(coordBits(p.x()), coordBits(p.y()));
+}
+
+
+/*!
+ * \brief Measure ring or line part.
+ *
+ * Points are in separate x and y arrays, as Table::points() gives them.
+ * Bounds and the shoelace and length sums are OpenMP SIMD reductions,
+ * built with -fopenmp-simd and -fno-math-errno (see PiriLib.pro), so
+ * sums of several points are added in one vector register. Coordinates
+ * are taken relative to first point, so large map coordinates do not
+ * lose precision in products.
+ * \param xs X coordinates
+ * \param ys Y coordinates
+ * \param n Number of points
+ * \param ring Is part ring? Closing edge of ring is added if needed.
+ * \return Measures
+ */
+PartMetrics partMetrics(const double *xs, const double *ys, int n, bool ring)
+{
+    PartMetrics m = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    if (n <= 0)
+        return m;
+    const double x0 = xs[0];
+    const double y0 = ys[0];
+
+    double minX = x0, minY = y0, maxX = x0, maxY = y0;
+#pragma omp simd reduction(min:minX,minY) reduction(max:maxX,maxY)
+    for (int i = 1; i < n; i++)
+    {
+        minX = xs[i] < minX ? xs[i] : minX;
+        minY = ys[i] < minY ? ys[i] : minY;
+        maxX = xs[i] > maxX ? xs[i] : maxX;
+        maxY = ys[i] > maxY ? ys[i] : maxY;
+    }
+    m.minX = minX;
+    m.minY = minY;
+    m.maxX = maxX;
+    m.maxY = maxY;
+
+    double area = 0.0, length = 0.0, cx = 0.0, cy = 0.0, lx = 0.0, ly = 0.0;
+#pragma omp simd reduction(+:area,length,cx,cy,lx,ly)
+    for (int i = 0; i < n - 1; i++)
+    {
+        double ax = xs[i] - x0;
+        double ay = ys[i] - y0;
+        double bx = xs[i + 1] - x0;
+        double by = ys[i + 1] - y0;
+        double cross = ax * by - bx * ay;
+        double segment = sqrt((bx - ax) * (bx - ax) + (by - ay) * (by - ay));
+        area += cross;
+        cx += (ax + bx) * cross;
+        cy += (ay + by) * cross;
+        length += segment;
+        lx += (ax + bx) * segment;
+        ly += (ay + by) * segment;
+    }
+    if (ring && n > 2 && (xs[n - 1] != x0 || ys[n - 1] != y0))
+    {
+        // Closing edge ends at first point, which is origin
+        double ax = xs[n - 1] - x0;
+        double ay = ys[n - 1] - y0;
+        length += sqrt(ax * ax + ay * ay);
+        lx += ax * sqrt(ax * ax + ay * ay);
+        ly += ay * sqrt(ax * ax + ay * ay);
+    }
+
+    m.length = length;
+    if (ring && area != 0.0)
+    {
+        m.area = area / 2.0;
+        m.centroidX = x0 + cx / (3.0 * area);
+        m.centroidY = y0 + cy / (3.0 * area);
+    } else if (length > 0.0) {
+        m.centroidX = x0 + lx / (2.0 * length);
+        m.centroidY = y0 + ly / (2.0 * length);
+    } else {
+        m.centroidX = x0;
+        m.centroidY = y0;
+    }
+    return m;
+}
+
+/*!
+ * \brief Measure region.
+ *
+ * Holes are taken away from area and from center of mass.
+ * \param region Rings of region
+ * \return Measures, area is not negative.
+ */
+PartMetrics regionMetrics(const Geometry &region)
+{
+    PartMetrics result = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    QVector<bool> holes = ringHoles(region);
+    QVector<double> xs;
+    QVector<double> ys;
+    double cx = 0.0;
+    double cy = 0.0;
+    bool first = true;
+    for (int i = 0; i < region.count(); i++)
+    {
+        const QPolygonF &ring = region.at(i);
+        if (ring.isEmpty())
+            continue;
+        xs.resize(ring.count());
+        ys.resize(ring.count());
+        for (int k = 0; k < ring.count(); k++)
+        {
+            xs[k] = ring.at(k).x();
+            ys[k] = ring.at(k).y();
+        }
+        PartMetrics m = partMetrics(xs.constData(), ys.constData(), ring.count(), true);
+        double area = holes.at(i) ? -qAbs(m.area) : qAbs(m.area);
+        result.area += area;
+        result.length += m.length;
+        cx += m.centroidX * area;
+        cy += m.centroidY * area;
+        result.minX = first ? m.minX : qMin(result.minX, m.minX);
+        result.minY = first ? m.minY : qMin(result.minY, m.minY);
+        result.maxX = first ? m.maxX : qMax(result.maxX, m.maxX);
+        result.maxY = first ? m.maxY : qMax(result.maxY, m.maxY);
+        first = false;
+    }
+    if (result.area > 0.0)
+    {
+        result.centroidX = cx / result.area;
+        result.centroidY = cy / result.area;
+    } else {
+        result.area = 0.0;
+        result.centroidX = (result.minX + result.maxX) / 2;
+        result.centroidY = (result.minY + result.maxY) / 2;
+    }
+    return result;
+}
+
+/*!
+ * \brief Get signed area of ring with shoelace formula.
+ *
+ * Ring can be closed or open, closing edge is added if needed.
+ * \param ring Ring
+ * \return Area, positive if ring is counterclockwise.
+ */
+double ringArea(const QPolygonF &ring)
+{
+    int n = ring.count();
+    if (n < 3)
+        return 0.0;
+    const QPointF *p = ring.constData();
+    // Coordinates are taken relative to first point, so large map
+    // coordinates do not lose precision in products.
+    double x0 = p[0].x();
+    double y0 = p[0].y();
+    double sum = 0.0;
+    for (int i = 1; i < n - 1; i++)
+        sum += (p[i].x() - x0) * (p[i + 1].y() - y0) - (p[i + 1].x() - x0) * (p[i].y() - y0);
+    return sum / 2.0;
+}
+
+/*!
+ * \brief Find holes of region.
+ *
+ * MapInfo region is list of rings without roles. Ring is hole if it is
+ * inside odd number of other rings of same region.
+ * \param region Rings of region
+ * \return Hole flag of every ring.
+ */
+QVector<bool> ringHoles(const Geometry &region)
+{
+    QVector<bool> holes(region.count(), false);
+    if (region.count() < 2)
+        return holes;
+    for (int i = 0; i < region.count(); i++)
+    {
+        if (region.at(i).isEmpty())
+            continue;
+        QPointF p = region.at(i).first();
+        int inside = 0;
+        for (int j = 0; j < region.count(); j++)
+        {
+            if (j != i && region.at(j).containsPoint(p, Qt::OddEvenFill))
+                inside++;
+        }
+        holes[i] = inside % 2 == 1;
+    }
+    return holes;
+}
+
+/*!
+ * \brief Orient rings of region, outer rings counterclockwise and holes clockwise.
+ * \param region Rings of region
+ * \return Oriented rings in same order.
+ */
+Geometry orientRings(const Geometry &region)
+{
+    QVector<bool> holes = ringHoles(region);
+    Geometry result = region;
+    for (int i = 0; i < result.count(); i++)
+    {
+        double area = ringArea(result.at(i));
+        if ((area < 0) != holes.at(i))
+            std::reverse(result[i].begin(), result[i].end());
+    }
+    return result;
+}
@@ -0,0 +1,37 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <QVector>
+#include <QPolygonF>
+#include <QPair>
+
+#include "pirilib.h"
+#include "table.h"
+
+/*!
+ * \brief Exact key of point, same coordinates give same key.
+ */
+typedef QPair<quint64, quint64> PointKey;
+
+/*!
+ * \brief Measures of one ring or line part.
+ */
+struct PartMetrics {
+    double area; /*!< Signed area, positive if counterclockwise. 0 for line. */
+    double length; /*!< Length of boundary or line. */
+    double centroidX; /*!< Center of mass, of area for ring and of line for line. */
+    double centroidY;
+    double minX; /*!< Bounding box */
+    double minY;
+    double maxX;
+    double maxY;
+};
+
+PartMetrics PIRILIBSHARED_EXPORT partMetrics(const double *xs, const double *ys, int n, bool ring);
+PartMetrics PIRILIBSHARED_EXPORT regionMetrics(const Geometry &region);
+PointKey PIRILIBSHARED_EXPORT pointKey(const QPointF &p);
+double PIRILIBSHARED_EXPORT ringArea(const QPolygonF &ring);
+QVector<bool> PIRILIBSHARED_EXPORT ringHoles(const Geometry &region);
+Geometry PIRILIBSHARED_EXPORT orientRings(const Geometry &region);
+
+#endif // GEOMETRY_H
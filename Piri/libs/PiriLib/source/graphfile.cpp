@@ -0,0 +1,461 @@
+#include "graphfile.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QDataStream>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QtEndian>
+
+
+static const quint32 binaryMagic = 0x50495249; // "PIRI"
+
+/*!
+ * \brief Graph file constructor.
+ *
+ * Graph file has two forms. Binary form is default, it is small and fast
+ * to read. Text form is meant for diffing and editing by hand, one record
+ * per line:
+ *
+ *     version <version>
+ *     node <id> "<op>" "<name>" <x> <y>
+ *     knob <id> "<label>" "<value>"
+ *     disable <id>
+ *     edge <source id> <destination id> <input>
+ *
+ * Lines starting with # are comments. Quoted strings can have \", \\, \n
+ * and \r.
+ * Text file without version line is version 1.
+ *
+ * Binary form is QDataStream: magic "PIRI", quint16 version, string table
+ * and then nodes and edges. Op names, node names, knob labels and values
+ * are written as indexes to string table, so repeated strings are stored
+ * once. Both forms are read in one pass, format is found from first bytes.
+ * Graph file does not need node graph or widgets, so it is read the same
+ * way in UI and in headless runner.
+ */
+GraphFile::GraphFile()
+{
+    myFormat = GRAPH_FORMAT_BINARY;
+}
+
+/*!
+ * \brief Split line to tokens, quoted strings are one token.
+ * \param line Line
+ * \return List of tokens without quotes.
+ */
+QStringList GraphFile::tokenize(QString line)
+{
+    QStringList tokens;
+    QString token;
+    bool inQuotes = false;
+    bool hasToken = false;
+    for (int i = 0; i < line.length(); i++)
+    {
+        QChar c = line.at(i);
+        if (inQuotes)
+        {
+            if (c == '\\' && i + 1 < line.length()) {
+                QChar e = line.at(++i);
+                if (e == 'n')
+                    token += '\n';
+                else if (e == 'r')
+                    token += '\r';
+                else
+                    token += e;
+            } else if (c == '"') {
+                inQuotes = false;
+            } else {
+                token += c;
+            }
+        } else if (c == '"') {
+            inQuotes = true;
+            hasToken = true;
+        } else if (c.isSpace()) {
+            if (hasToken)
+                tokens << token;
+            token.clear();
+            hasToken = false;
+        } else {
+            token += c;
+            hasToken = true;
+        }
+    }
+    if (hasToken)
+        tokens << token;
+    return tokens;
+}
+
+/*!
+ * \brief Quote string for graph file.
+ *
+ * Line breaks are escaped, so multi-line knob values stay on one line.
+ * \param text String
+ * \return Quoted string
+ */
+QString GraphFile::quote(QString text)
+{
+    text.replace("\\", "\\\\");
+    text.replace("\"", "\\\"");
+    text.replace("\n", "\\n");
+    text.replace("\r", "\\r");
+    return "\"" + text + "\"";
+}
+
+/*!
+ * \brief Read graph from file.
+ *
+ * Format is detected from file contents, see getFormat().
+ * \param fileName Path of graph file.
+ * \return True on success, see getError() otherwise.
+ */
+bool GraphFile::read(QString fileName)
+{
+    nodes.clear();
+    edges.clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        myError = "Can not open " + fileName;
+        return false;
+    }
+    QByteArray head = file.peek(4);
+    if (head.size() == 4 && qFromBigEndian<quint32>((const uchar*)head.constData()) == binaryMagic)
+    {
+        myFormat = GRAPH_FORMAT_BINARY;
+        return readBinary(fileName, file.readAll()) && checkEdges(fileName);
+    }
+    file.close();
+    myFormat = GRAPH_FORMAT_TEXT;
+    return readText(fileName) && checkEdges(fileName);
+}
+
+/*!
+ * \brief Read text form of graph file.
+ * \param fileName Path of graph file.
+ * \return True on success.
+ */
+bool GraphFile::readText(QString fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        myError = "Can not open " + fileName;
+        return false;
+    }
+
+    QHash<int, int> index; // node id -> index in nodes
+    QTextStream in(&file);
+    in.setCodec("UTF-8");
+    int lineNumber = 0;
+    while (!in.atEnd())
+    {
+        QString line = in.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty() || line.startsWith("#"))
+            continue;
+
+        QStringList t = tokenize(line);
+        bool ok = true;
+        if (t.at(0) == "version" && t.count() == 2) {
+            int version = t.at(1).toInt(&ok);
+            if (ok && version > GRAPH_FILE_VERSION)
+            {
+                myError = QString("%1: graph file version %2 is newer than supported version %3")
+                        .arg(fileName).arg(version).arg(GRAPH_FILE_VERSION);
+                return false;
+            }
+        } else if (t.at(0) == "node" && (t.count() == 4 || t.count() == 6)) {
+            GraphFileNode n;
+            n.id = t.at(1).toInt(&ok);
+            n.op = t.at(2);
+            n.name = t.at(3);
+            n.disabled = false;
+            if (t.count() == 6)
+            {
+                bool okX, okY;
+                n.pos = QPointF(t.at(4).toDouble(&okX), t.at(5).toDouble(&okY));
+                ok = ok && okX && okY;
+            }
+            if (ok && index.contains(n.id))
+                ok = false;
+            index[n.id] = nodes.count();
+            nodes << n;
+        } else if (t.at(0) == "knob" && t.count() == 4) {
+            int id = t.at(1).toInt(&ok);
+            if (ok && index.contains(id))
+                nodes[index.value(id)].knobs << qMakePair(t.at(2), t.at(3));
+            else
+                ok = false;
+        } else if (t.at(0) == "disable" && t.count() == 2) {
+            int id = t.at(1).toInt(&ok);
+            if (ok && index.contains(id))
+                nodes[index.value(id)].disabled = true;
+            else
+                ok = false;
+        } else if (t.at(0) == "edge" && t.count() == 4) {
+            GraphFileEdge e;
+            bool ok2, ok3;
+            e.source = t.at(1).toInt(&ok);
+            e.dest = t.at(2).toInt(&ok2);
+            e.input = t.at(3).toInt(&ok3);
+            ok = ok && ok2 && ok3;
+            edges << e;
+        } else {
+            ok = false;
+        }
+        if (!ok)
+        {
+            myError = QString("%1:%2: bad line: %3").arg(fileName).arg(lineNumber).arg(line);
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Read binary form of graph file.
+ * \param fileName Path of graph file, used in error messages.
+ * \param data File contents.
+ * \return True on success.
+ */
+bool GraphFile::readBinary(QString fileName, const QByteArray &data)
+{
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_1);
+
+    quint32 magic;
+    quint16 version;
+    in >> magic >> version;
+    if (version > GRAPH_FILE_VERSION)
+    {
+        myError = QString("%1: graph file version %2 is newer than supported version %3")
+                .arg(fileName).arg(version).arg(GRAPH_FILE_VERSION);
+        return false;
+    }
+
+    // Counts are checked against file size, so broken file can not make
+    // huge allocations. Every string takes at least 4 bytes.
+    quint32 stringCount;
+    in >> stringCount;
+    if (in.status() != QDataStream::Ok || stringCount > (quint32)data.size() / 4)
+    {
+        myError = fileName + ": broken string table";
+        return false;
+    }
+    QVector<QString> strings(stringCount);
+    for (quint32 i = 0; i < stringCount; i++)
+        in >> strings[i];
+
+    bool ok = true;
+    auto string = [&](quint32 i) -> QString {
+        if (i >= stringCount)
+        {
+            ok = false;
+            return QString();
+        }
+        return strings.at(i);
+    };
+
+    quint32 nodeCount;
+    in >> nodeCount;
+    if (in.status() != QDataStream::Ok || nodeCount > (quint32)data.size() / 4)
+    {
+        myError = fileName + ": broken node list";
+        return false;
+    }
+    nodes.reserve(nodeCount);
+    QSet<int> ids;
+    for (quint32 i = 0; i < nodeCount && ok && in.status() == QDataStream::Ok; i++)
+    {
+        qint32 id;
+        quint32 op, name, knobCount;
+        double x, y;
+        quint8 flags;
+        in >> id >> op >> name >> x >> y >> flags >> knobCount;
+
+        GraphFileNode n;
+        n.id = id;
+        n.op = string(op);
+        n.name = string(name);
+        n.pos = QPointF(x, y);
+        n.disabled = flags & 1;
+        if (knobCount > (quint32)data.size() / 8 || ids.contains(id))
+            ok = false;
+        for (quint32 k = 0; k < knobCount && ok; k++)
+        {
+            quint32 label, value;
+            in >> label >> value;
+            n.knobs << qMakePair(string(label), string(value));
+        }
+        ids.insert(id);
+        nodes << n;
+    }
+    if (!ok || in.status() != QDataStream::Ok)
+    {
+        myError = fileName + ": broken node list";
+        return false;
+    }
+
+    quint32 edgeCount;
+    in >> edgeCount;
+    if (in.status() != QDataStream::Ok || edgeCount > (quint32)data.size() / 12)
+    {
+        myError = fileName + ": broken edge list";
+        return false;
+    }
+    edges.reserve(edgeCount);
+    for (quint32 i = 0; i < edgeCount; i++)
+    {
+        qint32 source, dest, input;
+        in >> source >> dest >> input;
+        GraphFileEdge e;
+        e.source = source;
+        e.dest = dest;
+        e.input = input;
+        edges << e;
+    }
+    if (in.status() != QDataStream::Ok)
+    {
+        myError = fileName + ": file is truncated";
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Check that edges connect existing nodes.
+ * \param fileName Path of graph file, used in error messages.
+ * \return True if all edges are valid.
+ */
+bool GraphFile::checkEdges(QString fileName)
+{
+    QSet<int> ids;
+    foreach (const GraphFileNode &n, nodes)
+        ids.insert(n.id);
+    foreach (const GraphFileEdge &e, edges) {
+        if (!ids.contains(e.source) || !ids.contains(e.dest))
+        {
+            myError = QString("%1: edge %2 -> %3 refers to missing node").arg(fileName).arg(e.source).arg(e.dest);
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Write graph to file.
+ * \param fileName Path of graph file.
+ * \param format File format, see GRAPH_FORMAT_* in pirilib.h
+ * \return True on success, see getError() otherwise.
+ */
+bool GraphFile::write(QString fileName, int format)
+{
+    QFile file(fileName);
+    QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Truncate;
+    if (format == GRAPH_FORMAT_TEXT)
+        mode |= QIODevice::Text;
+    if (!file.open(mode))
+    {
+        myError = "Can not write " + fileName;
+        return false;
+    }
+
+    bool ok = format == GRAPH_FORMAT_TEXT ? writeText(&file) : writeBinary(&file);
+    if (!ok || file.error() != QFile::NoError)
+    {
+        myError = "Can not write " + fileName;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Write text form of graph file.
+ * \param file Open file.
+ * \return True on success.
+ */
+bool GraphFile::writeText(QFile *file)
+{
+    QTextStream out(file);
+    out.setCodec("UTF-8");
+    out << "# Piri graph\n";
+    out << "version " << GRAPH_FILE_VERSION << "\n";
+    foreach (GraphFileNode n, nodes) {
+        out << "node " << n.id << " " << quote(n.op) << " " << quote(n.name)
+            << " " << QString::number(n.pos.x(), 'g', 17) << " " << QString::number(n.pos.y(), 'g', 17) << "\n";
+        for (int i = 0; i < n.knobs.count(); i++)
+            out << "knob " << n.id << " " << quote(n.knobs.at(i).first) << " " << quote(n.knobs.at(i).second) << "\n";
+        if (n.disabled)
+            out << "disable " << n.id << "\n";
+    }
+    foreach (GraphFileEdge e, edges) {
+        out << "edge " << e.source << " " << e.dest << " " << e.input << "\n";
+    }
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
+
+/*!
+ * \brief Write binary form of graph file.
+ *
+ * Body is written first, so string table is complete when it is written
+ * before body.
+ * \param file Open file.
+ * \return True on success.
+ */
+bool GraphFile::writeBinary(QFile *file)
+{
+    QStringList strings;
+    QHash<QString, quint32> index;
+    auto string = [&](const QString &s) -> quint32 {
+        QHash<QString, quint32>::const_iterator i = index.constFind(s);
+        if (i != index.constEnd())
+            return i.value();
+        quint32 n = strings.count();
+        index.insert(s, n);
+        strings << s;
+        return n;
+    };
+
+    QByteArray body;
+    QDataStream b(&body, QIODevice::WriteOnly);
+    b.setVersion(QDataStream::Qt_5_1);
+    b << (quint32)nodes.count();
+    foreach (const GraphFileNode &n, nodes) {
+        b << (qint32)n.id << string(n.op) << string(n.name) << n.pos.x() << n.pos.y()
+          << (quint8)(n.disabled ? 1 : 0) << (quint32)n.knobs.count();
+        for (int i = 0; i < n.knobs.count(); i++)
+            b << string(n.knobs.at(i).first) << string(n.knobs.at(i).second);
+    }
+    b << (quint32)edges.count();
+    foreach (const GraphFileEdge &e, edges)
+        b << (qint32)e.source << (qint32)e.dest << (qint32)e.input;
+
+    QDataStream out(file);
+    out.setVersion(QDataStream::Qt_5_1);
+    out << binaryMagic << (quint16)GRAPH_FILE_VERSION << (quint32)strings.count();
+    foreach (const QString &s, strings)
+        out << s;
+    out.writeRawData(body.constData(), body.size());
+    return out.status() == QDataStream::Ok;
+}
+
+/*!
+ * \brief Find node by id or by name.
+ * \param idOrName Node id as string or node name.
+ * \return Index in nodes or -1 if not found.
+ */
+int GraphFile::findNode(QString idOrName)
+{
+    bool isId;
+    int id = idOrName.toInt(&isId);
+    for (int i = 0; i < nodes.count(); i++)
+    {
+        if ((isId && nodes.at(i).id == id) || nodes.at(i).name == idOrName)
+            return i;
+    }
+    return -1;
+}
@@ -0,0 +1,65 @@
+#ifndef GRAPHFILE_H
+#define GRAPHFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QPointF>
+
+#include "pirilib.h"
+
+class QFile;
+
+/*!
+ * \brief Node as stored in graph file.
+ *
+ * Knob values are kept as strings, they are converted when knobs are set.
+ */
+struct GraphFileNode {
+    int id;
+    QString op; /*!< Op name from op descriptor. */
+    QString name; /*!< Node name. */
+    QPointF pos;
+    bool disabled;
+    QList<QPair<QString, QString> > knobs; /*!< Knob labels and values. */
+};
+
+/*!
+ * \brief Edge as stored in graph file.
+ */
+struct GraphFileEdge {
+    int source; /*!< Source node id. */
+    int dest; /*!< Destination node id. */
+    int input; /*!< Input of destination node, 0 is main input. */
+};
+
+class PIRILIBSHARED_EXPORT GraphFile
+{
+public:
+    GraphFile();
+
+    bool read(QString fileName);
+    bool write(QString fileName, int format = GRAPH_FORMAT_BINARY);
+    int getFormat() { return myFormat; }
+    QString getError() { return myError; }
+
+    QList<GraphFileNode> nodes;
+    QList<GraphFileEdge> edges;
+
+    int findNode(QString idOrName);
+
+private:
+    bool readText(QString fileName);
+    bool readBinary(QString fileName, const QByteArray &data);
+    bool writeText(QFile *file);
+    bool writeBinary(QFile *file);
+    bool checkEdges(QString fileName);
+    static QStringList tokenize(QString line);
+    static QString quote(QString text);
+
+    int myFormat; /*!< Format of last read file, see GRAPH_FORMAT_* in pirilib.h */
+    QString myError; /*!< Last error. */
+};
+
+#endif // GRAPHFILE_H
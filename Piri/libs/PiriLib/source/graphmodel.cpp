@@ -0,0 +1,887 @@
+#include "graphmodel.h"
+#include "interfaces.h"
+#include "knobcallback.h"
+#include "op.h"
+#include "nativebackend.h"
+#include "graphfile.h"
+#include "pluginmanifest.h"
+#include "hasher.h"
+#include "resultcache.h"
+#include "evalprofiler.h"
+
+#include <QPair>
+#include <QtDebug>
+
+namespace {
+
+/*!
+ * \brief Stream that records batches of one node to profiler.
+ *
+ * Result stream of node is timed and its rows are counted as rows out.
+ * Input streams of node are only counted, as rows in.
+ */
+class ProfiledStream : public TableStream
+{
+public:
+    ProfiledStream(EvalProfiler *profiler, int id, const GraphNode &node, TableStreamPtr stream, bool input)
+        : myProfiler(profiler), myId(id), myName(node.name), myOp(node.descriptor->name),
+          myStream(stream), myInput(input) {}
+
+    TablePtr next()
+    {
+        if (!myInput)
+            myProfiler->begin(myId, myName, myOp, "stream");
+        TablePtr batch = myStream->next();
+        if (!myInput)
+            myProfiler->end();
+
+        if (!batch)
+            myError = myStream->getError();
+        else if (myInput)
+            myProfiler->addRows(myId, batch->rowCount(), 0, batch->byteSize(), 0);
+        else
+            myProfiler->addRows(myId, 0, batch->rowCount(), 0, batch->byteSize());
+        return batch;
+    }
+
+private:
+    EvalProfiler *myProfiler;
+    int myId;
+    QString myName;
+    QString myOp;
+    TableStreamPtr myStream;
+    bool myInput;
+};
+
+}
+
+
+/*!
+ * \brief Graph model constructor.
+ *
+ * Graph model holds graph topology and node ops without any widgets or
+ * graphics items. Nodes are kept in one array and inputs of all nodes in
+ * another, node id is index in node array. Node graph scene is a view
+ * over model, headless runner uses model directly.
+ */
+GraphModel::GraphModel()
+{
+    myProfiler = 0;
+}
+
+/*!
+ * \brief Graph model destructor. Deletes node ops and callbacks.
+ */
+GraphModel::~GraphModel()
+{
+    clear();
+}
+
+/*!
+ * \brief Add node to model.
+ *
+ * Model takes ownership of op. Input slots are made for maxInputs of op.
+ * \param op Op instance of node.
+ * \param name Node name.
+ * \return Node id.
+ */
+int GraphModel::addNode(OpInterfaceMI *op, QString name)
+{
+    GraphNode n;
+    n.op = op;
+    n.callback = 0;
+    n.descriptor = op->descriptor();
+    n.name = name;
+    n.disabled = false;
+    n.firstInput = myInputs.count();
+    n.inputCount = n.descriptor->maxInputs;
+    myInputs.insert(myInputs.count(), n.inputCount, -1);
+    myNodes << n;
+
+    int id = myNodes.count() - 1;
+    Op *o = dynamic_cast<Op*>(op);
+    if (o)
+        o->setModel(this, id);
+    return id;
+}
+
+/*!
+ * \brief Remove node from model.
+ *
+ * Deletes node op and callback. All inputs connected to node are
+ * disconnected. Node slot is left empty so other ids stay valid.
+ * \param id Node id.
+ */
+void GraphModel::removeNode(int id)
+{
+    if (!isValid(id))
+        return;
+    GraphNode &n = myNodes[id];
+    delete n.op;
+    delete n.callback;
+    n.op = 0;
+    n.callback = 0;
+    for (int i = 0; i < myInputs.count(); i++)
+    {
+        if (myInputs.at(i) == id)
+            myInputs[i] = -1;
+    }
+    for (int i = 0; i < n.inputCount; i++)
+        myInputs[n.firstInput + i] = -1;
+}
+
+/*!
+ * \brief Remove all nodes from model.
+ */
+void GraphModel::clear()
+{
+    for (int i = 0; i < myNodes.count(); i++)
+    {
+        delete myNodes.at(i).op;
+        delete myNodes.at(i).callback;
+    }
+    myNodes.clear();
+    myInputs.clear();
+}
+
+/*!
+ * \brief Is there a node with this id?
+ * \param id Node id.
+ * \return True if node exists.
+ */
+bool GraphModel::isValid(int id) const
+{
+    return id >= 0 && id < myNodes.count() && myNodes.at(id).op;
+}
+
+/*!
+ * \brief Get ids of all nodes.
+ * \return Node ids in creation order.
+ */
+QVector<int> GraphModel::nodeIds() const
+{
+    QVector<int> ids;
+    for (int i = 0; i < myNodes.count(); i++)
+    {
+        if (myNodes.at(i).op)
+            ids << i;
+    }
+    return ids;
+}
+
+/*!
+ * \brief Find node by name.
+ * \param name Node name.
+ * \return Node id or -1.
+ */
+int GraphModel::findNode(QString name) const
+{
+    for (int i = 0; i < myNodes.count(); i++)
+    {
+        if (myNodes.at(i).op && myNodes.at(i).name == name)
+            return i;
+    }
+    return -1;
+}
+
+/*!
+ * \brief Set node knob callback. Model takes ownership of callback.
+ *
+ * Knob values are kept in op, so old callback can be replaced and is
+ * deleted.
+ * \param id Node id.
+ * \param callback Knob callback.
+ */
+void GraphModel::setCallback(int id, KnobCallback *callback)
+{
+    if (!isValid(id) || myNodes.at(id).callback == callback)
+        return;
+    delete myNodes.at(id).callback;
+    myNodes[id].callback = callback;
+}
+
+/*!
+ * \brief Set node name.
+ * \param id Node id.
+ * \param name New name.
+ */
+void GraphModel::setName(int id, QString name)
+{
+    if (isValid(id))
+        myNodes[id].name = name;
+}
+
+/*!
+ * \brief Set node position in node graph.
+ * \param id Node id.
+ * \param pos Position.
+ */
+void GraphModel::setPos(int id, QPointF pos)
+{
+    if (isValid(id))
+        myNodes[id].pos = pos;
+}
+
+/*!
+ * \brief Set node disabled state.
+ * \param id Node id.
+ * \param disabled Is node disabled?
+ */
+void GraphModel::setDisabled(int id, bool disabled)
+{
+    if (isValid(id))
+        myNodes[id].disabled = disabled;
+}
+
+/*!
+ * \brief Connect node input.
+ * \param dest Destination node id.
+ * \param input Input slot of destination node, 0 is main input.
+ * \param source Source node id, -1 disconnects input.
+ */
+void GraphModel::setInput(int dest, int input, int source)
+{
+    if (!isValid(dest) || input < 0 || input >= myNodes.at(dest).inputCount)
+        return;
+    if (source >= 0 && !isValid(source))
+        source = -1;
+    myInputs[myNodes.at(dest).firstInput + input] = source;
+}
+
+/*!
+ * \brief Get node connected to input.
+ * \param dest Destination node id.
+ * \param input Input slot.
+ * \return Source node id or -1.
+ */
+int GraphModel::inputNode(int dest, int input) const
+{
+    if (!isValid(dest) || input < 0 || input >= myNodes.at(dest).inputCount)
+        return -1;
+    return myInputs.at(myNodes.at(dest).firstInput + input);
+}
+
+/*!
+ * \brief Get node that really gives data to input.
+ *
+ * Disabled nodes pass their main input through, so they are skipped.
+ * \param dest Destination node id.
+ * \param input Input slot.
+ * \return Source node id or -1.
+ */
+int GraphModel::resolveInput(int dest, int input) const
+{
+    int source = inputNode(dest, input);
+    int guard = myNodes.count();
+    while (source >= 0 && myNodes.at(source).disabled && guard-- > 0)
+        source = inputNode(source, 0);
+    return source;
+}
+
+/*!
+ * \brief Get nodes that use node as input.
+ * \param id Node id.
+ * \return Ids of output nodes.
+ */
+QVector<int> GraphModel::outputs(int id) const
+{
+    QVector<int> result;
+    for (int n = 0; n < myNodes.count(); n++)
+    {
+        const GraphNode &node = myNodes.at(n);
+        if (!node.op)
+            continue;
+        for (int i = 0; i < node.inputCount; i++)
+        {
+            if (myInputs.at(node.firstInput + i) == id)
+            {
+                result << n;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+/*!
+ * \brief Get node and all nodes above it in execution order.
+ *
+ * Every node is listed once, after all its inputs. Uses iterative depth
+ * first search, so deep graphs do not grow call stack.
+ * \param id Node id.
+ * \return Node ids, empty if graph has cycle (see getError()).
+ */
+QVector<int> GraphModel::upstream(int id)
+{
+    QVector<int> order;
+    if (!isValid(id))
+        return order;
+
+    // 0 - not visited, 1 - on stack, 2 - done
+    QVector<char> state(myNodes.count(), 0);
+    QVector<QPair<int, int> > stack; // node id, next input to visit
+    stack << qMakePair(id, 0);
+    state[id] = 1;
+    while (!stack.isEmpty())
+    {
+        int current = stack.last().first;
+        int input = stack.last().second;
+        const GraphNode &n = myNodes.at(current);
+        if (input < n.inputCount)
+        {
+            stack.last().second++;
+            int source = myInputs.at(n.firstInput + input);
+            if (source < 0 || state.at(source) == 2)
+                continue;
+            if (state.at(source) == 1)
+            {
+                myError = "Graph has a cycle at node " + myNodes.at(source).name;
+                return QVector<int>();
+            }
+            state[source] = 1;
+            stack << qMakePair(source, 0);
+        } else {
+            state[current] = 2;
+            order << current;
+            stack.removeLast();
+        }
+    }
+    return order;
+}
+
+/*!
+ * \brief Calculate node hash.
+ *
+ * Node hash is based on op name, the hash of knob callback and hashes
+ * of all nodes above this one. If something changes up in node tree,
+ * hash also changes.
+ * \param id Node id.
+ * \return Hash, null hash if there is no such node.
+ */
+Hash128 GraphModel::hash(int id)
+{
+    QVector<Hash128> memo(myNodes.count());
+    QVector<char> state(myNodes.count(), 0);
+    return hash(id, &memo, &state);
+}
+
+/*!
+ * \brief Calculate node hash, every node is hashed once per call.
+ * \param id Node id.
+ * \param memo Hashes calculated so far, index is node id.
+ * \param state 0 - not hashed, 1 - in progress, 2 - hashed.
+ * \return Hash
+ */
+Hash128 GraphModel::hash(int id, QVector<Hash128> *memo, QVector<char> *state)
+{
+    if (!isValid(id))
+        return Hash128();
+    // Node in progress is part of cycle, it can not recurse forever
+    if (state->at(id))
+        return memo->at(id);
+
+    (*state)[id] = 1;
+    const GraphNode &n = myNodes.at(id);
+    Hasher hasher;
+    hasher.addString(n.descriptor->name);
+    // Disabled nodes pass data through, so they do not change hash
+    for (int i = 0; i < n.inputCount; i++)
+    {
+        hasher.addInt(i);
+        hasher.addHash(hash(resolveInput(id, i), memo, state));
+    }
+    if (n.callback)
+        hasher.addHash(n.callback->getHash());
+    (*memo)[id] = hasher.result();
+    (*state)[id] = 2;
+    return memo->at(id);
+}
+
+/*!
+ * \brief Generate MapBasic commands for node.
+ *
+ * Commands of all nodes above node are generated first. Disabled nodes
+ * do not generate commands, nodes below them use their input instead.
+ * With profiler, engine() of every node is timed.
+ * \param id Node id.
+ * \param nodes Returns node id of every command, can be 0.
+ * \return Commands in execution order.
+ */
+QStringList GraphModel::commands(int id, QVector<int> *nodes)
+{
+    QStringList result;
+    if (nodes)
+        nodes->clear();
+    foreach (int n, upstream(id)) {
+        const GraphNode &node = myNodes.at(n);
+        if (node.disabled)
+            continue;
+        if (myProfiler)
+            myProfiler->begin(n, node.name, node.descriptor->name, "engine");
+        QString command = node.op->engine();
+        if (myProfiler)
+            myProfiler->end();
+        if (!command.trimmed().isEmpty())
+        {
+            result << command;
+            if (nodes)
+                *nodes << n;
+        }
+    }
+    return result;
+}
+
+/*!
+ * \brief Evaluate node with native backend.
+ *
+ * Every node above node is run once, in execution order, and whole result
+ * of every node is kept in memory. With result cache, nodes whose result
+ * is cached are loaded from cache and nodes above them are not run at all.
+ * New results are stored to cache.
+ * \param id Node id.
+ * \param backend Native backend.
+ * \param cache Result cache or 0.
+ * \return Result or null pointer on error, see getError().
+ */
+TablePtr GraphModel::evaluate(int id, NativeBackend *backend, ResultCache *cache)
+{
+    QVector<TablePtr> results;
+    QVector<TableStreamPtr> streams;
+    if (!run(id, backend, cache, 0, &results, &streams))
+        return TablePtr();
+    return results.at(id);
+}
+
+/*!
+ * \brief Evaluate node with native backend as stream.
+ *
+ * Ops that can stream are chained, so rows go from source to result in
+ * batches and only few batches of every node are in memory at once. Ops
+ * that can not stream and nodes read by many nodes are run on whole
+ * tables. Only these whole results are stored to cache.
+ *
+ * Nothing is read before result stream is read. Model and its ops have to
+ * stay unchanged until then.
+ * \param id Node id.
+ * \param backend Native backend.
+ * \param cache Result cache or 0.
+ * \param batchRows Rows in one batch.
+ * \return Result stream or null pointer on error, see getError().
+ */
+TableStreamPtr GraphModel::evaluateStream(int id, NativeBackend *backend, ResultCache *cache, int batchRows)
+{
+    QVector<TablePtr> results;
+    QVector<TableStreamPtr> streams;
+    if (!run(id, backend, cache, qMax(1, batchRows), &results, &streams))
+        return TableStreamPtr();
+    if (results.at(id))
+        return TableStreamPtr(new TableSliceStream(results.at(id), batchRows));
+    return streams.at(id);
+}
+
+/*!
+ * \brief Make execution plan of node without running anything.
+ *
+ * Plan lists all nodes above node in execution order with command that
+ * node generates and what evaluation would do with it. Cache is only
+ * checked, results are not loaded. Cost is time of node in last profiled
+ * evaluation, or time kept from earlier run (see EvalProfiler::loadTimes()),
+ * so plan of big graph can be checked before it is run.
+ * \param id Node id.
+ * \param cache Result cache or 0.
+ * \param batchRows Rows in one batch, 0 if nodes are not streamed.
+ * \return Plan steps in execution order, empty if there is no such node.
+ */
+QList<PlanStep> GraphModel::plan(int id, ResultCache *cache, int batchRows)
+{
+    QList<PlanStep> steps;
+    QVector<int> order = upstream(id);
+    if (order.isEmpty())
+        return steps;
+
+    QVector<Hash128> hashes;
+    QVector<char> needed;
+    QVector<char> cached;
+    QVector<int> readers;
+    markNeeded(id, order, cache, 0, &hashes, &needed, &cached, &readers);
+    QVector<Hash128> memo(myNodes.count());
+    QVector<char> hashState(myNodes.count(), 0);
+
+    foreach (int n, order) {
+        const GraphNode &node = myNodes.at(n);
+        PlanStep step;
+        step.node = n;
+        step.name = node.name;
+        step.op = node.descriptor->name;
+        step.hash = hash(n, &memo, &hashState);
+        step.streamed = false;
+        step.cost = -1.0;
+        if (node.disabled)
+            step.action = PLAN_ACTION_DISABLED;
+        else if (!needed.at(n))
+            step.action = PLAN_ACTION_SKIPPED;
+        else if (cached.at(n))
+            step.action = PLAN_ACTION_CACHED;
+        else
+            step.action = PLAN_ACTION_RUN;
+
+        if (!node.disabled)
+            step.command = node.op->engine().trimmed();
+        if (step.action == PLAN_ACTION_RUN)
+        {
+            step.streamed = batchRows > 0 && readers.at(n) <= 1
+                    && dynamic_cast<OpInterfaceStream*>(node.op) != 0;
+            if (myProfiler && myProfiler->contains(n))
+                step.cost = myProfiler->node(n).time / 1000000.0;
+            else if (myProfiler)
+                step.cost = myProfiler->savedTime(node.name);
+        }
+        steps << step;
+    }
+    return steps;
+}
+
+/*!
+ * \brief Format execution plan as text, one line per node.
+ * \param plan Plan steps
+ * \return Plan as text
+ */
+QString GraphModel::planText(const QList<PlanStep> &plan)
+{
+    static const char *actions[] = { "run", "cached", "skipped", "disabled" };
+    QStringList lines;
+    int run = 0;
+    int cached = 0;
+    double cost = 0.0;
+    bool costKnown = true;
+    foreach (const PlanStep &step, plan) {
+        QString action = actions[qBound(0, step.action, 3)];
+        if (step.streamed)
+            action += " stream";
+        QString line = QString("%1 %2 %3 %4 %5")
+                .arg(step.node, 4)
+                .arg(step.name.left(20), -20)
+                .arg(step.op.left(12), -12)
+                .arg(action, -14)
+                .arg(step.cost >= 0 ? QString::number(step.cost, 'f', 2) + " ms" : QString("-"), 10);
+        lines << line + "  " + step.hash.toHex();
+        if (!step.command.isEmpty())
+            lines << "         " + step.command.simplified();
+
+        if (step.action == PLAN_ACTION_RUN)
+        {
+            run++;
+            if (step.cost >= 0)
+                cost += step.cost;
+            else
+                costKnown = false;
+        } else if (step.action == PLAN_ACTION_CACHED) {
+            cached++;
+        }
+    }
+    lines << QString("%1 nodes, %2 to run, %3 cached, estimated %4")
+             .arg(plan.count()).arg(run).arg(cached)
+             .arg(costKnown ? QString::number(cost, 'f', 2) + " ms" : QString("cost unknown"));
+    return lines.join("\n");
+}
+
+/*!
+ * \brief Can result of node be kept in result cache?
+ *
+ * Output ops are run for their side effect, writing files, so they are
+ * always run and never served from cache. Disabled nodes only pass
+ * input through.
+ * \param id Node id.
+ * \return True if result can be loaded from and stored to cache.
+ */
+bool GraphModel::isCacheable(int id) const
+{
+    const GraphNode &node = myNodes.at(id);
+    return !node.disabled && QString(node.descriptor->menuClass) != "Output";
+}
+
+/*!
+ * \brief Find nodes that have to run for node result.
+ *
+ * Walks from node up, inputs of cached nodes are not needed. Readers are
+ * counted, because stream can be read only once.
+ * \param id Node id.
+ * \param order Nodes above node in execution order, see upstream().
+ * \param cache Result cache or 0.
+ * \param results Cached results are loaded here. If 0, cache is only checked.
+ * \param hashes Returns node hashes, calculated only with cache.
+ * \param needed Returns 1 for nodes whose result is needed.
+ * \param cached Returns 1 for needed nodes whose result is cached.
+ * \param readers Returns number of needed nodes that read node result.
+ */
+void GraphModel::markNeeded(int id, const QVector<int> &order, ResultCache *cache, QVector<TablePtr> *results,
+                            QVector<Hash128> *hashes, QVector<char> *needed, QVector<char> *cached,
+                            QVector<int> *readers)
+{
+    QVector<char> hashState(myNodes.count(), 0);
+    hashes->fill(Hash128(), myNodes.count());
+    needed->fill(0, myNodes.count());
+    cached->fill(0, myNodes.count());
+    readers->fill(0, myNodes.count());
+    (*needed)[id] = 1;
+    (*readers)[id] = 1;
+    for (int k = order.count() - 1; k >= 0; k--)
+    {
+        int n = order.at(k);
+        const GraphNode &node = myNodes.at(n);
+        if (!needed->at(n))
+            continue;
+        if (cache && isCacheable(n))
+        {
+            Hash128 h = hash(n, hashes, &hashState);
+            if (!results)
+            {
+                (*cached)[n] = cache->contains(h);
+            } else {
+                if (myProfiler)
+                    myProfiler->begin(n, node.name, node.descriptor->name, "cache");
+                (*results)[n] = cache->load(h);
+                (*cached)[n] = !results->at(n).isNull();
+                if (myProfiler)
+                {
+                    myProfiler->end();
+                    myProfiler->setCache(n, cached->at(n) ? PROFILE_CACHE_HIT : PROFILE_CACHE_MISS);
+                    if (cached->at(n))
+                        myProfiler->addRows(n, 0, results->at(n)->rowCount(), 0, results->at(n)->byteSize());
+                }
+            }
+            if (cached->at(n))
+                continue;
+        }
+        // Disabled node only passes main input through
+        int inputs = node.disabled ? qMin(1, node.inputCount) : node.inputCount;
+        for (int i = 0; i < inputs; i++)
+        {
+            int source = myInputs.at(node.firstInput + i);
+            if (source >= 0)
+            {
+                (*needed)[source] = 1;
+                (*readers)[source]++;
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Run all nodes needed for node result.
+ * \param id Node id.
+ * \param backend Native backend.
+ * \param cache Result cache or 0.
+ * \param batchRows Rows in one batch, 0 if nodes are not streamed.
+ * \param results Returns whole results, index is node id.
+ * \param streams Returns result streams, index is node id.
+ * \return True on success, see getError() otherwise.
+ */
+bool GraphModel::run(int id, NativeBackend *backend, ResultCache *cache, int batchRows,
+                     QVector<TablePtr> *results, QVector<TableStreamPtr> *streams)
+{
+    QVector<int> order = upstream(id);
+    if (order.isEmpty())
+        return false;
+
+    results->fill(TablePtr(), myNodes.count());
+    streams->fill(TableStreamPtr(), myNodes.count());
+    QVector<Hash128> hashes;
+    QVector<char> needed;
+    QVector<char> cached;
+    QVector<int> readers;
+    markNeeded(id, order, cache, results, &hashes, &needed, &cached, &readers);
+
+    foreach (int n, order) {
+        const GraphNode &node = myNodes.at(n);
+        if (!needed.at(n) || results->at(n))
+            continue;
+
+        if (batchRows > 0 && backend->canStream(node.op, node.disabled))
+        {
+            QList<TableStreamPtr> inputs;
+            for (int i = 0; i < node.inputCount; i++)
+            {
+                int source = myInputs.at(node.firstInput + i);
+                TableStreamPtr input;
+                if (source >= 0 && results->at(source))
+                    input = TableStreamPtr(new TableSliceStream(results->at(source), batchRows));
+                else if (source >= 0)
+                    input = streams->at(source);
+                if (myProfiler && input)
+                    input = TableStreamPtr(new ProfiledStream(myProfiler, n, node, input, true));
+                inputs << input;
+            }
+            TableStreamPtr stream = backend->stream(node.op, inputs, node.disabled, batchRows);
+            if (!stream)
+            {
+                myError = backend->getError() + " (node " + node.name + ")";
+                return false;
+            }
+            if (myProfiler)
+                stream = TableStreamPtr(new ProfiledStream(myProfiler, n, node, stream, false));
+            if (readers.at(n) <= 1)
+            {
+                (*streams)[n] = stream;
+                continue;
+            }
+            // Result read by many nodes is read into memory once
+            TablePtr result = stream->readAll();
+            if (!result)
+            {
+                myError = stream->getError() + " (node " + node.name + ")";
+                return false;
+            }
+            (*results)[n] = result;
+        } else {
+            QList<TablePtr> inputs;
+            for (int i = 0; i < node.inputCount; i++)
+            {
+                int source = myInputs.at(node.firstInput + i);
+                if (source >= 0 && !results->at(source) && streams->at(source))
+                {
+                    TableStreamPtr stream = streams->at(source);
+                    (*streams)[source].clear();
+                    (*results)[source] = stream->readAll();
+                    if (!results->at(source))
+                    {
+                        myError = stream->getError() + " (node " + myNodes.at(source).name + ")";
+                        return false;
+                    }
+                }
+                inputs << (source >= 0 ? results->at(source) : TablePtr());
+            }
+
+            if (myProfiler)
+                myProfiler->begin(n, node.name, node.descriptor->name, "run");
+            TablePtr result = backend->run(node.op, inputs, node.disabled);
+            if (myProfiler)
+                myProfiler->end();
+            if (!result)
+            {
+                myError = backend->getError() + " (node " + node.name + ")";
+                return false;
+            }
+            if (myProfiler)
+            {
+                foreach (TablePtr input, inputs) {
+                    if (input)
+                        myProfiler->addRows(n, input->rowCount(), 0, input->byteSize(), 0);
+                }
+                myProfiler->addRows(n, 0, result->rowCount(), 0, result->byteSize());
+            }
+            (*results)[n] = result;
+        }
+        if (cache && isCacheable(n))
+        {
+            if (myProfiler)
+                myProfiler->begin(n, node.name, node.descriptor->name, "store");
+            if (!cache->store(hashes.at(n), results->at(n)))
+                qWarning() << cache->getError();
+            if (myProfiler)
+                myProfiler->end();
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Store model to graph file.
+ *
+ * Node ids in file are model ids.
+ * \param file Graph file to fill.
+ */
+void GraphModel::save(GraphFile *file) const
+{
+    file->nodes.clear();
+    file->edges.clear();
+    for (int id = 0; id < myNodes.count(); id++)
+    {
+        const GraphNode &node = myNodes.at(id);
+        if (!node.op)
+            continue;
+
+        GraphFileNode n;
+        n.id = id;
+        n.op = node.descriptor->name;
+        n.name = node.name;
+        n.pos = node.pos;
+        n.disabled = node.disabled;
+        if (node.callback)
+        {
+            foreach (KnobStruct* ks, node.callback->getKnobs())
+                n.knobs << qMakePair(ks->label, node.callback->getValue(ks->label).toString());
+        }
+        file->nodes << n;
+
+        for (int i = 0; i < node.inputCount; i++)
+        {
+            int source = myInputs.at(node.firstInput + i);
+            if (source < 0)
+                continue;
+            GraphFileEdge e;
+            e.source = source;
+            e.dest = id;
+            e.input = i;
+            file->edges << e;
+        }
+    }
+}
+
+/*!
+ * \brief Load model from graph file.
+ *
+ * Ops are created from plugins in manifest. Callbacks have no parent node
+ * and no panel, so no widgets are made. Nodes get ids in file order, so
+ * node id is index in file nodes.
+ * \param file Graph file.
+ * \param manifest Plugin manifest.
+ * \return True on success, see getError() otherwise.
+ */
+bool GraphModel::load(const GraphFile &file, PluginManifest *manifest)
+{
+    clear();
+
+    QHash<QString, QString> plugins; // op name -> plugin file
+    foreach (PluginEntry entry, manifest->entries()) {
+        if (!entry.opName.isEmpty())
+            plugins.insert(entry.opName, entry.fileName);
+    }
+
+    QHash<int, int> ids; // file id -> model id
+    foreach (const GraphFileNode &n, file.nodes) {
+        if (!plugins.contains(n.op))
+        {
+            myError = QString("No plugin for op %1 (node %2)").arg(n.op).arg(n.name);
+            return false;
+        }
+        OpInterfaceMI *factory = manifest->loadOp(plugins.value(n.op));
+        if (!factory)
+        {
+            myError = manifest->getError();
+            return false;
+        }
+
+        OpInterfaceMI *op = factory->create();
+        int id = addNode(op, n.name);
+        KnobCallback *callback = new KnobCallback();
+        Op *o = dynamic_cast<Op*>(op);
+        if (o)
+            o->setCallback(callback);
+        op->knobs(callback);
+        setCallback(id, callback);
+        for (int i = 0; i < n.knobs.count(); i++)
+        {
+            if (!callback->setValue(n.knobs.at(i).first, n.knobs.at(i).second))
+                qWarning() << "Node" << n.name << "has no knob" << n.knobs.at(i).first;
+        }
+        setPos(id, n.pos);
+        setDisabled(id, n.disabled);
+        ids.insert(n.id, id);
+    }
+
+    foreach (const GraphFileEdge &e, file.edges) {
+        setInput(ids.value(e.dest, -1), e.input, ids.value(e.source, -1));
+    }
+    return true;
+}
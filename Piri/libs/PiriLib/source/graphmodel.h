@@ -0,0 +1,113 @@
+#ifndef GRAPHMODEL_H
+#define GRAPHMODEL_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QPointF>
+
+#include "pirilib.h"
+#include "table.h"
+#include "tablestream.h"
+#include "hasher.h"
+
+class OpInterfaceMI;
+class KnobCallback;
+class NativeBackend;
+class ResultCache;
+class EvalProfiler;
+class GraphFile;
+class PluginManifest;
+struct OpDescriptor;
+
+/*!
+ * \brief Node in graph model.
+ *
+ * Node id is index in model node array. Removed nodes leave empty slot
+ * (op is 0), so ids stay valid.
+ */
+struct GraphNode {
+    OpInterfaceMI* op; /*!< Node op, owned by model. 0 if slot is free. */
+    KnobCallback* callback; /*!< Knob callback, owned by model. */
+    const OpDescriptor* descriptor; /*!< Op descriptor. */
+    QString name;
+    QPointF pos;
+    bool disabled;
+    int firstInput; /*!< Index of first input slot in model input array. */
+    int inputCount; /*!< Number of input slots, maxInputs of op. */
+};
+
+/*!
+ * \brief One node in execution plan.
+ */
+struct PlanStep {
+    int node; /*!< Node id. */
+    QString name; /*!< Node name. */
+    QString op; /*!< Op name. */
+    int action; /*!< What evaluation does with node, see PLAN_ACTION_* in pirilib.h */
+    bool streamed; /*!< Is node run as stream? */
+    QString command; /*!< MapBasic command of node, empty for disabled nodes. */
+    Hash128 hash; /*!< Node hash, key of result cache. */
+    double cost; /*!< Time in last profiled or earlier run in ms, -1 if not known. */
+};
+
+class PIRILIBSHARED_EXPORT GraphModel
+{
+public:
+    GraphModel();
+    ~GraphModel();
+
+    int addNode(OpInterfaceMI *op, QString name);
+    void removeNode(int id);
+    void clear();
+    bool isValid(int id) const;
+    const GraphNode& node(int id) const { return myNodes.at(id); }
+    int nodeCount() const { return myNodes.count(); }
+    QVector<int> nodeIds() const;
+    int findNode(QString name) const;
+
+    void setCallback(int id, KnobCallback *callback);
+    void setName(int id, QString name);
+    void setPos(int id, QPointF pos);
+    void setDisabled(int id, bool disabled);
+
+    void setInput(int dest, int input, int source);
+    int inputNode(int dest, int input) const;
+    int resolveInput(int dest, int input) const;
+    QVector<int> outputs(int id) const;
+
+    QVector<int> upstream(int id);
+    Hash128 hash(int id);
+
+    QStringList commands(int id, QVector<int> *nodes = 0);
+    TablePtr evaluate(int id, NativeBackend *backend, ResultCache *cache = 0);
+    TableStreamPtr evaluateStream(int id, NativeBackend *backend, ResultCache *cache = 0,
+                                  int batchRows = STREAM_BATCH_ROWS);
+    QList<PlanStep> plan(int id, ResultCache *cache = 0, int batchRows = STREAM_BATCH_ROWS);
+    static QString planText(const QList<PlanStep> &plan);
+
+    void save(GraphFile *file) const;
+    bool load(const GraphFile &file, PluginManifest *manifest);
+
+    void setProfiler(EvalProfiler *profiler) { myProfiler = profiler; }
+    EvalProfiler* getProfiler() { return myProfiler; }
+
+    QString getError() { return myError; }
+
+private:
+    Hash128 hash(int id, QVector<Hash128> *memo, QVector<char> *state);
+    bool isCacheable(int id) const;
+    void markNeeded(int id, const QVector<int> &order, ResultCache *cache, QVector<TablePtr> *results,
+                    QVector<Hash128> *hashes, QVector<char> *needed, QVector<char> *cached,
+                    QVector<int> *readers);
+    bool run(int id, NativeBackend *backend, ResultCache *cache, int batchRows,
+             QVector<TablePtr> *results, QVector<TableStreamPtr> *streams);
+
+    QVector<GraphNode> myNodes; /*!< Nodes, index is node id. */
+    QVector<int> myInputs; /*!< Source node id of every input slot, -1 if not connected. */
+    EvalProfiler* myProfiler; /*!< Profiler of evaluation, not owned. 0 if not profiled. */
+    QString myError; /*!< Last error. */
+};
+
+#endif // GRAPHMODEL_H
@@ -0,0 +1,290 @@
+#include "hasher.h"
+
+#include <string.h>
+#include <QtEndian>
+
+// Type tags of canonical encoding
+#define HASH_TAG_INT    2
+#define HASH_TAG_BOOL   3
+#define HASH_TAG_DOUBLE 4
+#define HASH_TAG_STRING 5
+#define HASH_TAG_HASH   6
+
+// Q_FALLTHROUGH is in Qt 5.8 and later
+#ifndef Q_FALLTHROUGH
+#if defined(__GNUC__) && __GNUC__ >= 7
+#define Q_FALLTHROUGH() __attribute__((fallthrough))
+#else
+#define Q_FALLTHROUGH() (void)0
+#endif
+#endif
+
+static const quint64 c1 = Q_UINT64_C(0x87c37b91114253d5);
+static const quint64 c2 = Q_UINT64_C(0x4cf5ad432745937f);
+
+static inline quint64 rotl64(quint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline quint64 fmix64(quint64 k)
+{
+    k ^= k >> 33;
+    k *= Q_UINT64_C(0xff51afd7ed558ccd);
+    k ^= k >> 33;
+    k *= Q_UINT64_C(0xc4ceb9fe1a85ec53);
+    k ^= k >> 33;
+    return k;
+}
+
+
+/*!
+ * \brief Hasher constructor.
+ *
+ * Hash function is MurmurHash3 x64 128 with seed 0, fed in streaming
+ * way. Result is same as hashing all added bytes at once.
+ */
+Hasher::Hasher()
+{
+    myH1 = 0;
+    myH2 = 0;
+    myTailLength = 0;
+    myLength = 0;
+}
+
+/*!
+ * \brief Mix one 16 byte block into state.
+ * \param block Block, read as two little endian 64 bit words.
+ */
+void Hasher::mixBlock(const uchar *block)
+{
+    quint64 k1 = qFromLittleEndian<quint64>(block);
+    quint64 k2 = qFromLittleEndian<quint64>(block + 8);
+
+    k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; myH1 ^= k1;
+    myH1 = rotl64(myH1, 27); myH1 += myH2; myH1 = myH1 * 5 + 0x52dce729;
+
+    k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; myH2 ^= k2;
+    myH2 = rotl64(myH2, 31); myH2 += myH1; myH2 = myH2 * 5 + 0x38495ab5;
+}
+
+/*!
+ * \brief Add raw bytes.
+ *
+ * Bytes are not tagged, use typed functions for values.
+ * \param data Bytes
+ * \param length Number of bytes
+ */
+void Hasher::addBytes(const void *data, int length)
+{
+    const uchar *p = (const uchar *)data;
+    myLength += length;
+
+    if (myTailLength > 0)
+    {
+        int n = qMin(16 - myTailLength, length);
+        memcpy(myTail + myTailLength, p, n);
+        myTailLength += n;
+        p += n;
+        length -= n;
+        if (myTailLength < 16)
+            return;
+        mixBlock(myTail);
+        myTailLength = 0;
+    }
+    while (length >= 16)
+    {
+        mixBlock(p);
+        p += 16;
+        length -= 16;
+    }
+    memcpy(myTail, p, length);
+    myTailLength = length;
+}
+
+/*!
+ * \brief Add tag byte and value bytes.
+ * \param tag Type tag
+ * \param data Value bytes in canonical order.
+ * \param length Number of bytes
+ */
+void Hasher::addTagged(uchar tag, const void *data, int length)
+{
+    addBytes(&tag, 1);
+    addBytes(data, length);
+}
+
+/*!
+ * \brief Add integer. All integer types are hashed as 64 bit.
+ * \param value Value
+ */
+void Hasher::addInt(qint64 value)
+{
+    uchar b[8];
+    qToLittleEndian<qint64>(value, b);
+    addTagged(HASH_TAG_INT, b, 8);
+}
+
+/*!
+ * \brief Add boolean.
+ * \param value Value
+ */
+void Hasher::addBool(bool value)
+{
+    uchar b = value ? 1 : 0;
+    addTagged(HASH_TAG_BOOL, &b, 1);
+}
+
+/*!
+ * \brief Add floating point number.
+ *
+ * Negative zero is hashed as zero and all NaNs as one NaN, so equal
+ * numbers give equal hash.
+ * \param value Value
+ */
+void Hasher::addDouble(double value)
+{
+    if (value == 0.0)
+        value = 0.0;
+    quint64 bits;
+    if (value != value)
+        bits = Q_UINT64_C(0x7ff8000000000000);
+    else
+        memcpy(&bits, &value, 8);
+    uchar b[8];
+    qToLittleEndian<quint64>(bits, b);
+    addTagged(HASH_TAG_DOUBLE, b, 8);
+}
+
+/*!
+ * \brief Add string.
+ *
+ * String is hashed as length and UTF-16 code units, so "ab" + "c" and
+ * "a" + "bc" give different hash.
+ * \param value Value
+ */
+void Hasher::addString(const QString &value)
+{
+    uchar b[4];
+    qToLittleEndian<quint32>(value.length(), b);
+    addTagged(HASH_TAG_STRING, b, 4);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    addBytes(value.constData(), value.length() * 2);
+#else
+    for (int i = 0; i < value.length(); i++)
+    {
+        uchar c[2];
+        qToLittleEndian<quint16>(value.at(i).unicode(), c);
+        addBytes(c, 2);
+    }
+#endif
+}
+
+/*!
+ * \brief Add other hash, for example hash of input node.
+ * \param value Hash
+ */
+void Hasher::addHash(const Hash128 &value)
+{
+    uchar b[16];
+    qToLittleEndian<quint64>(value.low, b);
+    qToLittleEndian<quint64>(value.high, b + 8);
+    addTagged(HASH_TAG_HASH, b, 16);
+}
+
+/*!
+ * \brief Get hash of values added so far.
+ *
+ * Hasher can be used further after this.
+ * \return Hash, low half is first 64 bits of MurmurHash3 output.
+ */
+Hash128 Hasher::result() const
+{
+    quint64 h1 = myH1;
+    quint64 h2 = myH2;
+    quint64 k1 = 0;
+    quint64 k2 = 0;
+    const uchar *tail = myTail;
+
+    switch (myTailLength) {
+    case 15: k2 ^= quint64(tail[14]) << 48;
+             Q_FALLTHROUGH();
+    case 14: k2 ^= quint64(tail[13]) << 40;
+             Q_FALLTHROUGH();
+    case 13: k2 ^= quint64(tail[12]) << 32;
+             Q_FALLTHROUGH();
+    case 12: k2 ^= quint64(tail[11]) << 24;
+             Q_FALLTHROUGH();
+    case 11: k2 ^= quint64(tail[10]) << 16;
+             Q_FALLTHROUGH();
+    case 10: k2 ^= quint64(tail[9]) << 8;
+             Q_FALLTHROUGH();
+    case 9:  k2 ^= quint64(tail[8]);
+             k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+             Q_FALLTHROUGH();
+    case 8:  k1 ^= quint64(tail[7]) << 56;
+             Q_FALLTHROUGH();
+    case 7:  k1 ^= quint64(tail[6]) << 48;
+             Q_FALLTHROUGH();
+    case 6:  k1 ^= quint64(tail[5]) << 40;
+             Q_FALLTHROUGH();
+    case 5:  k1 ^= quint64(tail[4]) << 32;
+             Q_FALLTHROUGH();
+    case 4:  k1 ^= quint64(tail[3]) << 24;
+             Q_FALLTHROUGH();
+    case 3:  k1 ^= quint64(tail[2]) << 16;
+             Q_FALLTHROUGH();
+    case 2:  k1 ^= quint64(tail[1]) << 8;
+             Q_FALLTHROUGH();
+    case 1:  k1 ^= quint64(tail[0]);
+             k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= myLength;
+    h2 ^= myLength;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+    return Hash128(h1, h2);
+}
+
+
+/*!
+ * \brief Combine two hashes. Order matters, a.combine(b) != b.combine(a).
+ * \param other Hash to combine with.
+ * \return Combined hash
+ */
+Hash128 Hash128::combine(const Hash128 &other) const
+{
+    Hasher hasher;
+    hasher.addHash(*this);
+    hasher.addHash(other);
+    return hasher.result();
+}
+
+/*!
+ * \brief Get hash as hex string, for table names.
+ *
+ * Bytes are written in same order as MurmurHash3 reference output.
+ * \return 32 hex characters.
+ */
+QString Hash128::toHex() const
+{
+    static const char digits[] = "0123456789abcdef";
+    QString hex(32, Qt::Uninitialized);
+    QChar *out = hex.data();
+    quint64 halves[2] = { low, high };
+    for (int h = 0; h < 2; h++)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            uchar b = (halves[h] >> (i * 8)) & 0xff;
+            *out++ = QLatin1Char(digits[b >> 4]);
+            *out++ = QLatin1Char(digits[b & 15]);
+        }
+    }
+    return hex;
+}
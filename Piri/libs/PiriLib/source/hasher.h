@@ -0,0 +1,66 @@
+#ifndef HASHER_H
+#define HASHER_H
+
+#include <QString>
+
+#include "pirilib_global.h"
+
+/*!
+ * \brief 128 bit content hash.
+ *
+ * Node and knob hashes are kept as binary values. Hex string is made
+ * only when hash is used in table name.
+ */
+struct PIRILIBSHARED_EXPORT Hash128 {
+    quint64 low; /*!< First 64 bits. */
+    quint64 high; /*!< Last 64 bits. */
+
+    Hash128() : low(0), high(0) {}
+    Hash128(quint64 l, quint64 h) : low(l), high(h) {}
+
+    bool isNull() const { return low == 0 && high == 0; }
+    bool operator==(const Hash128 &other) const { return low == other.low && high == other.high; }
+    bool operator!=(const Hash128 &other) const { return !(*this == other); }
+
+    Hash128 combine(const Hash128 &other) const;
+    QString toHex() const;
+};
+
+inline uint qHash(const Hash128 &hash, uint seed = 0)
+{
+    return uint(hash.low ^ (hash.low >> 32)) ^ seed;
+}
+
+/*!
+ * \brief Fast 128 bit hasher for node and knob hashes.
+ *
+ * Values are fed with typed add functions. Every value is written with a
+ * type tag and fixed byte order, so same values always give same hash and
+ * values of different types do not collide.
+ */
+class PIRILIBSHARED_EXPORT Hasher
+{
+public:
+    Hasher();
+
+    void addBytes(const void *data, int length);
+    void addInt(qint64 value);
+    void addBool(bool value);
+    void addDouble(double value);
+    void addString(const QString &value);
+    void addHash(const Hash128 &value);
+
+    Hash128 result() const;
+
+private:
+    void addTagged(uchar tag, const void *data, int length);
+    void mixBlock(const uchar *block);
+
+    quint64 myH1; /*!< First half of state. */
+    quint64 myH2; /*!< Second half of state. */
+    uchar myTail[16]; /*!< Bytes not yet mixed, less than one block. */
+    int myTailLength; /*!< Number of bytes in myTail. */
+    quint64 myLength; /*!< Total number of bytes added. */
+};
+
+#endif // HASHER_H
@@ -5,6 +5,9 @@
 
 #include "pirilib.h"
 #include "knobcallback.h"
+#include "opdescriptor.h"
+#include "table.h"
+#include "tablestream.h"
 
 QT_BEGIN_NAMESPACE
 class QString;
@@ -12,19 +15,47 @@ class QStringList;
 QT_END_NAMESPACE
 
 // Kõik funktsioonid peavad olema "pure virtual", ehk siis lõpus = 0 !!! Muidu tuleb jama.
+// Plugin instance loaded by QPluginLoader is only a factory. Every node gets
+// its own op from create(), so knob values are not shared between nodes.
 class PIRILIBSHARED_EXPORT OpInterfaceMI
 {
 public:
     virtual ~OpInterfaceMI() {}
+    virtual OpInterfaceMI* create() = 0;
     virtual QString engine() = 0;
     virtual void knobs(KnobCallback* f) = 0;
-    virtual QString description() = 0;
+    virtual const OpDescriptor* descriptor() = 0;
+};
+
+// Ops that can run without MapInfo also implement native interface. Inputs
+// are results of input nodes in input order, null pointer is returned on error.
+class PIRILIBSHARED_EXPORT OpInterfaceNative
+{
+public:
+    virtual ~OpInterfaceNative() {}
+    virtual TablePtr run(QList<TablePtr> inputs) = 0;
+};
+
+// Row-wise ops can also implement streaming interface. Op gets streams of
+// input nodes and returns stream of its result, rows are pulled from inputs
+// only when result is read. Stream may use op until it is read to end.
+class PIRILIBSHARED_EXPORT OpInterfaceStream
+{
+public:
+    virtual ~OpInterfaceStream() {}
+    virtual TableStreamPtr stream(QList<TableStreamPtr> inputs, int batchRows) = 0;
 };
 
 QT_BEGIN_NAMESPACE
 
-#define OpInterfaceMI_iid "Kaldera.Piri.v01.OpInterfaceMI"
+#define OpInterfaceMI_iid "Kaldera.Piri.v03.OpInterfaceMI"
 Q_DECLARE_INTERFACE(OpInterfaceMI, OpInterfaceMI_iid)
 
+#define OpInterfaceNative_iid "Kaldera.Piri.v01.OpInterfaceNative"
+Q_DECLARE_INTERFACE(OpInterfaceNative, OpInterfaceNative_iid)
+
+#define OpInterfaceStream_iid "Kaldera.Piri.v01.OpInterfaceStream"
+Q_DECLARE_INTERFACE(OpInterfaceStream, OpInterfaceStream_iid)
+
 QT_END_NAMESPACE
 #endif // INTERFACES_H
@@ -1,72 +1,72 @@
 #include "knobcallback.h"
+#include "knobpanel.h"
 #include "node.h"
 #include "nodegraph.h"
 #include "mainwindow.h"
 #include "knobs.h"
+#include "hasher.h"
 
 #include <QtDebug>
 
 
+/*!
+ * \brief Knob callback constructor.
+ *
+ * Knob callback holds knobs of one op. It only keeps the connection between
+ * knob labels and op members, widgets are made only if callback has a panel.
+ * Callback without parent node is used when graph is run headless.
+ * \param parent Parent node or 0.
+ */
 KnobCallback::KnobCallback(Node *parent)
 {
     myParent = parent;
-    myHash = "no_hash";
-    setFocusPolicy(Qt::WheelFocus);
-
-    makeKnobs();
+    myPanel = 0;
 }
 
-
-void KnobCallback::makeKnobs()
+/*!
+ * \brief Knob callback destructor. Deletes knob structures.
+ */
+KnobCallback::~KnobCallback()
 {
+    qDeleteAll(knobs);
+    knobs.clear();
+}
 
-    // Header bar
-    QLineEdit *nodeName = new QLineEdit(myParent->getName());
-    QPushButton *buttonh = new QPushButton("?");
-    QPushButton *buttonx = new QPushButton("✕");
-
-    buttonh->setFixedWidth(25);
-    buttonh->setToolTip(myParent->getDesc());
-    buttonx->setFixedWidth(25);
-    connect(buttonx, SIGNAL(clicked()), this, SLOT(hide()));
-    connect(nodeName, SIGNAL(textChanged(QString)), this, SLOT(nodeNameChanged(QString)));
-
-    QWidget *header = new QWidget();
-    QHBoxLayout* hLayout = new QHBoxLayout;
-    hLayout->setMargin(0);
-    header->setLayout(hLayout);
-    hLayout->addWidget(nodeName);
-    hLayout->addWidget(buttonh);
-    hLayout->addWidget(buttonx);
-
-    // Widgetid, mis kirjeldavad erinevaid knobide tab'e
-    QWidget *knobArea = new QWidget();
-    QWidget *notesArea = new QWidget();
-    QWidget *metadataArea = new QWidget();
-    QWidget *userKnobArea = new QWidget();
-
-    // Knobide ala layout - vormilayout, mis jaotab üksteise alla label-widget põhimõttel
-    QFormLayout *layout = new QFormLayout;
-    layout->setMargin(20);
-    knobArea->setLayout(layout);
-    myLayout = layout;
-
-    // Tabwidget mis hoiab erinevaid knobide tab'e
-    QTabWidget *propTab = new QTabWidget;
-    //propTab->addTab(vGroupBox, "Knobs");
-    propTab->addTab(knobArea, "Knobs");
-    propTab->addTab(metadataArea, "Metadata");
-    propTab->addTab(notesArea, "Notes");
-    propTab->addTab(userKnobArea, "User");
-    propTab->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Minimum);
+/*!
+ * \brief Set panel that makes knob widgets.
+ *
+ * Setting panel to 0 forgets knob widgets, knob values stay connected.
+ * \param panel Knob panel or 0.
+ */
+void KnobCallback::setPanel(KnobPanel *panel)
+{
+    myPanel = panel;
+    if (!panel)
+    {
+        foreach (KnobStruct *kn, knobs)
+            kn->widget = 0;
+    }
+}
 
-    // Kogu ühe sõlme andmete hoidjawidget ja selle layout
-    QVBoxLayout *mainLayout = new QVBoxLayout;
-    mainLayout->addWidget(header);
-    mainLayout->addWidget(propTab);
-    //mainLayout->setSizePolicy(QSizePolicy::Expanding);
-    this->setLayout(mainLayout);
+/*!
+ * \brief Set parent node of callback.
+ *
+ * Callback made without node, for example when graph is loaded, gets
+ * its node when node graph shows it.
+ * \param parent Parent node.
+ */
+void KnobCallback::setParentNode(Node *parent)
+{
+    myParent = parent;
+}
 
+/*!
+ * \brief Get panel that shows knob widgets.
+ * \return Knob panel or 0.
+ */
+KnobPanel* KnobCallback::getPanel()
+{
+    return myPanel;
 }
 
 /*!
@@ -77,16 +77,21 @@ void KnobCallback::makeKnobs()
  */
 void KnobCallback::nodeNameChanged(QString name)
 {
-    myParent->setName(name);
+    if (myParent)
+        myParent->setName(name);
 }
 
 /*!
  * \brief Get callback layout that holds knobs.
- * \return Layout as QFormLayout
+ *
+ * Knob functions make widgets only if there is a layout.
+ * \return Layout as QFormLayout or 0 if callback has no panel.
  */
 QFormLayout *KnobCallback::getLayout()
 {
-    return myLayout;
+    if (myPanel)
+        return myPanel->getLayout();
+    return 0;
 }
 
 /*!
@@ -100,17 +105,36 @@ Node* KnobCallback::getParent()
 
 /*!
  * \brief Creates new knob structure and adds it to knob list "knobs"
- * \param knob Knob widget
+ *
+ * If knob with same label exists, it is connected to new value.
  * \param label Knob label
- * \param value Knob value as QVariant
+ * \param type Knob type
+ * \param value Op member connected to knob
  */
-void KnobCallback::addKnob(QWidget* knob, QString label, QVariant* value)
+void KnobCallback::addKnob(QString label, int type, void* value)
 {
-    KnobStruct *kn = new KnobStruct;
-    kn->widget = knob;
-    kn->label = label;
+    KnobStruct *kn = getKnob(label);
+    if (!kn)
+    {
+        kn = new KnobStruct;
+        kn->widget = 0;
+        kn->label = label;
+        knobs << kn;
+    }
+    kn->type = type;
     kn->value = value;
-    knobs << kn;
+}
+
+/*!
+ * \brief Set widget of knob
+ * \param label Knob label
+ * \param widget Knob widget
+ */
+void KnobCallback::setKnobWidget(QString label, QWidget* widget)
+{
+    KnobStruct *kn = getKnob(label);
+    if (kn)
+        kn->widget = widget;
 }
 
 
@@ -129,26 +153,137 @@ KnobStruct* KnobCallback::getKnob(QString knobLabel)
 }
 
 /*!
- * \brief Get callback hash
+ * \brief Get all knobs of callback
+ * \return List of knob structures
+ */
+QList<KnobStruct*> KnobCallback::getKnobs()
+{
+    return knobs;
+}
+
+/*!
+ * \brief Get knob value
+ * \param knobLabel Knob label
+ * \return Value as QVariant, invalid if there is no such knob.
+ */
+QVariant KnobCallback::getValue(QString knobLabel)
+{
+    KnobStruct *kn = getKnob(knobLabel);
+    if (!kn)
+        return QVariant();
+
+    switch (kn->type) {
+    case KNOB_TYPE_STRING:
+    case KNOB_TYPE_FILE:
+        return *(QString*)kn->value;
+    case KNOB_TYPE_INTEGER:
+    case KNOB_TYPE_COMBOBOX:
+        return *(int*)kn->value;
+    case KNOB_TYPE_BOOL:
+        return *(bool*)kn->value;
+    default:
+        return QVariant();
+    }
+}
+
+/*!
+ * \brief Set knob value
  *
- * Calls all knobs and adds their hash values. In the end calculates
- * new hash from this.
- * \return Callback hash
+ * Sets op member connected to knob. If knob has widget, widget is
+ * updated too.
+ * \param knobLabel Knob label
+ * \param value New value
+ * \return True if knob was found and value could be converted.
  */
-QString KnobCallback::getHash()
+bool KnobCallback::setValue(QString knobLabel, QVariant value)
 {
-    QString hashString;
-    foreach (KnobStruct *ks, knobs) {
-        QWidget* w = ks->widget;
+    KnobStruct *kn = getKnob(knobLabel);
+    if (!kn)
+        return false;
+
+    bool ok = true;
+    switch (kn->type) {
+    case KNOB_TYPE_STRING:
+    case KNOB_TYPE_FILE:
+        *(QString*)kn->value = value.toString();
+        break;
+    case KNOB_TYPE_INTEGER:
+    case KNOB_TYPE_COMBOBOX:
+        *(int*)kn->value = value.toInt(&ok);
+        break;
+    case KNOB_TYPE_BOOL:
+        *(bool*)kn->value = value.toBool();
+        break;
+    default:
+        ok = false;
+    }
 
-        KnobBase* kb = dynamic_cast<KnobBase*>(w);
-        if (kb)
-        {
-            hashString += kb->getHash();
+    KnobBase* kb = dynamic_cast<KnobBase*>(kn->widget);
+    if (kb)
+        kb->refresh();
+    return ok;
+}
+
+/*!
+ * \brief Add knob value to hasher.
+ *
+ * Each knob type has its own canonical encoding, integer knobs are hashed
+ * as integers and not as text. File knobs also hash size and modification
+ * time of all files with same base name (.TAB, .DAT, .MAP, ...), so hash
+ * changes when data on disk changes.
+ * \param hasher Hasher
+ * \param type Knob type, see KNOB_TYPE_* in pirilib.h
+ * \param value Op member connected to knob.
+ */
+void KnobCallback::hashValue(Hasher *hasher, int type, const void *value)
+{
+    hasher->addInt(type);
+    switch (type) {
+    case KNOB_TYPE_STRING:
+        hasher->addString(*(const QString*)value);
+        break;
+    case KNOB_TYPE_FILE:
+    {
+        const QString &path = *(const QString*)value;
+        hasher->addString(path);
+        if (path.isEmpty())
+            break;
+        QFileInfo info(path);
+        QStringList filter(info.completeBaseName() + ".*");
+        foreach (QFileInfo f, info.dir().entryInfoList(filter, QDir::Files, QDir::Name)) {
+            hasher->addString(f.suffix().toLower());
+            hasher->addInt(f.size());
+            hasher->addInt(f.lastModified().toMSecsSinceEpoch());
         }
+        break;
+    }
+    case KNOB_TYPE_INTEGER:
+    case KNOB_TYPE_COMBOBOX:
+        hasher->addInt(*(const int*)value);
+        break;
+    case KNOB_TYPE_BOOL:
+        hasher->addBool(*(const bool*)value);
+        break;
+    default:
+        break;
+    }
+}
 
+/*!
+ * \brief Get callback hash
+ *
+ * Hash is calculated from knob labels and values, not from widgets, so
+ * it is the same whether knob panel is open or not.
+ * \return Callback hash
+ */
+Hash128 KnobCallback::getHash()
+{
+    Hasher hasher;
+    foreach (KnobStruct *ks, knobs) {
+        hasher.addString(ks->label);
+        hashValue(&hasher, ks->type, ks->value);
     }
-    myHash = QString(QCryptographicHash::hash(hashString.toLatin1(),QCryptographicHash::Md5).toHex());
+    myHash = hasher.result();
     return myHash;
 }
 
@@ -157,7 +292,8 @@ QString KnobCallback::getHash()
  */
 void KnobCallback::valueChanged()
 {
-    myParent->getParent()->evaluate();
+    if (myParent)
+        myParent->getParent()->evaluate();
 }
 
 /*!
@@ -170,10 +306,17 @@ void KnobCallback::updateKnobs()
 
 /*!
  * \brief Show error on statusbar and add it to messagelog
+ *
+ * Without parent node error goes to debug output.
  * \param msg Message as Qstring
  */
 void KnobCallback::showError(QString msg)
 {
-    myParent->getParent()->getParent()->logMessage(msg);
+    if (!myParent)
+    {
+        qWarning() << msg;
+        return;
+    }
+    myParent->getParent()->getParent()->logMessage(msg, LOG_LEVEL_ERROR);
     myParent->getParent()->getParent()->statusBar()->showMessage(msg);
 }
@@ -4,30 +4,41 @@
 #include <QtWidgets>
 
 #include "pirilib.h"
+#include "hasher.h"
 
 struct KnobStruct {
-    QWidget* widget;
+    QWidget* widget; /*!< Knob widget, 0 if callback has no panel. */
     QString label;
-    QVariant* value;
-    QString* hash;
+    int type; /*!< Knob type, see KNOB_TYPE_* in pirilib.h */
+    void* value; /*!< Op member connected to knob, type depends on knob type. */
 };
 
 class Node;
+class KnobPanel;
 
-class PIRILIBSHARED_EXPORT KnobCallback : public QWidget
+class PIRILIBSHARED_EXPORT KnobCallback : public QObject
 {
     Q_OBJECT
 public:
-    KnobCallback(Node* parent);
+    KnobCallback(Node* parent = 0);
+    ~KnobCallback();
 
-    void makeKnobs();
+    void setPanel(KnobPanel* panel);
+    KnobPanel* getPanel();
     QFormLayout *getLayout();
     Node* getParent();
+    void setParentNode(Node* parent);
 
-    void addKnob(QWidget* knob, QString label, QVariant *value);
+    void addKnob(QString label, int type, void* value);
+    void setKnobWidget(QString label, QWidget* widget);
     KnobStruct* getKnob(QString knobLabel);
+    QList<KnobStruct*> getKnobs();
 
-    QString getHash();
+    QVariant getValue(QString knobLabel);
+    bool setValue(QString knobLabel, QVariant value);
+
+    Hash128 getHash();
+    static void hashValue(Hasher *hasher, int type, const void *value);
 
     void showError(QString msg);
 
@@ -37,11 +48,10 @@ public slots:
     void nodeNameChanged(QString name); /*! Called when node name is changed */
 
 private:
-    QFormLayout* myLayout; /*! Callback layout that holds knobs */
-    Node* myParent; /*! Parent node of this callback */
+    Node* myParent; /*! Parent node of this callback, 0 when running headless */
+    KnobPanel* myPanel; /*! Widget that shows knobs, 0 when running headless */
     QList<KnobStruct*> knobs; /*! List of knobs in this callback */
-    QString myHash; /*! Hash of this callback, calculated from knob values*/
-    QString topHash; /*! Hash of whole node tree above parent node of this callback */
+    Hash128 myHash; /*! Hash of this callback, calculated from knob values*/
 
 };
 
@@ -0,0 +1,93 @@
+#include "knobpanel.h"
+#include "knobcallback.h"
+#include "node.h"
+
+
+/*!
+ * \brief Knob panel constructor.
+ *
+ * Knob panel is the widget that shows knobs of one node in properties
+ * view. Knob values live in op, panel only shows them.
+ * \param callback Knob callback of node.
+ */
+KnobPanel::KnobPanel(KnobCallback *callback)
+{
+    myCallback = callback;
+    setFocusPolicy(Qt::WheelFocus);
+
+    makeKnobs();
+}
+
+
+/*!
+ * \brief Makes panel header and knob tabs.
+ *
+ * Knob widgets are added to layout by knob functions.
+ */
+void KnobPanel::makeKnobs()
+{
+    Node* node = myCallback->getParent();
+
+    // Header bar
+    QLineEdit *nodeName = new QLineEdit(node->getName());
+    QPushButton *buttonh = new QPushButton("?");
+    QPushButton *buttonx = new QPushButton("✕");
+
+    buttonh->setFixedWidth(25);
+    buttonh->setToolTip(node->getDesc());
+    buttonx->setFixedWidth(25);
+    connect(buttonx, SIGNAL(clicked()), this, SLOT(hide()));
+    connect(nodeName, SIGNAL(textChanged(QString)), myCallback, SLOT(nodeNameChanged(QString)));
+
+    QWidget *header = new QWidget();
+    QHBoxLayout* hLayout = new QHBoxLayout;
+    hLayout->setMargin(0);
+    header->setLayout(hLayout);
+    hLayout->addWidget(nodeName);
+    hLayout->addWidget(buttonh);
+    hLayout->addWidget(buttonx);
+
+    // Widgetid, mis kirjeldavad erinevaid knobide tab'e
+    QWidget *knobArea = new QWidget();
+    QWidget *notesArea = new QWidget();
+    QWidget *metadataArea = new QWidget();
+    QWidget *userKnobArea = new QWidget();
+
+    // Knobide ala layout - vormilayout, mis jaotab üksteise alla label-widget põhimõttel
+    QFormLayout *layout = new QFormLayout;
+    layout->setMargin(20);
+    knobArea->setLayout(layout);
+    myLayout = layout;
+
+    // Tabwidget mis hoiab erinevaid knobide tab'e
+    QTabWidget *propTab = new QTabWidget;
+    propTab->addTab(knobArea, "Knobs");
+    propTab->addTab(metadataArea, "Metadata");
+    propTab->addTab(notesArea, "Notes");
+    propTab->addTab(userKnobArea, "User");
+    propTab->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Minimum);
+
+    // Kogu ühe sõlme andmete hoidjawidget ja selle layout
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addWidget(header);
+    mainLayout->addWidget(propTab);
+    this->setLayout(mainLayout);
+}
+
+/*!
+ * \brief Get panel layout that holds knobs.
+ * \return Layout as QFormLayout
+ */
+QFormLayout *KnobPanel::getLayout()
+{
+    return myLayout;
+}
+
+/*!
+ * \brief Get knob callback shown in panel.
+ * \return Knob callback
+ */
+KnobCallback* KnobPanel::getCallback()
+{
+    return myCallback;
+}
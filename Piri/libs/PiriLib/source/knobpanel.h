@@ -0,0 +1,26 @@
+#ifndef KNOBPANEL_H
+#define KNOBPANEL_H
+
+#include <QtWidgets>
+
+#include "pirilib.h"
+
+class KnobCallback;
+
+class PIRILIBSHARED_EXPORT KnobPanel : public QWidget
+{
+    Q_OBJECT
+public:
+    KnobPanel(KnobCallback* callback);
+
+    QFormLayout *getLayout();
+    KnobCallback* getCallback();
+
+private:
+    void makeKnobs();
+
+    QFormLayout* myLayout; /*! Panel layout that holds knobs */
+    KnobCallback* myCallback; /*! Callback whose knobs are shown */
+};
+
+#endif // KNOBPANEL_H
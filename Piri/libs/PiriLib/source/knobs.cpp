@@ -6,6 +6,7 @@
 #include <QObject>
 
 #include "knobs.h"
+#include "hasher.h"
 
 /*!
  * \brief Adds values to last widget in callback.
@@ -17,6 +18,8 @@
  */
 void ADD_VALUES(KnobCallback *f, QString str)
 {
+    if (!f->getLayout())
+        return;
     QWidget *last = f->getLayout()->itemAt(f->getLayout()->rowCount()*2-1)->widget();
     for (int i = 1; i <= f->getLayout()->rowCount(); i++)
     {
@@ -70,14 +73,27 @@ void UPDATE(KnobCallback *f, QWidget* widget, QString str)
 }
 
 
+/*!
+ * \brief Knob base constructor.
+ *
+ * Hash is empty until knob sets it from its value.
+ */
 KnobBase::KnobBase()
 {
-    hash();
 }
 
-void KnobBase::hash()
+/*!
+ * \brief Set knob hash from knob value.
+ *
+ * Same typed encoding is used as in KnobCallback::getHash().
+ * \param type Knob type, see KNOB_TYPE_* in pirilib.h
+ * \param value Variable connected to knob.
+ */
+void KnobBase::setHash(int type, const void *value)
 {
-    _myHash = "tere";
+    Hasher hasher;
+    KnobCallback::hashValue(&hasher, type, value);
+    _myHash = hasher.result();
 }
 
 
@@ -96,10 +112,12 @@ STRING
  */
 StringKnob* String_knob(KnobCallback *f, QString *value, QString label)
 {
-    //qDebug() << "String knob: " << value << *value << label << value->toString();
+    f->addKnob(label, KNOB_TYPE_STRING, value);
+    if (!f->getLayout())
+        return 0;
     StringKnob *knob = new StringKnob(f, value, label);
     f->getLayout()->addRow(label, knob);
-    f->addKnob(knob, label, (QVariant*)value);
+    f->setKnobWidget(label, knob);
     knob->setToolTip(label.replace(":", "").toLower());
     return knob;
 }
@@ -120,18 +138,18 @@ StringKnob::StringKnob(KnobCallback *f, QString* value, QString label) :
     updateHash();
 }
 
-/*!
- * \brief Get node hash string.
- * \return Hash string.
- */
-QString StringKnob::getHash()
+void StringKnob::updateHash()
 {
-    return _myHash;
+    setHash(KNOB_TYPE_STRING, _myValue);
 }
 
-void StringKnob::updateHash()
+/*!
+ * \brief Reloads widget from variable associated with knob.
+ */
+void StringKnob::refresh()
 {
-    _myHash = generateHash(QString(*_myValue));
+    this->setText(*_myValue);
+    updateHash();
 }
 
 /*!
@@ -161,11 +179,12 @@ INTEGER_KNOB
  */
 IntegerKnob *Integer_knob(KnobCallback *f, int *value, QString label)
 {
-    qDebug() << "Integer knob: " << value << *value << label;
+    f->addKnob(label, KNOB_TYPE_INTEGER, value);
+    if (!f->getLayout())
+        return 0;
     IntegerKnob *knob = new IntegerKnob(f, value, label);
     f->getLayout()->addRow(label, knob);
-    //f->addKnob(knob, label, QString("%1").arg(*value, 0, 'g', 30));
-    f->addKnob(knob, label, (QVariant*)value);
+    f->setKnobWidget(label, knob);
     knob->setToolTip(label.replace(":", "").toLower());
     return knob;
 }
@@ -180,10 +199,11 @@ IntegerKnob *Integer_knob(KnobCallback *f, int *value, QString label)
 IntegerKnob::IntegerKnob(KnobCallback *f, int *value, QString label) :
     _myValue(value)
 {
-    this->setValue(*value);
     this->setMaximumWidth(70);
     this->setMinimumHeight(20);
+    // Range is set first, so value is not clamped to default range
     this->setRange(-100000000, 100000000);
+    this->setValue(*value);
     connect(this, SIGNAL(valueChanged(int)), this, SLOT(updateValue(int)));
     connect(this, SIGNAL(valueChanged(int)), f, SLOT(valueChanged()));
     updateHash();
@@ -198,32 +218,36 @@ IntegerKnob::IntegerKnob(KnobCallback *f, int *value, QString label) :
 IntegerKnob::IntegerKnob(KnobCallback *f, int *value, QString label, int min, int max) :
     _myValue(value)
 {
-    this->setValue(*value);
     this->setMaximumWidth(70);
     this->setMinimumHeight(20);
+    // Range is set first, so value is not clamped to default range
     this->setRange(min, max);
+    this->setValue(*value);
     connect(this, SIGNAL(valueChanged(int)), this, SLOT(updateValue(int)));
     connect(this, SIGNAL(valueChanged(int)), f, SLOT(valueChanged()));
+    updateHash();
 }
 
 /*!
- * \brief Get node hash string.
- * \return Hash string.
+ * \brief Update knob hash after changes.
  */
-QString IntegerKnob::getHash()
+void IntegerKnob::updateHash()
 {
-    return _myHash;
+    setHash(KNOB_TYPE_INTEGER, _myValue);
 }
 
+
 /*!
- * \brief Update knob hash after changes.
+ * \brief Reloads widget from variable connected to knob.
  */
-void IntegerKnob::updateHash()
+void IntegerKnob::refresh()
 {
-    _myHash = generateHash(QString(*_myValue).toLatin1());
+    this->blockSignals(true);
+    this->setValue(*_myValue);
+    this->blockSignals(false);
+    updateHash();
 }
 
-
 /*!
  * \brief Updates variable connected to knob.
  * \param v
@@ -243,10 +267,12 @@ CHECKBOX
 
 CheckBoxKnob *CheckBox_knob(KnobCallback *f, bool *value, QString label)
 {
-    qDebug() << "Checkbox knob: " << value << *value << label;
+    f->addKnob(label, KNOB_TYPE_BOOL, value);
+    if (!f->getLayout())
+        return 0;
     CheckBoxKnob *knob = new CheckBoxKnob(f, value, label);
     f->getLayout()->addRow(label, knob);
-    f->addKnob(knob, label, (QVariant*)value);
+    f->setKnobWidget(label, knob);
     knob->setToolTip(label.replace(":", "").toLower());
     return knob;
 }
@@ -268,6 +294,14 @@ int CheckBoxKnob::value()
     return *_myValue;
 }
 
+void CheckBoxKnob::refresh()
+{
+    this->blockSignals(true);
+    this->setChecked(*_myValue);
+    this->blockSignals(false);
+    updateHash();
+}
+
 void CheckBoxKnob::updateValue(int v)
 {
     *_myValue = this->isChecked();
@@ -283,12 +317,7 @@ void CheckBoxKnob::valueChanged(bool v)
 
 void CheckBoxKnob::updateHash()
 {
-    _myHash = generateHash(QString(*_myValue));
-}
-
-QString CheckBoxKnob::getHash()
-{
-    return _myHash;
+    setHash(KNOB_TYPE_BOOL, _myValue);
 }
 
 /*
@@ -299,10 +328,12 @@ COMBOBOX
 
 ComboBoxKnob* ComboBox_knob(KnobCallback *f, int *value, QString label, QString valueName)
 {
-    qDebug() << "Combobox knob: " << value << *value << label;
+    f->addKnob(label, KNOB_TYPE_COMBOBOX, value);
+    if (!f->getLayout())
+        return 0;
     ComboBoxKnob *knob = new ComboBoxKnob(f, value);
     f->getLayout()->addRow(label, knob);
-    f->addKnob(knob, label, (QVariant*)value);
+    f->setKnobWidget(label, knob);
     knob->setToolTip(valueName);
     return knob;
 }
@@ -317,20 +348,23 @@ ComboBoxKnob::ComboBoxKnob(KnobCallback *f, int* value) :
     updateHash();
 }
 
-void ComboBoxKnob::updateValue(int v)
+void ComboBoxKnob::refresh()
 {
-    *_myValue = this->currentIndex();
+    this->blockSignals(true);
+    this->setCurrentIndex(*_myValue);
+    this->blockSignals(false);
     updateHash();
 }
 
-void ComboBoxKnob::updateHash()
+void ComboBoxKnob::updateValue(int v)
 {
-    _myHash = generateHash(QString(*_myValue));
+    *_myValue = this->currentIndex();
+    updateHash();
 }
 
-QString ComboBoxKnob::getHash()
+void ComboBoxKnob::updateHash()
 {
-    return _myHash;
+    setHash(KNOB_TYPE_COMBOBOX, _myValue);
 }
 
 /*
@@ -341,10 +375,12 @@ FILEOPENDIALOG
 
 FileDialogKnob* FileDialog_knob(KnobCallback *f, QString *value, QString label)
 {
+    f->addKnob(label, KNOB_TYPE_FILE, value);
+    if (!f->getLayout())
+        return 0;
     FileDialogKnob *knob = new FileDialogKnob(f, value);
     f->getLayout()->addRow(label, knob);
-    //f->addKnob(knob, label, *value);
-    f->addKnob(knob, label, (QVariant*)value);
+    f->setKnobWidget(label, knob);
     knob->setToolTip(label.replace(":", "").toLower());
     knob->updateValueFromDialog(*value);
     return knob;
@@ -360,20 +396,35 @@ FileDialogKnob::FileDialogKnob(KnobCallback *f, QString* value) :
     this->setLayout(hLayout);
 
     QPushButton *dlgButton = new QPushButton();
-    QLineEdit *nameknob = new QLineEdit();
-    nameknob->setText(*value);
+    _myLineEdit = new QLineEdit();
+    _myLineEdit->setText(*value);
 
-    hLayout->addWidget(nameknob);
+    hLayout->addWidget(_myLineEdit);
     hLayout->addWidget(dlgButton);
 
     QObject::connect(dlgButton, SIGNAL(clicked()), this, SLOT(getFileName()));
-    QObject::connect(this, SIGNAL(valueUpdated(QString)), nameknob, SLOT(setText(QString)));
+    QObject::connect(this, SIGNAL(valueUpdated(QString)), _myLineEdit, SLOT(setText(QString)));
     QObject::connect(this, SIGNAL(valueUpdated(QString)), this, SLOT(updateHash(QString)));
-    QObject::connect(nameknob, SIGNAL(textChanged(QString)), f, SLOT(valueChanged()));
+    // Value is stored before callback evaluates graph
+    QObject::connect(_myLineEdit, SIGNAL(textChanged(QString)), this, SLOT(updateValueFromDialog(QString)));
+    QObject::connect(_myLineEdit, SIGNAL(textChanged(QString)), f, SLOT(valueChanged()));
     updateHash();
 }
 
 
+/*!
+ * \brief Reloads widget from variable associated with knob.
+ *
+ * Does not emit change signals, so graph is not evaluated again.
+ */
+void FileDialogKnob::refresh()
+{
+    _myLineEdit->blockSignals(true);
+    _myLineEdit->setText(*_myValue);
+    _myLineEdit->blockSignals(false);
+    updateHash();
+}
+
 void FileDialogKnob::updateValueFromDialog(QString s)
 {
     *_myValue = s;
@@ -383,22 +434,19 @@ void FileDialogKnob::updateValueFromDialog(QString s)
 void FileDialogKnob::getFileName()
 {
     QString fname = QFileDialog::getOpenFileName(this, tr("Open File"), "C:/");
+    if (fname.isEmpty())
+        return;
     *_myValue = fname;
     emit valueUpdated(fname);
 }
 
 void FileDialogKnob::updateHash(QString text)
 {
-    _myHash = generateHash(text);
-
+    setHash(KNOB_TYPE_FILE, &text);
 }
 
 void FileDialogKnob::updateHash()
 {
-    _myHash = generateHash(*_myValue);
+    setHash(KNOB_TYPE_FILE, _myValue);
 }
 
-QString FileDialogKnob::getHash()
-{
-    return _myHash;
-}
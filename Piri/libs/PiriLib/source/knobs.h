@@ -8,6 +8,7 @@
 
 #include "pirilib.h"
 #include "knobcallback.h"
+#include "hasher.h"
 
 
 class KnobCallback;
@@ -21,10 +22,13 @@ class PIRILIBSHARED_EXPORT KnobBase
 {
 public:
     KnobBase();
-    virtual QString getHash() { return _myHash; }
+    virtual ~KnobBase() {}
+    Hash128 getHash() { return _myHash; }
+    virtual void refresh() {}
+protected:
+    void setHash(int type, const void *value);
 private:
-    void hash();
-    QString _myHash;
+    Hash128 _myHash; /*!< Hash of knob value. */
 };
 
 class PIRILIBSHARED_EXPORT StringKnob : public QLineEdit, public KnobBase
@@ -33,14 +37,13 @@ class PIRILIBSHARED_EXPORT StringKnob : public QLineEdit, public KnobBase
 public:
     StringKnob(QWidget *parent = 0);
     StringKnob(KnobCallback *f, QString *value, QString label);
-    QString getHash();
+    void refresh();
 
 public slots:
     void updateValue();
 
 private:
     QString* _myValue;
-    QString _myHash;
     void updateHash();
 };
 
@@ -52,7 +55,7 @@ public:
     IntegerKnob(QWidget *parent = 0);
     IntegerKnob(KnobCallback *f, int *value, QString label);
     IntegerKnob(KnobCallback *f, int *value, QString label, int min, int max);
-    QString getHash();
+    void refresh();
 
 
 public slots:
@@ -60,7 +63,6 @@ public slots:
 
 private:
     int* _myValue;
-    QString _myHash;
     void updateHash();
 };
 
@@ -71,7 +73,7 @@ public:
     CheckBoxKnob(QWidget *parent = 0);
     CheckBoxKnob(KnobCallback *f, bool *value, QString label);
     int value();
-    QString getHash();
+    void refresh();
 
 public slots:
     void updateValue(int v);
@@ -79,7 +81,6 @@ public slots:
 
 private:
     bool* _myValue;
-    QString _myHash;
     void updateHash();
 };
 
@@ -89,14 +90,13 @@ class PIRILIBSHARED_EXPORT ComboBoxKnob : public QComboBox, public KnobBase
 public:
     ComboBoxKnob(QWidget *parent = 0);
     ComboBoxKnob(KnobCallback *f, int *value);
-    QString getHash();
+    void refresh();
 
 public slots:
     void updateValue(int v);
 
 private:
     int* _myValue;
-    QString _myHash;
     void updateHash();
 };
 
@@ -106,7 +106,7 @@ class PIRILIBSHARED_EXPORT FileDialogKnob : public QWidget, public KnobBase
 public:
     FileDialogKnob(QWidget *parent = 0);
     FileDialogKnob(KnobCallback *f, QString *value);
-    QString getHash();
+    void refresh();
 
 public slots:
     void updateValueFromDialog(QString s);
@@ -118,7 +118,7 @@ signals:
 
 private:
     QString* _myValue;
-    QString _myHash;
+    QLineEdit* _myLineEdit;
     void updateHash();
 
 };
@@ -2,6 +2,8 @@
 #include "nodegraph.h"
 #include "viewernodegraph.h"
 #include "interfaces.h"
+#include "messagelog.h"
+#include "pluginmanifest.h"
 
 #include <QtWidgets>
 #include <QtDebug>
@@ -19,6 +21,7 @@
 MainWindow::MainWindow()
 {
     contextMenuPos = QPointF(0.0, 0.0);
+    messageLog = new MessageLog(MESSAGE_LOG_CAPACITY, this);
 
     qDebug() << "MainWindow init start...";
 
@@ -50,7 +53,10 @@ MainWindow::MainWindow()
     setWindowTitle("Piri v.02");
     qDebug() << "MainWindow initialized!";
 
-    triggerMenuByName("Viewer");
+    // Graph file can be given as first argument, new graph starts with viewer
+    QStringList args = qApp->arguments();
+    if (args.count() < 2 || !openGraph(args.at(1)))
+        triggerMenuByName("Viewer");
 }
 
 
@@ -150,6 +156,30 @@ void MainWindow::createActions()
     quitAct->setStatusTip(tr("Quit the application"));
     connect(quitAct, SIGNAL(triggered()), this, SLOT(close()));
 
+    openGraphAct = new QAction(tr("&Open Graph..."), this);
+    openGraphAct->setShortcuts(QKeySequence::Open);
+    openGraphAct->setStatusTip(tr("Open node graph from file"));
+    connect(openGraphAct, SIGNAL(triggered()), this, SLOT(openGraph()));
+
+    saveGraphAct = new QAction(tr("&Save Graph..."), this);
+    saveGraphAct->setShortcuts(QKeySequence::Save);
+    saveGraphAct->setStatusTip(tr("Save node graph to file"));
+    connect(saveGraphAct, SIGNAL(triggered()), this, SLOT(saveGraph()));
+
+    exportProfileAct = new QAction(tr("&Export Profile..."), this);
+    exportProfileAct->setStatusTip(tr("Write profile of last evaluation as Chrome trace"));
+    connect(exportProfileAct, SIGNAL(triggered()), this, SLOT(exportProfile()));
+
+    showProfileAct = new QAction(tr("Show &Profile"), this);
+    showProfileAct->setStatusTip(tr("Show evaluation time on nodes"));
+    showProfileAct->setCheckable(true);
+    showProfileAct->setChecked(true);
+    connect(showProfileAct, SIGNAL(toggled(bool)), nodeGraph, SLOT(setProfileVisible(bool)));
+
+    showPlanAct = new QAction(tr("Execution P&lan..."), this);
+    showPlanAct->setStatusTip(tr("Show what evaluation would do, without running it"));
+    connect(showPlanAct, SIGNAL(triggered()), this, SLOT(showPlan()));
+
     aboutAct = new QAction(tr("&About"), this);
     aboutAct->setShortcuts(QKeySequence::HelpContents);
     aboutAct->setStatusTip(tr("Show the About box"));
@@ -158,6 +188,11 @@ void MainWindow::createActions()
     messageLogAct = new QAction(tr("&Message Log"), this);
     messageLogAct->setStatusTip(tr("Show message log"));
     connect(messageLogAct, SIGNAL(triggered()), this, SLOT(showMessageLog()));
+
+    verboseLogAct = new QAction(tr("&Verbose Log"), this);
+    verboseLogAct->setStatusTip(tr("Log node execution details"));
+    verboseLogAct->setCheckable(true);
+    connect(verboseLogAct, SIGNAL(toggled(bool)), this, SLOT(setVerboseLog(bool)));
 }
 
 
@@ -190,25 +225,149 @@ void MainWindow::close()
     qApp->exit();
 }
 
+/*!
+ * \brief MainWindow save graph action.
+ *
+ * Graph is saved in binary format, unless text format is selected. Text
+ * format is meant for diffing. Saved graph can be run without UI with
+ * PiriRunner.
+ * @see NodeGraph::saveGraph()
+ */
+void MainWindow::saveGraph()
+{
+    QString textFilter = tr("Piri graph as text (*.pirit)");
+    QString selectedFilter;
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Graph"), QString(),
+                                                    tr("Piri graph (*.piri)") + ";;" + textFilter, &selectedFilter);
+    if (fileName.isEmpty())
+        return;
+    int format = GRAPH_FORMAT_BINARY;
+    if (selectedFilter == textFilter || fileName.endsWith(".pirit", Qt::CaseInsensitive))
+        format = GRAPH_FORMAT_TEXT;
+    if (nodeGraph->saveGraph(fileName, format))
+        showStatusMessage(tr("Graph saved to %1").arg(fileName));
+}
+
+/*!
+ * \brief MainWindow open graph action.
+ * @see openGraph(QString)
+ */
+void MainWindow::openGraph()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Graph"), QString(),
+                                                    tr("Piri graph (*.piri *.pirit)"));
+    if (!fileName.isEmpty())
+        openGraph(fileName);
+}
+
+/*!
+ * \brief MainWindow export profile action.
+ *
+ * Profile of last evaluation is written as Chrome trace JSON, it can be
+ * opened in chrome://tracing.
+ * @see NodeGraph::writeProfile()
+ */
+void MainWindow::exportProfile()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export Profile"), QString(),
+                                                    tr("Chrome trace (*.json)"));
+    if (fileName.isEmpty())
+        return;
+    if (nodeGraph->writeProfile(fileName))
+        showStatusMessage(tr("Profile written to %1").arg(fileName));
+}
+
+/*!
+ * \brief MainWindow show plan action.
+ *
+ * Shows execution plan of active viewer in dialog. Nothing is run.
+ * @see NodeGraph::planText()
+ */
+void MainWindow::showPlan()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("Execution Plan"));
+    QPlainTextEdit *text = new QPlainTextEdit(nodeGraph->planText(), &dialog);
+    text->setReadOnly(true);
+    text->setLineWrapMode(QPlainTextEdit::NoWrap);
+    QFont font("Courier");
+    font.setStyleHint(QFont::Monospace);
+    text->setFont(font);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    layout->addWidget(text);
+    dialog.resize(800, 500);
+    dialog.exec();
+}
+
+/*!
+ * \brief Open graph file. Current graph is replaced.
+ * \param fileName Path of graph file, binary or text.
+ * \return True on success.
+ * @see NodeGraph::openGraph()
+ */
+bool MainWindow::openGraph(QString fileName)
+{
+    if (!nodeGraph->openGraph(fileName, pluginManifest))
+    {
+        showStatusMessage(tr("Can not open %1").arg(fileName));
+        return false;
+    }
+    showStatusMessage(tr("Graph opened from %1").arg(fileName));
+    return true;
+}
+
 /*!
  * \brief Add message to messagelog
  * \param message String
+ * \param level Message level. Levels are defined in pirilib.h
  */
-void MainWindow::logMessage(QString message)
+void MainWindow::logMessage(QString message, int level)
 {
-    messageLog.append(message);
-    MessageLogText->setText(stringListToString(messageLog));
-    MessageLogText->verticalScrollBar()->setValue(MessageLogText->verticalScrollBar()->maximum());
+    messageLog->append(message, level);
 }
 /*!
  * \brief Add message to messagelog
  * \param message StringList
+ * \param level Message level. Levels are defined in pirilib.h
  */
-void MainWindow::logMessage(QStringList message)
+void MainWindow::logMessage(QStringList message, int level)
 {
-    messageLog.append(message);
-    MessageLogText->setText(stringListToString(messageLog));
-    MessageLogText->verticalScrollBar()->setValue(MessageLogText->verticalScrollBar()->maximum());
+    messageLog->append(message, level);
+}
+
+/*!
+ * \brief Is message level logged?
+ *
+ * Hot paths should test this before formatting verbose messages.
+ * \param level Message level.
+ * \return True if messages of this level end up in log.
+ */
+bool MainWindow::isLogging(int level)
+{
+    return messageLog->isLogging(level);
+}
+
+/*!
+ * \brief Get message log model.
+ * \return Message log
+ */
+MessageLog* MainWindow::getMessageLog()
+{
+    return messageLog;
+}
+
+/*!
+ * \brief Turns verbose logging on or off.
+ * \param verbose If set, verbose messages are logged.
+ */
+void MainWindow::setVerboseLog(bool verbose)
+{
+    if (verbose)
+    {
+        messageLog->setLevel(LOG_LEVEL_VERBOSE);
+    } else {
+        messageLog->setLevel(LOG_LEVEL_INFO);
+    }
 }
 
 /*!
@@ -260,31 +419,23 @@ void MainWindow::triggerMenuByName(QString name)
 }
 
 
-/*!
- * \brief Converts stringlist to multi-line string
- * \param stringList List to convert
- * \return QString with generated string
- */
-QString MainWindow::stringListToString(QStringList stringList)
-{
-    QString result;
-    foreach (QString s, stringList)
-    {
-        result += s + "\n";
-    }
-    return result;
-}
-
 /*!
  * \brief Creates program message log
+ *
+ * Log view uses uniform item sizes, so only visible rows are laid out
+ * and new messages are appended without touching older ones.
  */
 void MainWindow::createMessageLog()
 {
     messageLogWidget = new QWidget();
-    MessageLogText = new QTextEdit(messageLogWidget);
-    MessageLogText->setText(stringListToString(messageLog));
-    MessageLogText->resize(400, 250);
+    messageLogView = new QListView(messageLogWidget);
+    messageLogView->setModel(messageLog);
+    messageLogView->setUniformItemSizes(true);
+    messageLogView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    messageLogView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    messageLogView->resize(400, 250);
     messageLogWidget->resize(400, 250);
+    connect(messageLog, SIGNAL(rowsInserted(QModelIndex,int,int)), messageLogView, SLOT(scrollToBottom()));
 }
 
 /*!
@@ -298,16 +449,22 @@ void MainWindow::showMessageLog()
 /*!
  * \brief Adds new Op to nodegraph.
  * Adds new Op to main nodegraph. At first it casts the sender object to QAction,
- * then casts QAction parent to OpInterfaceMI and calls mainGraph->addOp(Op).
+ * then loads plugin named in action data and calls mainGraph->addOp(Op).
  * @see nodeGraph::addOp()
+ * @see PluginManifest::loadOp()
  */
 void MainWindow::addOp()
 {
-    logMessage("MainWindow::addOp");
+    logMessage("MainWindow::addOp", LOG_LEVEL_VERBOSE);
     QAction *action = qobject_cast<QAction *>(sender());
-    OpInterfaceMI *OpMI = qobject_cast<OpInterfaceMI *>(action->parent());
+    OpInterfaceMI *OpMI = pluginManifest->loadOp(action->data().toString());
+    if (!OpMI)
+    {
+        logMessage(pluginManifest->getError(), LOG_LEVEL_ERROR);
+        return;
+    }
     nodeGraph->addOp(OpMI);
-    messageLog.append("Op Added!");
+    logMessage("Op Added!", LOG_LEVEL_VERBOSE);
 }
 
 
@@ -319,16 +476,23 @@ void MainWindow::addOp()
 void MainWindow::createMenus()
 {
     fileMenu = menuBar()->addMenu(tr("&File"));
+    fileMenu->addAction(openGraphAct);
+    fileMenu->addAction(saveGraphAct);
+    fileMenu->addAction(exportProfileAct);
+    fileMenu->addSeparator();
     fileMenu->addAction(quitAct);
 
     editMenu = menuBar()->addMenu(tr("&Edit"));
     viewMenu = menuBar()->addMenu(tr("&View"));
+    viewMenu->addAction(showProfileAct);
+    viewMenu->addAction(showPlanAct);
 
     menuBar()->addSeparator();
 
     helpMenu = menuBar()->addMenu(tr("&Help"));
     helpMenu->addAction(aboutAct);
     helpMenu->addAction(messageLogAct);
+    helpMenu->addAction(verboseLogAct);
 
     // Nodegraph popup menu.
     nodeMenu = new QMenu;
@@ -473,10 +637,13 @@ void MainWindow::createNodeGraph()
 /*!
  * \brief Loads DLL plugins.
  *
- * Loads all DLL plugins from /plugin directory that are compatible with OpInterface.
+ * Builds node menus for all plugins in /plugin directory that are compatible
+ * with OpInterface. Plugin descriptions come from plugin manifest, so only new
+ * or changed libraries are loaded here. Other libraries are loaded when their
+ * op is first added to nodegraph.
  * @see OpInterface
+ * @see PluginManifest
  * @see registerOp()
- * @see populateMenus()
  */
 void MainWindow::loadPlugins()
 {
@@ -497,64 +664,49 @@ void MainWindow::loadPlugins()
     pluginsDir.cd("plugins");
     qDebug() << "Plugins dir: " << pluginsDir;
 
-    foreach (QString fileName, pluginsDir.entryList(QDir::Files)) {
-        QPluginLoader loader(pluginsDir.absoluteFilePath(fileName));
-        QObject *plugin = loader.instance();
-        qDebug() << fileName;
-        if (plugin) {
-            populateMenus(plugin);
-            pluginFileNames += fileName;
-        }
+    QString manifestFile = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/plugins.manifest";
+    pluginManifest = new PluginManifest(pluginsDir, manifestFile);
+    pluginManifest->load();
+    int scanned = pluginManifest->scan();
+    if (scanned || pluginManifest->getRemoved())
+    {
+        if (!pluginManifest->save())
+            logMessage(pluginManifest->getError(), LOG_LEVEL_ERROR);
     }
-    //qDebug() << "Loaded plugins: " << pluginFileNames;
-    //showStatusMessage("Plugins loaded: " + pluginFileNames);
-
-    messageLog.append("Loaded plugins:");
-    messageLog.append(pluginFileNames);
-}
 
-
-/*!
- * \brief Casts plugins to OpInterfaces and calls registerOp()
- *
- * Casts loaded plugins to OpInterfaces and if successful, sends them to registerOp() for loading.
- * \param plugin Plugin to be cast.
- * @see loadPlugins()
- * @see registerOp()
- * @see OpInterface
- */
-void MainWindow::populateMenus(QObject *plugin)
-{
-    OpInterfaceMI *OpMI = qobject_cast<OpInterfaceMI *>(plugin);
-    if (OpMI)
+    foreach (PluginEntry entry, pluginManifest->entries())
     {
-        registerOp(plugin, OpMI->description(), SLOT(addOp()));
+        if (entry.opName.isEmpty())
+            continue;
+        registerOp(entry, SLOT(addOp()));
+        pluginFileNames += QFileInfo(entry.fileName).fileName() + " ";
     }
+
+    logMessage(QString("Loaded plugins (%1 scanned):").arg(scanned));
+    logMessage(pluginFileNames);
 }
 
 
 /*!
- * \brief Registers loaded plugin to system.
+ * \brief Registers plugin to system.
  *
- * Splits description of loaded plugin into class, name and description.
  * Creates new QAction and ties it with menu entry and addOp() function
- * for adding new node to graph.
+ * for adding new node to graph. Action data holds plugin file name.
  * Adds new menu class if necessary and new entry for loaded operation.
- * \param plugin Plugin to be registered.
- * \param text Plugin desctiption from Op->description().
+ * \param entry Plugin manifest entry.
  * \param member addOp() function to be tied into signal-slot mechanism.
  * @see loadPlugins()
- * @see populateMenus()
+ * @see PluginManifest
  */
-void MainWindow::registerOp(QObject *plugin, const QString text, const char *member)
+void MainWindow::registerOp(PluginEntry entry, const char *member)
 {
     QString opName, menuName;
-    opName = text.split(";").first();
-    opName = opName.split("/").last();
-    menuName = text.split(";").first();
-    menuName = menuName.split("/").first();
+    opName = entry.opName;
+    menuName = entry.menuClass;
 
-    QAction *action = new QAction(opName, plugin);
+    QAction *action = new QAction(opName, this);
+    action->setData(entry.fileName);
+    action->setToolTip(entry.opDesc);
     connect(action, SIGNAL(triggered()), this, member);
 
     // Otsime, kas vastav menüü on olemas ja kui pole, siis loome selle
@@ -578,7 +730,5 @@ void MainWindow::registerOp(QObject *plugin, const QString text, const char *mem
             m->addAction(action);
     }
 
-    messageLog.append("New plugin:");
-    messageLog.append(opName);
-    messageLog.append(menuName);
+    logMessage(QStringList() << "New plugin:" << opName << menuName, LOG_LEVEL_VERBOSE);
 }
@@ -11,7 +11,7 @@ QT_BEGIN_NAMESPACE
 class QAction;
 class QListWidget;
 class QMenu;
-class QTextEdit;
+class QListView;
 class QTableView;
 class Viewer;
 class QDir;
@@ -19,6 +19,9 @@ QT_END_NAMESPACE
 
 class NodeGraph;
 class ViewerNodeGraph;
+class MessageLog;
+class PluginManifest;
+struct PluginEntry;
 
 class PIRILIBSHARED_EXPORT MainWindow : public QMainWindow
 {
@@ -35,18 +38,26 @@ public:
 
     QWidget* getViewer();
 
-    void logMessage(QString message);
-    void logMessage(QStringList message);
+    void logMessage(QString message, int level = LOG_LEVEL_INFO);
+    void logMessage(QStringList message, int level = LOG_LEVEL_INFO);
+    bool isLogging(int level);
+    MessageLog* getMessageLog();
     void appendCommand(QString command);
     QStringList getCommandList();
     void clearCommandList();
 
     void triggerMenuByName(QString name);
+    bool openGraph(QString fileName);
 
 private slots:
     void about();
     void close();
+    void saveGraph();
+    void openGraph();
+    void exportProfile();
+    void showPlan();
     void showMessageLog();
+    void setVerboseLog(bool verbose);
     void addOp();
 
 private:
@@ -58,9 +69,7 @@ private:
     void createNodeGraph();
     void createMessageLog();
     void loadPlugins();
-    void populateMenus(QObject *plugin);
-    void registerOp(QObject *plugin, const QString text, const char *member);
-    QString stringListToString(QStringList stringList);
+    void registerOp(PluginEntry entry, const char *member);
 
     QMenu *fileMenu; /*!< File menu object. */
     QMenu *editMenu; /*!< Edit menu object. */
@@ -73,17 +82,24 @@ private:
 
     QAction *aboutAct; /*!< Shows about dialog. */
     QAction *quitAct; /*!< Closes application. */
-    QAction *messageLogAct; /*!< Closes application. */
+    QAction *openGraphAct; /*!< Opens node graph from file. */
+    QAction *saveGraphAct; /*!< Saves node graph to file. */
+    QAction *exportProfileAct; /*!< Writes profile of last evaluation to file. */
+    QAction *showProfileAct; /*!< Toggles profile badges on nodes. */
+    QAction *showPlanAct; /*!< Shows execution plan of active viewer. */
+    QAction *messageLogAct; /*!< Shows message log. */
+    QAction *verboseLogAct; /*!< Toggles verbose messages in message log. */
 
     QWidget* messageLogWidget;
-    QTextEdit* MessageLogText;
+    QListView* messageLogView; /*!< View into message log, creates rows only for visible messages. */
 
     NodeGraph *nodeGraph;
+    PluginManifest *pluginManifest; /*!< Cached descriptions of plugins, loads plugins on demand. */
 
     QWidget *propView; /*!< Dockable properties subwindow. */
     QWidget *viewerView; /*!< Dockable viewer area */
 
-    QStringList messageLog;
+    MessageLog* messageLog; /*!< Bounded log of program messages. */
     QStringList commandList; /*!< List that holds commands from node execute methods */
 };
 
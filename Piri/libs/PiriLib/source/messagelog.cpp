@@ -0,0 +1,139 @@
+#include "messagelog.h"
+
+#include <QBrush>
+
+
+/*!
+ * \brief Message log model.
+ *
+ * Holds program messages in a bounded ring buffer. When buffer is full,
+ * oldest messages are dropped. Views get only row insert and remove
+ * notifications, so appending a message costs the same no matter how
+ * long the session has been running.
+ * \param capacity Maximum number of messages held.
+ * \param parent Parent object.
+ */
+MessageLog::MessageLog(int capacity, QObject *parent)
+    : QAbstractListModel(parent),
+      myEntries(capacity)
+{
+    myLevel = LOG_LEVEL_INFO;
+}
+
+/*!
+ * \brief Number of messages in log.
+ *
+ * Reimplemented function.
+ * \param parent Not used, list model has no children.
+ * \return Message count.
+ */
+int MessageLog::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return myEntries.count();
+}
+
+/*!
+ * \brief Get message text or color for view.
+ *
+ * Reimplemented function. Errors are drawn in red.
+ * \param index Model index, row 0 is the oldest message.
+ * \param role Data role.
+ * \return Message data.
+ */
+QVariant MessageLog::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= myEntries.count())
+        return QVariant();
+
+    const LogEntry &entry = myEntries.at(myEntries.firstIndex() + index.row());
+    if (role == Qt::DisplayRole)
+        return entry.text;
+    if (role == Qt::ForegroundRole && entry.level == LOG_LEVEL_ERROR)
+        return QBrush(Qt::red);
+    return QVariant();
+}
+
+/*!
+ * \brief Add message to log.
+ *
+ * Message is dropped if its level is more verbose than current log level.
+ * \param message Message string.
+ * \param level Message level. Levels are defined in pirilib.h
+ */
+void MessageLog::append(QString message, int level)
+{
+    if (!isLogging(level))
+        return;
+
+    if (myEntries.isFull())
+    {
+        beginRemoveRows(QModelIndex(), 0, 0);
+        myEntries.removeFirst();
+        endRemoveRows();
+    }
+
+    if (!myEntries.areIndexesValid())
+        myEntries.normalizeIndexes();
+
+    LogEntry entry;
+    entry.level = level;
+    entry.text = message;
+
+    int row = myEntries.count();
+    beginInsertRows(QModelIndex(), row, row);
+    myEntries.append(entry);
+    endInsertRows();
+}
+
+/*!
+ * \brief Add list of messages to log.
+ *
+ * All messages are inserted with one model notification.
+ * \param messages List of messages.
+ * \param level Message level.
+ */
+void MessageLog::append(QStringList messages, int level)
+{
+    if (!isLogging(level) || messages.isEmpty())
+        return;
+
+    // Only last 'capacity' messages can fit in buffer
+    int capacity = myEntries.capacity();
+    if (messages.count() > capacity)
+        messages = messages.mid(messages.count() - capacity);
+
+    int overflow = myEntries.count() + messages.count() - capacity;
+    if (overflow > 0)
+    {
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        for (int i = 0; i < overflow; i++)
+            myEntries.removeFirst();
+        endRemoveRows();
+    }
+
+    if (!myEntries.areIndexesValid())
+        myEntries.normalizeIndexes();
+
+    int row = myEntries.count();
+    beginInsertRows(QModelIndex(), row, row + messages.count() - 1);
+    foreach (QString message, messages)
+    {
+        LogEntry entry;
+        entry.level = level;
+        entry.text = message;
+        myEntries.append(entry);
+    }
+    endInsertRows();
+}
+
+/*!
+ * \brief Remove all messages from log.
+ */
+void MessageLog::clear()
+{
+    beginResetModel();
+    myEntries.clear();
+    endResetModel();
+}
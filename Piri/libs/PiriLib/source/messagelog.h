@@ -0,0 +1,39 @@
+#ifndef MESSAGELOG_H
+#define MESSAGELOG_H
+
+#include <QAbstractListModel>
+#include <QContiguousCache>
+#include <QStringList>
+
+#include "pirilib.h"
+
+struct LogEntry {
+    int level;
+    QString text;
+};
+
+class PIRILIBSHARED_EXPORT MessageLog : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    MessageLog(int capacity = MESSAGE_LOG_CAPACITY, QObject *parent = 0);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    void append(QString message, int level = LOG_LEVEL_INFO);
+    void append(QStringList messages, int level = LOG_LEVEL_INFO);
+    void clear();
+
+    int getLevel() { return myLevel; }
+    void setLevel(int level) { myLevel = level; }
+    bool isLogging(int level) const { return level <= myLevel; }
+
+    int getCapacity() { return myEntries.capacity(); }
+
+private:
+    QContiguousCache<LogEntry> myEntries; /*!< Ring buffer of log entries, oldest entries are dropped first. */
+    int myLevel; /*!< Most verbose level that is still logged. */
+};
+
+#endif // MESSAGELOG_H
@@ -0,0 +1,310 @@
+#include "mifwriter.h"
+#include "tabwriter.h"
+
+#include <QFileInfo>
+#include <QTextCodec>
+#include <QVarLengthArray>
+#include <qmath.h>
+
+#include <float.h>
+
+
+/*!
+ * \brief MapInfo interchange writer constructor.
+ *
+ * Writes native table as MIF/MID file pair. Attributes go to .MID file
+ * while rows are written, objects go to temporary file that is appended
+ * to .MIF file after header. Default coordinate system is NonEarth in
+ * meters with bounds of data and default charset is WindowsBalticRim.
+ * \param fileName Path of .MIF file.
+ */
+MifWriter::MifWriter(QString fileName)
+{
+    myFileName = fileName;
+    myCharset = MAPINFO_CHARSET;
+    myCodec = 0;
+    myRowCount = 0;
+    myRowIdField = false;
+}
+
+/*!
+ * \brief Set coordinate system of .MIF file.
+ * \param coordSys MapBasic CoordSys clause, written as it is. Empty clause
+ * is NonEarth in meters.
+ * \return False if clause is not CoordSys clause, see getError().
+ */
+bool MifWriter::setCoordSys(QString coordSys)
+{
+    QString s = coordSys.simplified();
+    if (!s.isEmpty() && !s.startsWith("CoordSys ", Qt::CaseInsensitive))
+    {
+        myError = "Unsupported CoordSys: " + coordSys;
+        return false;
+    }
+    myCoordSys = s;
+    return true;
+}
+
+/*!
+ * \brief Write table.
+ * \param table Table to write.
+ * \return True on success, see getError() otherwise.
+ */
+bool MifWriter::write(TablePtr table)
+{
+    return write(TableStreamPtr(new TableSliceStream(table, qMax(1, table->rowCount()))));
+}
+
+/*!
+ * \brief Write table from stream, one batch at a time.
+ * \param stream Stream to write, all batches must have same columns.
+ * \return True on success, see getError() otherwise.
+ */
+bool MifWriter::write(TableStreamPtr stream)
+{
+    TablePtr batch = stream->next();
+    if (!batch)
+    {
+        myError = stream->hasError() ? stream->getError() : "No table to write to " + myFileName;
+        return false;
+    }
+    if (!begin(batch.data()))
+        return false;
+    while (batch)
+    {
+        if (!writeBatch(batch.data()))
+            return false;
+        batch = stream->next();
+    }
+    if (stream->hasError())
+    {
+        myError = stream->getError();
+        return false;
+    }
+    return finish();
+}
+
+/*!
+ * \brief Start writing table.
+ *
+ * Fields come from columns of first batch, same as in TabWriter.
+ * Coordinates are written with as many decimals as resolution of first
+ * batch has.
+ * \param first First batch, it is not written yet.
+ * \return True on success, see getError() otherwise.
+ */
+bool MifWriter::begin(const Table *first)
+{
+    myRowCount = 0;
+    myCodec = TabReader::codecForCharset(myCharset);
+    myFields = TabWriter::tabFields(first);
+    myRowIdField = myFields.isEmpty();
+    if (myRowIdField)
+    {
+        TabField f = { "ID", COLUMN_TYPE_INTEGER, TabReader::Integer, 0, 4 };
+        myFields << f;
+    }
+    myMinX = myMinY = DBL_MAX;
+    myMaxX = myMaxY = -DBL_MAX;
+
+    QFileInfo fi(myFileName);
+    bool lower = fi.suffix() == fi.suffix().toLower() && !fi.suffix().isEmpty();
+    QString midName = fi.path() + "/" + fi.completeBaseName() + (lower ? ".mid" : ".MID");
+    myMidFile.setFileName(midName);
+    if (!myMidFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+    {
+        myError = "Can not write " + midName;
+        return false;
+    }
+    if (!mySpool.open())
+    {
+        myError = "Can not create temporary file for " + myFileName;
+        return false;
+    }
+    mySpool.resize(0);
+    myMid.setDevice(&myMidFile);
+    myMid.setCodec(myCodec);
+    myObjects.setDevice(&mySpool);
+
+    CoordTransform t = first->getTransform();
+    double resolution = qMin(t.resolutionX, t.resolutionY);
+    int decimals = resolution > 0 ? qBound(0, (int)ceil(-log10(resolution) - 1e-9), 15) : 6;
+    myObjects.setRealNumberNotation(QTextStream::FixedNotation);
+    myObjects.setRealNumberPrecision(decimals);
+    return true;
+}
+
+/*!
+ * \brief Write rows of batch.
+ * \param batch Batch with same columns as first batch.
+ * \return True on success, see getError() otherwise.
+ */
+bool MifWriter::writeBatch(const Table *batch)
+{
+    if (batch->columnCount() != (myRowIdField ? 0 : myFields.count()))
+    {
+        myError = "Batches have different columns: " + myFileName;
+        return false;
+    }
+    for (int r = 0; r < batch->rowCount(); r++)
+    {
+        writeValues(batch, r);
+        writeObject(batch, r);
+    }
+    myRowCount += batch->rowCount();
+    if (myMidFile.error() != QFile::NoError || mySpool.error() != QFile::NoError)
+    {
+        myError = "Can not write " + myFileName;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Write .MIF file with header and objects.
+ * \return True on success, see getError() otherwise.
+ */
+bool MifWriter::finish()
+{
+    myMid.flush();
+    myMidFile.close();
+    myObjects.flush();
+
+    QFile file(myFileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !mySpool.seek(0))
+    {
+        myError = "Can not write " + myFileName;
+        return false;
+    }
+    QTextStream out(&file);
+    out.setCodec(myCodec);
+    writeHeader(out);
+    out.flush();
+    while (!mySpool.atEnd())
+        file.write(mySpool.read(1024 * 1024));
+
+    bool ok = file.error() == QFile::NoError && mySpool.error() == QFile::NoError;
+    mySpool.close();
+    if (!ok)
+    {
+        myError = "Can not write " + myFileName;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Write .MIF header.
+ *
+ * NonEarth coordinate system gets bounds of data.
+ * \param out Output
+ */
+void MifWriter::writeHeader(QTextStream &out)
+{
+    out << "Version 300\n";
+    out << "Charset \"" << myCharset << "\"\n";
+    out << "Delimiter \",\"\n";
+    if (myCoordSys.isEmpty())
+    {
+        if (myMinX > myMaxX)
+        {
+            myMinX = myMinY = 0.0;
+            myMaxX = myMaxY = 1.0;
+        }
+        out.setRealNumberPrecision(15);
+        out << "CoordSys NonEarth Units \"m\" Bounds (" << myMinX << ", " << myMinY << ") ("
+            << myMaxX << ", " << myMaxY << ")\n";
+    } else {
+        out << myCoordSys << "\n";
+    }
+    out << "Columns " << myFields.count() << "\n";
+    foreach (const TabField &f, myFields)
+        out << "  " << f.name << " " << TabWriter::tabFieldType(f).remove(' ') << "\n";
+    out << "Data\n\n";
+}
+
+/*!
+ * \brief Write attributes of row to .MID file.
+ *
+ * Strings are quoted, dates are yyyymmdd.
+ * \param batch Batch
+ * \param row Row in batch
+ */
+void MifWriter::writeValues(const Table *batch, int row)
+{
+    if (myRowIdField)
+    {
+        myMid << myRowCount + row + 1 << "\n";
+        return;
+    }
+    for (int c = 0; c < myFields.count(); c++)
+    {
+        if (c > 0)
+            myMid << ",";
+        TabField &f = myFields[c];
+        if (f.tabType == TabReader::Char)
+        {
+            QString s = batch->column(c).strings.at(row);
+            f.width = qBound(f.width, myCodec->fromUnicode(s).size(), 254);
+            s.replace("\"", "\"\"");
+            s.replace("\n", " ");
+            myMid << "\"" << s << "\"";
+        } else {
+            myMid << batch->toString(row, c);
+        }
+    }
+    myMid << "\n";
+}
+
+/*!
+ * \brief Write object of row to temporary object file.
+ *
+ * Points are points, lines are polylines and regions are regions, rows
+ * without geometry are none.
+ * \param batch Batch
+ * \param row Row in batch
+ */
+void MifWriter::writeObject(const Table *batch, int row)
+{
+    int type = batch->geometryType(row);
+    int parts = batch->partCount(row);
+    if (type == GEOMETRY_TYPE_NONE || parts == 0 || batch->pointCount(row, 0) == 0)
+    {
+        myObjects << "none\n";
+        return;
+    }
+
+    if (type == GEOMETRY_TYPE_REGION)
+        myObjects << "Region " << parts << "\n";
+    else if (type == GEOMETRY_TYPE_LINE && parts > 1)
+        myObjects << "Pline Multiple " << parts << "\n";
+    else if (type == GEOMETRY_TYPE_LINE)
+        myObjects << "Pline " << batch->pointCount(row, 0) << "\n";
+
+    QVarLengthArray<double, 512> xs;
+    QVarLengthArray<double, 512> ys;
+    for (int p = 0; p < parts; p++)
+    {
+        int n = batch->pointCount(row, p);
+        xs.resize(n);
+        ys.resize(n);
+        batch->points(row, p, xs.data(), ys.data());
+        for (int i = 0; i < n; i++)
+        {
+            myMinX = qMin(myMinX, xs[i]);
+            myMinY = qMin(myMinY, ys[i]);
+            myMaxX = qMax(myMaxX, xs[i]);
+            myMaxY = qMax(myMaxY, ys[i]);
+        }
+
+        if (type == GEOMETRY_TYPE_POINT)
+        {
+            myObjects << "Point " << xs[0] << " " << ys[0] << "\n";
+            return;
+        }
+        if (type == GEOMETRY_TYPE_REGION || parts > 1)
+            myObjects << "  " << n << "\n";
+        for (int i = 0; i < n; i++)
+            myObjects << xs[i] << " " << ys[i] << "\n";
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef MIFWRITER_H
+#define MIFWRITER_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+#include <QTemporaryFile>
+#include <QTextStream>
+
+#include "pirilib.h"
+#include "table.h"
+#include "tablestream.h"
+#include "tabreader.h"
+
+class QTextCodec;
+
+class PIRILIBSHARED_EXPORT MifWriter
+{
+public:
+    MifWriter(QString fileName);
+
+    void setCharset(QString charset) { myCharset = charset; }
+    bool setCoordSys(QString coordSys);
+
+    bool write(TablePtr table);
+    bool write(TableStreamPtr stream);
+    bool begin(const Table *first);
+    bool writeBatch(const Table *batch);
+    bool finish();
+    int getRowCount() { return myRowCount; }
+    QString getError() { return myError; }
+
+private:
+    void writeValues(const Table *batch, int row);
+    void writeObject(const Table *batch, int row);
+    void writeHeader(QTextStream &out);
+
+    QString myFileName; /*!< Path of .MIF file. */
+    QString myError; /*!< Last error. */
+    QString myCharset; /*!< MapInfo charset of strings. */
+    QTextCodec *myCodec; /*!< Codec of charset. */
+    QString myCoordSys; /*!< CoordSys clause, empty for NonEarth in meters. */
+    int myRowCount; /*!< Number of rows written. */
+    QVector<TabField> myFields; /*!< Fields of table, Char widths grow while rows are written. */
+    bool myRowIdField; /*!< Is row number written as only field? */
+
+    QFile myMidFile;
+    QTextStream myMid;
+    QTemporaryFile mySpool; /*!< Objects until header with Char widths and bounds can be written. */
+    QTextStream myObjects;
+    double myMinX; /*!< Bounds of all objects. */
+    double myMinY;
+    double myMaxX;
+    double myMaxY;
+};
+
+#endif // MIFWRITER_H
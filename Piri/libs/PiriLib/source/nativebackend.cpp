@@ -0,0 +1,104 @@
+#include "nativebackend.h"
+#include "interfaces.h"
+
+
+/*!
+ * \brief Native backend constructor.
+ *
+ * Native backend runs ops on native tables instead of generating MapBasic
+ * commands for MapInfo. It is used when graph is run headless.
+ */
+NativeBackend::NativeBackend()
+{
+}
+
+/*!
+ * \brief Run one op.
+ *
+ * Disabled op passes its main input through.
+ * \param op Op to run, has to implement OpInterfaceNative.
+ * \param inputs Results of input nodes in input order.
+ * \param disabled Is node disabled?
+ * \return Result table or null pointer on error, see getError().
+ */
+TablePtr NativeBackend::run(OpInterfaceMI *op, QList<TablePtr> inputs, bool disabled)
+{
+    const OpDescriptor *desc = op->descriptor();
+    if (disabled)
+        return inputs.value(0);
+
+    OpInterfaceNative *native = dynamic_cast<OpInterfaceNative*>(op);
+    if (!native)
+    {
+        myError = QString("Op %1 can not run without MapInfo").arg(desc->name);
+        return TablePtr();
+    }
+
+    int connected = 0;
+    foreach (TablePtr t, inputs) {
+        if (t)
+            connected++;
+    }
+    if (connected < desc->minInputs)
+    {
+        myError = QString("Op %1 needs %2 inputs").arg(desc->name).arg(desc->minInputs);
+        return TablePtr();
+    }
+
+    TablePtr result = native->run(inputs);
+    if (!result)
+        myError = QString("Op %1 failed").arg(desc->name);
+    return result;
+}
+
+/*!
+ * \brief Can op be run as stream?
+ * \param op Op
+ * \param disabled Is node disabled?
+ * \return True if op implements OpInterfaceStream or node is disabled.
+ */
+bool NativeBackend::canStream(OpInterfaceMI *op, bool disabled)
+{
+    return disabled || dynamic_cast<OpInterfaceStream*>(op) != 0;
+}
+
+/*!
+ * \brief Run one op as stream.
+ *
+ * Op is not run yet, rows are processed when result stream is read.
+ * Disabled op passes its main input through.
+ * \param op Op to run, has to implement OpInterfaceStream.
+ * \param inputs Streams of input nodes in input order.
+ * \param disabled Is node disabled?
+ * \param batchRows Rows in one batch.
+ * \return Result stream or null pointer on error, see getError().
+ */
+TableStreamPtr NativeBackend::stream(OpInterfaceMI *op, QList<TableStreamPtr> inputs, bool disabled, int batchRows)
+{
+    const OpDescriptor *desc = op->descriptor();
+    if (disabled)
+        return inputs.value(0);
+
+    OpInterfaceStream *streaming = dynamic_cast<OpInterfaceStream*>(op);
+    if (!streaming)
+    {
+        myError = QString("Op %1 can not run as stream").arg(desc->name);
+        return TableStreamPtr();
+    }
+
+    int connected = 0;
+    foreach (TableStreamPtr s, inputs) {
+        if (s)
+            connected++;
+    }
+    if (connected < desc->minInputs)
+    {
+        myError = QString("Op %1 needs %2 inputs").arg(desc->name).arg(desc->minInputs);
+        return TableStreamPtr();
+    }
+
+    TableStreamPtr result = streaming->stream(inputs, batchRows);
+    if (!result)
+        myError = QString("Op %1 failed").arg(desc->name);
+    return result;
+}
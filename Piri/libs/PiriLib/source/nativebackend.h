@@ -0,0 +1,28 @@
+#ifndef NATIVEBACKEND_H
+#define NATIVEBACKEND_H
+
+#include <QString>
+#include <QList>
+
+#include "pirilib.h"
+#include "table.h"
+#include "tablestream.h"
+
+class OpInterfaceMI;
+
+class PIRILIBSHARED_EXPORT NativeBackend
+{
+public:
+    NativeBackend();
+
+    TablePtr run(OpInterfaceMI *op, QList<TablePtr> inputs, bool disabled = false);
+    bool canStream(OpInterfaceMI *op, bool disabled = false);
+    TableStreamPtr stream(OpInterfaceMI *op, QList<TableStreamPtr> inputs, bool disabled = false,
+                          int batchRows = STREAM_BATCH_ROWS);
+    QString getError() { return myError; }
+
+private:
+    QString myError; /*!< Last error. */
+};
+
+#endif // NATIVEBACKEND_H
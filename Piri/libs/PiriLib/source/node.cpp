@@ -3,8 +3,10 @@
 #include "mainwindow.h"
 #include "interfaces.h"
 #include "knobcallback.h"
+#include "knobpanel.h"
 #include "op.h"
 #include "edge.h"
+#include "graphmodel.h"
 
 #include <QGraphicsScene>
 #include <QGraphicsSceneMouseEvent>
@@ -15,83 +17,102 @@
 
 /*!
  * \brief Node constructor. New variant.
+ *
+ * Node creates its own op instance from plugin op, so every node has
+ * its own knob values. Op is added to graph model, node is only its
+ * view in node graph scene.
  * \param nodeGraph Parent nodegraph.
  * \param name Node name.
- * \param op Node OpInterfaceMI.
+ * \param op Plugin OpInterfaceMI that acts as op factory.
  */
 Node::Node(NodeGraph *nodeGraph, QString name, OpInterfaceMI *op)
 {
     myParent = nodeGraph;
     //myParent->getParent()->logMessage("Node constructor");
+    myId = myParent->getModel()->addNode(op->create(), name);
+    setup();
+
+    setupInputs();
+    makeCallback();
+}
+
+/*!
+ * \brief Node constructor for node that is already in graph model.
+ *
+ * Used when graph is loaded from file. Op and knob values are already
+ * in model, so knob panel is made only when node is opened. Edges are
+ * added by node graph after all nodes are made.
+ * \param nodeGraph Parent nodegraph.
+ * \param id Node id in graph model.
+ * @see NodeGraph::openGraph()
+ */
+Node::Node(NodeGraph *nodeGraph, int id)
+{
+    myParent = nodeGraph;
+    myId = id;
+    setup();
+
+    const GraphNode &n = myParent->getModel()->node(myId);
+    disabled = n.disabled;
+    setPos(n.pos);
+    Op *op = dynamic_cast<Op*>(myOp);
+    if (op)
+        op->setParent(this);
+    myCallback = n.callback;
+    if (myCallback)
+        myCallback->setParentNode(this);
+    else
+        makeCallback();
+}
+
+/*!
+ * \brief Sets node members from op descriptor.
+ */
+void Node::setup()
+{
     myCallback = 0;
+    myPanel = 0;
     mainEdge = 0;
-    myName = op->description().split(";").first().split("/").last();
-    myClass = op->description().split(";").first().split("/").first();
-    myDesc = op->description().split(";").last().split("/").first();
+    myOp = myParent->getModel()->node(myId).op;
+    myDescriptor = myOp->descriptor();
+    myName = myParent->getModel()->node(myId).name;
+    myClass = myDescriptor->menuClass;
+    myClassType = classTypeToInt(myClass);
+    myDesc = myDescriptor->description;
     numInputs = 0;
-    maxInputs = op->description().split(";").last().split("/").last().toInt();
+    maxInputs = myDescriptor->maxInputs;
     disabled = false;
+    myProfileTime = -1;
+    myProfileShare = 0.0;
+    myProfileCache = PROFILE_CACHE_NONE;
     setFlag(ItemIsMovable);
     setFlag(ItemIsSelectable);
     setFlag(ItemSendsGeometryChanges);
     setCacheMode(DeviceCoordinateCache);
     setZValue(1);
-
-    myOp = op;
-
-    setupInputs();
-    makeCallback();
 }
 
-
 /*!
- * \brief Node execution routine.
+ * \brief Node destructor. Deletes knob panel.
  *
- * This function calls engine() on Op if node has inputs or if it is top node
- * (node that reads or creates data).
- * @see OpInterface::engine()
+ * Op and callback belong to graph model, see GraphModel::removeNode().
  */
-void Node::execute()
+Node::~Node()
 {
-    myParent->getParent()->logMessage("Execute node: " + myName);
-    //if ((edges().count() == edgesOut().count()) || edgesIn().count() > 0)
-    //{
-        if (!isDisabled())
-        {
-            //nodeHash = getHash();
-            //myOp->engine();
-            foreach (Edge* e, edgesIn())
-            {
-                e->sourceNode()->execute();
-            }
-            //Op *op = dynamic_cast<Op*>(myOp);
-            //myParent->getParent()->logMessage(QString("value: %1").arg(op->getCallback()->getKnob("File")->value->toString()));
-            myParent->getParent()->appendCommand(myOp->engine());
-        } else {
-            Op *op = dynamic_cast<Op*>(myOp);
-            op->disabled();
-        }
-    //}
+    deletePanel();
 }
 
+
 /*!
  * \brief Calculate node hash.
  *
- * Node hash is based on the hash of knob callback and hashes of
- * all nodes above this one. If something changes up in node tree,
- * hash also changes.
+ * Node hash is calculated in graph model.
+ * @see GraphModel::hash()
  * \return
  */
-QString Node::getHash()
+Hash128 Node::getHash()
 {
-    QString hashString;
-    foreach (Edge* e, edgesIn())
-    {
-        hashString += e->sourceNode()->getHash();
-    }
-    hashString += myCallback->getHash();
-    hashString = generateHash(hashString);
-    return hashString;
+    return myParent->getModel()->hash(myId);
 }
 
 
@@ -148,25 +169,62 @@ void Node::setupInputs()
 
 
 /*!
- * \brief Creates node callback.
+ * \brief Creates node knob callback.
  *
- * If callback exists, adds callback widget to properties view layout.
+ * Callback only connects knob labels to op members, it has no panel, so
+ * no widgets are made. Widgets are made in openPanel() when node is
+ * opened.
  */
 void Node::makeCallback()
 {
     Op *op = dynamic_cast<Op*>(myOp);
     if (!op)
     {
-        myParent->getParent()->logMessage("Op cast failed!");
+        myParent->getParent()->logMessage("Op cast failed!", LOG_LEVEL_ERROR);
         return;
     }
     if (!myCallback) {
         myCallback = new KnobCallback(this);
         myOp->knobs(myCallback);
         op->setCallback(myCallback);
+        myParent->getModel()->setCallback(myId, myCallback);
+    }
+}
+
+
+/*!
+ * \brief Opens node knob panel in properties view.
+ *
+ * Panel and knob widgets are made on first open. Op knobs() is called
+ * again with panel, knob functions find existing knobs by label and add
+ * widgets that show current values.
+ */
+void Node::openPanel()
+{
+    if (myName == "Dot" || !myCallback)
+        return;
+    if (!myPanel) {
+        myPanel = new KnobPanel(myCallback);
+        myCallback->setPanel(myPanel);
+        myOp->knobs(myCallback);
+        myParent->getParent()->getPropViewLayout()->addWidget(myPanel);
+        if (isSelected())
+            myPanel->setStyleSheet("KnobPanel { border: 2px solid rgb(240, 200, 100) }");
     }
-    if (myName != "Dot")
-        myParent->getParent()->getPropViewLayout()->addWidget(myCallback);
+    if (myPanel->isHidden())
+        myPanel->show();
+}
+
+
+/*!
+ * \brief Deletes node knob panel. Knob values stay in op.
+ */
+void Node::deletePanel()
+{
+    if (myCallback)
+        myCallback->setPanel(0);
+    delete myPanel;
+    myPanel = 0;
 }
 
 
@@ -264,6 +322,7 @@ QList<Edge *> Node::edgesOut() const
 void Node::setName(QString name)
 {
     myName = name;
+    myParent->getModel()->setName(myId, name);
     update();
 }
 
@@ -277,6 +336,7 @@ void Node::setName(QString name)
 void Node::disable(bool val)
 {
     disabled = val;
+    myParent->getModel()->setDisabled(myId, val);
     emit this->update(boundingRect());
 }
 
@@ -290,6 +350,32 @@ bool Node::isDisabled()
 }
 
 
+/*!
+ * \brief Set evaluation profile shown as badge under node.
+ * \param time Node time in ns.
+ * \param share Share of node in whole evaluation time, 0...1.
+ * \param cache Cache state, see PROFILE_CACHE_* in pirilib.h
+ */
+void Node::setProfile(qint64 time, double share, int cache)
+{
+    myProfileTime = time;
+    myProfileShare = qBound(0.0, share, 1.0);
+    myProfileCache = cache;
+    update();
+}
+
+/*!
+ * \brief Remove evaluation profile badge.
+ */
+void Node::clearProfile()
+{
+    if (myProfileTime < 0)
+        return;
+    myProfileTime = -1;
+    update();
+}
+
+
 /*!
  * \brief Overrides bounding rectangle.
  *
@@ -299,7 +385,7 @@ bool Node::isDisabled()
 QRectF Node::boundingRect() const
 {
     QRectF bRect;
-    if (classTypeToInt(myClass) != 99) {
+    if (myClassType != 99) {
         qreal bx = (myName.length() - 10) * 4;
 
 
@@ -330,13 +416,13 @@ QPainterPath Node::shape() const
 {
     QPainterPath path;
 
-    if (classTypeToInt(myClass) < 21) {
+    if (myClassType < 21) {
         path.addRect(-40, -20, 80, 40);
     }
-    if (classTypeToInt(myClass) > 20 && classTypeToInt(myClass) < 31) {
+    if (myClassType > 20 && myClassType < 31) {
         path.addRoundedRect(QRectF(-40, -20, 80, 40), 10.0, 10.0);
     }
-    if (classTypeToInt(myClass) == 99) {
+    if (myClassType == 99) {
         path.addEllipse(QPointF(0, 0), 6, 6);
     }
     return path;
@@ -407,7 +493,7 @@ void Node::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
     // Joonistame kolmnurgakese alla kui väljundeid pole
 
     /*
-    if (edgesOut().isEmpty() && classTypeToInt(myClass) != 0) {
+    if (edgesOut().isEmpty() && myClassType != 0) {
         painter->setPen(bottomPen);
         painter->setBrush(bottomBrush);
         painter->drawPolygon(QPolygonF() << QPointF(-8, 15) << QPointF(8, 15) << QPointF(0, 25));
@@ -415,7 +501,7 @@ void Node::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
     */
 
 
-    switch (classTypeToInt(myClass)) {
+    switch (myClassType) {
     case 0:
         painter->setPen(viewerPen);
         painter->setBrush(viewerBrush);
@@ -441,7 +527,7 @@ void Node::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
         painter->setBrush(brush);
     }
 
-    if (classTypeToInt(myClass) > 20 && classTypeToInt(myClass) <= 40) {
+    if (myClassType > 20 && myClassType <= 40) {
         painter->setPen(geo2dPen);
         painter->setBrush(geo2dBrush);
     }
@@ -459,16 +545,16 @@ void Node::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
 
 
     // Node shape
-    if (classTypeToInt(myClass) <= 20) {
+    if (myClassType <= 20) {
         painter->drawRect(QRectF(-36, -16, 72, 32));
     }
 
-    if (classTypeToInt(myClass) > 20 && classTypeToInt(myClass) <= 30) {
+    if (myClassType > 20 && myClassType <= 30) {
         painter->drawRoundedRect(QRectF(-36, -16, 72, 32), 10.0, 10.0);
     }
 
     // Node text and stuff
-    if (classTypeToInt(myClass) < 99) {
+    if (myClassType < 99) {
         painter->setPen(fontPen);
         QFont serifFont("Verdana", NODE_DRAW_TEXTSIZE, QFont::Normal);
         painter->setFont(serifFont);
@@ -488,24 +574,35 @@ void Node::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
         painter->drawLine(QPointF(-36, 16), QPointF(36, -16));
     }
 
+    // Profile badge, green for fast nodes and red for nodes that take most time
+    if (myProfileTime >= 0 && myClassType < 99)
+    {
+        QColor badgeColor = QColor::fromHsvF((1.0 - myProfileShare) / 3.0, 0.7, 0.9);
+        if (myProfileCache == PROFILE_CACHE_HIT)
+            badgeColor = QColor::fromRgbF(0.5, 0.7, 1.0, 1);
+        painter->setPen(QPen(badgeColor.darker(150), 1));
+        painter->setBrush(badgeColor);
+        painter->drawRoundedRect(QRectF(-30, 17, 60, 11), 3.0, 3.0);
+        QString text = QString::number(myProfileTime / 1000000.0, 'f', myProfileTime < 10000000 ? 1 : 0) + " ms";
+        if (myProfileCache == PROFILE_CACHE_HIT)
+            text = "cache";
+        painter->setPen(fontPen);
+        painter->setFont(QFont("Verdana", NODE_DRAW_TEXTSIZE - 3, QFont::Normal));
+        painter->drawText(QRectF(-30, 17, 60, 11), Qt::AlignCenter, text);
+    }
+
 }
 
 
 /*!
  * \brief Double click event on node.
  *
- * Reimplemented function. If knob callback is not visible it will be
- * show in properties window.
+ * Reimplemented function. Opens node knob panel in properties window.
  * \param event
  */
 void Node::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event)
 {
-    makeCallback();
-    if (myCallback)
-    {
-        if (myCallback->isHidden() && myName != "Dot")
-            myCallback->show();
-    }
+    openPanel();
 }
 
 
@@ -523,16 +620,16 @@ QVariant Node::itemChange(GraphicsItemChange change, const QVariant &value)
 {
     switch (change) {
     case ItemPositionHasChanged:
+        myParent->getModel()->setPos(myId, pos());
         break;
     case ItemSelectedHasChanged:
         {
-        Op* op = dynamic_cast<Op*>(myOp);
-        if (op->getCallback())
+        if (myPanel)
         {
             if (this->isSelected()) {
-                op->getCallback()->setStyleSheet("KnobCallback { border: 2px solid rgb(240, 200, 100) }");
+                myPanel->setStyleSheet("KnobPanel { border: 2px solid rgb(240, 200, 100) }");
             } else {
-                op->getCallback()->setStyleSheet("KnobCallback { border: 0px solid black }");
+                myPanel->setStyleSheet("KnobPanel { border: 0px solid black }");
             }
         }
         }
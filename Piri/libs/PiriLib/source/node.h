@@ -5,12 +5,15 @@
 #include <QList>
 
 #include "pirilib.h"
+#include "hasher.h"
 
 class Edge;
 class NodeGraph;
 class KnobCallback;
+class KnobPanel;
 //class Knob_Callback;
 class OpInterfaceMI;
+struct OpDescriptor;
 QT_BEGIN_NAMESPACE
 class QGraphicsSceneMouseEvent;
 QT_END_NAMESPACE
@@ -21,6 +24,8 @@ class PIRILIBSHARED_EXPORT Node : public QGraphicsItem
 {
 public:
     Node(NodeGraph *nodeGraph, QString name, OpInterfaceMI *op);
+    Node(NodeGraph *nodeGraph, int id);
+    ~Node();
     enum { Type = UserType + 1 };
     int type() const { return Type; }
 
@@ -31,9 +36,11 @@ public:
     void setName(QString name);
     QString getName() { return myName; }
     QString getDesc() { return myDesc; }
-    int getClassType() { return classTypeToInt(myClass); }
+    int getClassType() { return myClassType; }
+    const OpDescriptor* getDescriptor() { return myDescriptor; }
     NodeGraph* getParent() { return myParent; }
     OpInterfaceMI* getOp() { return myOp; }
+    int getId() { return myId; }
 
     // Methods related to edges
     void addEdge(Edge *edge, int isMain);
@@ -49,15 +56,18 @@ public:
 
     // Methods related to callback
     void makeCallback();
+    void openPanel();
+    void deletePanel();
     KnobCallback* getCallback() { return myCallback; }
-
-    // Op execution method
-    void execute();
+    KnobPanel* getPanel() { return myPanel; }
 
     void disable(bool val);
     bool isDisabled();
 
-    QString getHash();
+    Hash128 getHash();
+
+    void setProfile(qint64 time, double share, int cache);
+    void clearProfile();
 
 
 protected:
@@ -65,10 +75,13 @@ protected:
     void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event);
 
 private:
+    void setup();
     void setupInputs();
     QString myName; /*!< Node name. First set in Op description. */
     QString myDesc; /*!< Node description. Set in Op description. */
     QString myClass; /*!< Node class. Set in Op description. */
+    int myClassType; /*!< Node class as type code, see classTypeToInt(). */
+    const OpDescriptor* myDescriptor; /*!< Op descriptor, shared by all nodes of same op. */
     QList<Edge *> edgeList; /*!< List of all node edges. */
     QPointF newPos; /*!< Some position holder. */
     NodeGraph *myParent; /*!< Nodegraph this node is in. */
@@ -79,8 +92,14 @@ private:
     bool disabled; /*!< Is node disabled? */
 
     KnobCallback* myCallback; /*!< Knob callback of node. */
+    KnobPanel* myPanel; /*!< Knob panel of node, shown in properties view. */
+
+    qint64 myProfileTime; /*!< Time of last evaluation in ns, -1 if not profiled. */
+    double myProfileShare; /*!< Share of node in time of last evaluation, 0...1. */
+    int myProfileCache; /*!< Cache state in last evaluation, see PROFILE_CACHE_* in pirilib.h */
 
-    OpInterfaceMI *myOp; /*!< Node OpInterface. Used instead of myOp in plugins. */
+    int myId; /*!< Node id in graph model. */
+    OpInterfaceMI *myOp; /*!< Node OpInterface, owned by graph model. Created by plugin factory. */
 };
 
 #endif // NODE_H
@@ -2,7 +2,13 @@
 #include "mainwindow.h"
 #include "node.h"
 #include "edge.h"
+#include "knobcallback.h"
+#include "graphfile.h"
+#include "graphmodel.h"
+#include "evalprofiler.h"
+#ifdef Q_OS_WIN
 #include "miconnect.h"
+#endif
 
 #include <QtWidgets>
 
@@ -12,6 +18,8 @@
  *
  * All operations that add, move, connect or delete nodes are performed here.
  * Subclasses QGraphicsScene. There can be multiple views into same nodegraph.
+ * Graph topology and ops are kept in graph model, nodes and edges in scene
+ * only show it.
  * \param parent Main UI window
  */
 NodeGraph::NodeGraph(MainWindow *parent)
@@ -23,12 +31,20 @@ NodeGraph::NodeGraph(MainWindow *parent)
     contextSelectedNode = 0;
     myMode = DAG_MODE_PAN;
     activeViewer = 0;
+    myModel = new GraphModel();
+    myProfiler = new EvalProfiler();
+    myModel->setProfiler(myProfiler);
+    myProfileVisible = true;
     //nodeStack = 0;
     //nodeList = 0;
     //evalStack = 0;
     //visitStack = 0;
 
+#ifdef Q_OS_WIN
     miConnect = new MIConnect();
+#else
+    miConnect = 0;
+#endif
     //addWidget(new QLineEdit("Tere!"));
 }
 
@@ -224,13 +240,10 @@ void NodeGraph::addOp(OpInterfaceMI *OpMI)
 {
     //myParent->logMessage("NodeGraph::addOp");
     QString opName;
-    opName = OpMI->description().split(";").first();
-    opName = opName.split("/").last();
+    opName = OpMI->descriptor()->name;
 
-    QGraphicsItem *item = 0;
-
-    item = new Node(this, opName, OpMI);
-    myParent->logMessage("NodeGraph::addOp item created");
+    Node *item = new Node(this, opName, OpMI);
+    myParent->logMessage("NodeGraph::addOp item created", LOG_LEVEL_VERBOSE);
     if (contextSelectedNode)
     {
         //contextMenuPos += QPoint(0.0, 40.0);
@@ -241,6 +254,8 @@ void NodeGraph::addOp(OpInterfaceMI *OpMI)
 
     clearSelection();
     item->setSelected(true);
+    // Node added by user is opened right away
+    item->openPanel();
 }
 
 
@@ -289,6 +304,7 @@ void NodeGraph::removeEdge(Edge *edge)
 {
     edge->sourceNode()->removeEdge(edge);
     edge->destNode()->removeEdge(edge);
+    myModel->setInput(edge->destNode()->getId(), edge->getInput(), -1);
     removeItem(edge);
     delete edge;
 }
@@ -302,9 +318,9 @@ void NodeGraph::removeEdge(Edge *edge)
  */
 void NodeGraph::removeNode(Node *node)
 {
-    myParent->logMessage(QString("Deleting: %1").arg(node->getCallback()->getParent()->getName()));
+    myParent->logMessage(QString("Deleting: %1").arg(node->getName()));
 
-    delete node->getCallback();
+    node->deletePanel();
 
     Edge *mE = node->getMainEdge();
     Node *mD = 0;
@@ -343,6 +359,92 @@ void NodeGraph::removeNode(Node *node)
     nodeList.clear();
     nodeList = tempList;
     removeItem(node);
+    myModel->removeNode(node->getId());
+}
+
+/*!
+ * \brief Saves node graph to graph file.
+ * \param fileName Path of graph file.
+ * \param format File format, see GRAPH_FORMAT_* in pirilib.h
+ * \return True on success.
+ */
+bool NodeGraph::saveGraph(QString fileName, int format)
+{
+    GraphFile file;
+    myModel->save(&file);
+
+    if (!file.write(fileName, format))
+    {
+        myParent->logMessage(file.getError(), LOG_LEVEL_ERROR);
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Opens graph file. Current graph is removed.
+ *
+ * Graph is loaded to graph model first, then nodes and edges are made
+ * to show it. Nodes do not make knob panels, panel is made when node
+ * is opened.
+ * \param fileName Path of graph file.
+ * \param manifest Plugin manifest that gives ops.
+ * \return True on success.
+ */
+bool NodeGraph::openGraph(QString fileName, PluginManifest *manifest)
+{
+    GraphFile file;
+    if (!file.read(fileName))
+    {
+        myParent->logMessage(file.getError(), LOG_LEVEL_ERROR);
+        return false;
+    }
+
+    clearGraph();
+    if (!myModel->load(file, manifest))
+    {
+        myParent->logMessage(myModel->getError(), LOG_LEVEL_ERROR);
+        myModel->clear();
+        return false;
+    }
+
+    // Model ids are in file order, views are kept in same order
+    QVector<int> ids = myModel->nodeIds();
+    QVector<Node *> views(myModel->nodeCount(), 0);
+    foreach (int id, ids) {
+        Node *node = new Node(this, id);
+        views[id] = node;
+        addItem(node);
+        nodeList << node;
+    }
+
+    // Inputs in model are already set, edges set them again to same nodes
+    foreach (int id, ids) {
+        Node *node = views.at(id);
+        for (int input = 0; input < node->getMaxInputs(); input++)
+        {
+            int source = myModel->inputNode(id, input);
+            Node *sourceNode = source >= 0 ? views.at(source) : 0;
+            int type = (input == 0 && node->getMaxInputs() > 1) ? EDGE_TYPE_BASE : EDGE_TYPE_DEFAULT;
+            node->addEdge(addEdge(new Edge(sourceNode, node, type)), input == 0 ? EDGE_IS_MAINEDGE : EDGE_NOT_MAINEDGE);
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Removes all nodes and edges from node graph.
+ */
+void NodeGraph::clearGraph()
+{
+    contextSelectedNode = 0;
+    activeViewer = 0;
+    nodeList.clear();
+    nodeStack.clear();
+    evalStack.clear();
+    visitStack.clear();
+    clear();
+    myModel->clear();
 }
 
 /*!
@@ -409,9 +511,10 @@ void NodeGraph::setActiveViewer(Node *node)
  */
 void NodeGraph::updateViewer()
 {
+#ifdef Q_OS_WIN
 
     miConnect->runCommand(QString("Close Window %1").arg(miConnect->getWindowID()));
-    myParent->logMessage("Parent to window...");
+    myParent->logMessage("Parent to window...", LOG_LEVEL_VERBOSE);
     miConnect->parentToWindow(myParent->getViewer());
     int c = 0;
     foreach (Edge *e, activeViewer->edgesIn())
@@ -423,53 +526,134 @@ void NodeGraph::updateViewer()
     {
         return;
     }
-    myParent->logMessage("Browse from... " + QString("_") + activeViewer->getHash());
-    miConnect->browseFromTable(QString("_") + activeViewer->getHash());
+    if (myParent->isLogging(LOG_LEVEL_VERBOSE))
+        myParent->logMessage("Browse from... " + QString("_") + activeViewer->getHash().toHex(), LOG_LEVEL_VERBOSE);
+    miConnect->browseFromTable(QString("_") + activeViewer->getHash().toHex());
     miConnect->setWindowID(QString(miConnect->evalCommand("WindowID(0)")).toInt());
     miConnect->runCommand(QString("Close Table selection"));
+#endif
 }
 
 
 /*!
  * \brief Evaluate node graph
+ *
+ * Command generation and running of every command are profiled, profile
+ * is shown on nodes after evaluation.
  */
 void NodeGraph::evaluate()
 {
     myParent->clearCommandList();
     myParent->logMessage("Evaluated graph!");
-    myParent->logMessage("Commandlist: ");
-    myParent->logMessage(myParent->getCommandList());
 
+    myProfiler->clear();
+    myCommandNodes.clear();
     execute();
-    myParent->logMessage(myParent->getCommandList());
-    foreach(QString command, myParent->getCommandList())
+    if (myParent->isLogging(LOG_LEVEL_VERBOSE))
     {
-        miConnect->runCommand(command);
+        myParent->logMessage("Commandlist: ", LOG_LEVEL_VERBOSE);
+        myParent->logMessage(myParent->getCommandList(), LOG_LEVEL_VERBOSE);
     }
+#ifdef Q_OS_WIN
+    QStringList commands = myParent->getCommandList();
+    for (int i = 0; i < commands.count(); i++)
+    {
+        int id = myCommandNodes.value(i, -1);
+        if (myModel->isValid(id))
+            myProfiler->begin(id, myModel->node(id).name, myModel->node(id).descriptor->name, "command");
+        miConnect->runCommand(commands.at(i));
+        if (myModel->isValid(id))
+            myProfiler->end();
+    }
+#endif
     updateViewer();
+    updateProfile();
+}
+
+/*!
+ * \brief Show profile of last evaluation on nodes.
+ *
+ * Badge color goes from green to red by share of node in evaluation time.
+ */
+void NodeGraph::updateProfile()
+{
+    if (myParent->isLogging(LOG_LEVEL_VERBOSE))
+        myParent->logMessage(myProfiler->summary().split("\n"), LOG_LEVEL_VERBOSE);
+
+    qint64 total = myProfiler->getTotalTime();
+    foreach (Node *node, nodeList) {
+        if (!myProfileVisible || !myProfiler->contains(node->getId()))
+        {
+            node->clearProfile();
+            continue;
+        }
+        NodeProfile p = myProfiler->node(node->getId());
+        node->setProfile(p.time, total > 0 ? double(p.time) / total : 0.0, p.cache);
+    }
+}
+
+/*!
+ * \brief Show or hide profile badges on nodes.
+ * \param visible Are badges shown?
+ */
+void NodeGraph::setProfileVisible(bool visible)
+{
+    myProfileVisible = visible;
+    updateProfile();
+}
+
+/*!
+ * \brief Get execution plan of active viewer as text.
+ *
+ * Nothing is run, commands are only generated. Cost comes from profile
+ * of last evaluation.
+ * \return Plan, or message if there is no active viewer.
+ * @see GraphModel::plan()
+ */
+QString NodeGraph::planText()
+{
+    if (!activeViewer)
+        return tr("No active viewer");
+    return GraphModel::planText(myModel->plan(activeViewer->getId(), 0, 0));
+}
+
+/*!
+ * \brief Write profile of last evaluation as Chrome trace JSON.
+ * \param fileName Path of output file.
+ * \return True on success.
+ * @see EvalProfiler::writeChromeTrace()
+ */
+bool NodeGraph::writeProfile(QString fileName)
+{
+    if (!myProfiler->writeChromeTrace(fileName))
+    {
+        myParent->logMessage(myProfiler->getError(), LOG_LEVEL_ERROR);
+        return false;
+    }
+    return true;
 }
 
 
 /*!
  * \brief Node graph execution method.
  *
- * Calls the execute() function on last node in evaluation stack 'evalStack'.
- * Usually it is the active viewer node.
+ * Generates commands for active viewer and all nodes above it from
+ * graph model. Every node gives its command once.
  * @see evaluate()
- * @see Node::execute()
+ * @see GraphModel::commands()
  */
 void NodeGraph::execute()
 {
-    myParent->logMessage("Execute!");
+    myParent->logMessage("Execute!", LOG_LEVEL_VERBOSE);
     if (!activeViewer)
     {
-        myParent->logMessage("No active viewer!");
+        myParent->logMessage("No active viewer!", LOG_LEVEL_VERBOSE);
         foreach(Node* n, nodeList)
         {
             if (n->getClassType() == NODE_TYPE_VIEWER)
             {
                 activeViewer = n;
-                myParent->logMessage("Active viewer: " + activeViewer->getName());
+                myParent->logMessage("Active viewer: " + activeViewer->getName(), LOG_LEVEL_VERBOSE);
             }
         }
         if (!activeViewer)
@@ -477,7 +661,7 @@ void NodeGraph::execute()
     }
     if (!activeViewer)
     {
-        myParent->logMessage("Why no active viewer!");
+        myParent->logMessage("Why no active viewer!", LOG_LEVEL_ERROR);
         return;
     }
     int c = 0;
@@ -492,12 +676,6 @@ void NodeGraph::execute()
         return;
     }
 
-    evaluateNode(activeViewer);
-    myParent->logMessage("Evaluated active viewer!");
-    myParent->logMessage(debugStack(evalStack));
-    if (evalStack.count() > 1)
-    {
-        myParent->logMessage("Evalstack last: " + evalStack.last()->getName());
-        evalStack.last()->execute();
-    }
+    foreach (QString command, myModel->commands(activeViewer->getId(), &myCommandNodes))
+        myParent->appendCommand(command);
 }
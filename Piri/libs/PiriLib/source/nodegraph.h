@@ -12,6 +12,9 @@ class MainWindow;
 class Node;
 class Edge;
 class MIConnect;
+class GraphModel;
+class EvalProfiler;
+class PluginManifest;
 
 class PIRILIBSHARED_EXPORT NodeGraph : public QGraphicsScene
 {
@@ -20,6 +23,8 @@ class PIRILIBSHARED_EXPORT NodeGraph : public QGraphicsScene
 public:
     NodeGraph(MainWindow *parent = 0);
     MainWindow* getParent();
+    GraphModel* getModel() { return myModel; }
+    EvalProfiler* getProfiler() { return myProfiler; }
     int getMode();
     void setMode(int mode);
 
@@ -39,6 +44,11 @@ public:
     void removeEdge(Edge *edge);
     void removeNode(Node *node);
 
+    QList<Node *> getNodes() { return nodeList; }
+    bool saveGraph(QString fileName, int format = GRAPH_FORMAT_BINARY);
+    bool openGraph(QString fileName, PluginManifest *manifest);
+    void clearGraph();
+
     // Methods dealing with viewers
     void setActiveViewer(Node* node);
     Node* getActiveViewer();
@@ -48,11 +58,22 @@ public:
     // Graph execution method
     void execute();
 
+    // Evaluation profile
+    bool writeProfile(QString fileName);
+    QString planText();
+
 public slots:
     void addOp(OpInterfaceMI *OpMI);
+    void setProfileVisible(bool visible);
 
 private:
+    void updateProfile();
+
     MainWindow *myParent; /*!< Nodegraph parent object. */
+    GraphModel *myModel; /*!< Graph model this scene shows. */
+    EvalProfiler *myProfiler; /*!< Profile of last evaluation. */
+    QVector<int> myCommandNodes; /*!< Node id of every command in command list. */
+    bool myProfileVisible; /*!< Are profile badges shown on nodes? */
     int myMode;
 
     QList<Node *> nodeList; /*!< List of all nodes in nodegraph. */
@@ -4,6 +4,21 @@
 #include "knobcallback.h"
 #include "nodegraph.h"
 #include "mainwindow.h"
+#include "graphmodel.h"
+
+/*!
+ * \brief Op constructor.
+ *
+ * Op is instanced once per node, see OpInterfaceMI::create().
+ */
+Op::Op()
+{
+    myParent = 0;
+    myCallback = 0;
+    myModel = 0;
+    myId = -1;
+    inputCount = 0;
+}
 
 /*!
  * \brief Calls engine() on Op (through OpInterface)
@@ -35,31 +50,16 @@ void Op::setParent(Node *node)
 }
 
 /*!
- * \brief Called instead of evaluate when node is disabled.
+ * \brief Set graph model that holds op.
  *
- * If node is disabled, calls it's input nodes instead.
+ * Called by GraphModel::addNode().
+ * \param model Graph model
+ * \param id Node id in model
  */
-void Op::disabled()
+void Op::setModel(GraphModel *model, int id)
 {
-
-    if (myParent->edgesIn().count())
-    {
-        foreach (Edge* e, myParent->edgesIn())
-        {
-            e->sourceNode()->execute();
-        }
-    } else {
-        // Clear model or do nothing
-    }
-    /*
-    if (myInputNodes.count())
-    {
-        foreach (Node* n, myInputNodes)
-        {
-            n->execute();
-        }
-    }
-    */
+    myModel = model;
+    myId = id;
 }
 
 /*!
@@ -92,26 +92,34 @@ QList<Node*> Op::getInputNodes()
 
 /*!
  * \brief Get knob by name
+ *
+ * Knob widgets exist only while node knob panel is open.
  * \param knobName Name of knob
- * \return Knob as QWidget
+ * \return Knob as QWidget, 0 if node has no panel or no such knob.
  */
 QWidget* Op::getKnob(QString knobName)
 {
-    return myCallback->getKnob(knobName)->widget;
+    if (!myCallback)
+        return 0;
+    KnobStruct *kn = myCallback->getKnob(knobName);
+    return kn ? kn->widget : 0;
 }
 
 /*!
  * \brief Get hash of op parent node
- * \return Hash as string.
+ *
+ * Use toHex() of hash for table names.
+ * \return Node hash
  */
-QString Op::getHash()
+Hash128 Op::getHash()
 {
-    return myCallback->getParent()->getHash();
+    return myModel->hash(myId);
 }
 
 /*!
- * \brief Get hash of op parent node
- * \return Hash as string.
+ * \brief Get node connected to input
+ * \param order Input number, 0 is main input.
+ * \return Input node
  */
 Node* Op::getInput(int order)
 {
@@ -122,3 +130,28 @@ Node* Op::getInput(int order)
         return r;
     return 0;
 }
+
+/*!
+ * \brief Is input connected?
+ *
+ * Disabled nodes pass their input through, so input is connected only if
+ * there is enabled node above.
+ * \param order Input number, 0 is main input.
+ * \return True if input has data.
+ */
+bool Op::hasInput(int order)
+{
+    return myModel->resolveInput(myId, order) >= 0;
+}
+
+/*!
+ * \brief Get hash of node that gives data to input.
+ *
+ * MapBasic ops use it as input table name.
+ * \param order Input number, 0 is main input.
+ * \return Node hash, null hash if input is not connected.
+ */
+Hash128 Op::getInputHash(int order)
+{
+    return myModel->hash(myModel->resolveInput(myId, order));
+}
@@ -3,34 +3,40 @@
 
 #include <QtWidgets>
 #include "pirilib.h"
+#include "hasher.h"
 
 class KnobCallback;
 class Node;
 class Edge;
+class GraphModel;
 
 class PIRILIBSHARED_EXPORT Op
 {
 public:
+    Op();
     void evaluate();
     void setCallback(KnobCallback *callback);
     KnobCallback* getCallback() {return myCallback;}
     QWidget* getKnob(QString knobName);
 
-    void disabled();
-
     int numInputs();
     QList<Edge*> inputs();
     QList<Node*> getInputNodes();
     void setParent(Node* node);
+    void setModel(GraphModel* model, int id);
 
-    QString getHash();
+    Hash128 getHash();
     Node* getInput(int order);
+    bool hasInput(int order);
+    Hash128 getInputHash(int order);
 
 protected:
     QString myName;
     QString myDesc;
     Node* myParent;
     KnobCallback* myCallback; /*! Op callback. */
+    GraphModel* myModel; /*! Graph model that holds op. */
+    int myId; /*! Node id in graph model. */
     int inputCount; /*! Number of inputs. To be removed. */
     QList<Edge*> myInputs; /*! List of input edges */
     QList<Node*> myInputNodes; /*! List of input nodes. Will replace myInputs */
@@ -0,0 +1,37 @@
+#ifndef OPDESCRIPTOR_H
+#define OPDESCRIPTOR_H
+
+#include "pirilib_global.h"
+
+/*!
+ * \brief Column declared in op output schema.
+ *
+ * Column types are defined in pirilib.h (COLUMN_TYPE_*).
+ */
+struct OpColumn {
+    const char* name;
+    int type;
+};
+
+/*!
+ * \brief Static description of op.
+ *
+ * Every plugin defines one constexpr descriptor and returns it from
+ * OpInterfaceMI::descriptor(). Descriptor is read once per plugin and
+ * shared by all nodes of that op, nothing is parsed at node creation.
+ * Schema kinds are defined in pirilib.h (OP_SCHEMA_*). Declared columns
+ * are the whole output for OP_SCHEMA_FIXED and are appended to input
+ * columns for OP_SCHEMA_APPEND.
+ */
+struct OpDescriptor {
+    const char* menuClass; /*!< Menu class, also decides node type. */
+    const char* name; /*!< Op name, default node name. */
+    const char* description; /*!< Short description, shown as tooltip. */
+    int minInputs; /*!< Number of inputs needed for evaluation. */
+    int maxInputs; /*!< Number of input edges node gets. */
+    int schema; /*!< Kind of output schema. */
+    const OpColumn* columns; /*!< Declared output columns or 0. */
+    int columnCount; /*!< Number of declared output columns. */
+};
+
+#endif // OPDESCRIPTOR_H
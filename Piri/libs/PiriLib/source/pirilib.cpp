@@ -1,6 +1,7 @@
 #include "pirilib.h"
 
-#include "QCryptographicHash"
+#include "hasher.h"
+
 #include "QString"
 
 
@@ -8,9 +9,15 @@ PiriLib::PiriLib()
 {
 }
 
+/*!
+ * \brief Generate hash of string.
+ * \param hashBase String to hash.
+ * \return 128 bit hash as 32 hex characters.
+ * @see Hasher
+ */
 QString generateHash(QString hashBase)
 {
-    QString hashString;
-    hashString = QString(QCryptographicHash::hash(hashBase.toLatin1(),QCryptographicHash::Md5).toHex());
-    return hashString;
+    Hasher hasher;
+    hasher.addString(hashBase);
+    return hasher.toHex();
 }
@@ -18,6 +18,33 @@
 #define NODE_TYPE_GEOMETRY  4
 #define NODE_TYPE_DOT       99
 
+#define OP_SCHEMA_NONE      0
+#define OP_SCHEMA_INPUT     1
+#define OP_SCHEMA_SOURCE    2
+#define OP_SCHEMA_APPEND    3
+#define OP_SCHEMA_FIXED     4
+
+#define COLUMN_TYPE_STRING  0
+#define COLUMN_TYPE_INTEGER 1
+#define COLUMN_TYPE_FLOAT   2
+#define COLUMN_TYPE_LOGICAL 3
+#define COLUMN_TYPE_DATE    4
+
+#define GEOMETRY_TYPE_NONE  0
+#define GEOMETRY_TYPE_POINT 1
+#define GEOMETRY_TYPE_LINE  2
+#define GEOMETRY_TYPE_REGION 3
+#define GEOMETRY_RESOLUTION 0.01
+#define GEOMETRY_RESOLUTION_DEGREES 1e-7
+
+#define MAPINFO_CHARSET     "WindowsBalticRim"
+
+#define KNOB_TYPE_STRING    0
+#define KNOB_TYPE_INTEGER   1
+#define KNOB_TYPE_BOOL      2
+#define KNOB_TYPE_COMBOBOX  3
+#define KNOB_TYPE_FILE      4
+
 #define NODE_DRAW_WIDTH     40
 #define NODE_DRAW_HEIGHT    20
 #define NODE_DRAW_RADIUS    2
@@ -37,6 +64,48 @@
 #define EDGE_ARROWSIZE      10
 #define EDGE_BBOX_PENWIDTH  8
 
+#define LOG_LEVEL_ERROR     0
+#define LOG_LEVEL_INFO      1
+#define LOG_LEVEL_VERBOSE   2
+
+#define MESSAGE_LOG_CAPACITY 5000
+
+#define GRAPH_FORMAT_BINARY 0
+#define GRAPH_FORMAT_TEXT   1
+#define GRAPH_FILE_VERSION  1
+
+#define RESULT_CACHE_SIZE   (Q_INT64_C(2) * 1024 * 1024 * 1024)
+#define RESULT_CACHE_VERSION 3
+
+#define STREAM_BATCH_ROWS   65536
+
+#define PROFILE_CACHE_NONE  0
+#define PROFILE_CACHE_HIT   1
+#define PROFILE_CACHE_MISS  2
+
+#define PLAN_ACTION_RUN     0
+#define PLAN_ACTION_CACHED  1
+#define PLAN_ACTION_SKIPPED 2
+#define PLAN_ACTION_DISABLED 3
+
+#define JOIN_TYPE_INNER     0
+#define JOIN_TYPE_LEFT      1
+#define JOIN_TYPE_SEMI      2
+
+#define CLASSIFY_EQUAL      0
+#define CLASSIFY_QUANTILE   1
+#define CLASSIFY_JENKS      2
+#define CLASSIFY_CACHE_SIZE 256
+
+#define CARTOGRAM_TARGET_ERROR 0.01
+
+#define TILE_SIZE           256
+#define TILE_MAX_ZOOM       24
+#define TILE_GRID_WEBMERCATOR 0
+#define TILE_GRID_DATA      1
+#define TILE_WEBMERCATOR_EXTENT 20037508.342789244
+#define TILE_WEBMERCATOR_COORDSYS "CoordSys Earth Projection 10, 157, \"m\", 0"
+
 class PIRILIBSHARED_EXPORT PiriLib
 {
     
@@ -0,0 +1,272 @@
+#include "pluginmanifest.h"
+#include "interfaces.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QLibrary>
+#include <QPluginLoader>
+#include <QtDebug>
+
+
+/*!
+ * \brief Plugin manifest.
+ *
+ * Keeps description, menu class and number of inputs of every plugin in
+ * plugins directory. Manifest is persisted to file so plugin libraries
+ * do not have to be loaded at startup. Library is loaded only when its op
+ * is instanced for the first time.
+ * \param pluginsDir Directory that holds plugin libraries.
+ * \param manifestFile File where manifest is persisted.
+ */
+PluginManifest::PluginManifest(QDir pluginsDir, QString manifestFile)
+{
+    myPluginsDir = pluginsDir;
+    myManifestFile = manifestFile;
+    myRemoved = 0;
+}
+
+/*!
+ * \brief Manifest destructor. Unloads all loaded plugins.
+ */
+PluginManifest::~PluginManifest()
+{
+    foreach (QPluginLoader *loader, myLoaders)
+    {
+        delete loader;
+    }
+    myLoaders.clear();
+}
+
+/*!
+ * \brief Scans plugins directory.
+ *
+ * Every library is checked against manifest cache by file size and
+ * modification time. Only libraries that are new or have changed are
+ * loaded to read their description.
+ * Cached entries of libraries that no longer exist are dropped, so
+ * manifest never points ops to deleted files.
+ * \return Number of plugins that had to be loaded for scanning.
+ * @see getRemoved()
+ */
+int PluginManifest::scan()
+{
+    int loaded = 0;
+    myEntries.clear();
+
+    myRemoved = 0;
+    foreach (QString fileName, myCache.keys())
+    {
+        if (!QFile::exists(fileName))
+        {
+            myCache.remove(fileName);
+            myRemoved += 1;
+        }
+    }
+
+    foreach (QFileInfo info, myPluginsDir.entryInfoList(QDir::Files, QDir::Name))
+    {
+        if (!QLibrary::isLibrary(info.fileName()))
+            continue;
+
+        PluginEntry entry;
+        entry.fileName = info.absoluteFilePath();
+        entry.size = info.size();
+        entry.modified = info.lastModified().toMSecsSinceEpoch();
+        entry.minInputs = 0;
+        entry.maxInputs = 0;
+
+        if (myCache.contains(entry.fileName))
+        {
+            PluginEntry cached = myCache.value(entry.fileName);
+            if (cached.size == entry.size && cached.modified == entry.modified)
+            {
+                myEntries.append(cached);
+                continue;
+            }
+        }
+
+        // Libraries that are not ops are kept with empty op name,
+        // so they are not loaded again on next startup. Library that
+        // failed to load, for example for missing dependency, is tried
+        // again on next scan.
+        loaded += 1;
+        bool ok = readPlugin(&entry);
+        myEntries.append(entry);
+        if (ok)
+            myCache.insert(entry.fileName, entry);
+        else
+            myCache.remove(entry.fileName);
+    }
+    return loaded;
+}
+
+/*!
+ * \brief Loads library once to read its op description.
+ *
+ * Library is unloaded again after reading, it is loaded for good when
+ * op is needed. Op name stays empty if library is not a Piri op.
+ * \param entry Entry to fill.
+ * \return False if library could not be loaded.
+ */
+bool PluginManifest::readPlugin(PluginEntry *entry)
+{
+    QPluginLoader loader(entry->fileName);
+    QObject *plugin = loader.instance();
+    if (!plugin)
+    {
+        qDebug() << "Not a plugin: " << entry->fileName << loader.errorString();
+        return false;
+    }
+
+    OpInterfaceMI *OpMI = qobject_cast<OpInterfaceMI *>(plugin);
+    if (!OpMI)
+    {
+        loader.unload();
+        return true;
+    }
+
+    readDescriptor(entry, OpMI->descriptor());
+    loader.unload();
+    return true;
+}
+
+/*!
+ * \brief Copies op descriptor fields into entry.
+ * \param entry Entry to fill.
+ * \param descriptor Op descriptor.
+ */
+void PluginManifest::readDescriptor(PluginEntry *entry, const OpDescriptor *descriptor)
+{
+    entry->menuClass = descriptor->menuClass;
+    entry->opName = descriptor->name;
+    entry->opDesc = descriptor->description;
+    entry->minInputs = descriptor->minInputs;
+    entry->maxInputs = descriptor->maxInputs;
+}
+
+/*!
+ * \brief Reads manifest cache from file.
+ * \return True if manifest was read.
+ */
+bool PluginManifest::load()
+{
+    QFile file(myManifestFile);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    QJsonObject root = doc.object();
+    if (root.value("version").toDouble() != PLUGIN_MANIFEST_VERSION)
+    {
+        myError = "Plugin manifest version mismatch: " + myManifestFile;
+        return false;
+    }
+
+    myCache.clear();
+    foreach (QJsonValue v, root.value("plugins").toArray())
+    {
+        QJsonObject o = v.toObject();
+        PluginEntry entry;
+        entry.fileName = o.value("file").toString();
+        entry.size = (qint64)o.value("size").toDouble();
+        entry.modified = (qint64)o.value("modified").toDouble();
+        entry.opName = o.value("name").toString();
+        entry.menuClass = o.value("class").toString();
+        entry.opDesc = o.value("description").toString();
+        entry.minInputs = (int)o.value("minInputs").toDouble();
+        entry.maxInputs = (int)o.value("maxInputs").toDouble();
+        myCache.insert(entry.fileName, entry);
+    }
+    return true;
+}
+
+/*!
+ * \brief Writes manifest cache to file.
+ *
+ * Cache is written as whole, so entries of other plugin directories
+ * stay in manifest.
+ * \return True if manifest was written.
+ */
+bool PluginManifest::save()
+{
+    QJsonArray plugins;
+    foreach (PluginEntry entry, myCache)
+    {
+        QJsonObject o;
+        o.insert("file", entry.fileName);
+        o.insert("size", (double)entry.size);
+        o.insert("modified", (double)entry.modified);
+        o.insert("name", entry.opName);
+        o.insert("class", entry.menuClass);
+        o.insert("description", entry.opDesc);
+        o.insert("minInputs", entry.minInputs);
+        o.insert("maxInputs", entry.maxInputs);
+        plugins.append(o);
+    }
+    QJsonObject root;
+    root.insert("version", PLUGIN_MANIFEST_VERSION);
+    root.insert("plugins", plugins);
+
+    QFileInfo info(myManifestFile);
+    if (!info.dir().exists())
+        info.dir().mkpath(".");
+
+    QFile file(myManifestFile);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        myError = "Can not write plugin manifest: " + myManifestFile;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    return true;
+}
+
+/*!
+ * \brief Get all libraries found in last scan.
+ *
+ * Libraries that are not ops have empty op name.
+ * \return List of plugin entries.
+ */
+QList<PluginEntry> PluginManifest::entries()
+{
+    return myEntries;
+}
+
+/*!
+ * \brief Get plugin entry by library file name.
+ * \param fileName Absolute path of library.
+ * \return Entry or 0 if not found.
+ */
+PluginEntry* PluginManifest::getEntry(QString fileName)
+{
+    for (int i = 0; i < myEntries.count(); i++)
+    {
+        if (myEntries[i].fileName == fileName)
+            return &myEntries[i];
+    }
+    return 0;
+}
+
+/*!
+ * \brief Get op of plugin, loading the library if needed.
+ * \param fileName Absolute path of library.
+ * \return Op interface or 0 if library could not be loaded.
+ */
+OpInterfaceMI* PluginManifest::loadOp(QString fileName)
+{
+    QPluginLoader *loader = myLoaders.value(fileName);
+    if (!loader)
+    {
+        loader = new QPluginLoader(fileName);
+        myLoaders.insert(fileName, loader);
+    }
+
+    OpInterfaceMI *OpMI = qobject_cast<OpInterfaceMI *>(loader->instance());
+    if (!OpMI)
+        myError = "Can not load plugin: " + fileName + " " + loader->errorString();
+    return OpMI;
+}
@@ -0,0 +1,59 @@
+#ifndef PLUGINMANIFEST_H
+#define PLUGINMANIFEST_H
+
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "pirilib.h"
+
+class OpInterfaceMI;
+struct OpDescriptor;
+QT_BEGIN_NAMESPACE
+class QPluginLoader;
+QT_END_NAMESPACE
+
+#define PLUGIN_MANIFEST_VERSION 2
+
+struct PluginEntry {
+    QString fileName; /*!< Absolute path of plugin library. */
+    qint64 size; /*!< Library file size at the time it was scanned. */
+    qint64 modified; /*!< Library modification time in ms since epoch. */
+    QString opName; /*!< Op name, shown in menu. Empty if library is not an op. */
+    QString menuClass; /*!< Menu class the op belongs to. */
+    QString opDesc; /*!< Short op description. */
+    int minInputs; /*!< Number of inputs needed for evaluation. */
+    int maxInputs; /*!< Maximum number of inputs. */
+};
+
+class PIRILIBSHARED_EXPORT PluginManifest
+{
+public:
+    PluginManifest(QDir pluginsDir, QString manifestFile);
+    ~PluginManifest();
+
+    int scan();
+    int getRemoved() { return myRemoved; }
+    bool load();
+    bool save();
+
+    QList<PluginEntry> entries();
+    PluginEntry* getEntry(QString fileName);
+    OpInterfaceMI* loadOp(QString fileName);
+    QString getError() { return myError; }
+
+private:
+    bool readPlugin(PluginEntry *entry);
+    void readDescriptor(PluginEntry *entry, const OpDescriptor *descriptor);
+
+    QDir myPluginsDir; /*!< Directory that holds plugin libraries. */
+    QString myManifestFile; /*!< File where manifest is persisted. */
+    QString myError; /*!< Last error message. */
+    QList<PluginEntry> myEntries; /*!< Known plugins in directory order. */
+    QHash<QString, PluginEntry> myCache; /*!< Entries read from manifest file, keyed by file name. */
+    int myRemoved; /*!< Number of cached entries dropped in last scan. */
+    QHash<QString, QPluginLoader*> myLoaders; /*!< Loaders of plugins that have been instantiated. */
+};
+
+#endif // PLUGINMANIFEST_H
@@ -0,0 +1,540 @@
+#include "resultcache.h"
+
+#include <string.h>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDateTime>
+#include <QtEndian>
+#include <QtDebug>
+
+static const quint32 tableMagic = 0x54524950; // "PIRT" in little endian
+static const quint32 indexMagic = 0x58524950; // "PIRX" in little endian
+static const quint16 hostOrder = Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? 1 : 2;
+
+
+/*!
+ * \brief Bounds checked reader over mapped cache file.
+ */
+struct CacheCursor {
+    const uchar *data;
+    qint64 size;
+    qint64 pos;
+    bool ok;
+
+    const uchar* take(qint64 length)
+    {
+        if (!ok || length < 0 || pos + length > size)
+        {
+            ok = false;
+            return 0;
+        }
+        const uchar *p = data + pos;
+        pos += length;
+        return p;
+    }
+    quint32 u32()
+    {
+        const uchar *p = take(4);
+        return p ? qFromLittleEndian<quint32>(p) : 0;
+    }
+    void align() { pos = (pos + 7) & ~Q_INT64_C(7); }
+};
+
+
+/*!
+ * \brief Result cache constructor.
+ *
+ * Result cache keeps node results on disk between sessions. Every result
+ * is one file named by node hash, so same node in same graph is loaded
+ * from cache instead of running its ops again. When cache gets bigger
+ * than size limit, least recently used results are removed.
+ *
+ * Result file is columnar. After small header every column is one block
+ * of values, aligned to 8 bytes. File is memory mapped when read and
+ * column blocks are copied to table vectors in one go.
+ * \param directory Cache directory, made if it does not exist.
+ * \param maxBytes Size limit of all results.
+ */
+ResultCache::ResultCache(QString directory, qint64 maxBytes)
+{
+    myDir = QDir(directory);
+    if (!myDir.exists())
+        myDir.mkpath(".");
+    myMaxBytes = maxBytes;
+    myTotalBytes = 0;
+    myDirty = false;
+    loadIndex();
+}
+
+/*!
+ * \brief Result cache destructor. Saves cache index.
+ */
+ResultCache::~ResultCache()
+{
+    if (myDirty)
+        saveIndex();
+}
+
+/*!
+ * \brief Get path of result file.
+ * \param hash Node hash
+ * \return File path
+ */
+QString ResultCache::fileName(const Hash128 &hash) const
+{
+    return myDir.filePath(hash.toHex() + ".pirt");
+}
+
+/*!
+ * \brief Is node result in cache?
+ * \param hash Node hash
+ * \return True if result is cached.
+ */
+bool ResultCache::contains(const Hash128 &hash) const
+{
+    return myEntries.contains(hash);
+}
+
+/*!
+ * \brief Load node result from cache.
+ *
+ * Broken or missing file is removed from cache.
+ * \param hash Node hash
+ * \return Result table or null pointer if it is not cached.
+ */
+TablePtr ResultCache::load(const Hash128 &hash)
+{
+    if (!myEntries.contains(hash))
+        return TablePtr();
+
+    QFile file(fileName(hash));
+    TablePtr table;
+    if (file.open(QIODevice::ReadOnly))
+    {
+        qint64 size = file.size();
+        uchar *data = size > 0 ? file.map(0, size) : 0;
+        if (data)
+        {
+            table = readTable(data, size);
+            file.unmap(data);
+        }
+        file.close();
+    }
+    if (!table)
+    {
+        myError = "Broken cache file " + file.fileName();
+        remove(hash);
+        return table;
+    }
+
+    myEntries[hash].lastUsed = QDateTime::currentMSecsSinceEpoch();
+    myDirty = true;
+    return table;
+}
+
+/*!
+ * \brief Store node result to cache.
+ *
+ * File is written under temporary name and renamed, so broken file is
+ * never left under node hash.
+ * \param hash Node hash
+ * \param table Result table
+ * \return True on success, see getError() otherwise.
+ */
+bool ResultCache::store(const Hash128 &hash, TablePtr table)
+{
+    if (!table || myEntries.contains(hash))
+        return true;
+
+    QString name = fileName(hash);
+    QFile file(name + ".tmp");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        myError = "Can not write " + file.fileName();
+        return false;
+    }
+    bool ok = writeTable(&file, table.data());
+    qint64 size = file.size();
+    file.close();
+    QFile::remove(name);
+    if (!ok || !file.rename(name))
+    {
+        file.remove();
+        myError = "Can not write " + name;
+        return false;
+    }
+
+    ResultCacheEntry entry;
+    entry.size = size;
+    entry.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    myEntries.insert(hash, entry);
+    myTotalBytes += size;
+    evict();
+    return saveIndex();
+}
+
+/*!
+ * \brief Remove all results from cache.
+ */
+void ResultCache::clear()
+{
+    foreach (const Hash128 &hash, myEntries.keys())
+        QFile::remove(fileName(hash));
+    myEntries.clear();
+    myTotalBytes = 0;
+    saveIndex();
+}
+
+/*!
+ * \brief Set size limit. Results over limit are removed at once.
+ * \param maxBytes Size limit in bytes.
+ */
+void ResultCache::setMaxBytes(qint64 maxBytes)
+{
+    myMaxBytes = maxBytes;
+    evict();
+}
+
+/*!
+ * \brief Remove one result.
+ * \param hash Node hash
+ */
+void ResultCache::remove(const Hash128 &hash)
+{
+    QFile::remove(fileName(hash));
+    myTotalBytes -= myEntries.value(hash).size;
+    myEntries.remove(hash);
+    myDirty = true;
+}
+
+/*!
+ * \brief Remove least recently used results until cache fits size limit.
+ */
+void ResultCache::evict()
+{
+    while (myTotalBytes > myMaxBytes && !myEntries.isEmpty())
+    {
+        QHash<Hash128, ResultCacheEntry>::const_iterator oldest = myEntries.constBegin();
+        for (QHash<Hash128, ResultCacheEntry>::const_iterator i = myEntries.constBegin(); i != myEntries.constEnd(); ++i)
+        {
+            if (i.value().lastUsed < oldest.value().lastUsed)
+                oldest = i;
+        }
+        remove(oldest.key());
+    }
+}
+
+/*!
+ * \brief Load cache index.
+ *
+ * Index keeps last use times. If index is missing or broken, result
+ * files in directory are used and their modification time is last use.
+ */
+void ResultCache::loadIndex()
+{
+    myEntries.clear();
+    myTotalBytes = 0;
+
+    QFile file(myDir.filePath("index"));
+    if (file.open(QIODevice::ReadOnly))
+    {
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_5_1);
+        in.setByteOrder(QDataStream::LittleEndian);
+        quint32 magic, count;
+        quint16 version;
+        in >> magic >> version >> count;
+        if (magic == indexMagic && version == RESULT_CACHE_VERSION)
+        {
+            for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++)
+            {
+                Hash128 hash;
+                ResultCacheEntry entry;
+                in >> hash.low >> hash.high >> entry.size >> entry.lastUsed;
+                if (in.status() == QDataStream::Ok && QFile::exists(fileName(hash)))
+                {
+                    myEntries.insert(hash, entry);
+                    myTotalBytes += entry.size;
+                }
+            }
+            if (in.status() == QDataStream::Ok)
+                return;
+        }
+        myEntries.clear();
+        myTotalBytes = 0;
+    }
+
+    foreach (QFileInfo info, myDir.entryInfoList(QStringList() << "*.pirt", QDir::Files)) {
+        // File name is hex of hash bytes, halves are little endian
+        QString hex = info.completeBaseName();
+        bool ok1, ok2;
+        quint64 low = hex.left(16).toULongLong(&ok1, 16);
+        quint64 high = hex.mid(16).toULongLong(&ok2, 16);
+        if (hex.length() != 32 || !ok1 || !ok2)
+            continue;
+        Hash128 hash(qbswap<quint64>(low), qbswap<quint64>(high));
+        ResultCacheEntry entry;
+        entry.size = info.size();
+        entry.lastUsed = info.lastModified().toMSecsSinceEpoch();
+        myEntries.insert(hash, entry);
+        myTotalBytes += entry.size;
+    }
+    myDirty = true;
+}
+
+/*!
+ * \brief Save cache index.
+ * \return True on success.
+ */
+bool ResultCache::saveIndex()
+{
+    QFile file(myDir.filePath("index"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        myError = "Can not write " + file.fileName();
+        return false;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_1);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << indexMagic << (quint16)RESULT_CACHE_VERSION << (quint32)myEntries.count();
+    for (QHash<Hash128, ResultCacheEntry>::const_iterator i = myEntries.constBegin(); i != myEntries.constEnd(); ++i)
+        out << i.key().low << i.key().high << i.value().size << i.value().lastUsed;
+    myDirty = false;
+    return out.status() == QDataStream::Ok;
+}
+
+
+/*!
+ * \brief Write little endian 32 bit integer.
+ */
+static void writeU32(QFile *file, quint32 value)
+{
+    uchar b[4];
+    qToLittleEndian<quint32>(value, b);
+    file->write((const char *)b, 4);
+}
+
+/*!
+ * \brief Write string as length and UTF-16 code units.
+ */
+static void writeString(QFile *file, const QString &s)
+{
+    writeU32(file, s.length());
+    file->write((const char *)s.constData(), s.length() * 2);
+}
+
+/*!
+ * \brief Pad file to 8 byte boundary.
+ */
+static void writeAlign(QFile *file)
+{
+    static const char zeros[8] = { 0 };
+    int pad = (8 - file->pos() % 8) % 8;
+    file->write(zeros, pad);
+}
+
+/*!
+ * \brief Write table to result file.
+ *
+ * Column blocks are in host byte order, header tells which order it is.
+ * Geometry is written as coordinate transform, row part offsets, part
+ * point and byte offsets and one block of coordinates as table stores
+ * them, so they are not decoded or encoded again.
+ * \param file Open file
+ * \param table Table
+ * \return True on success.
+ */
+bool ResultCache::writeTable(QFile *file, const Table *table)
+{
+    int rows = table->rowCount();
+    writeU32(file, tableMagic);
+    uchar b[2];
+    qToLittleEndian<quint16>(RESULT_CACHE_VERSION, b);
+    file->write((const char *)b, 2);
+    qToLittleEndian<quint16>(hostOrder, b);
+    file->write((const char *)b, 2);
+    writeU32(file, rows);
+    writeU32(file, table->columnCount());
+    writeString(file, table->getName());
+    for (int c = 0; c < table->columnCount(); c++)
+    {
+        writeU32(file, table->column(c).type);
+        writeString(file, table->column(c).name);
+    }
+    writeAlign(file);
+
+    for (int c = 0; c < table->columnCount(); c++)
+    {
+        const TableColumn &col = table->column(c);
+        switch (col.type) {
+        case COLUMN_TYPE_STRING:
+        {
+            QVector<quint32> offsets(rows + 1);
+            offsets[0] = 0;
+            for (int r = 0; r < rows; r++)
+                offsets[r + 1] = offsets.at(r) + col.strings.at(r).length();
+            file->write((const char *)offsets.constData(), offsets.size() * 4);
+            writeAlign(file);
+            for (int r = 0; r < rows; r++)
+                file->write((const char *)col.strings.at(r).constData(), col.strings.at(r).length() * 2);
+            break;
+        }
+        case COLUMN_TYPE_FLOAT:
+            file->write((const char *)col.floats.constData(), rows * sizeof(double));
+            break;
+        default:
+            file->write((const char *)col.integers.constData(), rows * sizeof(qint64));
+        }
+        writeAlign(file);
+    }
+
+    bool geometry = table->hasGeometry();
+    writeU32(file, geometry ? 1 : 0);
+    writeAlign(file);
+    if (geometry)
+    {
+        CoordTransform t = table->getTransform();
+        double transform[4] = { t.originX, t.originY, t.resolutionX, t.resolutionY };
+        file->write((const char *)transform, sizeof(transform));
+
+        QVector<quint8> types(rows);
+        QVector<quint32> parts(rows + 1);
+        QVector<quint32> points(1, 0);
+        QVector<quint32> offsets(1, 0);
+        parts[0] = 0;
+        for (int r = 0; r < rows; r++)
+        {
+            types[r] = table->geometryType(r);
+            parts[r + 1] = parts.at(r) + table->partCount(r);
+            for (int p = 0; p < table->partCount(r); p++)
+            {
+                points << points.last() + table->pointCount(r, p);
+                offsets << offsets.last() + table->partBytes(r, p);
+            }
+        }
+        file->write((const char *)types.constData(), rows);
+        writeAlign(file);
+        file->write((const char *)parts.constData(), parts.size() * 4);
+        writeAlign(file);
+        file->write((const char *)points.constData(), points.size() * 4);
+        writeAlign(file);
+        file->write((const char *)offsets.constData(), offsets.size() * 4);
+        writeAlign(file);
+        for (int r = 0; r < rows; r++)
+        {
+            for (int p = 0; p < table->partCount(r); p++)
+                file->write(table->partData(r, p), table->partBytes(r, p));
+        }
+    }
+    return file->error() == QFile::NoError;
+}
+
+/*!
+ * \brief Read table from mapped result file.
+ * \param data File data
+ * \param size File size
+ * \return Table or null pointer if file is broken or from other version.
+ */
+TablePtr ResultCache::readTable(const uchar *data, qint64 size)
+{
+    CacheCursor in = { data, size, 0, true };
+    if (in.u32() != tableMagic)
+        return TablePtr();
+    const uchar *v = in.take(4);
+    if (!v || qFromLittleEndian<quint16>(v) != RESULT_CACHE_VERSION || qFromLittleEndian<quint16>(v + 2) != hostOrder)
+        return TablePtr();
+
+    quint32 rows = in.u32();
+    quint32 columns = in.u32();
+    if (!in.ok || rows > (quint64)size || columns > (quint64)size)
+        return TablePtr();
+
+    quint32 length = in.u32();
+    const uchar *name = in.take((qint64)length * 2);
+    if (!in.ok)
+        return TablePtr();
+    TablePtr table(new Table(QString((const QChar *)name, length)));
+    for (quint32 c = 0; c < columns && in.ok; c++)
+    {
+        int type = in.u32();
+        length = in.u32();
+        name = in.take((qint64)length * 2);
+        if (in.ok)
+            table->addColumn(QString((const QChar *)name, length), type);
+    }
+    in.align();
+    if (!in.ok)
+        return TablePtr();
+    table->resize(rows);
+
+    for (quint32 c = 0; c < columns && in.ok; c++)
+    {
+        TableColumn &col = table->column(c);
+        switch (col.type) {
+        case COLUMN_TYPE_STRING:
+        {
+            const quint32 *offsets = (const quint32 *)in.take((qint64)(rows + 1) * 4);
+            in.align();
+            if (!offsets)
+                break;
+            const QChar *chars = (const QChar *)in.take((qint64)offsets[rows] * 2);
+            for (quint32 r = 0; chars && r < rows; r++)
+            {
+                if (offsets[r + 1] < offsets[r] || offsets[r + 1] > offsets[rows])
+                {
+                    in.ok = false;
+                    break;
+                }
+                col.strings[r] = QString(chars + offsets[r], offsets[r + 1] - offsets[r]);
+            }
+            break;
+        }
+        case COLUMN_TYPE_FLOAT:
+        {
+            const uchar *p = in.take((qint64)rows * sizeof(double));
+            if (p)
+                memcpy(col.floats.data(), p, rows * sizeof(double));
+            break;
+        }
+        default:
+        {
+            const uchar *p = in.take((qint64)rows * sizeof(qint64));
+            if (p)
+                memcpy(col.integers.data(), p, rows * sizeof(qint64));
+        }
+        }
+        in.align();
+    }
+
+    quint32 geometry = in.u32();
+    in.align();
+    if (geometry && in.ok)
+    {
+        const double *transform = (const double *)in.take(4 * sizeof(double));
+        if (!transform)
+            return TablePtr();
+        CoordTransform t = { transform[0], transform[1], transform[2], transform[3] };
+        table->setTransform(t);
+
+        const quint8 *types = in.take(rows);
+        in.align();
+        const quint32 *parts = (const quint32 *)in.take((qint64)(rows + 1) * 4);
+        in.align();
+        if (!parts || parts[rows] > (quint64)size)
+            return TablePtr();
+        const quint32 *points = (const quint32 *)in.take((qint64)(parts[rows] + 1) * 4);
+        in.align();
+        const quint32 *offsets = (const quint32 *)in.take((qint64)(parts[rows] + 1) * 4);
+        in.align();
+        if (!points || !offsets || offsets[parts[rows]] > (quint64)size)
+            return TablePtr();
+        const char *coords = (const char *)in.take(offsets[parts[rows]]);
+        if (!in.ok || !types || !table->setStoredGeometry(types, parts, points, offsets, coords))
+            return TablePtr();
+    }
+    if (!in.ok)
+        return TablePtr();
+    return table;
+}
@@ -0,0 +1,56 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QString>
+#include <QDir>
+#include <QHash>
+
+#include "pirilib.h"
+#include "table.h"
+#include "hasher.h"
+
+class QFile;
+
+/*!
+ * \brief Cache entry of one node result.
+ */
+struct ResultCacheEntry {
+    qint64 size; /*!< File size in bytes. */
+    qint64 lastUsed; /*!< Last use time in ms since epoch. */
+};
+
+class PIRILIBSHARED_EXPORT ResultCache
+{
+public:
+    ResultCache(QString directory, qint64 maxBytes = RESULT_CACHE_SIZE);
+    ~ResultCache();
+
+    bool contains(const Hash128 &hash) const;
+    TablePtr load(const Hash128 &hash);
+    bool store(const Hash128 &hash, TablePtr table);
+    void clear();
+
+    void setMaxBytes(qint64 maxBytes);
+    qint64 getMaxBytes() { return myMaxBytes; }
+    qint64 getTotalBytes() { return myTotalBytes; }
+    QString getError() { return myError; }
+
+private:
+    QString fileName(const Hash128 &hash) const;
+    void remove(const Hash128 &hash);
+    void evict();
+    void loadIndex();
+    bool saveIndex();
+
+    static bool writeTable(QFile *file, const Table *table);
+    static TablePtr readTable(const uchar *data, qint64 size);
+
+    QDir myDir; /*!< Cache directory. */
+    qint64 myMaxBytes; /*!< Size limit of all cache files. */
+    qint64 myTotalBytes; /*!< Size of all cache files. */
+    QHash<Hash128, ResultCacheEntry> myEntries; /*!< Cached results by node hash. */
+    bool myDirty; /*!< Has index changed since it was saved? */
+    QString myError; /*!< Last error. */
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,460 @@
+#include "shapereader.h"
+
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QTextCodec>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <string.h>
+#include <limits.h>
+
+namespace {
+
+inline qint32 readInt32(const uchar *p) { return qFromLittleEndian<qint32>(p); }
+inline qint32 readInt32BE(const uchar *p) { return qFromBigEndian<qint32>(p); }
+
+inline double readDouble(const uchar *p)
+{
+    quint64 bits = qFromLittleEndian<quint64>(p);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+const int headerSize = 100;
+const int chunkRecords = 4096;
+
+/*!
+ * \brief Records read by one task.
+ */
+struct ShapeChunk {
+    const int *records; /*!< Record indices */
+    int count; /*!< Number of records */
+    TablePtr table; /*!< Returns rows of records. */
+    QString error; /*!< Returns error, empty on success. */
+};
+
+/*!
+ * \brief Reads chunks of records, tasks share only mapped files.
+ */
+struct ReadChunk {
+    typedef void result_type;
+
+    const ShapeReader *reader;
+
+    void operator()(ShapeChunk &chunk) const
+    {
+        chunk.table = reader->readRecords(chunk.records, chunk.count, &chunk.error);
+    }
+};
+
+}
+
+
+/*!
+ * \brief Shapefile reader constructor.
+ *
+ * Reader reads ESRI Shapefile (.shp, .shx, .dbf, .prj, .cpg) into native
+ * table, same as TabReader does for MapInfo tables. Points, multipoints,
+ * polylines and polygons are read, Z and M values are ignored.
+ * \param fileName Path of .shp file.
+ */
+ShapeReader::ShapeReader(QString fileName)
+{
+    myFileName = fileName;
+    myCodec = 0;
+    myRecordCount = 0;
+    myNextRecord = 0;
+    myShp = 0;
+    myShpSize = 0;
+    myShx = 0;
+    myRecords = 0;
+    myRecordLength = 0;
+}
+
+/*!
+ * \brief Read table.
+ * \return Table or null pointer on error, see getError().
+ */
+TablePtr ShapeReader::read()
+{
+    if (!open())
+        return TablePtr();
+    return readBatch(INT_MAX);
+}
+
+/*!
+ * \brief Open shapefile for reading in batches.
+ *
+ * Files are mapped, but no rows are read yet. Shapefile without .dbf file
+ * is read without columns and without .shx file its records are found
+ * by walking through .shp file.
+ * \return True on success, see getError() otherwise.
+ */
+bool ShapeReader::open()
+{
+    QFile prj(fileWithSuffix("prj"));
+    if (prj.open(QIODevice::ReadOnly | QIODevice::Text))
+        myPrj = QString::fromLatin1(prj.readAll()).trimmed();
+    if (!openShp())
+        return false;
+    if (QFile::exists(fileWithSuffix("dbf")) && !openDbf())
+        return false;
+    return true;
+}
+
+/*!
+ * \brief Get path of shapefile file with other suffix.
+ *
+ * Both lower and upper case suffixes are tried.
+ * \param suffix Suffix without dot, for example "dbf".
+ * \return Path of file.
+ */
+QString ShapeReader::fileWithSuffix(QString suffix)
+{
+    QFileInfo fi(myFileName);
+    QString base = fi.path() + "/" + fi.completeBaseName() + ".";
+    if (QFile::exists(base + suffix.toLower()))
+        return base + suffix.toLower();
+    if (QFile::exists(base + suffix.toUpper()))
+        return base + suffix.toUpper();
+    return base + suffix.toLower();
+}
+
+/*!
+ * \brief Map .shp and .shx files and read .shp header.
+ *
+ * Table coordinates start from lower left corner of .shp bounds, with
+ * GEOMETRY_RESOLUTION_DEGREES for geographic and GEOMETRY_RESOLUTION for
+ * projected coordinates.
+ * \return True on success.
+ */
+bool ShapeReader::openShp()
+{
+    myShpFile.setFileName(myFileName);
+    if (!myShpFile.open(QIODevice::ReadOnly))
+    {
+        myError = "Can not open " + myFileName;
+        return false;
+    }
+    myShpSize = myShpFile.size();
+    myShp = myShpSize >= headerSize ? myShpFile.map(0, myShpSize) : 0;
+    if (!myShp || readInt32BE(myShp) != 9994)
+    {
+        myError = "Not a shapefile: " + myFileName;
+        return false;
+    }
+
+    double minX = readDouble(myShp + 36);
+    double minY = readDouble(myShp + 44);
+    bool geographic = myPrj.startsWith("GEOGCS", Qt::CaseInsensitive);
+    myTransform.originX = qIsFinite(minX) ? minX : 0.0;
+    myTransform.originY = qIsFinite(minY) ? minY : 0.0;
+    myTransform.resolutionX = geographic ? GEOMETRY_RESOLUTION_DEGREES : GEOMETRY_RESOLUTION;
+    myTransform.resolutionY = myTransform.resolutionX;
+
+    myShxFile.setFileName(fileWithSuffix("shx"));
+    if (myShxFile.open(QIODevice::ReadOnly) && myShxFile.size() >= headerSize)
+    {
+        myShx = myShxFile.map(0, myShxFile.size());
+        myRecordCount = (myShxFile.size() - headerSize) / 8;
+    }
+    if (!myShx)
+    {
+        // Records follow each other, content length is in 16 bit words
+        // and holds at least shape type
+        myOffsets.clear();
+        for (qint64 offset = headerSize; offset + 8 <= myShpSize; )
+        {
+            qint64 length = readInt32BE(myShp + offset + 4);
+            if (length < 2 || offset + 8 + 2 * length > myShpSize)
+            {
+                myError = "Bad record length in shapefile: " + myFileName;
+                return false;
+            }
+            myOffsets << offset;
+            offset += 8 + 2 * length;
+        }
+        myRecordCount = myOffsets.count();
+    }
+    myNextRecord = 0;
+    return true;
+}
+
+/*!
+ * \brief Map .dbf file and read its fields.
+ *
+ * Charset comes from .cpg file, Windows-1252 is used if there is none.
+ * Numeric fields without decimals are integers, if they fit.
+ * \return True on success.
+ */
+bool ShapeReader::openDbf()
+{
+    QFile cpg(fileWithSuffix("cpg"));
+    QByteArray codecName = "Windows-1252";
+    if (cpg.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        QByteArray name = cpg.readAll().trimmed();
+        bool number;
+        int codePage = name.toInt(&number);
+        if (number)
+            name = codePage == 65001 ? "UTF-8" : "Windows-" + name;
+        if (QTextCodec::codecForName(name))
+            codecName = name;
+    }
+    myCodec = QTextCodec::codecForName(codecName);
+    if (!myCodec)
+        myCodec = QTextCodec::codecForName("ISO-8859-1");
+
+    myDbfFile.setFileName(fileWithSuffix("dbf"));
+    if (!myDbfFile.open(QIODevice::ReadOnly))
+    {
+        myError = "Can not open " + myDbfFile.fileName();
+        return false;
+    }
+    qint64 size = myDbfFile.size();
+    const uchar *dbf = size >= 32 ? myDbfFile.map(0, size) : 0;
+    if (!dbf)
+    {
+        myError = "Can not read " + myDbfFile.fileName();
+        return false;
+    }
+
+    int recordCount = readInt32(dbf + 4);
+    int headerLength = qFromLittleEndian<quint16>(dbf + 8);
+    int recordLength = qFromLittleEndian<quint16>(dbf + 10);
+    int offset = 1;
+    myFields.clear();
+    for (qint64 d = 32; d + 32 <= headerLength && dbf[d] != 0x0d; d += 32)
+    {
+        DbfField f;
+        const char *name = (const char*)dbf + d;
+        f.name = QString::fromLatin1(name, qstrnlen(name, 11));
+        f.dbfType = dbf[d + 11];
+        f.offset = offset;
+        f.width = dbf[d + 16];
+        f.decimals = dbf[d + 17];
+        if ((f.dbfType == 'N' || f.dbfType == 'I') && f.decimals == 0 && f.width <= 18)
+            f.type = COLUMN_TYPE_INTEGER;
+        else if (f.dbfType == 'N' || f.dbfType == 'F')
+            f.type = COLUMN_TYPE_FLOAT;
+        else if (f.dbfType == 'L')
+            f.type = COLUMN_TYPE_LOGICAL;
+        else if (f.dbfType == 'D')
+            f.type = COLUMN_TYPE_DATE;
+        else
+            f.type = COLUMN_TYPE_STRING;
+        myFields << f;
+        offset += f.width;
+    }
+    if (offset > recordLength || recordCount != myRecordCount
+            || headerLength + (qint64)recordCount * recordLength > size)
+    {
+        myError = "Records in .shp and .dbf do not match: " + myFileName;
+        return false;
+    }
+    myRecords = dbf + headerLength;
+    myRecordLength = recordLength;
+    return true;
+}
+
+/*!
+ * \brief Get offset of record in .shp file.
+ * \param record Record index from 0
+ * \return Offset of record header.
+ */
+qint64 ShapeReader::recordOffset(int record) const
+{
+    if (myShx)
+        return 2 * (qint64)readInt32BE(myShx + headerSize + 8 * record);
+    return myOffsets.at(record);
+}
+
+/*!
+ * \brief Read next rows of opened shapefile.
+ *
+ * Deleted records are skipped, so batch can have less rows than records.
+ * Records are read in parallel in chunks, chunks are then joined in
+ * order. Batch after last row is empty, but has all columns.
+ * \param maxRows Maximum number of rows in batch.
+ * \return Batch or null pointer on error, see getError().
+ */
+TablePtr ShapeReader::readBatch(int maxRows)
+{
+    QVector<int> records;
+    records.reserve(qMin(maxRows, myRecordCount - myNextRecord));
+    while (myNextRecord < myRecordCount && records.count() < maxRows)
+    {
+        if (!myRecords || myRecords[(qint64)myNextRecord * myRecordLength] != '*')
+            records << myNextRecord;
+        myNextRecord++;
+    }
+
+    QVector<ShapeChunk> chunks;
+    for (int i = 0; i < records.count(); i += chunkRecords)
+    {
+        ShapeChunk chunk;
+        chunk.records = records.constData() + i;
+        chunk.count = qMin(chunkRecords, records.count() - i);
+        chunks << chunk;
+    }
+    ReadChunk task;
+    task.reader = this;
+    if (chunks.count() == 1)
+        task(chunks[0]);
+    else
+        QtConcurrent::blockingMap(chunks, task);
+
+    TablePtr table = readRecords(0, 0, &myError);
+    foreach (const ShapeChunk &chunk, chunks) {
+        if (!chunk.error.isEmpty())
+        {
+            myError = chunk.error;
+            return TablePtr();
+        }
+        table->append(chunk.table.data());
+    }
+    return table;
+}
+
+/*!
+ * \brief Read records to new table.
+ *
+ * Only reads mapped files, so chunks can be read in parallel.
+ * \param records Record indices from 0
+ * \param count Number of records
+ * \param error Returns error.
+ * \return Table with one row per record, null pointer on error.
+ */
+TablePtr ShapeReader::readRecords(const int *records, int count, QString *error) const
+{
+    TablePtr table(new Table(QFileInfo(myFileName).completeBaseName()));
+    for (int c = 0; c < myFields.count(); c++)
+        table->addColumn(myFields.at(c).name, myFields.at(c).type);
+    table->resize(count);
+    table->setTransform(myTransform);
+
+    QScopedPointer<QTextDecoder> decoder(myCodec ? myCodec->makeDecoder() : 0);
+    for (int c = 0; c < myFields.count() && myRecords; c++)
+    {
+        const DbfField &f = myFields.at(c);
+        TableColumn &col = table->column(c);
+        for (int i = 0; i < count; i++)
+        {
+            const char *p = (const char*)myRecords + (qint64)records[i] * myRecordLength + f.offset;
+            int len = f.width;
+            while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == 0))
+                len--;
+            switch (f.type) {
+            case COLUMN_TYPE_STRING:
+                col.strings[i] = decoder->toUnicode(p, len);
+                break;
+            case COLUMN_TYPE_INTEGER:
+                col.integers[i] = QByteArray::fromRawData(p, len).trimmed().toLongLong();
+                break;
+            case COLUMN_TYPE_FLOAT:
+                col.floats[i] = QByteArray::fromRawData(p, len).trimmed().toDouble();
+                break;
+            case COLUMN_TYPE_DATE:
+                col.integers[i] = QByteArray::fromRawData(p, len).trimmed().toInt();
+                break;
+            case COLUMN_TYPE_LOGICAL:
+                col.integers[i] = (p[0] == 'T' || p[0] == 't' || p[0] == 'Y' || p[0] == 'y') ? 1 : 0;
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        int type;
+        Geometry geometry;
+        if (!readShape(recordOffset(records[i]), &type, &geometry))
+        {
+            *error = QString("Bad shape for record %1 in %2").arg(records[i] + 1).arg(myFileName);
+            return TablePtr();
+        }
+        if (type != GEOMETRY_TYPE_NONE)
+            table->setGeometry(i, type, geometry);
+    }
+    return table;
+}
+
+/*!
+ * \brief Read one shape from .shp file.
+ *
+ * Polygon parts are rings, same as MapInfo region rings. Multipoint is
+ * point with one part per point.
+ * \param offset Offset of record header
+ * \param type Returns geometry type
+ * \param geometry Returns geometry
+ * \return False if record is broken.
+ */
+bool ShapeReader::readShape(qint64 offset, int *type, Geometry *geometry) const
+{
+    *type = GEOMETRY_TYPE_NONE;
+    if (offset < headerSize || offset + 12 > myShpSize)
+        return false;
+    qint64 length = 2 * (qint64)readInt32BE(myShp + offset + 4);
+    const uchar *p = myShp + offset + 8;
+    if (length < 4 || offset + 8 + length > myShpSize)
+        return false;
+
+    int shapeType = readInt32(p);
+    switch (shapeType) {
+    case 0: // Null
+        return true;
+    case 1: // Point
+    case 11: // PointZ
+    case 21: // PointM
+        if (length < 20)
+            return false;
+        *type = GEOMETRY_TYPE_POINT;
+        *geometry << (QPolygonF() << QPointF(readDouble(p + 4), readDouble(p + 12)));
+        return true;
+    case 8: // MultiPoint
+    case 18:
+    case 28:
+    {
+        qint64 n = length >= 40 ? readInt32(p + 36) : -1;
+        if (n < 0 || 40 + 16 * n > length)
+            return false;
+        *type = GEOMETRY_TYPE_POINT;
+        for (int i = 0; i < n; i++)
+            *geometry << (QPolygonF() << QPointF(readDouble(p + 40 + 16 * i), readDouble(p + 48 + 16 * i)));
+        return true;
+    }
+    case 3: // PolyLine
+    case 13:
+    case 23:
+        *type = GEOMETRY_TYPE_LINE;
+        break;
+    case 5: // Polygon
+    case 15:
+    case 25:
+        *type = GEOMETRY_TYPE_REGION;
+        break;
+    default:
+        return true;
+    }
+
+    qint64 parts = length >= 44 ? readInt32(p + 36) : -1;
+    qint64 points = length >= 44 ? readInt32(p + 40) : -1;
+    if (parts < 0 || points < 0 || 44 + 4 * parts + 16 * points > length)
+        return false;
+    const uchar *xy = p + 44 + 4 * parts;
+    geometry->reserve(parts);
+    for (int i = 0; i < parts; i++)
+    {
+        qint32 first = readInt32(p + 44 + 4 * i);
+        qint32 last = i + 1 < parts ? readInt32(p + 48 + 4 * i) : points;
+        if (first < 0 || last < first || last > points)
+            return false;
+        QPolygonF part(last - first);
+        for (int v = first; v < last; v++)
+            part[v - first] = QPointF(readDouble(xy + 16 * v), readDouble(xy + 16 * v + 8));
+        *geometry << part;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef SHAPEREADER_H
+#define SHAPEREADER_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+
+#include "pirilib.h"
+#include "table.h"
+
+class QTextCodec;
+
+/*!
+ * \brief Field of dBase file.
+ */
+struct DbfField {
+    QString name;
+    int type; /*!< Column type, see COLUMN_TYPE_* in pirilib.h */
+    char dbfType; /*!< dBase type, for example 'C' or 'N'. */
+    int offset; /*!< Offset in record, after deletion flag. */
+    int width; /*!< Width in record. */
+    int decimals; /*!< Number of decimals of numeric field. */
+};
+
+class PIRILIBSHARED_EXPORT ShapeReader
+{
+public:
+    ShapeReader(QString fileName);
+
+    TablePtr read();
+    bool open();
+    TablePtr readBatch(int maxRows);
+    bool atEnd() const { return myNextRecord >= myRecordCount; }
+    QString getError() { return myError; }
+    QString getPrj() { return myPrj; }
+
+    TablePtr readRecords(const int *records, int count, QString *error) const;
+
+private:
+    bool openShp();
+    bool openDbf();
+    qint64 recordOffset(int record) const;
+    bool readShape(qint64 offset, int *type, Geometry *geometry) const;
+    QString fileWithSuffix(QString suffix);
+
+    QString myFileName; /*!< Path of .shp file. */
+    QString myError; /*!< Last error. */
+    QString myPrj; /*!< Projection as WKT from .prj file. */
+    QTextCodec *myCodec; /*!< Codec of .dbf strings. */
+    CoordTransform myTransform; /*!< Transform of table coordinates. */
+    int myRecordCount; /*!< Number of records, deleted records included. */
+    int myNextRecord; /*!< Index of next record to read. */
+
+    QFile myShpFile; /*!< Mapped .shp file. */
+    const uchar *myShp;
+    qint64 myShpSize;
+    QFile myShxFile; /*!< Mapped .shx file. */
+    const uchar *myShx; /*!< Mapped .shx data, 0 if offsets are in myOffsets. */
+    QVector<qint64> myOffsets; /*!< Record offsets found from .shp when there is no .shx file. */
+
+    QFile myDbfFile; /*!< Mapped .dbf file. */
+    const uchar *myRecords; /*!< First record in mapped .dbf file, 0 if there is no .dbf file. */
+    int myRecordLength; /*!< Length of one .dbf record. */
+    QVector<DbfField> myFields; /*!< Fields of .dbf file. */
+};
+
+#endif // SHAPEREADER_H
@@ -0,0 +1,624 @@
+#include "shapewriter.h"
+#include "tabreader.h"
+#include "geometry.h"
+
+#include <QDate>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <QTextCodec>
+#include <QtEndian>
+
+#include <algorithm>
+#include <string.h>
+#include <float.h>
+#include <limits.h>
+
+namespace {
+
+const int headerSize = 100;
+const int maxFloatDecimals = 15;
+
+// Shape types, Z and M variants are not written
+const int nullShape = 0;
+const int pointShape = 1;
+const int polyLineShape = 3;
+const int polygonShape = 5;
+const int multiPointShape = 8;
+
+inline void putInt16(uchar *p, qint16 v) { qToLittleEndian<qint16>(v, p); }
+inline void putInt32(uchar *p, qint32 v) { qToLittleEndian<qint32>(v, p); }
+inline void putInt32BE(uchar *p, qint32 v) { qToBigEndian<qint32>(v, p); }
+
+inline void putDouble(uchar *p, double d)
+{
+    quint64 bits;
+    memcpy(&bits, &d, sizeof(d));
+    qToLittleEndian<quint64>(bits, p);
+}
+
+inline uchar* data(QByteArray &a) { return (uchar*)a.data(); }
+
+/*!
+ * \brief Format float for .dbf file.
+ *
+ * Numbers that would need exponent are written with fixed decimals, as
+ * numeric fields can not have exponent in all readers.
+ * \param value Value
+ * \return Text, empty for NaN and infinity.
+ */
+QByteArray floatText(double value)
+{
+    if (!qIsFinite(value))
+        return QByteArray();
+    QByteArray text = QByteArray::number(value, 'g', 15);
+    if (text.contains('e'))
+        text = QByteArray::number(value, 'f', maxFloatDecimals);
+    return text.left(254);
+}
+
+}
+
+
+/*!
+ * \brief Shapefile writer constructor.
+ *
+ * Writes native table as ESRI Shapefile. Shapes are written to .shp and
+ * .shx files while rows are written and headers are fixed when writing
+ * finishes. Attributes are kept in temporary file until widths of .dbf
+ * fields are known, same as TabWriter does with .DAT file.
+ * \param fileName Path of .shp file.
+ */
+ShapeWriter::ShapeWriter(QString fileName)
+{
+    myFileName = fileName;
+    myCharset = MAPINFO_CHARSET;
+    myCodec = 0;
+    myRowCount = 0;
+    myRowIdField = false;
+    myShpSize = 0;
+    myShapeType = nullShape;
+    myMinX = myMinY = myMaxX = myMaxY = 0.0;
+}
+
+/*!
+ * \brief Set projection of shapefile.
+ * \param coordSys Projection as WKT, written to .prj file as it is. Empty
+ * projection writes no .prj file.
+ * \return False if projection is not WKT, see getError().
+ */
+bool ShapeWriter::setCoordSys(QString coordSys)
+{
+    QString s = coordSys.trimmed();
+    if (!s.isEmpty() && !s.startsWith("PROJCS[", Qt::CaseInsensitive)
+            && !s.startsWith("GEOGCS[", Qt::CaseInsensitive)
+            && !s.startsWith("COMPD_CS[", Qt::CaseInsensitive))
+    {
+        myError = "Shapefile projection must be WKT: " + coordSys;
+        return false;
+    }
+    myPrj = s;
+    return true;
+}
+
+/*!
+ * \brief Write table.
+ * \param table Table to write.
+ * \return True on success, see getError() otherwise.
+ */
+bool ShapeWriter::write(TablePtr table)
+{
+    return write(TableStreamPtr(new TableSliceStream(table, qMax(1, table->rowCount()))));
+}
+
+/*!
+ * \brief Write table from stream, one batch at a time.
+ * \param stream Stream to write, all batches must have same columns.
+ * \return True on success, see getError() otherwise.
+ */
+bool ShapeWriter::write(TableStreamPtr stream)
+{
+    TablePtr batch = stream->next();
+    if (!batch)
+    {
+        myError = stream->hasError() ? stream->getError() : "No table to write to " + myFileName;
+        return false;
+    }
+    if (!begin(batch.data()))
+        return false;
+    while (batch)
+    {
+        if (!writeBatch(batch.data()))
+            return false;
+        batch = stream->next();
+    }
+    if (stream->hasError())
+    {
+        myError = stream->getError();
+        return false;
+    }
+    return finish();
+}
+
+/*!
+ * \brief Get path of file with other suffix, in same case as .shp suffix.
+ * \param suffix Suffix without dot, for example "dbf".
+ * \return Path of file.
+ */
+QString ShapeWriter::fileWithSuffix(QString suffix)
+{
+    QFileInfo fi(myFileName);
+    QString base = fi.path() + "/" + fi.completeBaseName() + ".";
+    if (fi.suffix() == fi.suffix().toUpper() && !fi.suffix().isEmpty())
+        return base + suffix.toUpper();
+    return base + suffix.toLower();
+}
+
+/*!
+ * \brief Start writing table.
+ *
+ * Fields come from columns of first batch. Field names are cut to ten
+ * characters, which is the most .dbf file can keep. Table without columns
+ * gets row number as only field, as .dbf file needs at least one field.
+ * \param first First batch, it is not written yet.
+ * \return True on success, see getError() otherwise.
+ */
+bool ShapeWriter::begin(const Table *first)
+{
+    myRowCount = 0;
+    myShapeType = nullShape;
+    myMinX = myMinY = DBL_MAX;
+    myMaxX = myMaxY = -DBL_MAX;
+    myCodec = TabReader::codecForCharset(myCharset);
+
+    myFields.clear();
+    myIntegerWidths.clear();
+    QSet<QString> used;
+    for (int c = 0; c < first->columnCount(); c++)
+    {
+        QString base = first->column(c).name;
+        base.replace(QRegularExpression("[^A-Za-z0-9_]"), "_");
+        if (base.isEmpty() || base.at(0).isDigit())
+            base.prepend('_');
+        base = base.left(10);
+        QString name = base;
+        for (int k = 2; used.contains(name.toLower()); k++)
+            name = base.left(10 - QString::number(k).length() - 1) + "_" + QString::number(k);
+        used.insert(name.toLower());
+
+        DbfField f;
+        f.name = name;
+        f.type = first->column(c).type;
+        f.offset = 0;
+        f.width = 1;
+        f.decimals = 0;
+        switch (f.type) {
+        case COLUMN_TYPE_STRING:
+            f.dbfType = 'C';
+            break;
+        case COLUMN_TYPE_FLOAT:
+            f.dbfType = 'N';
+            f.decimals = 1;
+            break;
+        case COLUMN_TYPE_LOGICAL:
+            f.dbfType = 'L';
+            break;
+        case COLUMN_TYPE_DATE:
+            f.dbfType = 'D';
+            f.width = 8;
+            break;
+        default:
+            f.dbfType = 'N';
+            break;
+        }
+        myFields << f;
+        myIntegerWidths << 1;
+    }
+    myRowIdField = myFields.isEmpty();
+    if (myRowIdField)
+    {
+        DbfField f = { "ID", COLUMN_TYPE_INTEGER, 'N', 0, 1, 0 };
+        myFields << f;
+        myIntegerWidths << 1;
+    }
+
+    if (!mySpool.open())
+    {
+        myError = "Can not create temporary file for " + myFileName;
+        return false;
+    }
+    mySpool.resize(0);
+
+    myShpFile.setFileName(myFileName);
+    myShxFile.setFileName(fileWithSuffix("shx"));
+    if (!myShpFile.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || !myShxFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        myError = "Can not write " + myFileName;
+        return false;
+    }
+    // Headers are written again when bounds and sizes are known
+    myShpFile.write(QByteArray(headerSize, 0));
+    myShxFile.write(QByteArray(headerSize, 0));
+    myShpSize = headerSize;
+    return true;
+}
+
+/*!
+ * \brief Write rows of batch.
+ * \param batch Batch with same columns as first batch.
+ * \return True on success, see getError() otherwise.
+ */
+bool ShapeWriter::writeBatch(const Table *batch)
+{
+    if (batch->columnCount() != (myRowIdField ? 0 : myFields.count()))
+    {
+        myError = "Batches have different columns: " + myFileName;
+        return false;
+    }
+    spoolRecords(batch);
+    if (!writeShapes(batch))
+        return false;
+    myRowCount += batch->rowCount();
+    if (myShpFile.error() != QFile::NoError || myShxFile.error() != QFile::NoError
+            || mySpool.error() != QFile::NoError)
+    {
+        myError = "Can not write " + myFileName;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Finish .shp and .shx headers and write .dbf, .cpg and .prj files.
+ *
+ * Stale .prj file is removed if projection is not set.
+ * \return True on success, see getError() otherwise.
+ */
+bool ShapeWriter::finish()
+{
+    if (myMinX > myMaxX)
+        myMinX = myMinY = myMaxX = myMaxY = 0.0;
+    writeShpHeader(myShpFile, myShpSize);
+    writeShpHeader(myShxFile, headerSize + 8 * (qint64)myRowCount);
+    bool ok = myShpFile.error() == QFile::NoError && myShxFile.error() == QFile::NoError;
+    myShpFile.close();
+    myShxFile.close();
+    if (!ok)
+    {
+        myError = "Can not write " + myFileName;
+        return false;
+    }
+    if (!writeDbf())
+        return false;
+
+    QFile cpg(fileWithSuffix("cpg"));
+    if (!cpg.open(QIODevice::WriteOnly | QIODevice::Truncate) || cpg.write(myCodec->name()) < 0)
+    {
+        myError = "Can not write " + cpg.fileName();
+        return false;
+    }
+    if (myPrj.isEmpty())
+    {
+        QFile::remove(fileWithSuffix("prj"));
+        return true;
+    }
+    QFile prj(fileWithSuffix("prj"));
+    if (!prj.open(QIODevice::WriteOnly | QIODevice::Truncate) || prj.write(myPrj.toLatin1()) < 0)
+    {
+        myError = "Can not write " + prj.fileName();
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Write header of .shp or .shx file over placeholder.
+ * \param file File open for writing
+ * \param size Size of file in bytes
+ */
+void ShapeWriter::writeShpHeader(QFile &file, qint64 size)
+{
+    QByteArray header(headerSize, 0);
+    uchar *h = data(header);
+    putInt32BE(h, 9994);
+    putInt32BE(h + 24, size / 2);
+    putInt32(h + 28, 1000);
+    putInt32(h + 32, myShapeType);
+    putDouble(h + 36, myMinX);
+    putDouble(h + 44, myMinY);
+    putDouble(h + 52, myMaxX);
+    putDouble(h + 60, myMaxY);
+    file.seek(0);
+    file.write(header);
+}
+
+/*!
+ * \brief Get shape type of row.
+ *
+ * Point with more than one part is multipoint.
+ * \param batch Batch
+ * \param row Row in batch
+ * \return Shape type, 0 for row without geometry.
+ */
+int ShapeWriter::shapeType(const Table *batch, int row)
+{
+    int type = batch->geometryType(row);
+    if (type == GEOMETRY_TYPE_NONE || batch->partCount(row) == 0)
+        return nullShape;
+    if (type == GEOMETRY_TYPE_POINT)
+        return batch->partCount(row) > 1 || myShapeType == multiPointShape ? multiPointShape : pointShape;
+    if (type == GEOMETRY_TYPE_LINE)
+        return polyLineShape;
+    return polygonShape;
+}
+
+/*!
+ * \brief Write shapes of batch to .shp and .shx files.
+ *
+ * Shapefile has one shape type, so first geometry decides it and rows
+ * with other geometry type are errors. Polygon outer rings are clockwise
+ * and holes counterclockwise, rings are closed.
+ * \param batch Batch
+ * \return True on success, see getError() otherwise.
+ */
+bool ShapeWriter::writeShapes(const Table *batch)
+{
+    QByteArray shp;
+    QByteArray shx(8 * batch->rowCount(), 0);
+    for (int r = 0; r < batch->rowCount(); r++)
+    {
+        int type = shapeType(batch, r);
+        Geometry geometry;
+        if (type == polygonShape)
+        {
+            geometry = orientRings(batch->geometry(r));
+            for (int i = 0; i < geometry.count(); i++)
+            {
+                QPolygonF &ring = geometry[i];
+                std::reverse(ring.begin(), ring.end());
+                if (!ring.isEmpty() && ring.first() != ring.last())
+                    ring << ring.first();
+            }
+        } else if (type != nullShape) {
+            geometry = batch->geometry(r);
+        }
+
+        int points = 0;
+        double minX = DBL_MAX, minY = DBL_MAX, maxX = -DBL_MAX, maxY = -DBL_MAX;
+        foreach (const QPolygonF &part, geometry) {
+            points += part.count();
+            foreach (const QPointF &p, part) {
+                minX = qMin(minX, p.x());
+                minY = qMin(minY, p.y());
+                maxX = qMax(maxX, p.x());
+                maxY = qMax(maxY, p.y());
+            }
+        }
+        if (points == 0)
+            type = nullShape;
+        if (type != nullShape && myShapeType == nullShape)
+            myShapeType = type;
+        if (type != nullShape && type != myShapeType)
+        {
+            myError = QString("Shapefile can have only one geometry type, row %1 differs: %2")
+                    .arg(myRowCount + r + 1).arg(myFileName);
+            return false;
+        }
+        if (points > 0)
+        {
+            myMinX = qMin(myMinX, minX);
+            myMinY = qMin(myMinY, minY);
+            myMaxX = qMax(myMaxX, maxX);
+            myMaxY = qMax(myMaxY, maxY);
+        }
+
+        int length = 4;
+        if (type == pointShape)
+            length = 20;
+        else if (type == multiPointShape)
+            length = 40 + 16 * points;
+        else if (type != nullShape)
+            length = 44 + 4 * geometry.count() + 16 * points;
+
+        if (myShpSize + shp.size() + 8 + length > 2 * (qint64)INT_MAX)
+        {
+            myError = "Shapefile can not be larger than 4 GB: " + myFileName;
+            return false;
+        }
+        putInt32BE(data(shx) + 8 * r, (myShpSize + shp.size()) / 2);
+        putInt32BE(data(shx) + 8 * r + 4, length / 2);
+
+        int offset = shp.size();
+        shp.resize(offset + 8 + length);
+        uchar *p = data(shp) + offset;
+        putInt32BE(p, myRowCount + r + 1);
+        putInt32BE(p + 4, length / 2);
+        p += 8;
+        putInt32(p, type);
+        if (type == pointShape)
+        {
+            putDouble(p + 4, geometry.at(0).at(0).x());
+            putDouble(p + 12, geometry.at(0).at(0).y());
+        }
+        if (type == nullShape || type == pointShape)
+            continue;
+
+        putDouble(p + 4, minX);
+        putDouble(p + 12, minY);
+        putDouble(p + 20, maxX);
+        putDouble(p + 28, maxY);
+        uchar *xy;
+        if (type == multiPointShape)
+        {
+            putInt32(p + 36, points);
+            xy = p + 40;
+        } else {
+            putInt32(p + 36, geometry.count());
+            putInt32(p + 40, points);
+            int first = 0;
+            for (int i = 0; i < geometry.count(); i++)
+            {
+                putInt32(p + 44 + 4 * i, first);
+                first += geometry.at(i).count();
+            }
+            xy = p + 44 + 4 * geometry.count();
+        }
+        foreach (const QPolygonF &part, geometry) {
+            foreach (const QPointF &point, part) {
+                putDouble(xy, point.x());
+                putDouble(xy + 8, point.y());
+                xy += 16;
+            }
+        }
+    }
+    myShpFile.write(shp);
+    myShxFile.write(shx);
+    myShpSize += shp.size();
+    return true;
+}
+
+/*!
+ * \brief Write attributes of batch to temporary file as text.
+ *
+ * Every value is length byte and text. Widths of fields grow to fit the
+ * values, floats keep width before decimal point and decimals apart.
+ * \param batch Batch
+ */
+void ShapeWriter::spoolRecords(const Table *batch)
+{
+    QByteArray records;
+    for (int r = 0; r < batch->rowCount(); r++)
+    {
+        for (int c = 0; c < myFields.count(); c++)
+        {
+            DbfField &f = myFields[c];
+            QByteArray text;
+            if (myRowIdField)
+            {
+                text = QByteArray::number(myRowCount + r + 1);
+            } else {
+                const TableColumn &column = batch->column(c);
+                switch (f.type) {
+                case COLUMN_TYPE_STRING:
+                    text = myCodec->fromUnicode(column.strings.at(r)).left(254);
+                    break;
+                case COLUMN_TYPE_FLOAT:
+                {
+                    text = floatText(column.floats.at(r));
+                    int point = text.indexOf('.');
+                    int integerWidth = point < 0 ? text.size() : point;
+                    int decimals = point < 0 ? 0 : text.size() - point - 1;
+                    myIntegerWidths[c] = qMax(myIntegerWidths.at(c), integerWidth);
+                    f.decimals = qBound(f.decimals, decimals, maxFloatDecimals);
+                    break;
+                }
+                case COLUMN_TYPE_LOGICAL:
+                    text = column.integers.at(r) ? "T" : "F";
+                    break;
+                case COLUMN_TYPE_DATE:
+                    if (column.integers.at(r) > 0)
+                        text = QByteArray::number(column.integers.at(r)).rightJustified(8, '0', true);
+                    break;
+                default:
+                    text = QByteArray::number(column.integers.at(r));
+                    break;
+                }
+            }
+            if (f.type == COLUMN_TYPE_FLOAT)
+                f.width = qMin(254, myIntegerWidths.at(c) + 1 + f.decimals);
+            else
+                f.width = qMax(f.width, text.size());
+            records.append((char)text.size());
+            records.append(text);
+        }
+    }
+    uchar header[8];
+    putInt32(header, batch->rowCount());
+    putInt32(header + 4, records.size());
+    mySpool.write((const char*)header, 8);
+    mySpool.write(records);
+}
+
+/*!
+ * \brief Write .dbf file from temporary file.
+ *
+ * Strings are left aligned, numbers right aligned and floats get the
+ * decimals of their field.
+ * \return True on success, see getError() otherwise.
+ */
+bool ShapeWriter::writeDbf()
+{
+    QFile file(fileWithSuffix("dbf"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !mySpool.seek(0))
+    {
+        myError = "Can not write " + file.fileName();
+        return false;
+    }
+
+    int headerLength = 32 + 32 * myFields.count() + 1;
+    int recordLength = 1;
+    foreach (const DbfField &f, myFields)
+        recordLength += f.width;
+    QByteArray header(headerLength, 0);
+    uchar *h = data(header);
+    QDate today = QDate::currentDate();
+    h[0] = 0x03;
+    h[1] = today.year() - 1900;
+    h[2] = today.month();
+    h[3] = today.day();
+    putInt32(h + 4, myRowCount);
+    putInt16(h + 8, headerLength);
+    putInt16(h + 10, recordLength);
+    for (int c = 0; c < myFields.count(); c++)
+    {
+        uchar *d = h + 32 + 32 * c;
+        QByteArray name = myFields.at(c).name.toLatin1().left(10);
+        memcpy(d, name.constData(), name.size());
+        d[11] = myFields.at(c).dbfType;
+        d[16] = myFields.at(c).width;
+        d[17] = myFields.at(c).decimals;
+    }
+    h[headerLength - 1] = 0x0d;
+    file.write(header);
+
+    // Batch at a time, so memory does not grow with table
+    QByteArray records;
+    while (!mySpool.atEnd())
+    {
+        QByteArray batchHeader = mySpool.read(8);
+        if (batchHeader.size() != 8)
+            break;
+        int rows = qFromLittleEndian<qint32>((const uchar*)batchHeader.constData());
+        QByteArray spooled = mySpool.read(qFromLittleEndian<qint32>((const uchar*)batchHeader.constData() + 4));
+        const char *p = spooled.constData();
+        records.fill(' ', rows * recordLength);
+        char *out = records.data();
+        for (int r = 0; r < rows; r++)
+        {
+            out++; // deletion flag
+            for (int c = 0; c < myFields.count(); c++)
+            {
+                const DbfField &f = myFields.at(c);
+                QByteArray text = QByteArray::fromRawData(p + 1, (uchar)*p);
+                p += 1 + text.size();
+                if (f.type == COLUMN_TYPE_FLOAT && !text.isEmpty())
+                    text = QByteArray::number(text.toDouble(), 'f', f.decimals).left(f.width);
+                if (f.dbfType == 'N')
+                    memcpy(out + f.width - text.size(), text.constData(), text.size());
+                else
+                    memcpy(out, text.constData(), text.size());
+                out += f.width;
+            }
+        }
+        file.write(records);
+    }
+    file.write("\x1a", 1);
+    if (file.error() != QFile::NoError || mySpool.error() != QFile::NoError)
+    {
+        myError = "Can not write " + file.fileName();
+        return false;
+    }
+    mySpool.close();
+    return true;
+}
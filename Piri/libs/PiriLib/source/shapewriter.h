@@ -0,0 +1,62 @@
+#ifndef SHAPEWRITER_H
+#define SHAPEWRITER_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+#include <QTemporaryFile>
+
+#include "pirilib.h"
+#include "table.h"
+#include "tablestream.h"
+#include "shapereader.h"
+
+class QTextCodec;
+
+class PIRILIBSHARED_EXPORT ShapeWriter
+{
+public:
+    ShapeWriter(QString fileName);
+
+    void setCharset(QString charset) { myCharset = charset; }
+    bool setCoordSys(QString coordSys);
+
+    bool write(TablePtr table);
+    bool write(TableStreamPtr stream);
+    bool begin(const Table *first);
+    bool writeBatch(const Table *batch);
+    bool finish();
+    int getRowCount() { return myRowCount; }
+    QString getError() { return myError; }
+
+private:
+    QString fileWithSuffix(QString suffix);
+    void spoolRecords(const Table *batch);
+    bool writeDbf();
+    bool writeShapes(const Table *batch);
+    int shapeType(const Table *batch, int row);
+    void writeShpHeader(QFile &file, qint64 size);
+
+    QString myFileName; /*!< Path of .shp file. */
+    QString myError; /*!< Last error. */
+    QString myCharset; /*!< MapInfo charset of strings. */
+    QTextCodec *myCodec; /*!< Codec of charset. */
+    QString myPrj; /*!< Projection as WKT, empty if .prj is not written. */
+    int myRowCount; /*!< Number of rows written. */
+    QVector<DbfField> myFields; /*!< Fields of .dbf file, widths grow while rows are written. */
+    QVector<int> myIntegerWidths; /*!< Width before decimal point of each float field. */
+    bool myRowIdField; /*!< Is row number written as only field? */
+
+    QTemporaryFile mySpool; /*!< Values as text until field widths are known. */
+
+    QFile myShpFile;
+    QFile myShxFile;
+    qint64 myShpSize; /*!< Bytes written to .shp file, header included. */
+    int myShapeType; /*!< Shape type of file, 0 until first geometry. */
+    double myMinX; /*!< Bounds of all shapes. */
+    double myMinY;
+    double myMaxX;
+    double myMaxY;
+};
+
+#endif // SHAPEWRITER_H
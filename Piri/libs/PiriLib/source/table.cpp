@@ -0,0 +1,626 @@
+#include "table.h"
+
+#include <QVarLengthArray>
+
+
+/*!
+ * \brief Native table constructor.
+ *
+ * Native table is columnar in-memory table that ops use when graph is run
+ * without MapInfo. Every column keeps its values in one vector.
+ *
+ * Geometry is stored as integer coordinates of table transform, same as
+ * in MapInfo .MAP file. Points of part are stored as differences from
+ * previous point in variable length bytes, so neighbouring points take
+ * few bytes. Parts of all rows are in one byte array with offset arrays,
+ * geometry is decoded only when it is asked. Default transform keeps
+ * GEOMETRY_RESOLUTION precision, for example cm in metric coordinates.
+ * \param name Table name.
+ */
+Table::Table(QString name)
+{
+    myName = name;
+    myRowCount = 0;
+    myTransform.originX = 0.0;
+    myTransform.originY = 0.0;
+    myTransform.resolutionX = GEOMETRY_RESOLUTION;
+    myTransform.resolutionY = GEOMETRY_RESOLUTION;
+    myUnusedBytes = 0;
+}
+
+/*!
+ * \brief Set number of rows in table.
+ *
+ * All columns and geometry are resized, new rows are empty. Arrays that
+ * already have right size are not touched, so data shared with other
+ * tables is not copied.
+ * \param rows Number of rows.
+ */
+void Table::resize(int rows)
+{
+    for (int i = 0; i < myColumns.count(); i++)
+        resizeColumn(i, rows);
+    resizeGeometry(rows);
+    myRowCount = rows;
+}
+
+/*!
+ * \brief Set number of rows in one column, new rows are empty.
+ * \param index Column index
+ * \param rows Number of rows.
+ */
+void Table::resizeColumn(int index, int rows)
+{
+    const TableColumn &c = myColumns.at(index);
+    switch (c.type) {
+    case COLUMN_TYPE_STRING:
+        if (c.strings.count() != rows)
+            myColumns[index].strings.resize(rows);
+        break;
+    case COLUMN_TYPE_FLOAT:
+        if (c.floats.count() != rows)
+            myColumns[index].floats.resize(rows);
+        break;
+    default:
+        if (c.integers.count() != rows)
+            myColumns[index].integers.resize(rows);
+    }
+}
+
+/*!
+ * \brief Set number of rows in geometry arrays, new rows have no geometry.
+ * \param rows Number of rows.
+ */
+void Table::resizeGeometry(int rows)
+{
+    int old = myGeometryTypes.count();
+    if (old == rows)
+        return;
+    for (int r = rows; r < old; r++)
+        releaseGeometry(r);
+    myGeometryTypes.resize(rows);
+    myRowFirstPart.resize(rows);
+    myRowPartCount.resize(rows);
+    for (int r = old; r < rows; r++)
+    {
+        myGeometryTypes[r] = GEOMETRY_TYPE_NONE;
+        myRowFirstPart[r] = 0;
+        myRowPartCount[r] = 0;
+    }
+}
+
+/*!
+ * \brief Estimate size of table data.
+ *
+ * Numbers are 8 bytes and strings 2 bytes per character. Geometry is
+ * counted as stored. Container overhead is left out.
+ * \return Size in bytes.
+ */
+qint64 Table::byteSize() const
+{
+    qint64 size = 0;
+    foreach (const TableColumn &c, myColumns) {
+        if (c.type == COLUMN_TYPE_STRING)
+        {
+            foreach (const QString &s, c.strings)
+                size += s.length() * 2;
+        } else {
+            size += (qint64)myRowCount * 8;
+        }
+    }
+    size += myCoords.size() - myUnusedBytes;
+    size += (qint64)myPartOffsets.count() * 12 + (qint64)myRowCount * 12;
+    return size;
+}
+
+/*!
+ * \brief Add new column to table.
+ * \param name Column name
+ * \param type Column type, see COLUMN_TYPE_* in pirilib.h
+ * \return Index of new column.
+ */
+int Table::addColumn(QString name, int type)
+{
+    TableColumn c;
+    c.name = name;
+    c.type = type;
+    myColumns << c;
+    resizeColumn(myColumns.count() - 1, myRowCount);
+    return myColumns.count() - 1;
+}
+
+/*!
+ * \brief Find column by name.
+ *
+ * Column names are not case sensitive, same as in MapInfo.
+ * \param name Column name
+ * \return Column index or -1 if there is no such column.
+ */
+int Table::columnIndex(QString name) const
+{
+    for (int i = 0; i < myColumns.count(); i++)
+    {
+        if (myColumns.at(i).name.compare(name, Qt::CaseInsensitive) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/*!
+ * \brief Get value of table cell.
+ * \param row Row index
+ * \param column Column index
+ * \return Value as QVariant
+ */
+QVariant Table::value(int row, int column) const
+{
+    const TableColumn &c = myColumns.at(column);
+    switch (c.type) {
+    case COLUMN_TYPE_STRING:
+        return c.strings.at(row);
+    case COLUMN_TYPE_FLOAT:
+        return c.floats.at(row);
+    case COLUMN_TYPE_LOGICAL:
+        return c.integers.at(row) != 0;
+    default:
+        return c.integers.at(row);
+    }
+}
+
+/*!
+ * \brief Get value of table cell as string.
+ * \param row Row index
+ * \param column Column index
+ * \return Value as string
+ */
+QString Table::toString(int row, int column) const
+{
+    const TableColumn &c = myColumns.at(column);
+    switch (c.type) {
+    case COLUMN_TYPE_STRING:
+        return c.strings.at(row);
+    case COLUMN_TYPE_FLOAT:
+        return QString::number(c.floats.at(row), 'g', 15);
+    case COLUMN_TYPE_LOGICAL:
+        return c.integers.at(row) ? "T" : "F";
+    default:
+        return QString::number(c.integers.at(row));
+    }
+}
+
+/*!
+ * \brief Does any row have geometry?
+ * \return True if at least one row has geometry.
+ */
+bool Table::hasGeometry() const
+{
+    foreach (int type, myGeometryTypes) {
+        if (type != GEOMETRY_TYPE_NONE)
+            return true;
+    }
+    return false;
+}
+
+/*!
+ * \brief Write zigzag varint.
+ * \param out Buffer, room for 10 bytes.
+ * \param value Value
+ * \return Number of bytes written.
+ */
+static inline int writeVarint(char *out, qint64 value)
+{
+    quint64 v = ((quint64)value << 1) ^ (quint64)(value >> 63);
+    int n = 0;
+    while (v >= 0x80)
+    {
+        out[n++] = char(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = char(v);
+    return n;
+}
+
+/*!
+ * \brief Read zigzag varint.
+ * \param in Read position, moved past value.
+ * \return Value
+ */
+static inline qint64 readVarint(const uchar **in)
+{
+    const uchar *p = *in;
+    quint64 v = *p & 0x7f;
+    int shift = 7;
+    while (*p++ & 0x80)
+    {
+        v |= (quint64)(*p & 0x7f) << shift;
+        shift += 7;
+    }
+    *in = p;
+    return (qint64)(v >> 1) ^ -(qint64)(v & 1);
+}
+
+/*!
+ * \brief Set geometry of row.
+ * \param row Row index
+ * \param type Geometry type, see GEOMETRY_TYPE_* in pirilib.h
+ * \param geometry Geometry
+ */
+void Table::setGeometry(int row, int type, const Geometry &geometry)
+{
+    releaseGeometry(row);
+    myGeometryTypes[row] = type;
+    myRowFirstPart[row] = myPartOffsets.count();
+    myRowPartCount[row] = geometry.count();
+
+    const CoordTransform &t = myTransform;
+    char buffer[40];
+    foreach (const QPolygonF &part, geometry) {
+        int start = myCoords.size();
+        qint64 lastX = 0;
+        qint64 lastY = 0;
+        for (int i = 0; i < part.count(); i++)
+        {
+            qint64 x = qRound64((part.at(i).x() - t.originX) / t.resolutionX);
+            qint64 y = qRound64((part.at(i).y() - t.originY) / t.resolutionY);
+            int n = writeVarint(buffer, x - lastX);
+            n += writeVarint(buffer + n, y - lastY);
+            myCoords.append(buffer, n);
+            lastX = x;
+            lastY = y;
+        }
+        myPartOffsets << start;
+        myPartBytes << myCoords.size() - start;
+        myPartPoints << part.count();
+    }
+}
+
+/*!
+ * \brief Decode points of one part.
+ *
+ * Varints are decoded to integer coordinates first and scaled to map
+ * coordinates in separate loop. Arrays are separate for x and y, so
+ * callers can measure parts without building polygons.
+ * \param row Row index
+ * \param part Part index in row
+ * \param xs Returns x coordinates, room for pointCount() values.
+ * \param ys Returns y coordinates, room for pointCount() values.
+ */
+void Table::points(int row, int part, double *xs, double *ys) const
+{
+    int p = myRowFirstPart.at(row) + part;
+    int n = myPartPoints.at(p);
+    const uchar *in = (const uchar *)myCoords.constData() + myPartOffsets.at(p);
+    qint64 x = 0;
+    qint64 y = 0;
+    for (int i = 0; i < n; i++)
+    {
+        x += readVarint(&in);
+        y += readVarint(&in);
+        xs[i] = (double)x;
+        ys[i] = (double)y;
+    }
+
+    const double ox = myTransform.originX;
+    const double oy = myTransform.originY;
+    const double rx = myTransform.resolutionX;
+    const double ry = myTransform.resolutionY;
+    for (int i = 0; i < n; i++)
+    {
+        xs[i] = ox + xs[i] * rx;
+        ys[i] = oy + ys[i] * ry;
+    }
+}
+
+/*!
+ * \brief Get geometry of row.
+ *
+ * Geometry is decoded from stored coordinates every time.
+ * \param row Row index
+ * \return Geometry
+ */
+Geometry Table::geometry(int row) const
+{
+    Geometry result(myRowPartCount.at(row));
+    QVarLengthArray<double, 512> xs;
+    QVarLengthArray<double, 512> ys;
+    for (int part = 0; part < result.count(); part++)
+    {
+        int n = pointCount(row, part);
+        xs.resize(n);
+        ys.resize(n);
+        points(row, part, xs.data(), ys.data());
+        QPolygonF &polygon = result[part];
+        polygon.resize(n);
+        for (int i = 0; i < n; i++)
+            polygon[i] = QPointF(xs[i], ys[i]);
+    }
+    return result;
+}
+
+/*!
+ * \brief Set geometry of all rows from stored coordinates.
+ *
+ * Coordinates are taken as they are stored, delta and varint encoded with
+ * table transform, so result cache can read them in one copy. Arrays are
+ * cumulative, part p of all parts has points points[p] to points[p + 1]
+ * and bytes offsets[p] to offsets[p + 1] of coords.
+ * \param types Geometry type of every row
+ * \param parts First part of every row, rowCount() + 1 values.
+ * \param points First point of every part
+ * \param offsets First byte of every part
+ * \param coords Stored coordinates of all parts in row order.
+ * \return False if arrays do not match, table has then no geometry.
+ */
+bool Table::setStoredGeometry(const quint8 *types, const quint32 *parts, const quint32 *points,
+                              const quint32 *offsets, const char *coords)
+{
+    int partTotal = parts[myRowCount];
+    QVector<int> first(myRowCount);
+    QVector<int> counts(myRowCount);
+    QVector<int> partOffsets(partTotal);
+    QVector<int> partBytes(partTotal);
+    QVector<int> partPoints(partTotal);
+    bool ok = parts[0] == 0 && points[0] == 0 && offsets[0] == 0;
+    for (int r = 0; r < myRowCount && ok; r++)
+    {
+        ok = parts[r + 1] >= parts[r];
+        first[r] = parts[r];
+        counts[r] = parts[r + 1] - parts[r];
+    }
+    for (int p = 0; p < partTotal && ok; p++)
+    {
+        // Every point takes 2 to 20 bytes
+        qint64 n = qint64(points[p + 1]) - points[p];
+        qint64 bytes = qint64(offsets[p + 1]) - offsets[p];
+        ok = n >= 0 && bytes >= 2 * n && bytes <= 20 * n;
+        partOffsets[p] = offsets[p];
+        partBytes[p] = bytes;
+        partPoints[p] = n;
+    }
+
+    resizeGeometry(0);
+    myCoords.clear();
+    myPartOffsets.clear();
+    myPartBytes.clear();
+    myPartPoints.clear();
+    myUnusedBytes = 0;
+    resizeGeometry(myRowCount);
+    if (!ok)
+        return false;
+    for (int r = 0; r < myRowCount; r++)
+        myGeometryTypes[r] = types[r];
+    myRowFirstPart = first;
+    myRowPartCount = counts;
+    myPartOffsets = partOffsets;
+    myPartBytes = partBytes;
+    myPartPoints = partPoints;
+    myCoords = QByteArray(coords, offsets[partTotal]);
+    return true;
+}
+
+/*!
+ * \brief Set transform of stored coordinates.
+ *
+ * Geometry that is already in table is encoded again, so set transform
+ * before geometry when possible.
+ * \param transform New transform, resolutions have to be positive.
+ */
+void Table::setTransform(const CoordTransform &transform)
+{
+    if (myPartOffsets.isEmpty())
+    {
+        myTransform = transform;
+        return;
+    }
+    QVector<Geometry> geometries(myRowCount);
+    for (int r = 0; r < myRowCount; r++)
+        geometries[r] = geometry(r);
+    myTransform = transform;
+    for (int r = 0; r < myRowCount; r++)
+        setGeometry(r, myGeometryTypes.at(r), geometries.at(r));
+    compactGeometry();
+}
+
+/*!
+ * \brief Mark stored coordinates of row unused.
+ *
+ * Coordinates are removed when more than half of bytes are unused.
+ * \param row Row index
+ */
+void Table::releaseGeometry(int row)
+{
+    int first = myRowFirstPart.at(row);
+    for (int p = first; p < first + myRowPartCount.at(row); p++)
+        myUnusedBytes += myPartBytes.at(p);
+    myRowPartCount[row] = 0;
+    if (myUnusedBytes > 4096 && myUnusedBytes > myCoords.size() / 2)
+        compactGeometry();
+}
+
+/*!
+ * \brief Remove unused coordinates, parts are put in row order.
+ */
+void Table::compactGeometry()
+{
+    QByteArray coords;
+    coords.reserve(myCoords.size() - myUnusedBytes);
+    QVector<int> offsets;
+    QVector<int> bytes;
+    QVector<int> points;
+    for (int r = 0; r < myRowFirstPart.count(); r++)
+    {
+        int first = myRowFirstPart.at(r);
+        myRowFirstPart[r] = offsets.count();
+        for (int p = first; p < first + myRowPartCount.at(r); p++)
+        {
+            offsets << coords.size();
+            bytes << myPartBytes.at(p);
+            points << myPartPoints.at(p);
+            coords.append(myCoords.constData() + myPartOffsets.at(p), myPartBytes.at(p));
+        }
+    }
+    myCoords = coords;
+    myPartOffsets = offsets;
+    myPartBytes = bytes;
+    myPartPoints = points;
+    myUnusedBytes = 0;
+}
+
+/*!
+ * \brief Copy geometry of row from other table.
+ *
+ * Stored bytes are copied as they are when transforms are same.
+ * \param row Row index in this table.
+ * \param other Other table
+ * \param otherRow Row index in other table.
+ */
+void Table::copyGeometry(int row, const Table *other, int otherRow)
+{
+    const CoordTransform &a = myTransform;
+    const CoordTransform &b = other->myTransform;
+    if (a.originX != b.originX || a.originY != b.originY
+            || a.resolutionX != b.resolutionX || a.resolutionY != b.resolutionY)
+    {
+        setGeometry(row, other->geometryType(otherRow), other->geometry(otherRow));
+        return;
+    }
+
+    releaseGeometry(row);
+    myGeometryTypes[row] = other->myGeometryTypes.at(otherRow);
+    myRowFirstPart[row] = myPartOffsets.count();
+    myRowPartCount[row] = other->myRowPartCount.at(otherRow);
+    int first = other->myRowFirstPart.at(otherRow);
+    for (int p = first; p < first + other->myRowPartCount.at(otherRow); p++)
+    {
+        myPartOffsets << myCoords.size();
+        myPartBytes << other->myPartBytes.at(p);
+        myPartPoints << other->myPartPoints.at(p);
+        myCoords.append(other->myCoords.constData() + other->myPartOffsets.at(p), other->myPartBytes.at(p));
+    }
+}
+
+/*!
+ * \brief Make new table from some rows and columns of this table.
+ *
+ * Stored geometry bytes are copied for every row, they are not decoded.
+ * \param rows Row indexes in new order
+ * \param columns Column indexes in new order
+ * \return New table
+ */
+TablePtr Table::subset(const QVector<int> &rows, const QVector<int> &columns) const
+{
+    TablePtr result(new Table(myName));
+    result->myTransform = myTransform;
+    foreach (int ci, columns) {
+        result->addColumn(myColumns.at(ci).name, myColumns.at(ci).type);
+    }
+    result->resize(rows.count());
+
+    for (int j = 0; j < columns.count(); j++)
+    {
+        const TableColumn &src = myColumns.at(columns.at(j));
+        TableColumn &dst = result->column(j);
+        switch (src.type) {
+        case COLUMN_TYPE_STRING:
+            for (int i = 0; i < rows.count(); i++)
+                dst.strings[i] = src.strings.at(rows.at(i));
+            break;
+        case COLUMN_TYPE_FLOAT:
+            for (int i = 0; i < rows.count(); i++)
+                dst.floats[i] = src.floats.at(rows.at(i));
+            break;
+        default:
+            for (int i = 0; i < rows.count(); i++)
+                dst.integers[i] = src.integers.at(rows.at(i));
+        }
+    }
+    for (int i = 0; i < rows.count(); i++)
+    {
+        result->copyGeometry(i, this, rows.at(i));
+    }
+    return result;
+}
+
+/*!
+ * \brief Make new table from consecutive rows of this table.
+ *
+ * All columns are kept. Used to cut table into stream batches.
+ * \param first First row
+ * \param count Number of rows, rows past end are left out.
+ * \return New table
+ */
+TablePtr Table::slice(int first, int count) const
+{
+    first = qBound(0, first, myRowCount);
+    count = qBound(0, count, myRowCount - first);
+    TablePtr result(new Table(myName));
+    result->myTransform = myTransform;
+    foreach (const TableColumn &src, myColumns) {
+        TableColumn c;
+        c.name = src.name;
+        c.type = src.type;
+        switch (src.type) {
+        case COLUMN_TYPE_STRING:
+            c.strings = src.strings.mid(first, count);
+            break;
+        case COLUMN_TYPE_FLOAT:
+            c.floats = src.floats.mid(first, count);
+            break;
+        default:
+            c.integers = src.integers.mid(first, count);
+        }
+        result->myColumns << c;
+    }
+    result->resizeGeometry(count);
+    result->myRowCount = count;
+    for (int i = 0; i < count; i++)
+        result->copyGeometry(i, this, first + i);
+    return result;
+}
+
+/*!
+ * \brief Add rows of other table to end of this table.
+ *
+ * Empty table without columns takes columns and transform of other
+ * table. Otherwise columns have to match by count and type.
+ * \param other Table to append.
+ * \return False if columns do not match.
+ */
+bool Table::append(const Table *other)
+{
+    if (myColumns.isEmpty() && myRowCount == 0)
+    {
+        myTransform = other->myTransform;
+        for (int i = 0; i < other->columnCount(); i++)
+            addColumn(other->column(i).name, other->column(i).type);
+    }
+    if (other->columnCount() != columnCount())
+        return false;
+    for (int i = 0; i < myColumns.count(); i++)
+    {
+        if (myColumns.at(i).type != other->column(i).type)
+            return false;
+    }
+
+    for (int i = 0; i < myColumns.count(); i++)
+    {
+        TableColumn &c = myColumns[i];
+        const TableColumn &src = other->column(i);
+        switch (c.type) {
+        case COLUMN_TYPE_STRING:
+            c.strings += src.strings;
+            break;
+        case COLUMN_TYPE_FLOAT:
+            c.floats += src.floats;
+            break;
+        default:
+            c.integers += src.integers;
+        }
+    }
+    int start = myRowCount;
+    resizeGeometry(start + other->rowCount());
+    for (int i = 0; i < other->rowCount(); i++)
+        copyGeometry(start + i, other, i);
+    myRowCount += other->rowCount();
+    return true;
+}
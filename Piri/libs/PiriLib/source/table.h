@@ -0,0 +1,111 @@
+#ifndef TABLE_H
+#define TABLE_H
+
+#include <QString>
+#include <QVector>
+#include <QPolygonF>
+#include <QVariant>
+#include <QSharedPointer>
+#include <QByteArray>
+
+#include "pirilib.h"
+
+/*!
+ * \brief Geometry of one table row.
+ *
+ * Point is one polygon with one point, line is one polygon per section and
+ * region is one polygon per ring. Geometry type is kept in table.
+ */
+typedef QVector<QPolygonF> Geometry;
+
+/*!
+ * \brief Transform between map coordinates and stored integer coordinates.
+ *
+ * Map coordinate is origin + stored value * resolution.
+ */
+struct CoordTransform {
+    double originX;
+    double originY;
+    double resolutionX;
+    double resolutionY;
+};
+
+/*!
+ * \brief One column of native table.
+ *
+ * Only vector that matches column type is used. Integer, logical and date
+ * columns use integers, dates are stored as yyyymmdd.
+ */
+struct TableColumn {
+    QString name;
+    int type; /*!< Column type, see COLUMN_TYPE_* in pirilib.h */
+    QVector<QString> strings;
+    QVector<qint64> integers;
+    QVector<double> floats;
+};
+
+class Table;
+typedef QSharedPointer<Table> TablePtr;
+
+class PIRILIBSHARED_EXPORT Table
+{
+public:
+    Table(QString name = QString());
+
+    QString getName() const { return myName; }
+    void setName(QString name) { myName = name; }
+
+    int rowCount() const { return myRowCount; }
+    int columnCount() const { return myColumns.count(); }
+    void resize(int rows);
+    qint64 byteSize() const;
+
+    int addColumn(QString name, int type);
+    int columnIndex(QString name) const;
+    TableColumn& column(int index) { return myColumns[index]; }
+    const TableColumn& column(int index) const { return myColumns.at(index); }
+
+    QVariant value(int row, int column) const;
+    QString toString(int row, int column) const;
+
+    bool hasGeometry() const;
+    int geometryType(int row) const { return myGeometryTypes.at(row); }
+    Geometry geometry(int row) const;
+    void setGeometry(int row, int type, const Geometry &geometry);
+    int partCount(int row) const { return myRowPartCount.at(row); }
+    int pointCount(int row, int part) const { return myPartPoints.at(myRowFirstPart.at(row) + part); }
+    void points(int row, int part, double *xs, double *ys) const;
+    const char* partData(int row, int part) const { return myCoords.constData() + myPartOffsets.at(myRowFirstPart.at(row) + part); }
+    int partBytes(int row, int part) const { return myPartBytes.at(myRowFirstPart.at(row) + part); }
+    bool setStoredGeometry(const quint8 *types, const quint32 *parts, const quint32 *points,
+                           const quint32 *offsets, const char *coords);
+
+    CoordTransform getTransform() const { return myTransform; }
+    void setTransform(const CoordTransform &transform);
+
+    TablePtr subset(const QVector<int> &rows, const QVector<int> &columns) const;
+    TablePtr slice(int first, int count) const;
+    bool append(const Table *other);
+
+private:
+    void resizeColumn(int index, int rows);
+    void resizeGeometry(int rows);
+    void releaseGeometry(int row);
+    void copyGeometry(int row, const Table *other, int otherRow);
+    void compactGeometry();
+
+    QString myName; /*!< Table name, usually file name without suffix. */
+    int myRowCount; /*!< Number of rows in every column. */
+    QVector<TableColumn> myColumns; /*!< Table columns. */
+    QVector<int> myGeometryTypes; /*!< Geometry type of each row, see GEOMETRY_TYPE_* in pirilib.h */
+    CoordTransform myTransform; /*!< Transform of stored coordinates. */
+    QVector<int> myRowFirstPart; /*!< First part of each row. */
+    QVector<int> myRowPartCount; /*!< Number of parts of each row. */
+    QVector<int> myPartOffsets; /*!< Offset of each part in myCoords. */
+    QVector<int> myPartBytes; /*!< Size of each part in myCoords. */
+    QVector<int> myPartPoints; /*!< Number of points in each part. */
+    QByteArray myCoords; /*!< Coordinates of all parts, delta and varint encoded. */
+    int myUnusedBytes; /*!< Bytes in myCoords of replaced geometries. */
+};
+
+#endif // TABLE_H
@@ -0,0 +1,69 @@
+#include "tablestream.h"
+
+
+/*!
+ * \brief Read all remaining batches into one table.
+ *
+ * Whole result is kept in memory, use only when op needs whole table.
+ * \return Table or null pointer on error, see getError().
+ */
+TablePtr TableStream::readAll()
+{
+    TablePtr first = next();
+    if (!first)
+        return hasError() ? TablePtr() : TablePtr(new Table());
+
+    TablePtr batch = next();
+    if (!batch)
+        return hasError() ? TablePtr() : first;
+
+    // Batch can be shared with stream source, so rows are copied to new table
+    TablePtr result(new Table(first->getName()));
+    result->append(first.data());
+    while (batch)
+    {
+        if (!result->append(batch.data()))
+        {
+            myError = "Stream batches have different columns";
+            return TablePtr();
+        }
+        batch = next();
+    }
+    if (hasError())
+        return TablePtr();
+    return result;
+}
+
+
+/*!
+ * \brief Table slice stream constructor.
+ *
+ * First batch is always returned, even if table is empty, so consumer
+ * gets columns of table.
+ * \param table Table to stream.
+ * \param batchRows Rows in one batch.
+ */
+TableSliceStream::TableSliceStream(TablePtr table, int batchRows)
+{
+    myTable = table;
+    myBatchRows = qMax(1, batchRows);
+    myPos = 0;
+}
+
+/*!
+ * \brief Get next batch.
+ * \return Batch or null pointer at end.
+ */
+TablePtr TableSliceStream::next()
+{
+    if (!myTable || (myPos > 0 && myPos >= myTable->rowCount()))
+        return TablePtr();
+    if (myPos == 0 && myTable->rowCount() <= myBatchRows)
+    {
+        myPos = qMax(1, myTable->rowCount());
+        return myTable;
+    }
+    TablePtr batch = myTable->slice(myPos, myBatchRows);
+    myPos += myBatchRows;
+    return batch;
+}
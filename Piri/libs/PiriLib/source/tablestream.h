@@ -0,0 +1,54 @@
+#ifndef TABLESTREAM_H
+#define TABLESTREAM_H
+
+#include <QString>
+#include <QSharedPointer>
+
+#include "pirilib.h"
+#include "table.h"
+
+class TableStream;
+typedef QSharedPointer<TableStream> TableStreamPtr;
+
+/*!
+ * \brief Table that is read in batches.
+ *
+ * Streams are pulled by consumer, every call of next() gives next batch of
+ * rows. All batches of one stream have same columns. Row-wise ops stream
+ * their input to output, so only few batches are in memory at once.
+ */
+class PIRILIBSHARED_EXPORT TableStream
+{
+public:
+    virtual ~TableStream() {}
+
+    virtual TablePtr next() = 0;
+
+    TablePtr readAll();
+    bool hasError() { return !myError.isEmpty(); }
+    QString getError() { return myError; }
+
+protected:
+    QString myError; /*!< Last error, stream ends on error. */
+};
+
+/*!
+ * \brief Stream of table that is already in memory.
+ *
+ * Used when streaming op gets input from cache or from op that can not
+ * stream.
+ */
+class PIRILIBSHARED_EXPORT TableSliceStream : public TableStream
+{
+public:
+    TableSliceStream(TablePtr table, int batchRows = STREAM_BATCH_ROWS);
+
+    TablePtr next();
+
+private:
+    TablePtr myTable; /*!< Table to stream. */
+    int myBatchRows; /*!< Rows in one batch. */
+    int myPos; /*!< First row of next batch. */
+};
+
+#endif // TABLESTREAM_H
@@ -0,0 +1,707 @@
+#include "tabreader.h"
+
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QTextCodec>
+#include <QtEndian>
+
+#include <string.h>
+#include <limits.h>
+
+namespace {
+
+inline qint16 readInt16(const uchar *p) { return qFromLittleEndian<qint16>(p); }
+inline qint32 readInt32(const uchar *p) { return qFromLittleEndian<qint32>(p); }
+
+inline double readDouble(const uchar *p)
+{
+    quint64 bits = qFromLittleEndian<quint64>(p);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+/*!
+ * \brief Reads coordinate data from chained .MAP coordinate blocks.
+ *
+ * Coordinate block has 8 byte header (type, number of data bytes, next
+ * block). Data of one object can continue in next block.
+ */
+struct CoordCursor {
+    const uchar *map;
+    qint64 size;
+    int blockSize;
+    qint64 blockStart;
+    qint64 pos;
+    qint64 blockEnd;
+    bool ok;
+
+    CoordCursor(const uchar *m, qint64 s, int bs, qint64 offset)
+        : map(m), size(s), blockSize(bs), ok(true)
+    {
+        enterBlock(offset - offset % blockSize, offset);
+    }
+
+    void enterBlock(qint64 block, qint64 offset)
+    {
+        if (block <= 0 || block + 8 > size)
+        {
+            ok = false;
+            return;
+        }
+        blockStart = block;
+        pos = offset;
+        blockEnd = block + 8 + readInt16(map + block + 2);
+        if (blockEnd > size || pos < block + 8)
+            ok = false;
+    }
+
+    // Copies n bytes to dst, dst can be 0 when bytes are only skipped.
+    bool read(uchar *dst, int n)
+    {
+        while (n > 0 && ok)
+        {
+            if (pos >= blockEnd)
+            {
+                qint32 next = readInt32(map + blockStart + 4);
+                enterBlock(next, next + 8);
+                continue;
+            }
+            int c = (int)qMin<qint64>(n, blockEnd - pos);
+            if (dst)
+            {
+                memcpy(dst, map + pos, c);
+                dst += c;
+            }
+            pos += c;
+            n -= c;
+        }
+        return ok;
+    }
+
+    qint16 int16()
+    {
+        uchar b[2];
+        return read(b, 2) ? readInt16(b) : 0;
+    }
+
+    qint32 int32()
+    {
+        uchar b[4];
+        return read(b, 4) ? readInt32(b) : 0;
+    }
+
+    // Reads one vertex, compressed vertices are 16 bit offsets from origin.
+    void vertex(bool compressed, qint32 orgX, qint32 orgY, qint32 *x, qint32 *y)
+    {
+        if (compressed)
+        {
+            if (pos + 4 <= blockEnd)
+            {
+                *x = orgX + readInt16(map + pos);
+                *y = orgY + readInt16(map + pos + 2);
+                pos += 4;
+                return;
+            }
+            *x = orgX + int16();
+            *y = orgY + int16();
+        } else {
+            if (pos + 8 <= blockEnd)
+            {
+                *x = readInt32(map + pos);
+                *y = readInt32(map + pos + 4);
+                pos += 8;
+                return;
+            }
+            *x = int32();
+            *y = int32();
+        }
+    }
+};
+
+}
+
+
+/*!
+ * \brief MapInfo table reader constructor.
+ *
+ * Reader reads native MapInfo table (.TAB, .DAT, .ID, .MAP) into native
+ * table without MapInfo. Only native tables are supported, not views,
+ * seamless tables or rasters.
+ * \param fileName Path of .TAB file.
+ */
+TabReader::TabReader(QString fileName)
+{
+    myFileName = fileName;
+    myCodec = 0;
+    myRecords = 0;
+    myRecordCount = 0;
+    myRecordLength = 0;
+    myNextRecord = 0;
+    myMap = 0;
+    myMapSize = 0;
+    myBlockSize = 512;
+    myQuadrant = 1;
+    myXScale = 1.0;
+    myYScale = 1.0;
+    myXDispl = 0.0;
+    myYDispl = 0.0;
+}
+
+/*!
+ * \brief Read table.
+ *
+ * Table without .MAP file is read without geometry.
+ * \return Table or null pointer on error, see getError().
+ */
+TablePtr TabReader::read()
+{
+    if (!open())
+        return TablePtr();
+    return readBatch(INT_MAX);
+}
+
+/*!
+ * \brief Open table for reading in batches.
+ *
+ * Files are mapped, but no rows are read yet. Table without .MAP file is
+ * read without geometry.
+ * \return True on success, see getError() otherwise.
+ */
+bool TabReader::open()
+{
+    if (!readHeader() || !openDat())
+        return false;
+    if (QFile::exists(fileWithSuffix("MAP")) && !openMap())
+        return false;
+    return true;
+}
+
+/*!
+ * \brief Read next rows of opened table.
+ *
+ * Deleted records are skipped, so batch can have less rows than records.
+ * Batch after last row is empty, but has all columns.
+ * \param maxRows Maximum number of rows in batch.
+ * \return Batch or null pointer on error, see getError().
+ */
+TablePtr TabReader::readBatch(int maxRows)
+{
+    QVector<int> rows;
+    rows.reserve(qMin(maxRows, myRecordCount - myNextRecord));
+    while (myNextRecord < myRecordCount && rows.count() < maxRows)
+    {
+        if (myRecords[(qint64)myNextRecord * myRecordLength] != '*')
+            rows << myNextRecord + 1;
+        myNextRecord++;
+    }
+
+    TablePtr table(new Table(QFileInfo(myFileName).completeBaseName()));
+    for (int c = 0; c < myFields.count(); c++)
+        table->addColumn(myFields.at(c).name, myFields.at(c).type);
+    table->resize(rows.count());
+    readDat(table.data(), rows);
+    if (myMap)
+        table->setTransform(mapTransform());
+    if (myMap && !readMap(table.data(), rows))
+        return TablePtr();
+    return table;
+}
+
+/*!
+ * \brief Get path of table file with other suffix.
+ *
+ * Both upper and lower case suffixes are tried.
+ * \param suffix Suffix without dot, for example "DAT".
+ * \return Path of file.
+ */
+QString TabReader::fileWithSuffix(QString suffix)
+{
+    QFileInfo fi(myFileName);
+    QString base = fi.path() + "/" + fi.completeBaseName() + ".";
+    if (QFile::exists(base + suffix.toUpper()))
+        return base + suffix.toUpper();
+    if (QFile::exists(base + suffix.toLower()))
+        return base + suffix.toLower();
+    return base + suffix.toUpper();
+}
+
+/*!
+ * \brief Get codec of MapInfo charset.
+ *
+ * Unknown charsets are read as Windows-1252.
+ * \param charset Charset name as in .TAB file, for example "WindowsBalticRim".
+ * \return Codec, never null.
+ */
+QTextCodec* TabReader::codecForCharset(QString charset)
+{
+    QByteArray name = "Windows-1252";
+    if (charset == "WindowsBalticRim")
+        name = "Windows-1257";
+    else if (charset == "WindowsCyrillic")
+        name = "Windows-1251";
+    else if (charset == "WindowsLatin2")
+        name = "Windows-1250";
+    else if (charset == "Neutral" || charset == "ISO8859_1")
+        name = "ISO-8859-1";
+    QTextCodec *codec = QTextCodec::codecForName(name);
+    if (!codec)
+        codec = QTextCodec::codecForName("ISO-8859-1");
+    return codec;
+}
+
+/*!
+ * \brief Read field definitions and charset from .TAB file.
+ * \return True on success.
+ */
+bool TabReader::readHeader()
+{
+    QFile file(myFileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        myError = "Can not open " + myFileName;
+        return false;
+    }
+
+    QString charset;
+    int fieldCount = -1;
+    QRegularExpression fieldExp("^(\\S+)\\s+(\\w+)");
+    myFields.clear();
+
+    while (!file.atEnd())
+    {
+        QString line = QString::fromLatin1(file.readLine()).trimmed();
+        if (line.isEmpty())
+            continue;
+
+        if (fieldCount > 0)
+        {
+            QRegularExpressionMatch m = fieldExp.match(line);
+            if (!m.hasMatch())
+            {
+                myError = "Bad field definition: " + line;
+                return false;
+            }
+            TabField f;
+            f.name = m.captured(1);
+            f.offset = 0;
+            f.width = 0;
+            QString type = m.captured(2).toLower();
+            if (type == "char") {
+                f.tabType = Char;
+                f.type = COLUMN_TYPE_STRING;
+            } else if (type == "integer") {
+                f.tabType = Integer;
+                f.type = COLUMN_TYPE_INTEGER;
+            } else if (type == "smallint") {
+                f.tabType = SmallInt;
+                f.type = COLUMN_TYPE_INTEGER;
+            } else if (type == "float") {
+                f.tabType = Float;
+                f.type = COLUMN_TYPE_FLOAT;
+            } else if (type == "decimal") {
+                f.tabType = Decimal;
+                f.type = COLUMN_TYPE_FLOAT;
+            } else if (type == "date") {
+                f.tabType = Date;
+                f.type = COLUMN_TYPE_DATE;
+            } else if (type == "logical") {
+                f.tabType = Logical;
+                f.type = COLUMN_TYPE_LOGICAL;
+            } else {
+                myError = "Unsupported field type: " + line;
+                return false;
+            }
+            myFields << f;
+            fieldCount--;
+            continue;
+        }
+
+        QString lower = line.toLower();
+        if (lower.startsWith("!charset"))
+            charset = line.section(' ', 1, 1, QString::SectionSkipEmpty);
+        else if (lower.startsWith("type ") && !lower.contains("native"))
+        {
+            myError = "Only native MapInfo tables are supported: " + myFileName;
+            return false;
+        }
+        else if (lower.startsWith("fields "))
+            fieldCount = line.section(' ', 1, 1, QString::SectionSkipEmpty).toInt();
+    }
+
+    if (myFields.isEmpty())
+    {
+        myError = "No fields in " + myFileName;
+        return false;
+    }
+    myCodec = codecForCharset(charset);
+    return true;
+}
+
+/*!
+ * \brief Map .DAT file and read its header.
+ *
+ * Field widths come from .DAT header, field types from .TAB file.
+ * \return True on success.
+ */
+bool TabReader::openDat()
+{
+    myDatFile.setFileName(fileWithSuffix("DAT"));
+    if (!myDatFile.open(QIODevice::ReadOnly))
+    {
+        myError = "Can not open " + myDatFile.fileName();
+        return false;
+    }
+    qint64 size = myDatFile.size();
+    const uchar *dat = size >= 32 ? myDatFile.map(0, size) : 0;
+    if (!dat)
+    {
+        myError = "Can not read " + myDatFile.fileName();
+        return false;
+    }
+
+    int recordCount = readInt32(dat + 4);
+    int headerLength = (quint16)readInt16(dat + 8);
+    int recordLength = (quint16)readInt16(dat + 10);
+
+    int offset = 1;
+    int i = 0;
+    for (qint64 d = 32; d + 32 <= headerLength && dat[d] != 0x0d; d += 32, i++)
+    {
+        if (i >= myFields.count())
+            break;
+        myFields[i].offset = offset;
+        myFields[i].width = dat[d + 16];
+        offset += myFields[i].width;
+    }
+    if (i != myFields.count() || offset > recordLength || recordCount < 0
+            || headerLength + (qint64)recordCount * recordLength > size)
+    {
+        myError = "Table structure in .TAB and .DAT do not match: " + myFileName;
+        return false;
+    }
+
+    myRecords = dat + headerLength;
+    myRecordCount = recordCount;
+    myRecordLength = recordLength;
+    myNextRecord = 0;
+    return true;
+}
+
+/*!
+ * \brief Read attribute data of rows from .DAT file.
+ *
+ * Float fields are binary doubles even if .DAT header says character field.
+ * \param table Table to fill, has one row for every record.
+ * \param rows MapInfo row ids of records.
+ */
+void TabReader::readDat(Table *table, const QVector<int> &rows)
+{
+    for (int c = 0; c < myFields.count(); c++)
+    {
+        const TabField &f = myFields.at(c);
+        TableColumn &col = table->column(c);
+        for (int i = 0; i < rows.count(); i++)
+        {
+            const uchar *p = myRecords + (qint64)(rows.at(i) - 1) * myRecordLength + f.offset;
+            switch (f.tabType) {
+            case Char:
+            {
+                const uchar *end = (const uchar*)memchr(p, 0, f.width);
+                int len = end ? end - p : f.width;
+                while (len > 0 && p[len - 1] == ' ')
+                    len--;
+                col.strings[i] = myCodec->toUnicode((const char*)p, len);
+                break;
+            }
+            case Integer:
+                col.integers[i] = readInt32(p);
+                break;
+            case SmallInt:
+                col.integers[i] = readInt16(p);
+                break;
+            case Float:
+                col.floats[i] = readDouble(p);
+                break;
+            case Decimal:
+                col.floats[i] = QByteArray((const char*)p, f.width).trimmed().toDouble();
+                break;
+            case Date:
+                col.integers[i] = readInt16(p) * 10000 + p[2] * 100 + p[3];
+                break;
+            case Logical:
+                col.integers[i] = (p[0] == 'T' || p[0] == 't' || p[0] == 'Y' || p[0] == 'y') ? 1 : 0;
+                break;
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Get transform that stores table coordinates as .MAP integers.
+ *
+ * Table then keeps coordinates exactly as they are in .MAP file.
+ * \return Transform
+ */
+CoordTransform TabReader::mapTransform() const
+{
+    CoordTransform t;
+    t.originX = -myXDispl / myXScale;
+    t.originY = -myYDispl / myYScale;
+    t.resolutionX = 1.0 / qAbs(myXScale);
+    t.resolutionY = 1.0 / qAbs(myYScale);
+    return t;
+}
+
+/*!
+ * \brief Convert .MAP integer coordinates to table coordinates.
+ * \param x Integer x
+ * \param y Integer y
+ * \return Point in table coordinates.
+ */
+QPointF TabReader::toPoint(qint32 x, qint32 y) const
+{
+    double px, py;
+    if (myQuadrant == 2 || myQuadrant == 3 || myQuadrant == 0)
+        px = -(x + myXDispl) / myXScale;
+    else
+        px = (x - myXDispl) / myXScale;
+    if (myQuadrant == 3 || myQuadrant == 4 || myQuadrant == 0)
+        py = -(y + myYDispl) / myYScale;
+    else
+        py = (y - myYDispl) / myYScale;
+    return QPointF(px, py);
+}
+
+/*!
+ * \brief Map .MAP file, read its header and read .ID file.
+ * \return True on success.
+ */
+bool TabReader::openMap()
+{
+    QFile idFile(fileWithSuffix("ID"));
+    if (!idFile.open(QIODevice::ReadOnly))
+    {
+        myError = "Can not open " + idFile.fileName();
+        return false;
+    }
+    myIds = idFile.readAll();
+
+    myMapFile.setFileName(fileWithSuffix("MAP"));
+    if (!myMapFile.open(QIODevice::ReadOnly))
+    {
+        myError = "Can not open " + myMapFile.fileName();
+        return false;
+    }
+    qint64 size = myMapFile.size();
+    const uchar *map = size >= 1024 ? myMapFile.map(0, size) : 0;
+    if (!map || readInt32(map + 0x100) != 42424242)
+    {
+        myError = "Not a MapInfo .MAP file: " + myMapFile.fileName();
+        return false;
+    }
+
+    myBlockSize = readInt16(map + 0x106);
+    if (myBlockSize <= 0)
+        myBlockSize = 512;
+    myQuadrant = map[0x161];
+    myXScale = readDouble(map + 0x170);
+    myYScale = readDouble(map + 0x178);
+    myXDispl = readDouble(map + 0x180);
+    myYDispl = readDouble(map + 0x188);
+    if (myXScale == 0.0 || myYScale == 0.0)
+    {
+        myError = "Bad coordinate system in " + myMapFile.fileName();
+        return false;
+    }
+    myMap = map;
+    myMapSize = size;
+    return true;
+}
+
+/*!
+ * \brief Read geometry of rows from .MAP file using object offsets from .ID file.
+ * \param table Table to fill, has one row for every row id.
+ * \param rows MapInfo row ids.
+ * \return True on success.
+ */
+bool TabReader::readMap(Table *table, const QVector<int> &rows)
+{
+    const uchar *idData = (const uchar*)myIds.constData();
+    int idCount = myIds.size() / 4;
+    for (int i = 0; i < rows.count(); i++)
+    {
+        int row = rows.at(i);
+        if (row > idCount)
+            continue;
+        qint32 offset = readInt32(idData + (row - 1) * 4);
+        if (offset <= 0)
+            continue;
+
+        int type;
+        Geometry geometry;
+        if (!readObject(myMap, myMapSize, offset, &type, &geometry))
+        {
+            myError = QString("Bad object for row %1 in %2").arg(row).arg(myMapFile.fileName());
+            return false;
+        }
+        table->setGeometry(i, type, geometry);
+    }
+    return true;
+}
+
+/*!
+ * \brief Read one object from .MAP file.
+ *
+ * Supports points, lines, polylines, regions and multiple polylines, both
+ * compressed and uncompressed. Other objects (text, arcs, ellipses...)
+ * are read as objects without geometry.
+ * \param map Mapped .MAP file
+ * \param size Size of .MAP file
+ * \param offset Object offset from .ID file
+ * \param type Returns geometry type
+ * \param geometry Returns geometry
+ * \return False if object is broken.
+ */
+bool TabReader::readObject(const uchar *map, qint64 size, qint64 offset, int *type, Geometry *geometry)
+{
+    *type = GEOMETRY_TYPE_NONE;
+    if (offset + 5 > size)
+        return false;
+
+    int objType = map[offset];
+    const uchar *p = map + offset + 5;
+    qint64 block = offset - offset % myBlockSize;
+    qint32 centerX = readInt32(map + block + 4);
+    qint32 centerY = readInt32(map + block + 8);
+
+    bool compressed;
+    bool region = false;
+    bool singleSection = false;
+    bool v450 = false;
+    switch (objType) {
+    case 0x01: // SYMBOL_C
+        if (offset + 9 > size)
+            return false;
+        *type = GEOMETRY_TYPE_POINT;
+        *geometry << (QPolygonF() << toPoint(centerX + readInt16(p), centerY + readInt16(p + 2)));
+        return true;
+    case 0x02: // SYMBOL
+        if (offset + 13 > size)
+            return false;
+        *type = GEOMETRY_TYPE_POINT;
+        *geometry << (QPolygonF() << toPoint(readInt32(p), readInt32(p + 4)));
+        return true;
+    case 0x04: // LINE_C
+        if (offset + 13 > size)
+            return false;
+        *type = GEOMETRY_TYPE_LINE;
+        *geometry << (QPolygonF() << toPoint(centerX + readInt16(p), centerY + readInt16(p + 2))
+                                  << toPoint(centerX + readInt16(p + 4), centerY + readInt16(p + 6)));
+        return true;
+    case 0x05: // LINE
+        if (offset + 21 > size)
+            return false;
+        *type = GEOMETRY_TYPE_LINE;
+        *geometry << (QPolygonF() << toPoint(readInt32(p), readInt32(p + 4))
+                                  << toPoint(readInt32(p + 8), readInt32(p + 12)));
+        return true;
+    case 0x07: // PLINE_C
+    case 0x08: // PLINE
+        compressed = objType == 0x07;
+        singleSection = true;
+        break;
+    case 0x0d: // REGION_C
+    case 0x0e: // REGION
+        compressed = objType == 0x0d;
+        region = true;
+        break;
+    case 0x25: // MULTIPLINE_C
+    case 0x26: // MULTIPLINE
+        compressed = objType == 0x25;
+        break;
+    case 0x2e: // V450_REGION_C
+    case 0x2f: // V450_REGION
+        compressed = objType == 0x2e;
+        region = true;
+        v450 = true;
+        break;
+    case 0x31: // V450_MULTIPLINE_C
+    case 0x32: // V450_MULTIPLINE
+        compressed = objType == 0x31;
+        v450 = true;
+        break;
+    default:
+        return true;
+    }
+
+    if (offset + 5 + 10 + 12 > size)
+        return false;
+    qint32 coordPtr = readInt32(p);
+    qint32 coordSize = readInt32(p + 4) & 0x7fffffff;
+    p += 8;
+    int sections = 1;
+    if (!singleSection)
+    {
+        sections = readInt16(p);
+        p += 2;
+    }
+    qint32 orgX = 0;
+    qint32 orgY = 0;
+    if (compressed)
+    {
+        orgX = readInt32(p + 4);
+        orgY = readInt32(p + 8);
+    }
+
+    CoordCursor cursor(map, size, myBlockSize, coordPtr);
+    QVector<int> vertexCounts;
+    QVector<int> firstVertex;
+    int total = 0;
+    if (singleSection)
+    {
+        total = coordSize / (compressed ? 4 : 8);
+        vertexCounts << total;
+        firstVertex << 0;
+    } else {
+        // Section data offset is counted as if headers and vertices were
+        // uncompressed, sections are not always stored in order.
+        int headerSize = (v450 ? 28 : 24) * sections;
+        for (int s = 0; s < sections && cursor.ok; s++)
+        {
+            int nv = v450 ? cursor.int32() : cursor.int16();
+            cursor.int16(); // number of holes
+            cursor.read(0, compressed ? 8 : 16); // MBR
+            int dataOffset = cursor.int32();
+            vertexCounts << nv;
+            firstVertex << (dataOffset - headerSize) / 8;
+            total += nv;
+        }
+    }
+    if (!cursor.ok || total < 0)
+        return false;
+
+    QVector<QPointF> points(total);
+    QPointF *out = points.data();
+    for (int v = 0; v < total; v++)
+    {
+        qint32 x, y;
+        cursor.vertex(compressed, orgX, orgY, &x, &y);
+        out[v] = toPoint(x, y);
+    }
+    if (!cursor.ok)
+        return false;
+
+    geometry->reserve(vertexCounts.count());
+    for (int s = 0; s < vertexCounts.count(); s++)
+    {
+        int first = firstVertex.at(s);
+        int nv = vertexCounts.at(s);
+        if (nv < 0 || first < 0 || first + nv > total)
+            return false;
+        *geometry << QPolygonF(points.mid(first, nv));
+    }
+
+    *type = region ? GEOMETRY_TYPE_REGION : GEOMETRY_TYPE_LINE;
+    return true;
+}
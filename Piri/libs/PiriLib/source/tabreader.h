@@ -0,0 +1,76 @@
+#ifndef TABREADER_H
+#define TABREADER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QFile>
+
+#include "pirilib.h"
+#include "table.h"
+
+class QTextCodec;
+
+/*!
+ * \brief Field of MapInfo table as declared in .TAB file.
+ */
+struct TabField {
+    QString name;
+    int type; /*!< Column type, see COLUMN_TYPE_* in pirilib.h */
+    int tabType; /*!< MapInfo type, see TabReader::FieldType */
+    int offset; /*!< Offset in .DAT record, after deletion flag. */
+    int width; /*!< Width in .DAT record. */
+};
+
+class PIRILIBSHARED_EXPORT TabReader
+{
+public:
+    enum FieldType { Char, Integer, SmallInt, Float, Decimal, Date, Logical };
+
+    TabReader(QString fileName);
+
+    TablePtr read();
+    bool open();
+    TablePtr readBatch(int maxRows);
+    bool atEnd() const { return myNextRecord >= myRecordCount; }
+    QString getError() { return myError; }
+
+    static QTextCodec* codecForCharset(QString charset);
+
+private:
+    bool readHeader();
+    bool openDat();
+    bool openMap();
+    void readDat(Table *table, const QVector<int> &rows);
+    bool readMap(Table *table, const QVector<int> &rows);
+    bool readObject(const uchar *map, qint64 size, qint64 offset, int *type, Geometry *geometry);
+    QPointF toPoint(qint32 x, qint32 y) const;
+    CoordTransform mapTransform() const;
+    QString fileWithSuffix(QString suffix);
+
+    QString myFileName; /*!< Path of .TAB file. */
+    QString myError; /*!< Last error. */
+    QTextCodec* myCodec; /*!< Codec of table charset. */
+    QVector<TabField> myFields; /*!< Fields declared in .TAB file. */
+
+    QFile myDatFile; /*!< Mapped .DAT file. */
+    const uchar *myRecords; /*!< First record in mapped .DAT file. */
+    int myRecordCount; /*!< Number of records, deleted records included. */
+    int myRecordLength; /*!< Length of one record. */
+    int myNextRecord; /*!< Index of next record to read. */
+
+    QFile myMapFile; /*!< Mapped .MAP file. */
+    const uchar *myMap; /*!< Mapped .MAP data, 0 if table has no geometry. */
+    qint64 myMapSize; /*!< Size of .MAP file. */
+    QByteArray myIds; /*!< Object offsets from .ID file. */
+
+    // .MAP header values
+    int myBlockSize;
+    int myQuadrant;
+    double myXScale;
+    double myYScale;
+    double myXDispl;
+    double myYDispl;
+};
+
+#endif // TABREADER_H
@@ -0,0 +1,1036 @@
+#include "tabwriter.h"
+#include "geometry.h"
+
+#include <QDate>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <QTextCodec>
+#include <QTextStream>
+#include <QVarLengthArray>
+#include <QtEndian>
+
+#include <string.h>
+#include <limits.h>
+
+namespace {
+
+const int blockSize = 512;
+const int mapHeaderSize = 1024;
+const int objectHeaderSize = 20;
+const int coordHeaderSize = 8;
+const int indexHeaderSize = 4;
+const int indexEntrySize = 20;
+const int maxIndexEntries = (blockSize - indexHeaderSize) / indexEntrySize;
+const qint64 maxMapCoord = 1000000000;
+
+// Object types and sizes of their records in object block
+const uchar symbolType = 0x02;
+const uchar regionType = 0x0e;
+const uchar multiPlineType = 0x26;
+const uchar v450RegionType = 0x2f;
+const uchar v450MultiPlineType = 0x32;
+const int symbolSize = 14;
+const int regionSize = 41;
+const int multiPlineSize = 40;
+
+inline void putInt16(uchar *p, qint16 v) { qToLittleEndian<qint16>(v, p); }
+inline void putInt32(uchar *p, qint32 v) { qToLittleEndian<qint32>(v, p); }
+
+inline void putDouble(uchar *p, double d)
+{
+    quint64 bits;
+    memcpy(&bits, &d, sizeof(d));
+    qToLittleEndian<quint64>(bits, p);
+}
+
+inline uchar* data(QByteArray &a) { return (uchar*)a.data(); }
+
+MapIndexEntry emptyBounds()
+{
+    MapIndexEntry b = { INT_MAX, INT_MAX, INT_MIN, INT_MIN, 0 };
+    return b;
+}
+
+void addPoint(MapIndexEntry *b, qint32 x, qint32 y)
+{
+    b->minX = qMin(b->minX, x);
+    b->minY = qMin(b->minY, y);
+    b->maxX = qMax(b->maxX, x);
+    b->maxY = qMax(b->maxY, y);
+}
+
+void addBounds(MapIndexEntry *b, const MapIndexEntry &other)
+{
+    addPoint(b, other.minX, other.minY);
+    addPoint(b, other.maxX, other.maxY);
+}
+
+void putBounds(uchar *p, const MapIndexEntry &b)
+{
+    putInt32(p, b.minX);
+    putInt32(p + 4, b.minY);
+    putInt32(p + 8, b.maxX);
+    putInt32(p + 12, b.maxY);
+}
+
+/*!
+ * \brief Get MapInfo units code of unit name.
+ * \param name Unit name as in CoordSys clause, for example "m".
+ * \return Units code, -1 if unit is unknown.
+ */
+int unitsCode(QString name)
+{
+    static const char *names[] = { "mi", "km", "in", "ft", "yd", "mm", "cm", "m", "survey ft", "nmi" };
+    for (int i = 0; i < 10; i++)
+    {
+        if (name == names[i])
+            return i;
+    }
+    if (name == "degree")
+        return 13;
+    return -1;
+}
+
+}
+
+
+/*!
+ * \brief MapInfo table writer constructor.
+ *
+ * Writes native table as native MapInfo table (.TAB, .DAT, .ID, .MAP)
+ * without MapInfo. Points, lines and regions are written with default
+ * pen, brush and symbol. Default coordinate system is NonEarth in meters
+ * and default charset is WindowsBalticRim.
+ * \param fileName Path of .TAB file.
+ */
+TabWriter::TabWriter(QString fileName)
+{
+    myFileName = fileName;
+    myCharset = MAPINFO_CHARSET;
+    myCodec = 0;
+    myRowCount = 0;
+    myRowIdField = false;
+    myHasMap = false;
+    setCoordSys(QString());
+}
+
+/*!
+ * \brief Set coordinate system of .MAP file.
+ *
+ * Earth projections with standard or custom datum and NonEarth systems
+ * are supported, Bounds are ignored and affine transforms are not
+ * supported.
+ * \param coordSys MapBasic CoordSys clause, for example
+ * CoordSys Earth Projection 3, 115, "m", 24, 0, 58, 59.333333, 500000, 6375000.
+ * Empty clause is NonEarth in meters.
+ * \return False if clause is not supported, see getError().
+ */
+bool TabWriter::setCoordSys(QString coordSys)
+{
+    MapProjection p;
+    memset(&p, 0, sizeof(p));
+    p.units = 7;
+
+    QString s = coordSys.simplified();
+    s.remove(QRegularExpression("\\s*Bounds\\s*\\(.*$", QRegularExpression::CaseInsensitiveOption));
+    if (s.isEmpty())
+    {
+        myProjection = p;
+        return true;
+    }
+
+    QRegularExpression nonEarth("^CoordSys NonEarth Units \"([^\"]+)\"$", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpression earth("^CoordSys Earth Projection (.+)$", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch m = nonEarth.match(s);
+    bool ok = true;
+    if (m.hasMatch())
+    {
+        p.units = unitsCode(m.captured(1));
+        ok = p.units >= 0;
+    } else if ((m = earth.match(s)).hasMatch()) {
+        QStringList values = m.captured(1).split(',');
+        for (int i = 0; i < values.count(); i++)
+            values[i] = values.at(i).trimmed();
+        int i = 0;
+        p.projection = values.value(i++).toInt(&ok);
+        if (ok)
+            p.datum = values.value(i++).toInt(&ok);
+
+        // Custom datum has ellipsoid and shift, 9999 also rotation, scale and prime meridian
+        int datumParams = p.datum == 999 ? 3 : p.datum == 9999 ? 8 : 0;
+        if (ok && datumParams > 0)
+            p.ellipsoid = values.value(i++).toInt(&ok);
+        for (int k = 0; k < datumParams && ok; k++)
+            p.datumParams[k] = values.value(i++).toDouble(&ok);
+
+        // Longitude / Latitude has no units
+        if (ok && p.projection == 1)
+        {
+            p.units = 13;
+        } else if (ok) {
+            QString units = values.value(i++);
+            ok = units.length() > 2 && units.startsWith('"') && units.endsWith('"');
+            p.units = ok ? unitsCode(units.mid(1, units.length() - 2)) : -1;
+            ok = p.units >= 0;
+        }
+        for (int k = 0; ok && i < values.count(); k++)
+        {
+            if (k >= 6)
+                ok = false;
+            else
+                p.params[k] = values.value(i++).toDouble(&ok);
+        }
+    } else {
+        ok = false;
+    }
+
+    if (!ok)
+    {
+        myError = "Unsupported CoordSys: " + coordSys;
+        return false;
+    }
+    myProjection = p;
+    return true;
+}
+
+/*!
+ * \brief Get MapInfo fields of table columns.
+ *
+ * Column names are changed to valid and unique MapInfo names. Char
+ * width is 1, it is grown to longest string while rows are written.
+ * \param table Table, only columns are used.
+ * \return Fields in column order.
+ */
+QVector<TabField> TabWriter::tabFields(const Table *table)
+{
+    QVector<TabField> fields;
+    QSet<QString> used;
+    for (int c = 0; c < table->columnCount(); c++)
+    {
+        QString base = table->column(c).name;
+        base.replace(QRegularExpression("[^A-Za-z0-9_]"), "_");
+        if (base.isEmpty() || base.at(0).isDigit())
+            base.prepend('_');
+        base = base.left(31);
+        QString name = base;
+        for (int k = 2; used.contains(name.toLower()); k++)
+            name = base.left(28) + "_" + QString::number(k);
+        used.insert(name.toLower());
+
+        TabField f;
+        f.name = name;
+        f.type = table->column(c).type;
+        f.offset = 0;
+        switch (f.type) {
+        case COLUMN_TYPE_STRING:
+            f.tabType = TabReader::Char;
+            f.width = 1;
+            break;
+        case COLUMN_TYPE_FLOAT:
+            f.tabType = TabReader::Float;
+            f.width = 8;
+            break;
+        case COLUMN_TYPE_LOGICAL:
+            f.tabType = TabReader::Logical;
+            f.width = 1;
+            break;
+        case COLUMN_TYPE_DATE:
+            f.tabType = TabReader::Date;
+            f.width = 4;
+            break;
+        default:
+            f.tabType = TabReader::Integer;
+            f.width = 4;
+            break;
+        }
+        fields << f;
+    }
+    return fields;
+}
+
+/*!
+ * \brief Get MapInfo type of field for table definition.
+ * \param field Field
+ * \return Type, for example "Char (20)".
+ */
+QString TabWriter::tabFieldType(const TabField &field)
+{
+    switch (field.tabType) {
+    case TabReader::Char:
+        return QString("Char (%1)").arg(field.width);
+    case TabReader::Float:
+        return "Float";
+    case TabReader::Logical:
+        return "Logical";
+    case TabReader::Date:
+        return "Date";
+    default:
+        return "Integer";
+    }
+}
+
+/*!
+ * \brief Get path of table file with other suffix.
+ *
+ * Suffix has same case as suffix of .TAB file.
+ * \param suffix Suffix without dot, for example "DAT".
+ * \return Path of file.
+ */
+QString TabWriter::fileWithSuffix(QString suffix)
+{
+    QFileInfo fi(myFileName);
+    QString base = fi.path() + "/" + fi.completeBaseName() + ".";
+    if (fi.suffix() == fi.suffix().toLower() && !fi.suffix().isEmpty())
+        return base + suffix.toLower();
+    return base + suffix.toUpper();
+}
+
+/*!
+ * \brief Write table.
+ * \param table Table to write.
+ * \return True on success, see getError() otherwise.
+ */
+bool TabWriter::write(TablePtr table)
+{
+    return write(TableStreamPtr(new TableSliceStream(table, qMax(1, table->rowCount()))));
+}
+
+/*!
+ * \brief Write table from stream, one batch at a time.
+ * \param stream Stream to write, all batches must have same columns.
+ * \return True on success, see getError() otherwise.
+ */
+bool TabWriter::write(TableStreamPtr stream)
+{
+    TablePtr batch = stream->next();
+    if (!batch)
+    {
+        myError = stream->hasError() ? stream->getError() : "No table to write to " + myFileName;
+        return false;
+    }
+    if (!begin(batch.data()))
+        return false;
+    while (batch)
+    {
+        if (!writeBatch(batch.data()))
+            return false;
+        batch = stream->next();
+    }
+    if (stream->hasError())
+    {
+        myError = stream->getError();
+        return false;
+    }
+    return finish();
+}
+
+/*!
+ * \brief Start writing table.
+ *
+ * Fields come from columns of first batch and .MAP file is written if
+ * first batch has geometry. Coordinates are stored with transform of first
+ * batch, so table read with TabReader is written back without rounding.
+ * Table without columns gets row number as only field, because MapInfo
+ * table must have fields.
+ * \param first First batch, it is not written yet.
+ * \return True on success, see getError() otherwise.
+ */
+bool TabWriter::begin(const Table *first)
+{
+    myRowCount = 0;
+    myCodec = TabReader::codecForCharset(myCharset);
+    myFields = tabFields(first);
+    myRowIdField = myFields.isEmpty();
+    if (myRowIdField)
+    {
+        TabField f = { "ID", COLUMN_TYPE_INTEGER, TabReader::Integer, 0, 4 };
+        myFields << f;
+    }
+    if (!mySpool.open())
+    {
+        myError = "Can not create temporary file for " + myFileName;
+        return false;
+    }
+    mySpool.resize(0);
+
+    // Old geometry would be read with new attributes
+    QFile::remove(fileWithSuffix("MAP"));
+    QFile::remove(fileWithSuffix("ID"));
+    myHasMap = first->hasGeometry();
+    if (!myHasMap)
+        return true;
+
+    myMapFile.setFileName(fileWithSuffix("MAP"));
+    myIdFile.setFileName(fileWithSuffix("ID"));
+    if (!myMapFile.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || !myIdFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        myError = "Can not write " + myMapFile.fileName();
+        return false;
+    }
+    // Header is written last, when counts and bounds are known
+    myMapFile.write(QByteArray(mapHeaderSize, 0));
+
+    myTransform = first->getTransform();
+    myNextBlock = mapHeaderSize;
+    myVersion = 300;
+    myObjectBlock.fill(0, blockSize);
+    myObjectUsed = objectHeaderSize;
+    myObjectBounds = emptyBounds();
+    myPendingIds.clear();
+    myCoordBlock.fill(0, blockSize);
+    myCoordUsed = coordHeaderSize;
+    myCoordAddress = 0;
+    myFirstCoordBlock = 0;
+    myObjectBlocks.clear();
+    myBounds = emptyBounds();
+    myMaxCoordSize = 0;
+    myIndexDepth = 0;
+    myIndexBlock = 0;
+    myToolBlock = 0;
+    myPointCount = 0;
+    myLineCount = 0;
+    myRegionCount = 0;
+    return true;
+}
+
+/*!
+ * \brief Write rows of batch.
+ *
+ * Geometry goes to .MAP and .ID files at once. Records go to temporary
+ * file with strings in variable length, .DAT file is written in finish()
+ * when widths of Char fields are known.
+ * \param batch Batch with same columns as first batch.
+ * \return True on success, see getError() otherwise.
+ */
+bool TabWriter::writeBatch(const Table *batch)
+{
+    if (batch->columnCount() != (myRowIdField ? 0 : myFields.count()))
+    {
+        myError = "Batches have different columns: " + myFileName;
+        return false;
+    }
+    spoolRecords(batch);
+    for (int r = 0; r < batch->rowCount() && myHasMap; r++)
+    {
+        if (!writeObject(batch, r))
+            return false;
+    }
+    myRowCount += batch->rowCount();
+    return true;
+}
+
+/*!
+ * \brief Write remaining blocks, .DAT file and .TAB file.
+ * \return True on success, see getError() otherwise.
+ */
+bool TabWriter::finish()
+{
+    if (myHasMap)
+    {
+        flushObjectBlock();
+        writeIndex();
+        writeToolBlock();
+        writeMapHeader();
+        bool ok = myMapFile.error() == QFile::NoError && myIdFile.error() == QFile::NoError;
+        myMapFile.close();
+        myIdFile.close();
+        if (!ok)
+        {
+            myError = "Can not write " + myMapFile.fileName();
+            return false;
+        }
+    }
+    bool ok = writeDat() && writeTab();
+    mySpool.close();
+    return ok;
+}
+
+/*!
+ * \brief Write records of batch to temporary file.
+ *
+ * Fields are in .DAT format, except Char fields that have length byte
+ * and string without padding. Batch is one block with row count and
+ * size before it.
+ * \param batch Batch
+ */
+void TabWriter::spoolRecords(const Table *batch)
+{
+    QByteArray records;
+    for (int r = 0; r < batch->rowCount(); r++)
+    {
+        for (int c = 0; c < myFields.count(); c++)
+        {
+            TabField &f = myFields[c];
+            uchar b[8];
+            if (myRowIdField)
+            {
+                putInt32(b, myRowCount + r + 1);
+                records.append((const char*)b, 4);
+                continue;
+            }
+            const TableColumn &column = batch->column(c);
+            switch (f.tabType) {
+            case TabReader::Char:
+            {
+                QByteArray s = myCodec->fromUnicode(column.strings.at(r)).left(254);
+                f.width = qMax(f.width, s.size());
+                records.append((char)s.size());
+                records.append(s);
+                break;
+            }
+            case TabReader::Float:
+                putDouble(b, column.floats.at(r));
+                records.append((const char*)b, 8);
+                break;
+            case TabReader::Logical:
+                records.append(column.integers.at(r) ? 'T' : 'F');
+                break;
+            case TabReader::Date:
+            {
+                qint64 date = column.integers.at(r);
+                putInt16(b, date / 10000);
+                b[2] = date / 100 % 100;
+                b[3] = date % 100;
+                records.append((const char*)b, 4);
+                break;
+            }
+            default:
+                putInt32(b, (qint32)qBound<qint64>(INT_MIN, column.integers.at(r), INT_MAX));
+                records.append((const char*)b, 4);
+                break;
+            }
+        }
+    }
+    uchar header[8];
+    putInt32(header, batch->rowCount());
+    putInt32(header + 4, records.size());
+    mySpool.write((const char*)header, 8);
+    mySpool.write(records);
+}
+
+/*!
+ * \brief Write .DAT file from temporary records.
+ * \return True on success.
+ */
+bool TabWriter::writeDat()
+{
+    QFile file(fileWithSuffix("DAT"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !mySpool.seek(0))
+    {
+        myError = "Can not write " + file.fileName();
+        return false;
+    }
+
+    int headerLength = 32 + 32 * myFields.count() + 1;
+    int recordLength = 1;
+    foreach (const TabField &f, myFields)
+        recordLength += f.width;
+    QByteArray header(headerLength, 0);
+    uchar *h = data(header);
+    QDate today = QDate::currentDate();
+    h[0] = 0x03;
+    h[1] = today.year() - 1900;
+    h[2] = today.month();
+    h[3] = today.day();
+    putInt32(h + 4, myRowCount);
+    putInt16(h + 8, headerLength);
+    putInt16(h + 10, recordLength);
+    for (int c = 0; c < myFields.count(); c++)
+    {
+        uchar *d = h + 32 + 32 * c;
+        QByteArray name = myFields.at(c).name.toLatin1().left(10);
+        memcpy(d, name.constData(), name.size());
+        d[11] = myFields.at(c).tabType == TabReader::Logical ? 'L' : 'C';
+        d[16] = myFields.at(c).width;
+    }
+    h[headerLength - 1] = 0x0d;
+    file.write(header);
+
+    // Batch at a time, so memory does not grow with table
+    QByteArray records;
+    while (!mySpool.atEnd())
+    {
+        QByteArray batchHeader = mySpool.read(8);
+        if (batchHeader.size() != 8)
+            break;
+        int rows = qFromLittleEndian<qint32>((const uchar*)batchHeader.constData());
+        QByteArray spooled = mySpool.read(qFromLittleEndian<qint32>((const uchar*)batchHeader.constData() + 4));
+        const char *p = spooled.constData();
+        records.fill(' ', rows * recordLength);
+        char *out = records.data();
+        for (int r = 0; r < rows; r++)
+        {
+            out++; // deletion flag
+            for (int c = 0; c < myFields.count(); c++)
+            {
+                const TabField &f = myFields.at(c);
+                int length = f.width;
+                if (f.tabType == TabReader::Char)
+                    length = (uchar)*p++;
+                memcpy(out, p, length);
+                p += length;
+                out += f.width;
+            }
+        }
+        file.write(records);
+    }
+    file.write("\x1a", 1);
+    if (file.error() != QFile::NoError || mySpool.error() != QFile::NoError)
+    {
+        myError = "Can not write " + file.fileName();
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Write .TAB file.
+ * \return True on success.
+ */
+bool TabWriter::writeTab()
+{
+    QFile file(myFileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+    {
+        myError = "Can not write " + myFileName;
+        return false;
+    }
+    QTextStream out(&file);
+    out << "!table\n";
+    out << "!version " << (myHasMap ? myVersion : 300) << "\n";
+    out << "!charset " << myCharset << "\n\n";
+    out << "Definition Table\n";
+    out << "  Type NATIVE Charset \"" << myCharset << "\"\n";
+    out << "  Fields " << myFields.count() << "\n";
+    foreach (const TabField &f, myFields)
+        out << "    " << f.name << " " << tabFieldType(f) << " ;\n";
+    out.flush();
+    if (file.error() != QFile::NoError)
+    {
+        myError = "Can not write " + myFileName;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Convert table coordinates to .MAP integer coordinates.
+ * \param x Map x
+ * \param y Map y
+ * \param mapX Returns integer x
+ * \param mapY Returns integer y
+ * \return False if point is outside of range of .MAP coordinates.
+ */
+bool TabWriter::toMap(double x, double y, qint32 *mapX, qint32 *mapY)
+{
+    double ix = (x - myTransform.originX) / myTransform.resolutionX;
+    double iy = (y - myTransform.originY) / myTransform.resolutionY;
+    if (!(qAbs(ix) <= maxMapCoord && qAbs(iy) <= maxMapCoord))
+    {
+        myError = QString("Coordinates out of range of .MAP file: %1 %2").arg(x).arg(y);
+        return false;
+    }
+    *mapX = (qint32)qRound64(ix);
+    *mapY = (qint32)qRound64(iy);
+    return true;
+}
+
+/*!
+ * \brief Write geometry of one row to .MAP file and its offset to .ID file.
+ *
+ * Points are symbols, lines are multiple polylines and regions are
+ * regions, all uncompressed. Objects with more than 32767 vertices in one
+ * section use MapInfo 4.5 types.
+ * \param batch Batch
+ * \param row Row in batch
+ * \return True on success, see getError() otherwise.
+ */
+bool TabWriter::writeObject(const Table *batch, int row)
+{
+    int type = batch->geometryType(row);
+    int parts = batch->partCount(row);
+    int total = 0;
+    for (int p = 0; p < parts; p++)
+        total += batch->pointCount(row, p);
+    if (type == GEOMETRY_TYPE_NONE || total == 0 || parts > SHRT_MAX)
+    {
+        if (myPendingIds.isEmpty())
+            myIdFile.write(QByteArray(4, 0));
+        else
+            myPendingIds << 0;
+        return true;
+    }
+
+    QVarLengthArray<double, 512> xs(total);
+    QVarLengthArray<double, 512> ys(total);
+    QVarLengthArray<qint32, 1024> coords(2 * total);
+    QVarLengthArray<MapIndexEntry, 16> sections(parts);
+    MapIndexEntry bounds = emptyBounds();
+    bool v450 = false;
+    for (int p = 0, v = 0; p < parts; p++)
+    {
+        int n = batch->pointCount(row, p);
+        batch->points(row, p, xs.data() + v, ys.data() + v);
+        sections[p] = emptyBounds();
+        for (int i = v; i < v + n; i++)
+        {
+            if (!toMap(xs[i], ys[i], &coords[2 * i], &coords[2 * i + 1]))
+                return false;
+            addPoint(&sections[p], coords[2 * i], coords[2 * i + 1]);
+        }
+        if (n > 0)
+            addBounds(&bounds, sections[p]);
+        v450 = v450 || n > SHRT_MAX;
+        v += n;
+    }
+
+    uchar record[regionSize];
+    memset(record, 0, sizeof(record));
+    int size;
+    if (type == GEOMETRY_TYPE_POINT)
+    {
+        size = symbolSize;
+        if (myObjectUsed + size > blockSize)
+            flushObjectBlock();
+        record[0] = symbolType;
+        putInt32(record + 5, coords[0]);
+        putInt32(record + 9, coords[1]);
+        record[13] = 1;
+        bounds.minX = bounds.maxX = coords[0];
+        bounds.minY = bounds.maxY = coords[1];
+        myPointCount++;
+    } else {
+        bool region = type == GEOMETRY_TYPE_REGION;
+        size = region ? regionSize : multiPlineSize;
+        if (myObjectUsed + size > blockSize)
+            flushObjectBlock();
+
+        // Outer ring tells how many holes follow it
+        QVector<bool> holes;
+        if (region && parts > 1)
+            holes = ringHoles(batch->geometry(row));
+        QVector<int> holeCounts(parts, 0);
+        for (int p = 0, outer = -1; p < parts; p++)
+        {
+            if (!holes.value(p))
+                outer = p;
+            else if (outer >= 0)
+                holeCounts[outer]++;
+        }
+
+        // Section data offset is counted as if headers were uncompressed
+        // MapInfo 4.5 headers, 28 bytes, even if they are 26 bytes.
+        int headerSize = v450 ? 26 : 24;
+        QByteArray coordData(headerSize * parts + 8 * total, 0);
+        uchar *d = data(coordData);
+        int offset = (v450 ? 28 : 24) * parts;
+        for (int p = 0; p < parts; p++)
+        {
+            int n = batch->pointCount(row, p);
+            if (v450)
+            {
+                putInt32(d, n);
+                d += 4;
+            } else {
+                putInt16(d, n);
+                d += 2;
+            }
+            putInt16(d, holeCounts.at(p));
+            putBounds(d + 2, n > 0 ? sections[p] : bounds);
+            putInt32(d + 18, offset);
+            d += 22;
+            offset += 8 * n;
+        }
+        for (int i = 0; i < 2 * total; i++, d += 4)
+            putInt32(d, coords[i]);
+
+        reserveCoords();
+        qint32 coordPtr = myCoordAddress + myCoordUsed;
+        writeCoords((const uchar*)coordData.constData(), coordData.size());
+        myMaxCoordSize = qMax(myMaxCoordSize, coordData.size());
+        if (v450)
+            myVersion = 450;
+
+        record[0] = region ? (v450 ? v450RegionType : regionType) : (v450 ? v450MultiPlineType : multiPlineType);
+        putInt32(record + 5, coordPtr);
+        putInt32(record + 9, coordData.size());
+        putInt16(record + 13, parts);
+        putInt32(record + 15, (qint32)(((qint64)bounds.minX + bounds.maxX) / 2));
+        putInt32(record + 19, (qint32)(((qint64)bounds.minY + bounds.maxY) / 2));
+        putBounds(record + 23, bounds);
+        record[39] = 1;
+        if (region)
+        {
+            record[40] = 1;
+            myRegionCount++;
+        } else {
+            myLineCount++;
+        }
+    }
+    putInt32(record + 1, myRowCount + row + 1);
+
+    memcpy(data(myObjectBlock) + myObjectUsed, record, size);
+    myPendingIds << myObjectUsed;
+    myObjectUsed += size;
+    addBounds(&myObjectBounds, bounds);
+    addBounds(&myBounds, bounds);
+    return true;
+}
+
+/*!
+ * \brief Get block address and move allocation to next block.
+ *
+ * Blocks are allocated in the order they are written, so .MAP file is
+ * written from start to end except header.
+ * \return Address of block
+ */
+qint32 TabWriter::allocateBlock()
+{
+    qint32 address = myNextBlock;
+    myNextBlock += blockSize;
+    return address;
+}
+
+/*!
+ * \brief Write block to .MAP file.
+ * \param address Address of block
+ * \param block Block data
+ */
+void TabWriter::writeBlock(qint32 address, const QByteArray &block)
+{
+    if (myMapFile.pos() != address)
+        myMapFile.seek(address);
+    myMapFile.write(block);
+}
+
+/*!
+ * \brief Make sure that coordinate block has room for next byte.
+ */
+void TabWriter::reserveCoords()
+{
+    if (myCoordAddress == 0)
+    {
+        myCoordAddress = allocateBlock();
+        myCoordUsed = coordHeaderSize;
+        if (myFirstCoordBlock == 0)
+            myFirstCoordBlock = myCoordAddress;
+    } else if (myCoordUsed == blockSize) {
+        qint32 next = allocateBlock();
+        flushCoordBlock(next);
+        myCoordAddress = next;
+        myCoordUsed = coordHeaderSize;
+    }
+}
+
+/*!
+ * \brief Write coordinate data, data continues in next block when block is full.
+ * \param data Coordinate data
+ * \param size Size of data
+ */
+void TabWriter::writeCoords(const uchar *data, int size)
+{
+    while (size > 0)
+    {
+        reserveCoords();
+        int n = qMin(size, blockSize - myCoordUsed);
+        memcpy(myCoordBlock.data() + myCoordUsed, data, n);
+        myCoordUsed += n;
+        data += n;
+        size -= n;
+    }
+}
+
+/*!
+ * \brief Write coordinate block.
+ * \param next Address of next coordinate block, 0 if block is last of object block.
+ */
+void TabWriter::flushCoordBlock(qint32 next)
+{
+    uchar *b = data(myCoordBlock);
+    putInt16(b, 3);
+    putInt16(b + 2, myCoordUsed - coordHeaderSize);
+    putInt32(b + 4, next);
+    writeBlock(myCoordAddress, myCoordBlock);
+    myCoordBlock.fill(0);
+}
+
+/*!
+ * \brief Write object block and its last coordinate block.
+ *
+ * Offsets of rows in block are written to .ID file.
+ */
+void TabWriter::flushObjectBlock()
+{
+    if (myObjectUsed <= objectHeaderSize)
+        return;
+    qint32 lastCoordBlock = myCoordAddress;
+    if (myCoordAddress != 0)
+        flushCoordBlock(0);
+
+    qint32 address = allocateBlock();
+    uchar *b = data(myObjectBlock);
+    putInt16(b, 2);
+    putInt16(b + 2, myObjectUsed - objectHeaderSize);
+    putInt32(b + 4, (qint32)(((qint64)myObjectBounds.minX + myObjectBounds.maxX) / 2));
+    putInt32(b + 8, (qint32)(((qint64)myObjectBounds.minY + myObjectBounds.maxY) / 2));
+    putInt32(b + 12, myFirstCoordBlock);
+    putInt32(b + 16, lastCoordBlock);
+    writeBlock(address, myObjectBlock);
+    writeIds(address);
+
+    myObjectBounds.block = address;
+    myObjectBlocks << myObjectBounds;
+    myObjectBlock.fill(0);
+    myObjectUsed = objectHeaderSize;
+    myObjectBounds = emptyBounds();
+    myCoordAddress = 0;
+    myFirstCoordBlock = 0;
+}
+
+/*!
+ * \brief Write .ID entries of rows since first object of object block.
+ * \param block Address of object block
+ */
+void TabWriter::writeIds(qint32 block)
+{
+    QByteArray ids(4 * myPendingIds.count(), 0);
+    for (int i = 0; i < myPendingIds.count(); i++)
+        putInt32(data(ids) + 4 * i, myPendingIds.at(i) ? block + myPendingIds.at(i) : 0);
+    myIdFile.write(ids);
+    myPendingIds.clear();
+}
+
+/*!
+ * \brief Write spatial index of object blocks.
+ *
+ * Index is R-tree built bottom up, object blocks are already in order of
+ * rows, which are usually spatially sorted.
+ */
+void TabWriter::writeIndex()
+{
+    QVector<MapIndexEntry> level = myObjectBlocks;
+    myIndexDepth = 0;
+    myIndexBlock = 0;
+    if (level.isEmpty())
+        return;
+    do {
+        QVector<MapIndexEntry> parents;
+        for (int i = 0; i < level.count(); i += maxIndexEntries)
+        {
+            int n = qMin(maxIndexEntries, level.count() - i);
+            QByteArray block(blockSize, 0);
+            uchar *b = data(block);
+            putInt16(b, 1);
+            putInt16(b + 2, n);
+            MapIndexEntry parent = emptyBounds();
+            for (int k = 0; k < n; k++)
+            {
+                const MapIndexEntry &e = level.at(i + k);
+                uchar *p = b + indexHeaderSize + indexEntrySize * k;
+                putBounds(p, e);
+                putInt32(p + 16, e.block);
+                addBounds(&parent, e);
+            }
+            parent.block = allocateBlock();
+            writeBlock(parent.block, block);
+            parents << parent;
+        }
+        level = parents;
+        myIndexDepth++;
+    } while (level.count() > 1);
+    myIndexBlock = level.first().block;
+}
+
+/*!
+ * \brief Write drawing tool block with default pen, brush and symbol.
+ *
+ * Every object uses tool 1. Pen is thin black line, brush is white fill
+ * and symbol is black star.
+ */
+void TabWriter::writeToolBlock()
+{
+    QByteArray block(blockSize, 0);
+    uchar *b = data(block);
+    uchar *p = b + 8;
+    // Pen: width, pattern, point width, color
+    p[0] = 1;
+    putInt32(p + 1, myLineCount + myRegionCount);
+    p[5] = 1;
+    p[6] = 2;
+    p += 11;
+    // Brush: pattern, transparency, foreground and background color
+    p[0] = 2;
+    putInt32(p + 1, myRegionCount);
+    p[5] = 2;
+    memset(p + 7, 0xff, 6);
+    p += 13;
+    // Symbol: shape, size, color
+    p[0] = 3;
+    putInt32(p + 1, myPointCount);
+    putInt16(p + 5, 35);
+    putInt16(p + 7, 12);
+    p += 13;
+
+    putInt16(b, 5);
+    putInt16(b + 2, p - b - 8);
+    myToolBlock = allocateBlock();
+    writeBlock(myToolBlock, block);
+}
+
+/*!
+ * \brief Write .MAP header with counts, bounds and coordinate system.
+ */
+void TabWriter::writeMapHeader()
+{
+    QByteArray header(mapHeaderSize, 0);
+    uchar *h = data(header);
+
+    // Object record sizes by type, high bit tells that object has
+    // coordinate data. Only types that are written are listed.
+    h[symbolType] = symbolSize;
+    h[regionType] = 0x80 | regionSize;
+    h[multiPlineType] = 0x80 | multiPlineSize;
+    h[v450RegionType] = 0x80 | regionSize;
+    h[v450MultiPlineType] = 0x80 | multiPlineSize;
+
+    MapIndexEntry bounds = myBounds;
+    if (bounds.minX > bounds.maxX)
+        bounds.minX = bounds.minY = bounds.maxX = bounds.maxY = 0;
+    putInt32(h + 0x100, 42424242);
+    putInt16(h + 0x104, myVersion);
+    putInt16(h + 0x106, blockSize);
+    putDouble(h + 0x108, 1.0);
+    putBounds(h + 0x110, bounds);
+    putInt32(h + 0x130, myIndexBlock);
+    putInt32(h + 0x138, myToolBlock);
+    putInt32(h + 0x13c, myPointCount);
+    putInt32(h + 0x140, myLineCount);
+    putInt32(h + 0x144, myRegionCount);
+    putInt32(h + 0x14c, myMaxCoordSize);
+    h[0x15e] = myProjection.units;
+    h[0x15f] = myIndexDepth;
+    h[0x160] = 3;
+    h[0x161] = 1;
+    h[0x163] = v450MultiPlineType;
+    h[0x164] = 1;
+    h[0x165] = 1;
+    h[0x166] = 1;
+    putInt16(h + 0x168, 1);
+    putInt16(h + 0x16a, myProjection.datum);
+    h[0x16d] = myProjection.projection;
+    h[0x16e] = myProjection.ellipsoid;
+    h[0x16f] = myProjection.units;
+
+    // Quadrant 1: map x = (integer x - displacement) / scale
+    putDouble(h + 0x170, 1.0 / myTransform.resolutionX);
+    putDouble(h + 0x178, 1.0 / myTransform.resolutionY);
+    putDouble(h + 0x180, -myTransform.originX / myTransform.resolutionX);
+    putDouble(h + 0x188, -myTransform.originY / myTransform.resolutionY);
+    for (int i = 0; i < 6; i++)
+        putDouble(h + 0x190 + 8 * i, myProjection.params[i]);
+    for (int i = 0; i < 8; i++)
+        putDouble(h + 0x1c0 + 8 * i, myProjection.datumParams[i]);
+    writeBlock(0, header);
+}
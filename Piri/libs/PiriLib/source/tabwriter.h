@@ -0,0 +1,114 @@
+#ifndef TABWRITER_H
+#define TABWRITER_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+#include <QTemporaryFile>
+
+#include "pirilib.h"
+#include "table.h"
+#include "tablestream.h"
+#include "tabreader.h"
+
+class QTextCodec;
+
+/*!
+ * \brief Coordinate system of .MAP file, parsed from MapBasic CoordSys clause.
+ */
+struct MapProjection {
+    int projection; /*!< Projection type, 0 for NonEarth. */
+    int datum;
+    int ellipsoid; /*!< Ellipsoid of custom datum 999 or 9999. */
+    int units; /*!< MapInfo units code, 7 is meters. */
+    double params[6]; /*!< Projection parameters in CoordSys order. */
+    double datumParams[8]; /*!< Shift, rotation, scale and prime meridian of custom datum. */
+};
+
+/*!
+ * \brief Spatial index entry, bounds of one .MAP block.
+ */
+struct MapIndexEntry {
+    qint32 minX;
+    qint32 minY;
+    qint32 maxX;
+    qint32 maxY;
+    qint32 block; /*!< Address of object or index block. */
+};
+
+class PIRILIBSHARED_EXPORT TabWriter
+{
+public:
+    TabWriter(QString fileName);
+
+    void setCharset(QString charset) { myCharset = charset; }
+    bool setCoordSys(QString coordSys);
+
+    bool write(TablePtr table);
+    bool write(TableStreamPtr stream);
+    bool begin(const Table *first);
+    bool writeBatch(const Table *batch);
+    bool finish();
+    int getRowCount() { return myRowCount; }
+    QString getError() { return myError; }
+
+    static QVector<TabField> tabFields(const Table *table);
+    static QString tabFieldType(const TabField &field);
+
+private:
+    QString fileWithSuffix(QString suffix);
+    void spoolRecords(const Table *batch);
+    bool writeDat();
+    bool writeTab();
+    bool writeObject(const Table *batch, int row);
+    void reserveCoords();
+    void writeCoords(const uchar *data, int size);
+    void writeBlock(qint32 address, const QByteArray &block);
+    void flushCoordBlock(qint32 next);
+    void flushObjectBlock();
+    void writeIds(qint32 block);
+    void writeIndex();
+    void writeToolBlock();
+    void writeMapHeader();
+    qint32 allocateBlock();
+    bool toMap(double x, double y, qint32 *mapX, qint32 *mapY);
+
+    QString myFileName; /*!< Path of .TAB file. */
+    QString myError; /*!< Last error. */
+    QString myCharset; /*!< MapInfo charset of strings. */
+    QTextCodec *myCodec; /*!< Codec of charset. */
+    MapProjection myProjection; /*!< Coordinate system of .MAP file. */
+    int myRowCount; /*!< Number of rows written. */
+    QVector<TabField> myFields; /*!< Fields of table, Char widths grow while rows are written. */
+    bool myRowIdField; /*!< Is row number written as only field? */
+
+    QTemporaryFile mySpool; /*!< Records with variable length strings until widths are known. */
+
+    bool myHasMap; /*!< Is geometry written? */
+    QFile myMapFile;
+    QFile myIdFile;
+    CoordTransform myTransform; /*!< Map coordinate of integer x is originX + x * resolutionX. */
+    qint32 myNextBlock; /*!< Address of next unallocated block. */
+    int myVersion; /*!< .MAP version, 450 if some object needs 32 bit vertex counts. */
+
+    QByteArray myObjectBlock; /*!< Object block being filled. */
+    int myObjectUsed; /*!< Bytes used in object block, header included. */
+    MapIndexEntry myObjectBounds; /*!< Bounds of objects in object block. */
+    QVector<qint32> myPendingIds; /*!< Object offsets in object block of rows since its first object, 0 for no object. */
+    QByteArray myCoordBlock; /*!< Coordinate block being filled. */
+    int myCoordUsed; /*!< Bytes used in coordinate block, header included. */
+    qint32 myCoordAddress; /*!< Address of coordinate block, 0 if none. */
+    qint32 myFirstCoordBlock; /*!< First coordinate block of object block. */
+    QVector<MapIndexEntry> myObjectBlocks; /*!< Written object blocks. */
+
+    MapIndexEntry myBounds; /*!< Bounds of all objects. */
+    int myMaxCoordSize; /*!< Largest coordinate data of one object. */
+    int myIndexDepth;
+    qint32 myIndexBlock;
+    qint32 myToolBlock;
+    int myPointCount;
+    int myLineCount;
+    int myRegionCount;
+};
+
+#endif // TABWRITER_H
@@ -0,0 +1,361 @@
+#include "topology.h"
+#include "geometry.h"
+
+#include <QHash>
+
+
+/*!
+ * \brief Topology constructor.
+ *
+ * Topology is built from region table with build(). Arcs can then be
+ * changed, for example simplified, and regions made again with
+ * geometry() or toTable().
+ */
+Topology::Topology()
+{
+}
+
+/*!
+ * \brief Add neighbour of point.
+ *
+ * Only two neighbours are kept, point with more neighbours is node.
+ * \param point Point id
+ * \param neighbour Neighbour point id
+ * \param first First neighbours
+ * \param second Second neighbours
+ * \param nodes Node flags
+ */
+static void addNeighbour(int point, int neighbour, QVector<int> *first, QVector<int> *second, QVector<bool> *nodes)
+{
+    if (first->at(point) == neighbour || second->at(point) == neighbour)
+        return;
+    if (first->at(point) < 0)
+        (*first)[point] = neighbour;
+    else if (second->at(point) < 0)
+        (*second)[point] = neighbour;
+    else
+        (*nodes)[point] = true;
+}
+
+/*!
+ * \brief Build topology of region table.
+ *
+ * Points with same coordinates are merged. Node is point where more or
+ * less than two boundaries meet, rings are cut to arcs at nodes. Ring
+ * without nodes is one closed arc starting at its smallest point id, so
+ * island and hole with same points get same arc. Arc is found by its
+ * first edge, both directions are looked up, so shared boundary is
+ * stored once. Rows without region keep no rings.
+ * \param table Table to build from.
+ */
+void Topology::build(const Table *table)
+{
+    myPoints.clear();
+    myArcs.clear();
+    myRows.clear();
+    myRows.resize(table->rowCount());
+
+    // Rings as point ids without repeated points and closing point
+    QHash<PointKey, int> ids;
+    QVector<QVector<QVector<int> > > rings(table->rowCount());
+    for (int row = 0; row < table->rowCount(); row++)
+    {
+        if (table->geometryType(row) != GEOMETRY_TYPE_REGION)
+            continue;
+        foreach (const QPolygonF &polygon, table->geometry(row)) {
+            QVector<int> ring;
+            ring.reserve(polygon.count());
+            for (int i = 0; i < polygon.count(); i++)
+            {
+                QHash<PointKey, int>::iterator v = ids.find(pointKey(polygon.at(i)));
+                if (v == ids.end())
+                {
+                    v = ids.insert(pointKey(polygon.at(i)), myPoints.count());
+                    myPoints << polygon.at(i);
+                }
+                if (ring.isEmpty() || ring.last() != v.value())
+                    ring << v.value();
+            }
+            if (ring.count() > 1 && ring.first() == ring.last())
+                ring.removeLast();
+            if (ring.count() >= 3)
+                rings[row] << ring;
+        }
+    }
+
+    QVector<int> first(myPoints.count(), -1);
+    QVector<int> second(myPoints.count(), -1);
+    QVector<bool> nodes(myPoints.count(), false);
+    foreach (const QVector<QVector<int> > &row, rings) {
+        foreach (const QVector<int> &ring, row) {
+            for (int i = 0; i < ring.count(); i++)
+            {
+                int a = ring.at(i);
+                int b = ring.at((i + 1) % ring.count());
+                addNeighbour(a, b, &first, &second, &nodes);
+                addNeighbour(b, a, &first, &second, &nodes);
+            }
+        }
+    }
+
+    // Arc reference by first edge in both directions
+    QHash<quint64, int> arcIndex;
+    for (int row = 0; row < rings.count(); row++)
+    {
+        foreach (const QVector<int> &ring, rings.at(row)) {
+            int n = ring.count();
+            int start = -1;
+            for (int i = 0; i < n && start < 0; i++)
+            {
+                if (nodes.at(ring.at(i)))
+                    start = i;
+            }
+            if (start < 0)
+            {
+                start = 0;
+                for (int i = 1; i < n; i++)
+                {
+                    if (ring.at(i) < ring.at(start))
+                        start = i;
+                }
+            }
+
+            QVector<int> refs;
+            QVector<int> arc;
+            arc << ring.at(start);
+            for (int k = 1; k <= n; k++)
+            {
+                int p = ring.at((start + k) % n);
+                arc << p;
+                if (k < n && !nodes.at(p))
+                    continue;
+
+                quint64 forward = (quint64(arc.at(0)) << 32) | quint64(arc.at(1));
+                QHash<quint64, int>::iterator found = arcIndex.find(forward);
+                if (found != arcIndex.end())
+                {
+                    refs << found.value();
+                } else {
+                    int index = myArcs.count();
+                    quint64 backward = (quint64(arc.last()) << 32) | quint64(arc.at(arc.count() - 2));
+                    arcIndex.insert(forward, index);
+                    arcIndex.insert(backward, ~index);
+                    myArcs << arc;
+                    refs << index;
+                }
+                arc.clear();
+                arc << p;
+            }
+            myRows[row] << refs;
+        }
+    }
+}
+
+/*!
+ * \brief Get number of vertices in all arcs.
+ * \return Number of vertices, shared boundaries counted once.
+ */
+int Topology::vertexCount() const
+{
+    int count = 0;
+    foreach (const QVector<int> &arc, myArcs)
+        count += arc.count();
+    return count;
+}
+
+/*!
+ * \brief Get squared distance from point to segment.
+ * \param p Point
+ * \param a Segment start
+ * \param b Segment end
+ * \return Squared distance
+ */
+static double segmentDistance2(const QPointF &p, const QPointF &a, const QPointF &b)
+{
+    double dx = b.x() - a.x();
+    double dy = b.y() - a.y();
+    double length2 = dx * dx + dy * dy;
+    double t = length2 > 0 ? ((p.x() - a.x()) * dx + (p.y() - a.y()) * dy) / length2 : 0.0;
+    t = qBound(0.0, t, 1.0);
+    double ex = a.x() + t * dx - p.x();
+    double ey = a.y() + t * dy - p.y();
+    return ex * ex + ey * ey;
+}
+
+/*!
+ * \brief Mark points of arc part that Douglas-Peucker keeps.
+ * \param points All points
+ * \param arc Arc point ids
+ * \param first First index of part, kept.
+ * \param last Last index of part, kept.
+ * \param tolerance2 Squared tolerance
+ * \param keep Keep flags of arc points.
+ */
+static void douglasPeucker(const QVector<QPointF> &points, const QVector<int> &arc, int first, int last,
+                           double tolerance2, QVector<bool> *keep)
+{
+    QVector<QPair<int, int> > stack;
+    stack << qMakePair(first, last);
+    while (!stack.isEmpty())
+    {
+        QPair<int, int> part = stack.takeLast();
+        const QPointF &a = points.at(arc.at(part.first));
+        const QPointF &b = points.at(arc.at(part.second));
+        double max = -1;
+        int index = -1;
+        for (int i = part.first + 1; i < part.second; i++)
+        {
+            double d = segmentDistance2(points.at(arc.at(i)), a, b);
+            if (d > max)
+            {
+                max = d;
+                index = i;
+            }
+        }
+        if (index >= 0 && max > tolerance2)
+        {
+            (*keep)[index] = true;
+            stack << qMakePair(part.first, index) << qMakePair(index, part.second);
+        }
+    }
+}
+
+/*!
+ * \brief Simplify every arc once with Douglas-Peucker.
+ *
+ * Nodes are kept, so neighbours still meet at same boundary. Closed arc
+ * keeps at least three points, so island does not vanish. Ring made of
+ * arcs that all shrink to their nodes, like two arcs between same two
+ * nodes, keeps interior points farthest from arc ends until it has three
+ * vertices. Ring can still cross other ring of same region if tolerance
+ * is large.
+ * \param tolerance Largest distance of removed point from result, in map units.
+ */
+void Topology::simplify(double tolerance)
+{
+    double tolerance2 = tolerance * tolerance;
+    QVector<QVector<bool> > keeps(myArcs.count());
+    for (int i = 0; i < myArcs.count(); i++)
+    {
+        const QVector<int> &arc = myArcs.at(i);
+        int last = arc.count() - 1;
+        QVector<bool> &keep = keeps[i];
+        keep.fill(true, arc.count());
+        if (last < 2)
+            continue;
+        keep.fill(false);
+        keep[0] = true;
+        keep[last] = true;
+        if (arc.first() == arc.last())
+        {
+            // Closed arc is split at point farthest from start
+            int far = 1;
+            double max = -1;
+            for (int k = 1; k < last; k++)
+            {
+                QPointF d = myPoints.at(arc.at(k)) - myPoints.at(arc.first());
+                if (d.x() * d.x() + d.y() * d.y() > max)
+                {
+                    max = d.x() * d.x() + d.y() * d.y();
+                    far = k;
+                }
+            }
+            keep[far] = true;
+            douglasPeucker(myPoints, arc, 0, far, tolerance2, &keep);
+            douglasPeucker(myPoints, arc, far, last, tolerance2, &keep);
+            if (keep.count(true) < 4)
+                keep[far > 1 ? far / 2 : (far + last) / 2] = true;
+        } else {
+            douglasPeucker(myPoints, arc, 0, last, tolerance2, &keep);
+        }
+    }
+
+    // Rings with less than three vertices left would be dropped
+    foreach (const QVector<QVector<int> > &row, myRows) {
+        foreach (const QVector<int> &refs, row) {
+            int vertices = 0;
+            foreach (int ref, refs)
+                vertices += keeps.at(ref >= 0 ? ref : ~ref).count(true) - 1;
+            for (int r = 0; r < refs.count() && vertices < 3; r++)
+            {
+                int index = refs.at(r) >= 0 ? refs.at(r) : ~refs.at(r);
+                const QVector<int> &arc = myArcs.at(index);
+                int last = arc.count() - 1;
+                int far = -1;
+                double max = -1;
+                for (int k = 1; k < last; k++)
+                {
+                    if (keeps.at(index).at(k))
+                        continue;
+                    double d = segmentDistance2(myPoints.at(arc.at(k)), myPoints.at(arc.first()),
+                                                myPoints.at(arc.last()));
+                    if (d > max)
+                    {
+                        max = d;
+                        far = k;
+                    }
+                }
+                if (far < 0)
+                    continue;
+                keeps[index][far] = true;
+                vertices++;
+                r--;
+            }
+        }
+    }
+
+    for (int i = 0; i < myArcs.count(); i++)
+    {
+        const QVector<int> &arc = myArcs.at(i);
+        QVector<int> simplified;
+        for (int k = 0; k < arc.count(); k++)
+        {
+            if (keeps.at(i).at(k))
+                simplified << arc.at(k);
+        }
+        myArcs[i] = simplified;
+    }
+}
+
+/*!
+ * \brief Make region of row from arcs.
+ *
+ * Rings that have less than three points are dropped, after
+ * simplify() only rings that had less already.
+ * \param row Row index
+ * \return Closed rings of row.
+ */
+Geometry Topology::geometry(int row) const
+{
+    Geometry result;
+    foreach (const QVector<int> &refs, myRows.at(row)) {
+        QPolygonF ring;
+        foreach (int ref, refs) {
+            const QVector<int> &arc = myArcs.at(ref >= 0 ? ref : ~ref);
+            int n = arc.count();
+            for (int k = ring.isEmpty() ? 0 : 1; k < n; k++)
+                ring << myPoints.at(arc.at(ref >= 0 ? k : n - 1 - k));
+        }
+        if (ring.count() >= 4)
+            result << ring;
+    }
+    return result;
+}
+
+/*!
+ * \brief Make copy of table with regions made from arcs.
+ * \param table Table that topology was built from.
+ * \return New table, rows without region are copied as they are.
+ */
+TablePtr Topology::toTable(const Table *table) const
+{
+    TablePtr result = table->slice(0, table->rowCount());
+    for (int row = 0; row < myRows.count() && row < result->rowCount(); row++)
+    {
+        if (table->geometryType(row) != GEOMETRY_TYPE_REGION)
+            continue;
+        Geometry region = geometry(row);
+        result->setGeometry(row, region.isEmpty() ? GEOMETRY_TYPE_NONE : GEOMETRY_TYPE_REGION, region);
+    }
+    return result;
+}
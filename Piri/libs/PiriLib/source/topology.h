@@ -0,0 +1,45 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <QVector>
+#include <QPointF>
+
+#include "pirilib.h"
+#include "table.h"
+
+/*!
+ * \brief Shared arc topology of region table.
+ *
+ * Every boundary between two nodes is stored once as arc of point ids,
+ * rings refer to arcs. Arc that ring walks backwards is referred as ~index.
+ * Changing arcs or points changes all regions that share them, so
+ * neighbours stay without gaps and overlaps.
+ */
+class PIRILIBSHARED_EXPORT Topology
+{
+public:
+    Topology();
+
+    void build(const Table *table);
+
+    int pointCount() const { return myPoints.count(); }
+    QPointF point(int id) const { return myPoints.at(id); }
+    void setPoint(int id, const QPointF &p) { myPoints[id] = p; }
+    int arcCount() const { return myArcs.count(); }
+    const QVector<int>& arc(int index) const { return myArcs.at(index); }
+    int vertexCount() const;
+
+    int rowCount() const { return myRows.count(); }
+    const QVector<QVector<int> >& rings(int row) const { return myRows.at(row); }
+
+    void simplify(double tolerance);
+    Geometry geometry(int row) const;
+    TablePtr toTable(const Table *table) const;
+
+private:
+    QVector<QPointF> myPoints; /*!< Unique points. */
+    QVector<QVector<int> > myArcs; /*!< Arcs as point ids. */
+    QVector<QVector<QVector<int> > > myRows; /*!< Arc references of every ring of every row. */
+};
+
+#endif // TOPOLOGY_H
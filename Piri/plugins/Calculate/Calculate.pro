@@ -0,0 +1,21 @@
+
+TEMPLATE      = lib
+CONFIG       += plugin c++11
+QT           += widgets core gui concurrent
+INCLUDEPATH  += ../../libs/PiriLib/source
+HEADERS      += calculate.h
+
+SOURCES      += calculate.cpp \
+
+TARGET        = calculate
+DESTDIR       = ../../bin/plugins
+
+target.path = ../../bin/plugins
+INSTALLS += target
+
+win32:CONFIG(release, debug|release): LIBS += -L$$PWD/../../libs/PiriLib/libs/ -lPiriLib
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$PWD/../../libs/PiriLib/libs/ -lPiriLibd
+else:unix: LIBS += -L$$PWD/../../libs/PiriLib/libs/ -lPiriLib
+
+INCLUDEPATH += $$PWD/../../libs/PiriLib/libs
+DEPENDPATH += $$PWD/../../libs/PiriLib/libs
@@ -0,0 +1,228 @@
+#include "calculate.h"
+#include "node.h"
+#include "edge.h"
+#include "knobs.h"
+#include "geometry.h"
+
+#include <QtConcurrent>
+#include <QVarLengthArray>
+
+static constexpr OpColumn calculateColumns[] = {
+    { "AREA", COLUMN_TYPE_FLOAT },
+    { "PERIMETER", COLUMN_TYPE_FLOAT },
+    { "CENTROID_X", COLUMN_TYPE_FLOAT },
+    { "CENTROID_Y", COLUMN_TYPE_FLOAT },
+    { "MINX", COLUMN_TYPE_FLOAT },
+    { "MINY", COLUMN_TYPE_FLOAT },
+    { "MAXX", COLUMN_TYPE_FLOAT },
+    { "MAXY", COLUMN_TYPE_FLOAT }
+};
+static constexpr int calculateColumnCount = sizeof(calculateColumns) / sizeof(calculateColumns[0]);
+static constexpr OpDescriptor calculateDescriptor = { "Create", "Calculate", "Add area, perimeter, centroid and bounds columns.",
+                                                      1, 1, OP_SCHEMA_APPEND, calculateColumns, calculateColumnCount };
+
+Calculate::Calculate()
+{
+    setup();
+}
+
+OpInterfaceMI* Calculate::create()
+{
+    return new Calculate();
+}
+
+void Calculate::setup()
+{
+
+}
+
+const OpDescriptor* Calculate::descriptor()
+{
+    return &calculateDescriptor;
+}
+
+void Calculate::knobs(KnobCallback* f)
+{
+    Q_UNUSED(f);
+}
+
+QString Calculate::engine()
+{
+    if (!hasInput(0))
+        return " ";
+    return QString("Select *, CartesianArea(obj, \"sq m\") \"AREA\", CartesianPerimeter(obj, \"m\") \"PERIMETER\", "
+                   "CentroidX(obj) \"CENTROID_X\", CentroidY(obj) \"CENTROID_Y\", "
+                   "ObjectGeography(obj, 1) \"MINX\", ObjectGeography(obj, 2) \"MINY\", "
+                   "ObjectGeography(obj, 3) \"MAXX\", ObjectGeography(obj, 4) \"MAXY\" "
+                   "From _%1 Into _%2").arg(getInputHash(0).toHex(), getHash().toHex());
+}
+
+/*!
+ * \brief Rows measured by one task.
+ */
+struct MeasureChunk {
+    int first; /*!< First row */
+    int count; /*!< Number of rows */
+};
+
+/*!
+ * \brief Measures rows of table into result columns.
+ *
+ * Columns are given as raw arrays, so tasks can write their own rows
+ * in parallel without touching Qt containers.
+ */
+struct MeasureRows {
+    typedef void result_type;
+
+    const Table *table;
+    double *values[calculateColumnCount]; /*!< Result columns in calculateColumns order. */
+
+    void operator()(const MeasureChunk &chunk) const
+    {
+        QVarLengthArray<double, 512> xs;
+        QVarLengthArray<double, 512> ys;
+        for (int r = chunk.first; r < chunk.first + chunk.count; r++)
+        {
+            int type = table->geometryType(r);
+            int parts = table->partCount(r);
+            QVector<bool> holes;
+            if (type == GEOMETRY_TYPE_REGION && parts > 1)
+                holes = ringHoles(table->geometry(r));
+
+            double area = 0, length = 0, cx = 0, cy = 0, weight = 0;
+            int count = 0;
+            double minX = 0, minY = 0, maxX = 0, maxY = 0;
+            for (int p = 0; p < parts; p++)
+            {
+                int n = table->pointCount(r, p);
+                if (n == 0)
+                    continue;
+                xs.resize(n);
+                ys.resize(n);
+                table->points(r, p, xs.data(), ys.data());
+                PartMetrics m = partMetrics(xs.data(), ys.data(), n, type == GEOMETRY_TYPE_REGION);
+
+                // Area of hole is taken away, center of mass too
+                double w;
+                if (type == GEOMETRY_TYPE_REGION)
+                    w = holes.value(p) ? -qAbs(m.area) : qAbs(m.area);
+                else if (type == GEOMETRY_TYPE_LINE)
+                    w = m.length;
+                else
+                    w = n;
+                area += type == GEOMETRY_TYPE_REGION ? w : 0;
+                length += m.length;
+                cx += m.centroidX * w;
+                cy += m.centroidY * w;
+                weight += w;
+
+                if (count == 0)
+                {
+                    minX = m.minX;
+                    minY = m.minY;
+                    maxX = m.maxX;
+                    maxY = m.maxY;
+                } else {
+                    minX = qMin(minX, m.minX);
+                    minY = qMin(minY, m.minY);
+                    maxX = qMax(maxX, m.maxX);
+                    maxY = qMax(maxY, m.maxY);
+                }
+                count++;
+            }
+            values[0][r] = area;
+            values[1][r] = length;
+            values[2][r] = weight != 0 ? cx / weight : (minX + maxX) / 2;
+            values[3][r] = weight != 0 ? cy / weight : (minY + maxY) / 2;
+            values[4][r] = minX;
+            values[5][r] = minY;
+            values[6][r] = maxX;
+            values[7][r] = maxY;
+        }
+    }
+};
+
+/*!
+ * \brief Add measure columns to table.
+ *
+ * Rows are measured in parallel in chunks. Rows without geometry get
+ * zeros.
+ * \param input Input table
+ * \return Input columns and measure columns
+ */
+static TablePtr measure(const TablePtr &input)
+{
+    // Copy shares column and geometry data with input, new columns are
+    // sized alone so input columns are not copied
+    TablePtr result(new Table(*input));
+    MeasureRows task;
+    task.table = input.data();
+    int first = result->columnCount();
+    for (int c = 0; c < calculateColumnCount; c++)
+        result->addColumn(calculateColumns[c].name, calculateColumns[c].type);
+    for (int c = 0; c < calculateColumnCount; c++)
+        task.values[c] = result->column(first + c).floats.data();
+
+    QVector<MeasureChunk> chunks;
+    for (int r = 0; r < input->rowCount(); r += 1024)
+    {
+        MeasureChunk chunk = { r, qMin(1024, input->rowCount() - r) };
+        chunks << chunk;
+    }
+    if (chunks.count() == 1)
+        task(chunks.first());
+    else
+        QtConcurrent::blockingMap(chunks, task);
+    return result;
+}
+
+/*!
+ * \brief Stream with measure columns added to every batch.
+ */
+class CalculateStream : public TableStream
+{
+public:
+    CalculateStream(TableStreamPtr input) : myInput(input) {}
+
+    TablePtr next()
+    {
+        TablePtr batch = myInput->next();
+        if (!batch)
+        {
+            myError = myInput->getError();
+            return TablePtr();
+        }
+        return measure(batch);
+    }
+
+private:
+    TableStreamPtr myInput; /*!< Input stream. */
+};
+
+/*!
+ * \brief Run calculate on native table.
+ * \param inputs Input tables
+ * \return Table with measure columns
+ */
+TablePtr Calculate::run(QList<TablePtr> inputs)
+{
+    TablePtr input = inputs.value(0);
+    if (!input)
+        return TablePtr();
+    return measure(input);
+}
+
+/*!
+ * \brief Run calculate as stream, every batch is measured separately.
+ * \param inputs Input streams
+ * \param batchRows Rows in one batch, batches follow input batches.
+ * \return Stream of tables with measure columns
+ */
+TableStreamPtr Calculate::stream(QList<TableStreamPtr> inputs, int batchRows)
+{
+    Q_UNUSED(batchRows);
+    TableStreamPtr input = inputs.value(0);
+    if (!input)
+        return TableStreamPtr();
+    return TableStreamPtr(new CalculateStream(input));
+}
@@ -0,0 +1,29 @@
+#ifndef CALCULATE_H
+#define CALCULATE_H
+
+#include <QObject>
+#include <QtPlugin>
+
+#include "pirilib.h"
+#include "interfaces.h"
+#include "knobcallback.h"
+#include "op.h"
+
+class Calculate : public QObject, public OpInterfaceMI, public OpInterfaceNative, public OpInterfaceStream, public Op
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID "Kaldera.Piri.v03.OpInterfaceMI")
+    Q_INTERFACES(OpInterfaceMI OpInterfaceNative OpInterfaceStream)
+
+public:
+    Calculate();
+    OpInterfaceMI* create();
+    void setup();
+    const OpDescriptor* descriptor();
+    void knobs(KnobCallback *f);
+    QString engine();
+    TablePtr run(QList<TablePtr> inputs);
+    TableStreamPtr stream(QList<TableStreamPtr> inputs, int batchRows);
+};
+
+#endif // CALCULATE_H
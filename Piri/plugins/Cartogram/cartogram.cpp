@@ -0,0 +1,197 @@
+#include "cartogram.h"
+#include "node.h"
+#include "edge.h"
+#include "knobs.h"
+#include "geometry.h"
+#include "topology.h"
+
+#include <QtConcurrent>
+#include <qmath.h>
+
+static constexpr OpDescriptor cartogramDescriptor = { "Transform", "Cartogram", "Contiguous cartogram of regions.", 1, 1, OP_SCHEMA_INPUT, 0, 0 };
+
+Cartogram::Cartogram()
+{
+    setup();
+}
+
+OpInterfaceMI* Cartogram::create()
+{
+    return new Cartogram();
+}
+
+void Cartogram::setup()
+{
+    column = "";
+    iterations = 20;
+}
+
+const OpDescriptor* Cartogram::descriptor()
+{
+    return &cartogramDescriptor;
+}
+
+void Cartogram::knobs(KnobCallback* f)
+{
+    String_knob(f, &column, "Value");
+    Integer_knob(f, &iterations, "Iterations");
+}
+
+/*!
+ * \brief Generate MapBasic command.
+ *
+ * MapInfo has no cartograms, so rows are only selected into result.
+ * Regions are distorted in native run.
+ * \return MapBasic command
+ */
+QString Cartogram::engine()
+{
+    if (!hasInput(0))
+        return " ";
+    return QString("Select * From _%1 Into _%2").arg(getInputHash(0).toHex(), getHash().toHex());
+}
+
+/*!
+ * \brief Force of one region in one iteration.
+ */
+struct CartogramForce {
+    double x; /*!< Center of mass */
+    double y;
+    double radius; /*!< Radius of circle with region area. */
+    double mass; /*!< Radius change that region needs, negative shrinks. */
+};
+
+/*!
+ * \brief Moves points by forces of all regions.
+ *
+ * Points are moved into separate array, so tasks can run in parallel
+ * over chunks of points.
+ */
+struct MovePoints {
+    typedef void result_type;
+
+    const QVector<CartogramForce> *forces;
+    const QPointF *points; /*!< Points before iteration. */
+    QPointF *moved; /*!< Points after iteration. */
+    double reduction; /*!< Force reduction factor of iteration. */
+
+    void operator()(const QPair<int, int> &chunk) const
+    {
+        const CartogramForce *f = forces->constData();
+        int count = forces->count();
+        for (int i = chunk.first; i < chunk.second; i++)
+        {
+            double px = points[i].x();
+            double py = points[i].y();
+            double dx = 0.0;
+            double dy = 0.0;
+            for (int j = 0; j < count; j++)
+            {
+                double vx = px - f[j].x;
+                double vy = py - f[j].y;
+                double d = sqrt(vx * vx + vy * vy);
+                if (d <= 0.0)
+                    continue;
+                double r = f[j].radius;
+                double force;
+                if (d > r)
+                    force = f[j].mass * r / d;
+                else
+                    force = f[j].mass * (d * d) / (r * r) * (4.0 - 3.0 * d / r);
+                dx += force * vx / d;
+                dy += force * vy / d;
+            }
+            moved[i] = QPointF(px + dx * reduction, py + dy * reduction);
+        }
+    }
+};
+
+/*!
+ * \brief Run cartogram on native table.
+ *
+ * Rubber sheet method of Dougenik, Chrisman and Niemeyer. Every iteration
+ * each region pushes or pulls points by how much its area differs from
+ * its share of value. Points are moved in topology, so shared boundaries
+ * move together and regions stay contiguous. Iterations stop early when
+ * mean area error is below CARTOGRAM_TARGET_ERROR.
+ * \param inputs Input tables
+ * \return Table with distorted regions
+ */
+TablePtr Cartogram::run(QList<TablePtr> inputs)
+{
+    TablePtr input = inputs.value(0);
+    if (!input)
+        return TablePtr();
+    int ci = input->columnIndex(column);
+    if (ci < 0 || input->column(ci).type == COLUMN_TYPE_STRING)
+    {
+        if (myCallback)
+            myCallback->showError("Cartogram: no numeric column " + column);
+        return TablePtr();
+    }
+
+    const TableColumn &c = input->column(ci);
+    QVector<int> rows;
+    QVector<double> values;
+    double totalValue = 0.0;
+    for (int r = 0; r < input->rowCount(); r++)
+    {
+        if (input->geometryType(r) != GEOMETRY_TYPE_REGION)
+            continue;
+        double v = c.type == COLUMN_TYPE_FLOAT ? c.floats.at(r) : (double)c.integers.at(r);
+        rows << r;
+        values << qMax(0.0, v);
+        totalValue += qMax(0.0, v);
+    }
+
+    Topology topology;
+    topology.build(input.data());
+    if (rows.isEmpty() || totalValue <= 0.0)
+        return topology.toTable(input.data());
+
+    double totalArea = 0.0;
+    foreach (int row, rows)
+        totalArea += regionMetrics(topology.geometry(row)).area;
+
+    QVector<QPointF> points(topology.pointCount());
+    QVector<QPointF> moved(topology.pointCount());
+    for (int p = 0; p < points.count(); p++)
+        points[p] = topology.point(p);
+    QVector<QPair<int, int> > chunks;
+    for (int p = 0; p < points.count(); p += 1024)
+        chunks << qMakePair(p, qMin(points.count(), p + 1024));
+
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        QVector<CartogramForce> forces(rows.count());
+        double error = 0.0;
+        for (int i = 0; i < rows.count(); i++)
+        {
+            PartMetrics m = regionMetrics(topology.geometry(rows.at(i)));
+            // Region without value keeps small area, so error stays finite
+            double desired = qMax(values.at(i) / totalValue, 1e-6) * totalArea;
+            double area = qMax(m.area, 1e-12);
+            forces[i].x = m.centroidX;
+            forces[i].y = m.centroidY;
+            forces[i].radius = qMax(sqrt(area / M_PI), 1e-12);
+            forces[i].mass = sqrt(desired / M_PI) - sqrt(area / M_PI);
+            error += qMax(area, desired) / qMax(qMin(area, desired), 1e-12);
+        }
+        // Mean ratio of larger and smaller area, 1 when all areas are right
+        error /= rows.count();
+        if (error - 1.0 < CARTOGRAM_TARGET_ERROR)
+            break;
+
+        MovePoints task;
+        task.forces = &forces;
+        task.points = points.constData();
+        task.moved = moved.data();
+        task.reduction = 1.0 / (1.0 + error);
+        QtConcurrent::blockingMap(chunks, task);
+
+        points.swap(moved);
+        for (int p = 0; p < points.count(); p++)
+            topology.setPoint(p, points.at(p));
+    }
+    return topology.toTable(input.data());
+}
@@ -0,0 +1,32 @@
+#ifndef CARTOGRAM_H
+#define CARTOGRAM_H
+
+#include <QObject>
+#include <QtPlugin>
+
+#include "pirilib.h"
+#include "interfaces.h"
+#include "knobcallback.h"
+#include "op.h"
+
+class Cartogram : public QObject, public OpInterfaceMI, public OpInterfaceNative, public Op
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID "Kaldera.Piri.v03.OpInterfaceMI")
+    Q_INTERFACES(OpInterfaceMI OpInterfaceNative)
+
+public:
+    Cartogram();
+    OpInterfaceMI* create();
+    void setup();
+    const OpDescriptor* descriptor();
+    void knobs(KnobCallback *f);
+    QString engine();
+    TablePtr run(QList<TablePtr> inputs);
+
+private:
+    QString column; /*!< Numeric column that region areas should follow. */
+    int iterations; /*!< Maximum number of iterations. */
+};
+
+#endif // CARTOGRAM_H
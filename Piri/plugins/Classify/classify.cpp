@@ -0,0 +1,297 @@
+#include "classify.h"
+#include "node.h"
+#include "edge.h"
+#include "knobs.h"
+#include "hasher.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <algorithm>
+
+static constexpr OpColumn classifyColumns[] = {
+    { "CLASS", COLUMN_TYPE_INTEGER },
+    { "CLASS_FROM", COLUMN_TYPE_FLOAT },
+    { "CLASS_TO", COLUMN_TYPE_FLOAT }
+};
+static constexpr OpDescriptor classifyDescriptor = { "MetaData", "Classify", "Class breaks of numeric column.",
+                                                     1, 1, OP_SCHEMA_APPEND, classifyColumns, 3 };
+
+Classify::Classify()
+{
+    setup();
+}
+
+OpInterfaceMI* Classify::create()
+{
+    return new Classify();
+}
+
+void Classify::setup()
+{
+    column = "";
+    method = CLASSIFY_JENKS;
+    classes = 5;
+}
+
+const OpDescriptor* Classify::descriptor()
+{
+    return &classifyDescriptor;
+}
+
+void Classify::knobs(KnobCallback* f)
+{
+    String_knob(f, &column, "Column");
+    ComboBox_knob(f, &method, "Method", "Classification method");
+    ADD_VALUES(f, "Equal interval,Quantile,Natural breaks");
+    Integer_knob(f, &classes, "Classes");
+}
+
+/*!
+ * \brief Generate MapBasic command.
+ *
+ * MapInfo makes ranges only in thematic layers, so rows are only
+ * selected into result. Classes are computed in native run.
+ * \return MapBasic command
+ */
+QString Classify::engine()
+{
+    if (!hasInput(0))
+        return " ";
+    return QString("Select * From _%1 Into _%2").arg(getInputHash(0).toHex(), getHash().toHex());
+}
+
+/*!
+ * \brief Breaks of equal width classes.
+ * \param sorted Sorted values
+ * \param k Number of classes
+ * \return Class limits, first is minimum and last is maximum.
+ */
+static QVector<double> equalBreaks(const QVector<double> &sorted, int k)
+{
+    double min = sorted.first();
+    double max = sorted.last();
+    QVector<double> breaks;
+    for (int i = 0; i < k; i++)
+        breaks << min + (max - min) * i / k;
+    breaks << max;
+    return breaks;
+}
+
+/*!
+ * \brief Breaks of classes with same number of values.
+ * \param sorted Sorted values
+ * \param k Number of classes
+ * \return Class limits, first is minimum and last is maximum.
+ */
+static QVector<double> quantileBreaks(const QVector<double> &sorted, int k)
+{
+    int n = sorted.count();
+    QVector<double> breaks;
+    breaks << sorted.first();
+    for (int i = 1; i < k; i++)
+        breaks << sorted.at(qMax(0, int((qint64)i * n / k) - 1));
+    breaks << sorted.last();
+    return breaks;
+}
+
+/*!
+ * \brief Sums of squares for Jenks, sum of squared deviations of value range.
+ */
+struct JenksSums {
+    QVector<double> sum; /*!< Prefix sums of values minus median. */
+    QVector<double> sum2; /*!< Prefix sums of squares. */
+
+    double cost(int first, int last) const
+    {
+        double s = sum.at(last + 1) - sum.at(first);
+        double s2 = sum2.at(last + 1) - sum2.at(first);
+        return qMax(0.0, s2 - s * s / (last - first + 1));
+    }
+};
+
+/*!
+ * \brief Fill one row of Jenks table by divide and conquer.
+ *
+ * Best start of last class does not move left when class end moves
+ * right, so middle end is solved first and halves search only their side
+ * of starts. One row takes O(n log n) instead of O(n^2).
+ * \param sums Sums of squares
+ * \param previous Costs of previous row, previous[j] for values 0..j.
+ * \param current Returns costs of this row.
+ * \param starts Returns best start of last class.
+ * \param q Row, number of classes minus one.
+ * \param first First end to solve
+ * \param last Last end to solve
+ * \param startMin Smallest possible start
+ * \param startMax Largest possible start
+ */
+static void jenksRow(const JenksSums &sums, const QVector<double> &previous, QVector<double> *current,
+                     QVector<int> *starts, int q, int first, int last, int startMin, int startMax)
+{
+    while (first <= last)
+    {
+        int i = (first + last) / 2;
+        double best = -1;
+        int bestStart = qMax(q, startMin);
+        for (int j = qMax(q, startMin); j <= qMin(i, startMax); j++)
+        {
+            double c = previous.at(j - 1) + sums.cost(j, i);
+            if (best < 0 || c < best)
+            {
+                best = c;
+                bestStart = j;
+            }
+        }
+        (*current)[i] = best;
+        (*starts)[i] = bestStart;
+
+        // Left half recursively, right half in loop
+        jenksRow(sums, previous, current, starts, q, first, i - 1, startMin, bestStart);
+        first = i + 1;
+        startMin = bestStart;
+    }
+}
+
+/*!
+ * \brief Jenks natural breaks, optimal classes with least squared deviation.
+ *
+ * Dynamic program of Wang and Song (Ckmeans.1d.dp) with divide and
+ * conquer rows, O(k n log n) in total.
+ * \param sorted Sorted values
+ * \param k Number of classes
+ * \return Class limits, first is minimum and last is maximum.
+ */
+static QVector<double> jenksBreaks(const QVector<double> &sorted, int k)
+{
+    int n = sorted.count();
+    JenksSums sums;
+    sums.sum.resize(n + 1);
+    sums.sum2.resize(n + 1);
+    double shift = sorted.at(n / 2);
+    sums.sum[0] = 0;
+    sums.sum2[0] = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double v = sorted.at(i) - shift;
+        sums.sum[i + 1] = sums.sum.at(i) + v;
+        sums.sum2[i + 1] = sums.sum2.at(i) + v * v;
+    }
+
+    QVector<QVector<int> > starts(k);
+    QVector<double> previous(n);
+    for (int i = 0; i < n; i++)
+        previous[i] = sums.cost(0, i);
+    starts[0].fill(0, n);
+    for (int q = 1; q < k; q++)
+    {
+        QVector<double> current(n, 0.0);
+        starts[q].fill(0, n);
+        jenksRow(sums, previous, &current, &starts[q], q, q, n - 1, q, n - 1);
+        previous = current;
+    }
+
+    QVector<double> breaks(k + 1);
+    breaks[0] = sorted.first();
+    breaks[k] = sorted.last();
+    int end = n - 1;
+    for (int q = k - 1; q > 0; q--)
+    {
+        int start = starts.at(q).at(end);
+        breaks[q] = sorted.at(start - 1);
+        end = start - 1;
+    }
+    return breaks;
+}
+
+/*!
+ * \brief Cache of class breaks by column content, method and classes.
+ *
+ * Shared by all Classify nodes, so changing style of node that shows
+ * classified table does not compute breaks again.
+ */
+static QHash<Hash128, QVector<double> > breakCache;
+static QMutex breakCacheMutex;
+
+/*!
+ * \brief Get class breaks of values, from cache if same values were classified.
+ * \param values Values in row order
+ * \param method Method, see CLASSIFY_* in pirilib.h
+ * \param k Number of classes
+ * \return Class limits, first is minimum and last is maximum.
+ */
+static QVector<double> classBreaks(const QVector<double> &values, int method, int k)
+{
+    Hasher hasher;
+    hasher.addInt(method);
+    hasher.addInt(k);
+    hasher.addBytes(values.constData(), values.count() * sizeof(double));
+    Hash128 key = hasher.result();
+    {
+        QMutexLocker lock(&breakCacheMutex);
+        QHash<Hash128, QVector<double> >::const_iterator i = breakCache.constFind(key);
+        if (i != breakCache.constEnd())
+            return i.value();
+    }
+
+    QVector<double> sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+    QVector<double> breaks;
+    if (method == CLASSIFY_QUANTILE)
+        breaks = quantileBreaks(sorted, k);
+    else if (method == CLASSIFY_JENKS)
+        breaks = jenksBreaks(sorted, k);
+    else
+        breaks = equalBreaks(sorted, k);
+
+    QMutexLocker lock(&breakCacheMutex);
+    if (breakCache.count() >= CLASSIFY_CACHE_SIZE)
+        breakCache.clear();
+    breakCache.insert(key, breaks);
+    return breaks;
+}
+
+/*!
+ * \brief Run classification on native table.
+ *
+ * Adds class number from 1, and lower and upper limit of class to every
+ * row. Value on limit belongs to lower class.
+ * \param inputs Input tables
+ * \return Table with class columns
+ */
+TablePtr Classify::run(QList<TablePtr> inputs)
+{
+    TablePtr input = inputs.value(0);
+    if (!input)
+        return TablePtr();
+    int ci = input->columnIndex(column);
+    if (ci < 0 || input->column(ci).type == COLUMN_TYPE_STRING)
+    {
+        if (myCallback)
+            myCallback->showError("Classify: no numeric column " + column);
+        return TablePtr();
+    }
+
+    const TableColumn &c = input->column(ci);
+    int n = input->rowCount();
+    QVector<double> values(n);
+    for (int r = 0; r < n; r++)
+        values[r] = c.type == COLUMN_TYPE_FLOAT ? c.floats.at(r) : (double)c.integers.at(r);
+
+    TablePtr result(new Table(*input));
+    int classColumn = result->addColumn(classifyColumns[0].name, classifyColumns[0].type);
+    int fromColumn = result->addColumn(classifyColumns[1].name, classifyColumns[1].type);
+    int toColumn = result->addColumn(classifyColumns[2].name, classifyColumns[2].type);
+    if (n == 0)
+        return result;
+
+    int k = qBound(1, classes, n);
+    QVector<double> breaks = classBreaks(values, method, k);
+    for (int r = 0; r < n; r++)
+    {
+        int i = std::lower_bound(breaks.constBegin() + 1, breaks.constEnd() - 1, values.at(r)) - breaks.constBegin();
+        result->column(classColumn).integers[r] = i;
+        result->column(fromColumn).floats[r] = breaks.at(i - 1);
+        result->column(toColumn).floats[r] = breaks.at(i);
+    }
+    return result;
+}
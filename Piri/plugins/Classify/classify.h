@@ -0,0 +1,33 @@
+#ifndef CLASSIFY_H
+#define CLASSIFY_H
+
+#include <QObject>
+#include <QtPlugin>
+
+#include "pirilib.h"
+#include "interfaces.h"
+#include "knobcallback.h"
+#include "op.h"
+
+class Classify : public QObject, public OpInterfaceMI, public OpInterfaceNative, public Op
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID "Kaldera.Piri.v03.OpInterfaceMI")
+    Q_INTERFACES(OpInterfaceMI OpInterfaceNative)
+
+public:
+    Classify();
+    OpInterfaceMI* create();
+    void setup();
+    const OpDescriptor* descriptor();
+    void knobs(KnobCallback *f);
+    QString engine();
+    TablePtr run(QList<TablePtr> inputs);
+
+private:
+    QString column; /*!< Numeric column to classify. */
+    int method; /*!< Classification method, see CLASSIFY_* in pirilib.h */
+    int classes; /*!< Number of classes. */
+};
+
+#endif // CLASSIFY_H
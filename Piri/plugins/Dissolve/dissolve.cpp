@@ -0,0 +1,406 @@
+#include "dissolve.h"
+#include "node.h"
+#include "edge.h"
+#include "knobs.h"
+#include "geometry.h"
+
+#include <QLineF>
+#include <QPainterPath>
+#include <QtConcurrent>
+#include <qmath.h>
+#include <algorithm>
+
+static constexpr OpColumn dissolveColumns[] = {
+    { "KEY", COLUMN_TYPE_STRING },
+    { "FEATURES", COLUMN_TYPE_INTEGER }
+};
+static constexpr OpDescriptor dissolveDescriptor = { "Transform", "Dissolve", "Union regions by key column.",
+                                                     1, 1, OP_SCHEMA_FIXED, dissolveColumns, 2 };
+
+Dissolve::Dissolve()
+{
+    setup();
+}
+
+OpInterfaceMI* Dissolve::create()
+{
+    return new Dissolve();
+}
+
+void Dissolve::setup()
+{
+    key = "MKOOD";
+}
+
+const OpDescriptor* Dissolve::descriptor()
+{
+    return &dissolveDescriptor;
+}
+
+void Dissolve::knobs(KnobCallback* f)
+{
+    String_knob(f, &key, "Key");
+}
+
+/*!
+ * \brief Generate MapBasic union.
+ *
+ * Result has same columns as native run, key value as text and number
+ * of united features.
+ * \return MapBasic command
+ */
+QString Dissolve::engine()
+{
+    if (!hasInput(0))
+        return " ";
+    QString table = "_" + getHash().toHex();
+    return QString("Create Table %1 (KEY Char(254), FEATURES Integer) File TempFileName$(\"\") Create Map For %1 "
+                   "Create Object As Union From _%3 Into Table %1 Data KEY = %2, FEATURES = Count(*) Group By %2")
+            .arg(table, key, getInputHash(0).toHex());
+}
+
+/*!
+ * \brief Rows of one key value.
+ */
+struct DissolveGroup {
+    const Table *table; /*!< Input table. */
+    QVector<int> rows; /*!< Rows in input order. */
+};
+
+/*!
+ * \brief Side of point c from line a-b.
+ * \return Positive if c is left of a-b, 0 if on line.
+ */
+static inline double orient(const QPointF &a, const QPointF &b, const QPointF &c)
+{
+    return (b.x() - a.x()) * (c.y() - a.y()) - (b.y() - a.y()) * (c.x() - a.x());
+}
+
+/*!
+ * \brief Is point on line a-b inside segment a-b, endpoints excluded?
+ */
+static inline bool insideSegment(const QPointF &a, const QPointF &b, const QPointF &p)
+{
+    return p != a && p != b
+            && p.x() >= qMin(a.x(), b.x()) && p.x() <= qMax(a.x(), b.x())
+            && p.y() >= qMin(a.y(), b.y()) && p.y() <= qMax(a.y(), b.y());
+}
+
+/*!
+ * \brief Do segments meet anywhere else than at shared endpoints?
+ *
+ * Crossing, vertex of one segment on other segment and equal segments
+ * all count.
+ */
+static bool segmentsMeet(const QLineF &p, const QLineF &q)
+{
+    if ((p.p1() == q.p1() && p.p2() == q.p2()) || (p.p1() == q.p2() && p.p2() == q.p1()))
+        return true;
+    double d1 = orient(q.p1(), q.p2(), p.p1());
+    double d2 = orient(q.p1(), q.p2(), p.p2());
+    double d3 = orient(p.p1(), p.p2(), q.p1());
+    double d4 = orient(p.p1(), p.p2(), q.p2());
+    if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+        return true;
+    return (d1 == 0 && insideSegment(q.p1(), q.p2(), p.p1()))
+            || (d2 == 0 && insideSegment(q.p1(), q.p2(), p.p2()))
+            || (d3 == 0 && insideSegment(p.p1(), p.p2(), q.p1()))
+            || (d4 == 0 && insideSegment(p.p1(), p.p2(), q.p2()));
+}
+
+/*!
+ * \brief Check that rings are outline of union.
+ *
+ * Edges left by edge cancelling are union outline only if no two edges
+ * cross or overlap, and every ring is hole exactly when it is clockwise.
+ * Overlapping regions and neighbours with vertex on other side's edge
+ * leave crossing or nested rings. Edges are tested pairwise inside cells
+ * of uniform grid, rings are tested for nesting only against rings whose
+ * bounds contain them.
+ * \param rings Closed rings
+ * \return True if rings are valid union outline.
+ */
+static bool isUnionOutline(const Geometry &rings)
+{
+    QVector<QLineF> segments;
+    QVector<QRectF> ringBounds;
+    QRectF bounds;
+    foreach (const QPolygonF &ring, rings) {
+        for (int i = 0; i + 1 < ring.count(); i++)
+            segments << QLineF(ring.at(i), ring.at(i + 1));
+        ringBounds << ring.boundingRect();
+        bounds |= ringBounds.last();
+    }
+    if (segments.isEmpty())
+        return true;
+
+    int n = qBound(1, (int)sqrt((double)segments.count()), 1024);
+    double cellWidth = qMax(bounds.width() / n, 1e-12);
+    double cellHeight = qMax(bounds.height() / n, 1e-12);
+    QVector<QVector<int> > cells(n * n);
+    for (int s = 0; s < segments.count(); s++)
+    {
+        const QLineF &l = segments.at(s);
+        int x0 = qBound(0, int((qMin(l.x1(), l.x2()) - bounds.left()) / cellWidth), n - 1);
+        int x1 = qBound(0, int((qMax(l.x1(), l.x2()) - bounds.left()) / cellWidth), n - 1);
+        int y0 = qBound(0, int((qMin(l.y1(), l.y2()) - bounds.top()) / cellHeight), n - 1);
+        int y1 = qBound(0, int((qMax(l.y1(), l.y2()) - bounds.top()) / cellHeight), n - 1);
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                QVector<int> &cell = cells[y * n + x];
+                foreach (int other, cell) {
+                    if (segmentsMeet(l, segments.at(other)))
+                        return false;
+                }
+                cell << s;
+            }
+        }
+    }
+
+    for (int i = 0; i < rings.count(); i++)
+    {
+        if (rings.at(i).isEmpty())
+            continue;
+        QPointF p = rings.at(i).first();
+        int inside = 0;
+        for (int j = 0; j < rings.count(); j++)
+        {
+            if (j != i && ringBounds.at(j).contains(p) && rings.at(j).containsPoint(p, Qt::OddEvenFill))
+                inside++;
+        }
+        if ((inside % 2 == 1) != (ringArea(rings.at(i)) < 0))
+            return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Union regions of group by cancelling shared edges.
+ *
+ * Rings are oriented so that inside is on left side. Edge shared by two
+ * neighbours is then walked in opposite directions, so both copies are
+ * removed and remaining edges are outline of union. Works when
+ * neighbours share vertices exactly and do not overlap, like in MapInfo
+ * coverage layers, other input is found with isUnionOutline().
+ * \param group Rows to union
+ * \param result Returns rings of union.
+ * \return False if remaining edges are not outline of union.
+ */
+static bool cancelEdges(const DissolveGroup &group, Geometry *result)
+{
+    QHash<PointKey, int> ids;
+    QVector<QPointF> points;
+    QHash<quint64, int> edges;
+    QVector<quint64> edgeOrder;
+
+    foreach (int row, group.rows) {
+        if (group.table->geometryType(row) != GEOMETRY_TYPE_REGION)
+            continue;
+        Geometry region = orientRings(group.table->geometry(row));
+        foreach (const QPolygonF &ring, region) {
+            int n = ring.count();
+            QVector<int> ringIds(n);
+            for (int i = 0; i < n; i++)
+            {
+                PointKey k = pointKey(ring.at(i));
+                QHash<PointKey, int>::iterator v = ids.find(k);
+                if (v == ids.end())
+                {
+                    v = ids.insert(k, points.count());
+                    points << ring.at(i);
+                }
+                ringIds[i] = v.value();
+            }
+            for (int i = 0; i < n; i++)
+            {
+                quint64 a = ringIds.at(i);
+                quint64 b = ringIds.at((i + 1) % n);
+                if (a == b)
+                    continue;
+                QHash<quint64, int>::iterator reverse = edges.find((b << 32) | a);
+                if (reverse != edges.end())
+                {
+                    if (--reverse.value() == 0)
+                        edges.erase(reverse);
+                } else {
+                    int &count = edges[(a << 32) | b];
+                    if (count++ == 0)
+                        edgeOrder << ((a << 32) | b);
+                }
+            }
+        }
+    }
+
+    // Outgoing edges by vertex, in input order so result does not depend
+    // on hash order
+    QVector<QVector<int> > outgoing(points.count());
+    int remaining = 0;
+    foreach (quint64 e, edgeOrder) {
+        int count = edges.take(e);
+        for (int i = 0; i < count; i++)
+            outgoing[int(e >> 32)] << int(e & 0xffffffff);
+        remaining += count;
+    }
+
+    for (int start = 0; start < outgoing.count() && remaining > 0; start++)
+    {
+        while (!outgoing.at(start).isEmpty())
+        {
+            QPolygonF ring;
+            int v = start;
+            do {
+                if (outgoing.at(v).isEmpty())
+                    return false;
+                ring << points.at(v);
+                int w = outgoing[v].first();
+                outgoing[v].removeFirst();
+                remaining--;
+                v = w;
+            } while (v != start);
+            ring << points.at(start);
+            if (ring.count() >= 4)
+                *result << ring;
+        }
+    }
+    return isUnionOutline(*result);
+}
+
+/*!
+ * \brief Get Z-order code of point for spatial sorting.
+ * \param p Point
+ * \param bounds Bounds of all points.
+ * \return Code with 16 bits per axis interleaved.
+ */
+static quint32 mortonCode(const QPointF &p, const QRectF &bounds)
+{
+    quint32 x = bounds.width() > 0 ? quint32((p.x() - bounds.left()) / bounds.width() * 65535.0) : 0;
+    quint32 y = bounds.height() > 0 ? quint32((p.y() - bounds.top()) / bounds.height() * 65535.0) : 0;
+    quint32 code = 0;
+    for (int i = 0; i < 16; i++)
+        code |= ((x >> i) & 1) << (2 * i) | ((y >> i) & 1) << (2 * i + 1);
+    return code;
+}
+
+/*!
+ * \brief Union regions of group with cascaded polygon union.
+ *
+ * Regions are sorted by Z-order of their centers and united pairwise in
+ * tree. Neighbours are united first, so intermediate results stay small.
+ * Used when regions do not share vertices exactly.
+ * \param group Rows to union
+ * \return Rings of union.
+ */
+static Geometry cascadedUnion(const DissolveGroup &group)
+{
+    QVector<QPair<quint32, QPainterPath> > items;
+    QRectF bounds;
+    foreach (int row, group.rows) {
+        if (group.table->geometryType(row) != GEOMETRY_TYPE_REGION)
+            continue;
+        QPainterPath path;
+        path.setFillRule(Qt::OddEvenFill);
+        foreach (const QPolygonF &ring, group.table->geometry(row))
+            path.addPolygon(ring);
+        bounds |= path.boundingRect();
+        items << qMakePair(quint32(0), path);
+    }
+    for (int i = 0; i < items.count(); i++)
+        items[i].first = mortonCode(items.at(i).second.boundingRect().center(), bounds);
+    std::stable_sort(items.begin(), items.end(),
+                     [](const QPair<quint32, QPainterPath> &a, const QPair<quint32, QPainterPath> &b) {
+        return a.first < b.first;
+    });
+
+    QList<QPainterPath> paths;
+    for (int i = 0; i < items.count(); i++)
+        paths << items.at(i).second;
+    while (paths.count() > 1)
+    {
+        QList<QPainterPath> next;
+        for (int i = 0; i < paths.count(); i += 2)
+            next << (i + 1 < paths.count() ? paths.at(i).united(paths.at(i + 1)) : paths.at(i));
+        paths = next;
+    }
+
+    Geometry result;
+    if (!paths.isEmpty())
+    {
+        foreach (const QPolygonF &ring, paths.first().simplified().toFillPolygons())
+            result << ring;
+    }
+    return result;
+}
+
+/*!
+ * \brief Union regions of one group.
+ * \param group Rows to union
+ * \return Rings of union.
+ */
+static Geometry dissolveGroup(const DissolveGroup &group)
+{
+    Geometry result;
+    if (cancelEdges(group, &result))
+        return result;
+    // Overlapping or not exactly matching regions
+    return cascadedUnion(group);
+}
+
+/*!
+ * \brief Run dissolve on native table.
+ *
+ * Result has one row per key value in order of first appearance, with
+ * KEY and FEATURES columns of descriptor and union of regions. Key is
+ * text whatever the type of key column, same as in MapInfo. Groups are
+ * united in parallel.
+ * \param inputs Input tables
+ * \return Dissolved table
+ */
+TablePtr Dissolve::run(QList<TablePtr> inputs)
+{
+    TablePtr input = inputs.value(0);
+    if (!input)
+        return TablePtr();
+    int column = input->columnIndex(key);
+    if (column < 0)
+    {
+        if (myCallback)
+            myCallback->showError("Dissolve: no column " + key);
+        return TablePtr();
+    }
+
+    QHash<QString, int> groupIndex;
+    QVector<DissolveGroup> groups;
+    QStringList keys;
+    for (int r = 0; r < input->rowCount(); r++)
+    {
+        QString value = input->toString(r, column);
+        QHash<QString, int>::iterator i = groupIndex.find(value);
+        if (i == groupIndex.end())
+        {
+            i = groupIndex.insert(value, groups.count());
+            DissolveGroup group;
+            group.table = input.data();
+            groups << group;
+            keys << value;
+        }
+        groups[i.value()].rows << r;
+    }
+
+    QList<Geometry> geometries = QtConcurrent::blockingMapped<QList<Geometry> >(groups, dissolveGroup);
+
+    TablePtr result(new Table(input->getName()));
+    result->setTransform(input->getTransform());
+    for (int c = 0; c < dissolveDescriptor.columnCount; c++)
+        result->addColumn(dissolveColumns[c].name, dissolveColumns[c].type);
+    result->resize(groups.count());
+    for (int g = 0; g < groups.count(); g++)
+    {
+        result->column(0).strings[g] = keys.at(g);
+        result->column(1).integers[g] = groups.at(g).rows.count();
+        const Geometry &geometry = geometries.at(g);
+        result->setGeometry(g, geometry.isEmpty() ? GEOMETRY_TYPE_NONE : GEOMETRY_TYPE_REGION, geometry);
+    }
+    return result;
+}
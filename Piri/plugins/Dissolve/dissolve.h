@@ -0,0 +1,31 @@
+#ifndef DISSOLVE_H
+#define DISSOLVE_H
+
+#include <QObject>
+#include <QtPlugin>
+
+#include "pirilib.h"
+#include "interfaces.h"
+#include "knobcallback.h"
+#include "op.h"
+
+class Dissolve : public QObject, public OpInterfaceMI, public OpInterfaceNative, public Op
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID "Kaldera.Piri.v03.OpInterfaceMI")
+    Q_INTERFACES(OpInterfaceMI OpInterfaceNative)
+
+public:
+    Dissolve();
+    OpInterfaceMI* create();
+    void setup();
+    const OpDescriptor* descriptor();
+    void knobs(KnobCallback *f);
+    QString engine();
+    TablePtr run(QList<TablePtr> inputs);
+
+private:
+    QString key; /*!< Column that groups features. */
+};
+
+#endif // DISSOLVE_H
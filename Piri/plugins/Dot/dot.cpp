@@ -1,14 +1,25 @@
 #include "dot.h"
 
+static constexpr OpDescriptor dotDescriptor = { "Other", "Dot", "Graph redirection dot.", 1, 1, OP_SCHEMA_INPUT, 0, 0 };
+
+Dot::Dot()
+{
+    setup();
+}
+
+OpInterfaceMI* Dot::create()
+{
+    return new Dot();
+}
+
 void Dot::setup()
 {
 
 }
 
-QString Dot::description()
+const OpDescriptor* Dot::descriptor()
 {
-    setup();
-    return QString("Other/Dot;Graph redirection dot./1");
+    return &dotDescriptor;
 }
 
 void Dot::knobs(KnobCallback* f)
@@ -22,3 +33,14 @@ QString Dot::engine()
     command = "";
     return command;
 }
+
+TablePtr Dot::run(QList<TablePtr> inputs)
+{
+    return inputs.value(0);
+}
+
+TableStreamPtr Dot::stream(QList<TableStreamPtr> inputs, int batchRows)
+{
+    Q_UNUSED(batchRows);
+    return inputs.value(0);
+}
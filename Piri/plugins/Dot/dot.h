@@ -14,17 +14,21 @@
 #include "knobcallback.h"
 #include "op.h"
 
-class Dot : public QObject, public OpInterfaceMI, public Op
+class Dot : public QObject, public OpInterfaceMI, public OpInterfaceNative, public OpInterfaceStream, public Op
 {
     Q_OBJECT
-    Q_PLUGIN_METADATA(IID "Kaldera.Piri.v01.OpInterfaceMI")
-    Q_INTERFACES(OpInterfaceMI)
+    Q_PLUGIN_METADATA(IID "Kaldera.Piri.v03.OpInterfaceMI")
+    Q_INTERFACES(OpInterfaceMI OpInterfaceNative OpInterfaceStream)
 
 public:
+    Dot();
+    OpInterfaceMI* create();
     void setup();
-    QString description();
+    const OpDescriptor* descriptor();
     void knobs(KnobCallback *f);
     QString engine();
+    TablePtr run(QList<TablePtr> inputs);
+    TableStreamPtr stream(QList<TableStreamPtr> inputs, int batchRows);
 
 protected:
 
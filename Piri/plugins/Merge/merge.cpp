@@ -0,0 +1,474 @@
+#include "merge.h"
+#include "node.h"
+#include "edge.h"
+#include "knobs.h"
+
+static constexpr OpDescriptor mergeDescriptor = { "Merge", "Merge", "Join two tables on key column.", 2, 2, OP_SCHEMA_NONE, 0, 0 };
+
+Merge::Merge()
+{
+    setup();
+}
+
+OpInterfaceMI* Merge::create()
+{
+    return new Merge();
+}
+
+void Merge::setup()
+{
+    leftKey = "OKOOD";
+    rightKey = "";
+    joinType = JOIN_TYPE_INNER;
+}
+
+const OpDescriptor* Merge::descriptor()
+{
+    return &mergeDescriptor;
+}
+
+void Merge::knobs(KnobCallback* f)
+{
+    String_knob(f, &leftKey, "Key");
+    String_knob(f, &rightKey, "Input 2 key");
+    ComboBox_knob(f, &joinType, "Join", "Join type");
+    ADD_VALUES(f, "Inner,Left,Semi");
+}
+
+/*!
+ * \brief Generate MapBasic join.
+ *
+ * MapBasic has no outer join, so left join is refused in MapInfo
+ * instead of giving other rows than native run.
+ * \return MapBasic command
+ */
+QString Merge::engine()
+{
+    if (!hasInput(0) || !hasInput(1))
+        return " ";
+    if (joinType == JOIN_TYPE_LEFT)
+    {
+        if (myCallback)
+            myCallback->showError("Merge: MapInfo has no left join, use native backend");
+        return " ";
+    }
+    QString left = "_" + getInputHash(0).toHex();
+    QString right = "_" + getInputHash(1).toHex();
+    QString key2 = rightKey.isEmpty() ? leftKey : rightKey;
+    if (joinType == JOIN_TYPE_SEMI)
+        return QString("Select * From %1 Where %2 In (Select %3 From %4) Into _%5")
+                .arg(left, leftKey, key2, right, getHash().toHex());
+    return QString("Select * From %1, %2 Where %1.%3 = %2.%4 Into _%5")
+            .arg(left, right, leftKey, key2, getHash().toHex());
+}
+
+/*!
+ * \brief Can column be used as integer key?
+ * \param type Column type, see COLUMN_TYPE_* in pirilib.h
+ * \return True for integer, logical and date columns.
+ */
+static bool isIntegerKey(int type)
+{
+    return type != COLUMN_TYPE_STRING && type != COLUMN_TYPE_FLOAT;
+}
+
+static bool isNullKey(const QString &key)
+{
+    return key.isEmpty();
+}
+
+static bool isNullKey(qint64 key)
+{
+    Q_UNUSED(key);
+    return false;
+}
+
+/*!
+ * \brief Get keys of integer key column.
+ * \param table Table
+ * \param column Key column
+ * \param keys Returns key of every row.
+ */
+static void keyValues(const Table *table, int column, QVector<qint64> *keys)
+{
+    *keys = table->column(column).integers;
+}
+
+/*!
+ * \brief Get keys of other key columns as strings.
+ *
+ * Keys are case folded, because MapInfo compares strings without case.
+ * Folding does not copy strings that are already folded, like codes.
+ * \param table Table
+ * \param column Key column
+ * \param keys Returns key of every row.
+ */
+static void keyValues(const Table *table, int column, QVector<QString> *keys)
+{
+    keys->resize(table->rowCount());
+    for (int r = 0; r < table->rowCount(); r++)
+        (*keys)[r] = table->toString(r, column).toCaseFolded();
+}
+
+/*!
+ * \brief Hash index of key column.
+ *
+ * Rows with same key are chained in row order through next, so there is
+ * one hash entry per distinct key and no per-key lists.
+ */
+template <typename Key>
+struct JoinIndex {
+    QHash<Key, int> first; /*!< First row of every key. */
+    QVector<int> next; /*!< Next row with same key or -1. */
+
+    void build(const QVector<Key> &keys)
+    {
+        first.clear();
+        first.reserve(keys.count());
+        next.fill(-1, keys.count());
+        for (int r = keys.count() - 1; r >= 0; r--)
+        {
+            if (isNullKey(keys.at(r)))
+                continue;
+            typename QHash<Key, int>::iterator i = first.find(keys.at(r));
+            if (i == first.end())
+            {
+                first.insert(keys.at(r), r);
+            } else {
+                next[r] = i.value();
+                i.value() = r;
+            }
+        }
+    }
+
+    int find(const Key &key) const
+    {
+        return isNullKey(key) ? -1 : first.value(key, -1);
+    }
+};
+
+/*!
+ * \brief Matching rows of join, one entry per result row.
+ */
+struct JoinRows {
+    QVector<int> left; /*!< Row of main input. */
+    QVector<int> right; /*!< Row of second input or -1. */
+};
+
+/*!
+ * \brief Join by probing index of second input with main input rows.
+ * \param leftKeys Keys of main input.
+ * \param rightIndex Index of second input.
+ * \param type Join type, see JOIN_TYPE_* in pirilib.h
+ * \param rows Returns matching rows in main input order.
+ */
+template <typename Key>
+static void probeRows(const QVector<Key> &leftKeys, const JoinIndex<Key> &rightIndex, int type, JoinRows *rows)
+{
+    rows->left.reserve(leftKeys.count());
+    rows->right.reserve(leftKeys.count());
+    for (int l = 0; l < leftKeys.count(); l++)
+    {
+        int r = rightIndex.find(leftKeys.at(l));
+        if (r < 0 || type == JOIN_TYPE_SEMI)
+        {
+            if (r >= 0 || type == JOIN_TYPE_LEFT)
+            {
+                rows->left << l;
+                rows->right << -1;
+            }
+            continue;
+        }
+        for (; r >= 0; r = rightIndex.next.at(r))
+        {
+            rows->left << l;
+            rows->right << r;
+        }
+    }
+}
+
+/*!
+ * \brief Join by building index of main input and probing it.
+ *
+ * Used when main input is smaller. Matches are put back to main input
+ * order with counting sort, so result is same as with probeRows().
+ * \param leftKeys Keys of main input.
+ * \param rightKeys Keys of second input.
+ * \param type Join type, see JOIN_TYPE_* in pirilib.h
+ * \param rows Returns matching rows in main input order.
+ */
+template <typename Key>
+static void buildLeftRows(const QVector<Key> &leftKeys, const QVector<Key> &rightKeys, int type, JoinRows *rows)
+{
+    JoinIndex<Key> index;
+    index.build(leftKeys);
+
+    QVector<int> counts(leftKeys.count(), 0);
+    QVector<int> pairs;
+    for (int r = 0; r < rightKeys.count(); r++)
+    {
+        for (int l = index.find(rightKeys.at(r)); l >= 0; l = index.next.at(l))
+        {
+            counts[l]++;
+            if (type != JOIN_TYPE_SEMI)
+                pairs << l << r;
+        }
+    }
+
+    QVector<int> offsets(leftKeys.count());
+    int total = 0;
+    for (int l = 0; l < leftKeys.count(); l++)
+    {
+        offsets[l] = total;
+        if (type == JOIN_TYPE_SEMI)
+            total += counts.at(l) > 0 ? 1 : 0;
+        else if (type == JOIN_TYPE_LEFT)
+            total += qMax(1, counts.at(l));
+        else
+            total += counts.at(l);
+    }
+
+    rows->left.resize(total);
+    rows->right.fill(-1, total);
+    for (int l = 0; l < leftKeys.count(); l++)
+    {
+        int end = l + 1 < leftKeys.count() ? offsets.at(l + 1) : total;
+        for (int i = offsets.at(l); i < end; i++)
+            rows->left[i] = l;
+    }
+    for (int i = 0; i < pairs.count(); i += 2)
+        rows->right[offsets[pairs.at(i)]++] = pairs.at(i + 1);
+}
+
+/*!
+ * \brief Join two whole tables, smaller table is indexed.
+ * \param left Main input
+ * \param leftColumn Key column of main input.
+ * \param right Second input
+ * \param rightColumn Key column of second input.
+ * \param type Join type, see JOIN_TYPE_* in pirilib.h
+ * \param rows Returns matching rows in main input order.
+ */
+template <typename Key>
+static void joinRows(const Table *left, int leftColumn, const Table *right, int rightColumn, int type, JoinRows *rows)
+{
+    QVector<Key> leftKeys;
+    QVector<Key> rightKeys;
+    keyValues(left, leftColumn, &leftKeys);
+    keyValues(right, rightColumn, &rightKeys);
+    if (left->rowCount() < right->rowCount())
+    {
+        buildLeftRows(leftKeys, rightKeys, type, rows);
+    } else {
+        JoinIndex<Key> index;
+        index.build(rightKeys);
+        probeRows(leftKeys, index, type, rows);
+    }
+}
+
+/*!
+ * \brief Make result table from matching rows.
+ *
+ * Result has all columns of main input and columns of second input
+ * without its key column. Same column names get number suffix. Geometry
+ * comes from main input, same as in MapInfo join.
+ * \param left Main input
+ * \param right Second input
+ * \param rightColumn Key column of second input.
+ * \param type Join type, see JOIN_TYPE_* in pirilib.h
+ * \param rows Matching rows
+ * \return Result table
+ */
+static TablePtr joinTable(const Table *left, const Table *right, int rightColumn, int type, const JoinRows &rows)
+{
+    QVector<int> leftColumns;
+    for (int i = 0; i < left->columnCount(); i++)
+        leftColumns << i;
+    TablePtr result = left->subset(rows.left, leftColumns);
+    if (type == JOIN_TYPE_SEMI)
+        return result;
+
+    for (int j = 0; j < right->columnCount(); j++)
+    {
+        if (j == rightColumn)
+            continue;
+        const TableColumn &src = right->column(j);
+        QString name = src.name;
+        for (int n = 2; result->columnIndex(name) >= 0; n++)
+            name = QString("%1_%2").arg(src.name).arg(n);
+        TableColumn &dst = result->column(result->addColumn(name, src.type));
+        for (int i = 0; i < rows.right.count(); i++)
+        {
+            int r = rows.right.at(i);
+            if (r < 0)
+                continue;
+            switch (src.type) {
+            case COLUMN_TYPE_STRING:
+                dst.strings[i] = src.strings.at(r);
+                break;
+            case COLUMN_TYPE_FLOAT:
+                dst.floats[i] = src.floats.at(r);
+                break;
+            default:
+                dst.integers[i] = src.integers.at(r);
+            }
+        }
+    }
+    return result;
+}
+
+/*!
+ * \brief Find key columns of both inputs.
+ * \param left Main input
+ * \param leftKey Key column name of main input.
+ * \param right Second input
+ * \param rightKey Key column name of second input, empty for same name.
+ * \param leftColumn Returns key column of main input.
+ * \param rightColumn Returns key column of second input.
+ * \param error Returns error message.
+ * \return True if both columns exist.
+ */
+static bool findKeys(const Table *left, const QString &leftKey, const Table *right, const QString &rightKey,
+                     int *leftColumn, int *rightColumn, QString *error)
+{
+    QString key2 = rightKey.isEmpty() ? leftKey : rightKey;
+    *leftColumn = left->columnIndex(leftKey);
+    *rightColumn = right->columnIndex(key2);
+    if (*leftColumn < 0 || *rightColumn < 0)
+    {
+        *error = "Merge: no column " + (*leftColumn < 0 ? leftKey : key2);
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Stream of joined rows.
+ *
+ * Second input is read whole and indexed when first batch is asked, then
+ * every batch of main input is joined with index. Use second input for
+ * lookup table, main input can be any size.
+ */
+class MergeStream : public TableStream
+{
+public:
+    MergeStream(QString leftKey, QString rightKey, int type, TableStreamPtr left, TableStreamPtr right)
+        : myLeftKey(leftKey), myRightKey(rightKey), myType(type), myLeft(left), myRightStream(right),
+          myLeftColumn(-1), myRightColumn(-1), myIntegerKeys(false) {}
+
+    TablePtr next()
+    {
+        if (hasError())
+            return TablePtr();
+        TablePtr batch = myLeft->next();
+        if (!batch)
+        {
+            myError = myLeft->getError();
+            return TablePtr();
+        }
+        if (!myRight && !buildIndex(batch.data()))
+            return TablePtr();
+
+        JoinRows rows;
+        if (myIntegerKeys)
+        {
+            QVector<qint64> keys;
+            keyValues(batch.data(), myLeftColumn, &keys);
+            probeRows(keys, myIntegerIndex, myType, &rows);
+        } else {
+            QVector<QString> keys;
+            keyValues(batch.data(), myLeftColumn, &keys);
+            probeRows(keys, myStringIndex, myType, &rows);
+        }
+        return joinTable(batch.data(), myRight.data(), myRightColumn, myType, rows);
+    }
+
+private:
+    bool buildIndex(const Table *batch)
+    {
+        myRight = myRightStream->readAll();
+        if (!myRight)
+        {
+            myError = myRightStream->getError();
+            return false;
+        }
+        if (!findKeys(batch, myLeftKey, myRight.data(), myRightKey, &myLeftColumn, &myRightColumn, &myError))
+            return false;
+        myIntegerKeys = isIntegerKey(batch->column(myLeftColumn).type)
+                && isIntegerKey(myRight->column(myRightColumn).type);
+        if (myIntegerKeys)
+        {
+            QVector<qint64> keys;
+            keyValues(myRight.data(), myRightColumn, &keys);
+            myIntegerIndex.build(keys);
+        } else {
+            QVector<QString> keys;
+            keyValues(myRight.data(), myRightColumn, &keys);
+            myStringIndex.build(keys);
+        }
+        return true;
+    }
+
+    QString myLeftKey; /*!< Key column of main input. */
+    QString myRightKey; /*!< Key column of second input. */
+    int myType; /*!< Join type. */
+    TableStreamPtr myLeft; /*!< Main input stream. */
+    TableStreamPtr myRightStream; /*!< Second input stream, read whole. */
+    TablePtr myRight; /*!< Second input table. */
+    int myLeftColumn; /*!< Key column of main input. */
+    int myRightColumn; /*!< Key column of second input. */
+    bool myIntegerKeys; /*!< Are keys integers? */
+    JoinIndex<qint64> myIntegerIndex; /*!< Index of integer keys. */
+    JoinIndex<QString> myStringIndex; /*!< Index of other keys. */
+};
+
+/*!
+ * \brief Run join on native tables.
+ *
+ * Hash join, smaller input is indexed and other input probes it. Result
+ * rows are in main input order in both cases. Empty keys never match.
+ * \param inputs Input tables
+ * \return Joined table
+ */
+TablePtr Merge::run(QList<TablePtr> inputs)
+{
+    TablePtr left = inputs.value(0);
+    TablePtr right = inputs.value(1);
+    if (!left || !right)
+        return TablePtr();
+
+    int leftColumn;
+    int rightColumn;
+    QString error;
+    if (!findKeys(left.data(), leftKey, right.data(), rightKey, &leftColumn, &rightColumn, &error))
+    {
+        if (myCallback)
+            myCallback->showError(error);
+        return TablePtr();
+    }
+
+    JoinRows rows;
+    if (isIntegerKey(left->column(leftColumn).type) && isIntegerKey(right->column(rightColumn).type))
+        joinRows<qint64>(left.data(), leftColumn, right.data(), rightColumn, joinType, &rows);
+    else
+        joinRows<QString>(left.data(), leftColumn, right.data(), rightColumn, joinType, &rows);
+    return joinTable(left.data(), right.data(), rightColumn, joinType, rows);
+}
+
+/*!
+ * \brief Run join as stream.
+ *
+ * Second input is always indexed, main input is streamed.
+ * \param inputs Input streams
+ * \param batchRows Rows in one batch, batches follow main input batches.
+ * \return Stream of joined rows
+ */
+TableStreamPtr Merge::stream(QList<TableStreamPtr> inputs, int batchRows)
+{
+    Q_UNUSED(batchRows);
+    TableStreamPtr left = inputs.value(0);
+    TableStreamPtr right = inputs.value(1);
+    if (!left || !right)
+        return TableStreamPtr();
+    return TableStreamPtr(new MergeStream(leftKey, rightKey, joinType, left, right));
+}
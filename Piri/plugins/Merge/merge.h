@@ -0,0 +1,34 @@
+#ifndef MERGE_H
+#define MERGE_H
+
+#include <QObject>
+#include <QtPlugin>
+
+#include "pirilib.h"
+#include "interfaces.h"
+#include "knobcallback.h"
+#include "op.h"
+
+class Merge : public QObject, public OpInterfaceMI, public OpInterfaceNative, public OpInterfaceStream, public Op
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID "Kaldera.Piri.v03.OpInterfaceMI")
+    Q_INTERFACES(OpInterfaceMI OpInterfaceNative OpInterfaceStream)
+
+public:
+    Merge();
+    OpInterfaceMI* create();
+    void setup();
+    const OpDescriptor* descriptor();
+    void knobs(KnobCallback *f);
+    QString engine();
+    TablePtr run(QList<TablePtr> inputs);
+    TableStreamPtr stream(QList<TableStreamPtr> inputs, int batchRows);
+
+private:
+    QString leftKey; /*!< Key column of main input. */
+    QString rightKey; /*!< Key column of second input. */
+    int joinType; /*!< Join type, see JOIN_TYPE_* in pirilib.h */
+};
+
+#endif // MERGE_H
@@ -1,6 +1,6 @@
 
 TEMPLATE      = lib
-CONFIG       += plugin
+CONFIG       += plugin c++11
 QT           += widgets core gui
 INCLUDEPATH  += ../../libs/PiriLib/source
 HEADERS      += open.h
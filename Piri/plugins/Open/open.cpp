@@ -1,6 +1,22 @@
 #include "open.h"
 #include "knobs.h"
 #include "node.h"
+#include "tabreader.h"
+#include "shapereader.h"
+
+#include <QFileInfo>
+
+static constexpr OpDescriptor openDescriptor = { "Input", "Open Table", "Open MapInfo table or shapefile.", 0, 0, OP_SCHEMA_SOURCE, 0, 0 };
+
+Open::Open()
+{
+    setup();
+}
+
+OpInterfaceMI* Open::create()
+{
+    return new Open();
+}
 
 void Open::setup()
 {
@@ -9,24 +25,111 @@ void Open::setup()
     number = 1;
 }
 
-QString Open::description()
+const OpDescriptor* Open::descriptor()
 {
-    setup();
-    return QString("Input/Open Table;Open data table./0");
+    return &openDescriptor;
 }
 
 void Open::knobs(KnobCallback* f)
 {
-    setup();
     FileDialog_knob(f, &filename, "File");
     //Integer_knob(f, &number, "Number:");
 }
 
+/*!
+ * \brief Is file ESRI Shapefile?
+ * \return True if file suffix is .shp, otherwise file is MapInfo table.
+ */
+bool Open::isShape()
+{
+    return QFileInfo(filename).suffix().toLower() == "shp";
+}
+
 QString Open::engine()
 {
+    QString name = QFileInfo(filename).completeBaseName();
     QString command;
-    command = QString("Open Table \"%1\" ").arg(filename);
-    command += QString("Select * From %1 Into _%2 ").arg(filename.split("/").last().split(".").first()).arg(getHash());
+    if (isShape())
+    {
+        QString tab = QFileInfo(filename).path() + "/" + name + ".TAB";
+        command = QString("Register Table \"%1\" Type \"SHAPEFILE\" Into \"%2\" ").arg(filename, tab);
+        command += QString("Open Table \"%1\" ").arg(tab);
+    } else {
+        command = QString("Open Table \"%1\" ").arg(filename);
+    }
+    command += QString("Select * From %1 Into _%2 ").arg(name).arg(getHash().toHex());
 
     return command;
 }
+
+/*!
+ * \brief Read whole table with reader of given type.
+ * \param error Returns error.
+ * \return Table or null pointer on error.
+ */
+template <class Reader>
+static TablePtr readTable(QString fileName, QString *error)
+{
+    Reader reader(fileName);
+    TablePtr table = reader.read();
+    if (!table)
+        *error = reader.getError();
+    return table;
+}
+
+TablePtr Open::run(QList<TablePtr> inputs)
+{
+    Q_UNUSED(inputs);
+    QString error;
+    TablePtr table = isShape() ? readTable<ShapeReader>(filename, &error) : readTable<TabReader>(filename, &error);
+    if (!table && myCallback)
+        myCallback->showError(error);
+    return table;
+}
+
+/*!
+ * \brief Stream of table rows, read from mapped files in batches.
+ *
+ * Reader is TabReader for MapInfo tables or ShapeReader for shapefiles.
+ */
+template <class Reader>
+class OpenStream : public TableStream
+{
+public:
+    OpenStream(QString fileName, int batchRows)
+        : myReader(fileName), myBatchRows(batchRows), myOpened(false) {}
+
+    TablePtr next()
+    {
+        if (hasError())
+            return TablePtr();
+        if (!myOpened)
+        {
+            myOpened = true;
+            if (!myReader.open())
+            {
+                myError = myReader.getError();
+                return TablePtr();
+            }
+        } else if (myReader.atEnd()) {
+            return TablePtr();
+        }
+        TablePtr batch = myReader.readBatch(myBatchRows);
+        if (!batch)
+            myError = myReader.getError();
+        return batch;
+    }
+
+private:
+    Reader myReader; /*!< Reader of opened table. */
+    int myBatchRows; /*!< Rows in one batch. */
+    bool myOpened; /*!< Is table opened? */
+};
+
+TableStreamPtr Open::stream(QList<TableStreamPtr> inputs, int batchRows)
+{
+    Q_UNUSED(inputs);
+    if (isShape())
+        return TableStreamPtr(new OpenStream<ShapeReader>(filename, batchRows));
+    return TableStreamPtr(new OpenStream<TabReader>(filename, batchRows));
+}
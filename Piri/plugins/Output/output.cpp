@@ -0,0 +1,262 @@
+#include "output.h"
+#include "knobs.h"
+#include "node.h"
+#include "tabwriter.h"
+#include "mifwriter.h"
+#include "shapewriter.h"
+
+#include <QFileInfo>
+
+static constexpr OpDescriptor outputDescriptor = { "Output", "Write Table", "Write MapInfo table, MIF/MID file or shapefile.", 1, 1, OP_SCHEMA_INPUT, 0, 0 };
+
+Output::Output()
+{
+    setup();
+}
+
+OpInterfaceMI* Output::create()
+{
+    return new Output();
+}
+
+void Output::setup()
+{
+    filename = "";
+    coordSys = "";
+    charset = MAPINFO_CHARSET;
+}
+
+const OpDescriptor* Output::descriptor()
+{
+    return &outputDescriptor;
+}
+
+void Output::knobs(KnobCallback* f)
+{
+    // Not a file knob, its hash would follow stats of the written file
+    String_knob(f, &filename, "File");
+    String_knob(f, &coordSys, "CoordSys");
+    String_knob(f, &charset, "Charset");
+}
+
+/*!
+ * \brief Generate MapBasic command.
+ *
+ * Input is saved as native table or shapefile or exported to MIF/MID,
+ * and selected into result so that output can be viewed. CoordSys knob is
+ * WKT projection for shapefile.
+ * \return MapBasic command
+ */
+QString Output::engine()
+{
+    if (!hasInput(0))
+        return " ";
+    QString input = "_" + getInputHash(0).toHex();
+    QString command;
+    if (isMif())
+        command = QString("Export %1 Into \"%2\" Type \"MIF\" Overwrite CharSet \"%3\" ").arg(input, filename, charset);
+    else if (isShape())
+        command = QString("Commit Table %1 As \"%2\" Type SHAPEFILE Charset \"%3\" ").arg(input, filename, charset);
+    else
+        command = QString("Commit Table %1 As \"%2\" Type NATIVE Charset \"%3\" %4 ").arg(input, filename, charset, coordSys);
+    command += QString("Select * From %1 Into _%2").arg(input, getHash().toHex());
+    return command;
+}
+
+/*!
+ * \brief Is output written as MIF/MID?
+ * \return True if file suffix is .mif, otherwise native table is written.
+ */
+bool Output::isMif()
+{
+    return QFileInfo(filename).suffix().toLower() == "mif";
+}
+
+/*!
+ * \brief Is output written as shapefile?
+ * \return True if file suffix is .shp.
+ */
+bool Output::isShape()
+{
+    return QFileInfo(filename).suffix().toLower() == "shp";
+}
+
+/*!
+ * \brief Get path of file that keeps hash of node that wrote output.
+ * \return Output path with .hash suffix added.
+ */
+QString Output::hashFile()
+{
+    return filename + ".hash";
+}
+
+/*!
+ * \brief Get hash of written content.
+ *
+ * Hash is made of input hash and knob values only, so writing the file
+ * does not change it.
+ * \return Hash that is kept in hash file.
+ */
+Hash128 Output::writeHash()
+{
+    Hasher hasher;
+    hasher.addHash(getInputHash(0));
+    hasher.addString(filename);
+    hasher.addString(coordSys);
+    hasher.addString(charset);
+    return hasher.result();
+}
+
+/*!
+ * \brief Is output already written with same content?
+ *
+ * Write hash changes when knobs or input change, so same hash means
+ * same content.
+ * \return True if output exists and was written with current hash.
+ */
+bool Output::isWritten()
+{
+    QFile file(hashFile());
+    if (!QFile::exists(filename) || !file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    return QString::fromLatin1(file.readAll()).trimmed() == writeHash().toHex();
+}
+
+/*!
+ * \brief Stream that writes every batch to file and passes it on.
+ *
+ * Hash file is removed before first batch and written after last, so
+ * interrupted write is never taken as done.
+ */
+template <class Writer>
+class OutputStream : public TableStream
+{
+public:
+    OutputStream(TableStreamPtr input, Writer *writer, QString hashFile, QString hash)
+        : myInput(input), myWriter(writer), myHashFile(hashFile), myHash(hash), myStarted(false), myDone(false) {}
+
+    TablePtr next()
+    {
+        if (hasError() || myDone)
+            return TablePtr();
+        TablePtr batch = myInput->next();
+        if (myInput->hasError())
+        {
+            myError = myInput->getError();
+            return TablePtr();
+        }
+        if (!batch)
+        {
+            myDone = true;
+            if (!myStarted || !myWriter->finish())
+            {
+                myError = myStarted ? myWriter->getError() : "No table to write";
+                return TablePtr();
+            }
+            QFile file(myHashFile);
+            if (file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+                file.write(myHash.toLatin1() + "\n");
+            return TablePtr();
+        }
+        if (!myStarted)
+        {
+            QFile::remove(myHashFile);
+            myStarted = true;
+            if (!myWriter->begin(batch.data()))
+            {
+                myError = myWriter->getError();
+                return TablePtr();
+            }
+        }
+        if (!myWriter->writeBatch(batch.data()))
+        {
+            myError = myWriter->getError();
+            return TablePtr();
+        }
+        return batch;
+    }
+
+private:
+    TableStreamPtr myInput; /*!< Input stream. */
+    QScopedPointer<Writer> myWriter; /*!< Writer of output file. */
+    QString myHashFile; /*!< Path of hash file. */
+    QString myHash; /*!< Write hash as hex. */
+    bool myStarted; /*!< Is first batch written? */
+    bool myDone; /*!< Is file finished? */
+};
+
+/*!
+ * \brief Make writing stream with writer of given type.
+ * \param input Input stream
+ * \param error Returns error if coordinate system is not supported.
+ * \return Stream or null pointer on error.
+ */
+template <class Writer>
+static TableStreamPtr outputStream(TableStreamPtr input, QString filename, QString charset, QString coordSys,
+                                   QString hashFile, QString hash, QString *error)
+{
+    Writer *writer = new Writer(filename);
+    writer->setCharset(charset);
+    if (!writer->setCoordSys(coordSys))
+    {
+        *error = writer->getError();
+        delete writer;
+        return TableStreamPtr();
+    }
+    return TableStreamPtr(new OutputStream<Writer>(input, writer, hashFile, hash));
+}
+
+/*!
+ * \brief Write input to file and return it.
+ *
+ * Writing is skipped if file was written with same write hash.
+ * \param inputs Input tables
+ * \return Input table
+ */
+TablePtr Output::run(QList<TablePtr> inputs)
+{
+    TablePtr input = inputs.value(0);
+    if (!input || isWritten())
+        return input;
+
+    TableStreamPtr stream = this->stream(QList<TableStreamPtr>() << TableStreamPtr(new TableSliceStream(input)), STREAM_BATCH_ROWS);
+    if (!stream)
+        return TablePtr();
+    while (stream->next())
+        ;
+    if (stream->hasError())
+    {
+        if (myCallback)
+            myCallback->showError("Write Table: " + stream->getError());
+        return TablePtr();
+    }
+    return input;
+}
+
+/*!
+ * \brief Run output as stream, every batch is written when it passes.
+ *
+ * Input is passed on as it is if file was written with same write hash.
+ * \param inputs Input streams
+ * \param batchRows Rows in one batch, batches follow input batches.
+ * \return Stream of input tables
+ */
+TableStreamPtr Output::stream(QList<TableStreamPtr> inputs, int batchRows)
+{
+    Q_UNUSED(batchRows);
+    TableStreamPtr input = inputs.value(0);
+    if (!input || isWritten())
+        return input;
+
+    QString error;
+    TableStreamPtr stream;
+    if (isMif())
+        stream = outputStream<MifWriter>(input, filename, charset, coordSys, hashFile(), writeHash().toHex(), &error);
+    else if (isShape())
+        stream = outputStream<ShapeWriter>(input, filename, charset, coordSys, hashFile(), writeHash().toHex(), &error);
+    else
+        stream = outputStream<TabWriter>(input, filename, charset, coordSys, hashFile(), writeHash().toHex(), &error);
+    if (!stream && myCallback)
+        myCallback->showError("Write Table: " + error);
+    return stream;
+}
@@ -0,0 +1,40 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <QObject>
+#include <QtPlugin>
+
+#include "pirilib.h"
+#include "interfaces.h"
+#include "knobcallback.h"
+#include "op.h"
+
+class Output : public QObject, public OpInterfaceMI, public OpInterfaceNative, public OpInterfaceStream, public Op
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID "Kaldera.Piri.v03.OpInterfaceMI")
+    Q_INTERFACES(OpInterfaceMI OpInterfaceNative OpInterfaceStream)
+
+public:
+    Output();
+    OpInterfaceMI* create();
+    void setup();
+    const OpDescriptor* descriptor();
+    void knobs(KnobCallback *f);
+    QString engine();
+    TablePtr run(QList<TablePtr> inputs);
+    TableStreamPtr stream(QList<TableStreamPtr> inputs, int batchRows);
+
+private:
+    bool isMif();
+    bool isShape();
+    QString hashFile();
+    Hash128 writeHash();
+    bool isWritten();
+
+    QString filename;
+    QString coordSys;
+    QString charset;
+};
+
+#endif // OUTPUT_H
@@ -3,6 +3,20 @@
 #include "edge.h"
 #include "knobs.h"
 
+#include <QRegularExpression>
+
+static constexpr OpDescriptor selectDescriptor = { "Query", "Select", "Simple select.", 1, 1, OP_SCHEMA_INPUT, 0, 0 };
+
+Select::Select()
+{
+    setup();
+}
+
+OpInterfaceMI* Select::create()
+{
+    return new Select();
+}
+
 void Select::setup()
 {
     rowFrom = 1;
@@ -11,25 +25,253 @@ void Select::setup()
     colTo = 5;
 }
 
-QString Select::description()
+const OpDescriptor* Select::descriptor()
 {
-    setup();
-    return QString("Query/Select;Simple select./1");
+    return &selectDescriptor;
 }
 
 void Select::knobs(KnobCallback* f)
 {
-    setup();
     String_knob(f, &queryString, "Query");
 }
 
 QString Select::engine()
 {
-    if (!getInput(0))
+    if (!hasInput(0))
         return " ";
     QString command;
     //command = "Select * from _" + getInput(0)->getHash() + " into _" + getHash();
     command = queryString;
-    command.replace(QString("input0"), QString("_" + getInput(0)->getHash()) + " into _" + getHash());
+    command.replace(QString("input0"), QString("_" + getInputHash(0).toHex()) + " into _" + getHash().toHex());
     return command;
 }
+
+/*!
+ * \brief Test one where condition.
+ * \param table Input table
+ * \param row Row index
+ * \param column Column index
+ * \param op Comparison operator
+ * \param text Literal as string
+ * \param number Literal as number
+ * \param isNumber Is literal number?
+ * \return Result of comparison
+ */
+static bool testCondition(const Table *table, int row, int column, const QString &op,
+                          const QString &text, double number, bool isNumber)
+{
+    const TableColumn &c = table->column(column);
+    int cmp;
+    if (c.type == COLUMN_TYPE_STRING || !isNumber)
+    {
+        cmp = QString::compare(table->toString(row, column), text, Qt::CaseInsensitive);
+    } else {
+        double v = c.type == COLUMN_TYPE_FLOAT ? c.floats.at(row) : (double)c.integers.at(row);
+        cmp = v < number ? -1 : (v > number ? 1 : 0);
+    }
+    if (op == "=") return cmp == 0;
+    if (op == "<>" || op == "!=") return cmp != 0;
+    if (op == "<") return cmp < 0;
+    if (op == ">") return cmp > 0;
+    if (op == "<=") return cmp <= 0;
+    return cmp >= 0;
+}
+
+/*!
+ * \brief One where condition, "column op literal".
+ */
+struct SelectCondition {
+    int column;
+    QString op;
+    QString text;
+    double number;
+    bool isNumber;
+};
+
+/*!
+ * \brief Parsed select query.
+ */
+struct SelectQuery {
+    QVector<int> columns; /*!< Selected columns in result order. */
+    QList<QList<SelectCondition> > groups; /*!< Groups joined with or, conditions in group joined with and. */
+};
+
+/*!
+ * \brief Parse select query for input columns.
+ *
+ * Supports subset of MapBasic select: column list or *, from input0 and
+ * where conditions "column op literal" joined with and/or. And binds
+ * stronger than or, same as in MapBasic.
+ * \param queryString Query
+ * \param input Input table, only columns are used.
+ * \param query Returns parsed query.
+ * \param error Returns error message.
+ * \return True on success.
+ */
+static bool parseQuery(const QString &queryString, const Table *input, SelectQuery *query, QString *error)
+{
+    QRegularExpression queryExp("^\\s*select\\s+(.+?)\\s+from\\s+input0(?:\\s+where\\s+(.+?))?\\s*$",
+                                QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch match = queryExp.match(queryString);
+    if (!match.hasMatch())
+    {
+        *error = "Select: can not run query " + queryString;
+        return false;
+    }
+
+    query->columns.clear();
+    query->groups.clear();
+    if (match.captured(1).trimmed() == "*")
+    {
+        for (int i = 0; i < input->columnCount(); i++)
+            query->columns << i;
+    } else {
+        foreach (QString name, match.captured(1).split(",")) {
+            int ci = input->columnIndex(name.trimmed());
+            if (ci < 0)
+            {
+                *error = "Select: no column " + name.trimmed();
+                return false;
+            }
+            query->columns << ci;
+        }
+    }
+
+    QString where = match.captured(2);
+    if (!where.isEmpty())
+    {
+        QRegularExpression condExp("\\s*(\\w+)\\s*(<>|!=|<=|>=|=|<|>)\\s*(?:\"([^\"]*)\"|'([^']*)'|([-+]?[0-9.]+(?:[eE][-+]?[0-9]+)?))\\s*(?:(and|or)\\b|$)",
+                                   QRegularExpression::CaseInsensitiveOption);
+        query->groups << QList<SelectCondition>();
+        int offset = 0;
+        while (offset < where.length())
+        {
+            QRegularExpressionMatch m = condExp.match(where, offset, QRegularExpression::NormalMatch,
+                                                      QRegularExpression::AnchoredMatchOption);
+            SelectCondition c;
+            c.column = m.hasMatch() ? input->columnIndex(m.captured(1)) : -1;
+            if (c.column < 0)
+            {
+                *error = "Select: can not parse condition " + where.mid(offset);
+                return false;
+            }
+            c.op = m.captured(2);
+            c.isNumber = !m.captured(5).isEmpty();
+            c.text = c.isNumber ? m.captured(5) : m.captured(3) + m.captured(4);
+            c.number = c.text.toDouble();
+            query->groups.last() << c;
+            if (m.captured(6).compare("or", Qt::CaseInsensitive) == 0)
+                query->groups << QList<SelectCondition>();
+            offset = m.capturedEnd(0);
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Select rows and columns of table with parsed query.
+ * \param input Input table
+ * \param query Parsed query
+ * \return Selected rows and columns
+ */
+static TablePtr selectRows(const Table *input, const SelectQuery &query)
+{
+    QVector<int> rows;
+    rows.reserve(input->rowCount());
+    for (int r = 0; r < input->rowCount(); r++)
+    {
+        bool selected = query.groups.isEmpty();
+        foreach (const QList<SelectCondition> &group, query.groups) {
+            bool all = true;
+            foreach (const SelectCondition &c, group) {
+                if (!testCondition(input, r, c.column, c.op, c.text, c.number, c.isNumber))
+                {
+                    all = false;
+                    break;
+                }
+            }
+            if (all)
+            {
+                selected = true;
+                break;
+            }
+        }
+        if (selected)
+            rows << r;
+    }
+    return input->subset(rows, query.columns);
+}
+
+/*!
+ * \brief Stream of selected rows.
+ *
+ * Query is parsed when first batch comes, then every input batch gives
+ * one result batch.
+ */
+class SelectStream : public TableStream
+{
+public:
+    SelectStream(QString queryString, TableStreamPtr input)
+        : myQueryString(queryString), myInput(input), myParsed(false) {}
+
+    TablePtr next()
+    {
+        if (hasError())
+            return TablePtr();
+        TablePtr batch = myInput->next();
+        if (!batch)
+        {
+            myError = myInput->getError();
+            return TablePtr();
+        }
+        if (!myParsed && !parseQuery(myQueryString, batch.data(), &myQuery, &myError))
+            return TablePtr();
+        myParsed = true;
+        return selectRows(batch.data(), myQuery);
+    }
+
+private:
+    QString myQueryString; /*!< Query as it was when stream was made. */
+    TableStreamPtr myInput; /*!< Input stream. */
+    SelectQuery myQuery; /*!< Parsed query. */
+    bool myParsed; /*!< Is query parsed? */
+};
+
+/*!
+ * \brief Run select on native table.
+ * \param inputs Input tables
+ * \return Selected rows and columns
+ */
+TablePtr Select::run(QList<TablePtr> inputs)
+{
+    TablePtr input = inputs.value(0);
+    if (!input)
+        return TablePtr();
+
+    SelectQuery query;
+    QString error;
+    if (!parseQuery(queryString, input.data(), &query, &error))
+    {
+        if (myCallback)
+            myCallback->showError(error);
+        return TablePtr();
+    }
+    return selectRows(input.data(), query);
+}
+
+/*!
+ * \brief Run select as stream.
+ *
+ * Select is row-wise, so every batch is selected separately.
+ * \param inputs Input streams
+ * \param batchRows Rows in one batch, batches follow input batches.
+ * \return Stream of selected rows and columns
+ */
+TableStreamPtr Select::stream(QList<TableStreamPtr> inputs, int batchRows)
+{
+    Q_UNUSED(batchRows);
+    TableStreamPtr input = inputs.value(0);
+    if (!input)
+        return TableStreamPtr();
+    return TableStreamPtr(new SelectStream(queryString, input));
+}
@@ -0,0 +1,66 @@
+#include "simplify.h"
+#include "node.h"
+#include "edge.h"
+#include "knobs.h"
+#include "topology.h"
+
+static constexpr OpDescriptor simplifyDescriptor = { "Transform", "Simplify", "Simplify regions without gaps between neighbours.", 1, 1, OP_SCHEMA_INPUT, 0, 0 };
+
+Simplify::Simplify()
+{
+    setup();
+}
+
+OpInterfaceMI* Simplify::create()
+{
+    return new Simplify();
+}
+
+void Simplify::setup()
+{
+    tolerance = 100;
+}
+
+const OpDescriptor* Simplify::descriptor()
+{
+    return &simplifyDescriptor;
+}
+
+void Simplify::knobs(KnobCallback* f)
+{
+    Integer_knob(f, &tolerance, "Tolerance");
+}
+
+/*!
+ * \brief Generate MapBasic command.
+ *
+ * MapInfo has no generalization that keeps shared boundaries, so rows
+ * are only selected into result. Simplification is done in native run.
+ * \return MapBasic command
+ */
+QString Simplify::engine()
+{
+    if (!hasInput(0))
+        return " ";
+    return QString("Select * From _%1 Into _%2").arg(getInputHash(0).toHex(), getHash().toHex());
+}
+
+/*!
+ * \brief Simplify regions of native table.
+ *
+ * Shared boundaries are found with topology and every boundary is
+ * simplified once, so neighbours get same boundary and no gaps or
+ * slivers open between them.
+ * \param inputs Input tables
+ * \return Table with simplified regions
+ */
+TablePtr Simplify::run(QList<TablePtr> inputs)
+{
+    TablePtr input = inputs.value(0);
+    if (!input)
+        return TablePtr();
+    Topology topology;
+    topology.build(input.data());
+    topology.simplify(qMax(0, tolerance));
+    return topology.toTable(input.data());
+}
@@ -0,0 +1,884 @@
+#include "tiles.h"
+#include "node.h"
+#include "edge.h"
+#include "knobs.h"
+#include "hasher.h"
+
+#include <QtConcurrent>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QPainter>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QThread>
+#include <QVarLengthArray>
+#include <qmath.h>
+
+#include <float.h>
+
+static constexpr OpDescriptor tilesDescriptor = { "Output", "Render Tiles", "Render layer to PNG tile pyramid.", 1, 1, OP_SCHEMA_INPUT, 0, 0 };
+
+Tiles::Tiles()
+{
+    setup();
+}
+
+OpInterfaceMI* Tiles::create()
+{
+    return new Tiles();
+}
+
+void Tiles::setup()
+{
+    directory = "";
+    grid = TILE_GRID_DATA;
+    coordSys = "";
+    minZoom = 0;
+    maxZoom = 14;
+    fill = "#a0c0e0";
+    line = "#404040";
+    lineWidth = 1;
+    symbolSize = 6;
+    classColumn = "";
+    classColors = "#fef0d9,#fdcc8a,#fc8d59,#e34a33,#b30000";
+}
+
+const OpDescriptor* Tiles::descriptor()
+{
+    return &tilesDescriptor;
+}
+
+void Tiles::knobs(KnobCallback* f)
+{
+    String_knob(f, &directory, "Directory");
+    ComboBox_knob(f, &grid, "Grid", "Tile grid");
+    ADD_VALUES(f, "Web Mercator,Data bounds");
+    String_knob(f, &coordSys, "CoordSys");
+    Integer_knob(f, &minZoom, "Min zoom");
+    Integer_knob(f, &maxZoom, "Max zoom");
+    String_knob(f, &fill, "Fill");
+    String_knob(f, &line, "Line");
+    Integer_knob(f, &lineWidth, "Line width");
+    Integer_knob(f, &symbolSize, "Symbol size");
+    String_knob(f, &classColumn, "Class column");
+    String_knob(f, &classColors, "Class colors");
+}
+
+/*!
+ * \brief Generate MapBasic command.
+ *
+ * MapInfo has no tile renderer, so rows are only selected into result.
+ * Tiles are rendered in native run.
+ * \return MapBasic command
+ */
+QString Tiles::engine()
+{
+    if (!hasInput(0))
+        return " ";
+    return QString("Select * From _%1 Into _%2").arg(getInputHash(0).toHex(), getHash().toHex());
+}
+
+/*!
+ * \brief Get path of file that keeps node hash and hashes of tiles.
+ * \return Path of tiles.hash in tile directory.
+ */
+QString Tiles::manifestFile()
+{
+    return directory + "/tiles.hash";
+}
+
+/*!
+ * \brief Is coordinate system Web Mercator (EPSG:3857)?
+ * \param coordSys MapBasic CoordSys clause, Bounds are ignored.
+ * \return True if clause is TILE_WEBMERCATOR_COORDSYS.
+ */
+static bool isWebMercator(QString coordSys)
+{
+    QString s = coordSys.simplified();
+    s.remove(QRegularExpression("\\s*Bounds\\s*\\(.*$", QRegularExpression::CaseInsensitiveOption));
+    s.remove(' ');
+    return s.compare(QString(TILE_WEBMERCATOR_COORDSYS).remove(' '), Qt::CaseInsensitive) == 0;
+}
+
+/*!
+ * \brief Area that zoom level 0 tile covers, in map coordinates.
+ */
+struct TileGrid {
+    double left;
+    double top;
+    double size; /*!< Width and height of level 0 tile. */
+};
+
+/*!
+ * \brief Style shared by all tiles.
+ */
+struct TileStyle {
+    QColor line;
+    int lineWidth;
+    int symbolSize;
+    Hash128 hash; /*!< Hash of grid and style, part of every tile hash. */
+};
+
+/*!
+ * \brief Area of tile in map coordinates, y grows up.
+ */
+struct TileBox {
+    double x0;
+    double y0;
+    double x1;
+    double y1;
+};
+
+/*!
+ * \brief Row and its parts that reach tile.
+ */
+struct TileRow {
+    int row;
+    Geometry geometry; /*!< Geometry clipped to tile or to its parent. */
+};
+
+/*!
+ * \brief Tile of pyramid and rows that may be drawn on it.
+ */
+struct TileNode {
+    int z;
+    int x;
+    int y;
+    QVector<int> candidates; /*!< Rows whose bounds touch tile, in row order. */
+    bool decoded; /*!< Are rows set? Tiles above changed tiles are not decoded. */
+    QVector<TileRow> rows; /*!< Clipped geometry of candidates that reach tile. */
+};
+
+/*!
+ * \brief Tile to visit and what came out of it.
+ */
+struct TileTask {
+    TileNode node;
+    QStringList lines; /*!< Returns manifest lines of tile and tiles below it. */
+    QStringList skipped; /*!< Returns tiles whose subtree did not change. */
+    QVector<TileNode> children; /*!< Returns tiles to visit next. */
+    QString error; /*!< Returns error, empty on success. */
+};
+
+/*!
+ * \brief Convert geometry to pixel path of tile.
+ *
+ * Vertices closer than half a pixel to previous vertex are dropped, so
+ * detail follows zoom level. Parts that get too few vertices are dropped.
+ * \param geometry Geometry in map coordinates
+ * \param closed Are parts rings?
+ * \param left Left edge of tile
+ * \param top Top edge of tile
+ * \param scale Pixels per map unit
+ * \return Path, empty if nothing is left.
+ */
+static QPainterPath pixelPath(const Geometry &geometry, bool closed, double left, double top, double scale)
+{
+    QPainterPath path;
+    QPolygonF pixels;
+    foreach (const QPolygonF &part, geometry) {
+        pixels.clear();
+        for (int i = 0; i < part.count(); i++)
+        {
+            QPointF p((part.at(i).x() - left) * scale, (top - part.at(i).y()) * scale);
+            if (!pixels.isEmpty() && i < part.count() - 1
+                    && qAbs(p.x() - pixels.last().x()) < 0.5 && qAbs(p.y() - pixels.last().y()) < 0.5)
+                continue;
+            pixels << p;
+        }
+        if (pixels.count() < (closed ? 3 : 2))
+            continue;
+        path.addPolygon(pixels);
+        if (closed)
+            path.closeSubpath();
+    }
+    return path;
+}
+
+static inline bool insideBox(const QPointF &p, const TileBox &box)
+{
+    return p.x() >= box.x0 && p.x() <= box.x1 && p.y() >= box.y0 && p.y() <= box.y1;
+}
+
+/*!
+ * \brief Clip ring to one side of line x = value or y = value.
+ * \param ring Ring to clip
+ * \param vertical Clip by x? Otherwise by y.
+ * \param value Coordinate of clip line
+ * \param keepBelow Keep side where coordinate is below value?
+ * \return Clipped ring, may touch clip line with zero width.
+ */
+static QPolygonF clipRingSide(const QPolygonF &ring, bool vertical, double value, bool keepBelow)
+{
+    QPolygonF out;
+    if (ring.isEmpty())
+        return out;
+    QPointF a = ring.last();
+    double ca = vertical ? a.x() : a.y();
+    bool inA = keepBelow ? ca <= value : ca >= value;
+    for (int i = 0; i < ring.count(); i++)
+    {
+        QPointF b = ring.at(i);
+        double cb = vertical ? b.x() : b.y();
+        bool inB = keepBelow ? cb <= value : cb >= value;
+        if (inA != inB)
+        {
+            double t = (value - ca) / (cb - ca);
+            QPointF p = a + t * (b - a);
+            if (vertical)
+                p.setX(value);
+            else
+                p.setY(value);
+            out << p;
+        }
+        if (inB)
+            out << b;
+        a = b;
+        ca = cb;
+        inA = inB;
+    }
+    return out;
+}
+
+/*!
+ * \brief Clip segment a-b to box (Liang-Barsky).
+ * \return False if segment is outside box.
+ */
+static bool clipSegment(QPointF *a, QPointF *b, const TileBox &box)
+{
+    double dx = b->x() - a->x();
+    double dy = b->y() - a->y();
+    double p[4] = { -dx, dx, -dy, dy };
+    double q[4] = { a->x() - box.x0, box.x1 - a->x(), a->y() - box.y0, box.y1 - a->y() };
+    double t0 = 0.0;
+    double t1 = 1.0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (p[i] == 0.0)
+        {
+            if (q[i] < 0.0)
+                return false;
+            continue;
+        }
+        double t = q[i] / p[i];
+        if (p[i] < 0.0)
+        {
+            if (t > t1)
+                return false;
+            t0 = qMax(t0, t);
+        } else {
+            if (t < t0)
+                return false;
+            t1 = qMin(t1, t);
+        }
+    }
+    QPointF start = *a;
+    if (t1 < 1.0)
+        *b = start + t1 * QPointF(dx, dy);
+    if (t0 > 0.0)
+        *a = start + t0 * QPointF(dx, dy);
+    return true;
+}
+
+/*!
+ * \brief Clip geometry to box.
+ *
+ * Rings are clipped with Sutherland-Hodgman, so odd even fill stays right
+ * inside box. Lines are split where they leave box, points outside box
+ * are dropped.
+ * \param geometry Geometry in map coordinates
+ * \param type Geometry type
+ * \param box Box to clip to
+ * \return Parts that are left.
+ */
+static Geometry clipGeometry(const Geometry &geometry, int type, const TileBox &box)
+{
+    Geometry result;
+    foreach (const QPolygonF &part, geometry) {
+        if (part.isEmpty())
+            continue;
+        if (type == GEOMETRY_TYPE_POINT)
+        {
+            if (insideBox(part.first(), box))
+                result << part;
+        } else if (type == GEOMETRY_TYPE_REGION) {
+            QPolygonF ring = clipRingSide(part, true, box.x0, false);
+            ring = clipRingSide(ring, true, box.x1, true);
+            ring = clipRingSide(ring, false, box.y0, false);
+            ring = clipRingSide(ring, false, box.y1, true);
+            if (ring.count() >= 3)
+                result << ring;
+        } else {
+            if (part.count() == 1)
+            {
+                if (insideBox(part.first(), box))
+                    result << part;
+                continue;
+            }
+            QPolygonF section;
+            for (int i = 1; i < part.count(); i++)
+            {
+                QPointF a = part.at(i - 1);
+                QPointF b = part.at(i);
+                if (!clipSegment(&a, &b, box))
+                    continue;
+                if (!section.isEmpty() && section.last() != a)
+                {
+                    result << section;
+                    section.clear();
+                }
+                if (section.isEmpty())
+                    section << a;
+                section << b;
+            }
+            if (!section.isEmpty())
+                result << section;
+        }
+    }
+    return result;
+}
+
+/*!
+ * \brief Walks tile pyramid, shared read only by all tasks.
+ *
+ * Tile hash is made of style and of hashes of rows whose bounds touch
+ * tile. Rows of child tile are subset of rows of its parent, so if tile
+ * hash did not change, nothing below it changed either and whole subtree
+ * is skipped without decoding any geometry.
+ */
+struct TilePyramid {
+    const Table *table;
+    const QVector<QRgb> *fills; /*!< Fill color of every row. */
+    const QVector<Hash128> *rowHashes; /*!< Hash of stored geometry and fill of every row. */
+    const QVector<double> *bounds; /*!< Bounds of every row, four values per row. */
+    const QHash<QString, QString> *oldTiles; /*!< Tile hashes of last render. */
+    const TileStyle *style;
+    TileGrid grid;
+    QString directory;
+    int z0;
+    int z1;
+
+    /*!
+     * \brief Get area of tile with margin for symbols and line widths.
+     */
+    TileBox box(int z, int x, int y) const
+    {
+        double span = grid.size / (Q_INT64_C(1) << z);
+        double margin = (style->symbolSize / 2.0 + style->lineWidth + 1) * span / TILE_SIZE;
+        TileBox b;
+        b.x0 = grid.left + x * span - margin;
+        b.x1 = grid.left + (x + 1) * span + margin;
+        b.y0 = grid.top - (y + 1) * span - margin;
+        b.y1 = grid.top - y * span + margin;
+        return b;
+    }
+
+    bool touches(int row, const TileBox &b) const
+    {
+        const double *r = bounds->constData() + 4 * row;
+        return r[0] <= b.x1 && r[2] >= b.x0 && r[1] <= b.y1 && r[3] >= b.y0;
+    }
+
+    bool within(int row, const TileBox &b) const
+    {
+        const double *r = bounds->constData() + 4 * row;
+        return r[0] >= b.x0 && r[2] <= b.x1 && r[1] >= b.y0 && r[3] <= b.y1;
+    }
+
+    /*!
+     * \brief Get level 0 tile with all rows that touch it.
+     */
+    TileNode root() const
+    {
+        TileNode node;
+        node.z = node.x = node.y = 0;
+        node.decoded = false;
+        TileBox b = box(0, 0, 0);
+        for (int r = 0; r < table->rowCount(); r++)
+        {
+            if (bounds->at(4 * r) <= bounds->at(4 * r + 2) && touches(r, b))
+                node.candidates << r;
+        }
+        return node;
+    }
+
+    /*!
+     * \brief Get child tile with rows of parent that touch it.
+     * \param parent Parent tile
+     * \param quadrant 0 top left, 1 top right, 2 bottom left, 3 bottom right
+     * \return Child tile, its geometry is clipped when it is visited.
+     */
+    TileNode child(const TileNode &parent, int quadrant) const
+    {
+        TileNode node;
+        node.z = parent.z + 1;
+        node.x = parent.x * 2 + (quadrant & 1);
+        node.y = parent.y * 2 + (quadrant >> 1);
+        node.decoded = parent.decoded;
+        TileBox b = box(node.z, node.x, node.y);
+        int k = 0;
+        foreach (int r, parent.candidates) {
+            if (!touches(r, b))
+                continue;
+            node.candidates << r;
+            if (!parent.decoded)
+                continue;
+            while (k < parent.rows.count() && parent.rows.at(k).row < r)
+                k++;
+            if (k < parent.rows.count() && parent.rows.at(k).row == r)
+                node.rows << parent.rows.at(k);
+        }
+        return node;
+    }
+
+    /*!
+     * \brief Visit one tile: skip it, or clip its rows and render it.
+     * \param node Tile, its rows are clipped to it.
+     * \param task Returns manifest lines, skipped tiles and error.
+     * \return True if tiles below have to be visited.
+     */
+    bool visit(TileNode &node, TileTask *task) const
+    {
+        // Levels above min zoom are not rendered, rows are only culled
+        if (node.z < z0)
+            return true;
+
+        Hasher hasher;
+        hasher.addHash(style->hash);
+        foreach (int r, node.candidates)
+            hasher.addHash(rowHashes->at(r));
+        QString hash = hasher.result().toHex();
+        QString key = QString("%1/%2/%3").arg(node.z).arg(node.x).arg(node.y);
+        QString fileName = directory + "/" + key + ".png";
+        if (oldTiles->value(key) == hash && QFile::exists(fileName))
+        {
+            task->lines << key + " " + hash;
+            task->skipped << key;
+            return false;
+        }
+
+        TileBox b = box(node.z, node.x, node.y);
+        if (!node.decoded)
+        {
+            node.rows.clear();
+            foreach (int r, node.candidates) {
+                TileRow row;
+                row.row = r;
+                row.geometry = table->geometry(r);
+                node.rows << row;
+            }
+            node.decoded = true;
+        }
+        QVector<TileRow> rows;
+        foreach (const TileRow &row, node.rows) {
+            if (within(row.row, b))
+            {
+                rows << row;
+                continue;
+            }
+            TileRow clipped;
+            clipped.row = row.row;
+            clipped.geometry = clipGeometry(row.geometry, table->geometryType(row.row), b);
+            if (!clipped.geometry.isEmpty())
+                rows << clipped;
+        }
+        node.rows = rows;
+        // Only occupied tiles are kept
+        if (node.rows.isEmpty())
+            return false;
+
+        if (!render(node, fileName, &task->error))
+            return false;
+        task->lines << key + " " + hash;
+        return node.z < z1;
+    }
+
+    /*!
+     * \brief Visit tile and all tiles below it, depth first.
+     */
+    void descend(TileNode &node, TileTask *task) const
+    {
+        if (!visit(node, task) || !task->error.isEmpty())
+            return;
+        for (int q = 0; q < 4 && task->error.isEmpty(); q++)
+        {
+            TileNode next = child(node, q);
+            if (!next.candidates.isEmpty())
+                descend(next, task);
+        }
+    }
+
+    /*!
+     * \brief Draw clipped rows of tile to PNG file.
+     * \param node Tile with clipped rows
+     * \param fileName PNG file
+     * \param error Returns error.
+     * \return True on success.
+     */
+    bool render(const TileNode &node, const QString &fileName, QString *error) const
+    {
+        double span = grid.size / (Q_INT64_C(1) << node.z);
+        double scale = TILE_SIZE / span;
+        double left = grid.left + node.x * span;
+        double top = grid.top - node.y * span;
+        QImage image(TILE_SIZE, TILE_SIZE, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        QPen pen(style->line, qMax(1, style->lineWidth));
+        pen.setJoinStyle(Qt::RoundJoin);
+        pen.setCapStyle(Qt::RoundCap);
+
+        foreach (const TileRow &row, node.rows) {
+            const Geometry &geometry = row.geometry;
+            int type = table->geometryType(row.row);
+            QColor fillColor = QColor::fromRgba(fills->at(row.row));
+            if (type == GEOMETRY_TYPE_POINT)
+            {
+                double radius = style->symbolSize / 2.0;
+                painter.setPen(style->lineWidth > 0 ? pen : QPen(Qt::NoPen));
+                painter.setBrush(fillColor);
+                foreach (const QPolygonF &part, geometry) {
+                    if (!part.isEmpty())
+                        painter.drawEllipse(QPointF((part.first().x() - left) * scale, (top - part.first().y()) * scale), radius, radius);
+                }
+                continue;
+            }
+
+            QPainterPath path = pixelPath(geometry, type == GEOMETRY_TYPE_REGION, left, top, scale);
+            if (path.isEmpty())
+            {
+                // Feature smaller than pixel is still seen as one pixel
+                if (!geometry.isEmpty() && !geometry.first().isEmpty())
+                {
+                    QPointF p = geometry.first().first();
+                    painter.fillRect(QRectF((p.x() - left) * scale, (top - p.y()) * scale, 1, 1),
+                                     type == GEOMETRY_TYPE_REGION ? fillColor : style->line);
+                }
+                continue;
+            }
+            if (type == GEOMETRY_TYPE_REGION)
+            {
+                path.setFillRule(Qt::OddEvenFill);
+                painter.fillPath(path, fillColor);
+                if (style->lineWidth > 0)
+                    painter.strokePath(path, pen);
+            } else {
+                painter.strokePath(path, pen);
+            }
+        }
+        painter.end();
+
+        QDir().mkpath(QFileInfo(fileName).path());
+        if (!image.save(fileName, "PNG"))
+        {
+            *error = "Can not write " + fileName;
+            return false;
+        }
+        return true;
+    }
+};
+
+/*!
+ * \brief Visits one tile of frontier, and tiles below it if descend is set.
+ */
+struct VisitTile {
+    typedef void result_type;
+
+    const TilePyramid *pyramid;
+    bool descend;
+
+    void operator()(TileTask &task) const
+    {
+        if (descend)
+        {
+            pyramid->descend(task.node, &task);
+            return;
+        }
+        if (!pyramid->visit(task.node, &task) || !task.error.isEmpty())
+            return;
+        for (int q = 0; q < 4; q++)
+        {
+            TileNode next = pyramid->child(task.node, q);
+            if (!next.candidates.isEmpty())
+                task.children << next;
+        }
+    }
+};
+
+/*!
+ * \brief Render input to tile pyramid and return it.
+ * \param inputs Input tables
+ * \return Input table
+ */
+TablePtr Tiles::run(QList<TablePtr> inputs)
+{
+    TablePtr input = inputs.value(0);
+    if (!input)
+        return input;
+    QString error;
+    if (!render(input, &error))
+    {
+        if (myCallback)
+            myCallback->showError("Render Tiles: " + error);
+        return TablePtr();
+    }
+    return input;
+}
+
+/*!
+ * \brief Render tiles of all zoom levels.
+ *
+ * Every row is hashed once from its stored coordinates. Pyramid is walked
+ * from level 0 down, only to tiles that some row touches, and geometry of
+ * parent tile is clipped to child tile, so each tile draws only what
+ * reaches it. Top levels are visited one level at a time until there are
+ * enough tiles to keep all threads busy, then each of those subtrees is
+ * walked depth first in parallel. Subtrees whose hash did not change are
+ * kept as they are, other tiles that are no longer made are removed.
+ * Nothing is done if tiles were rendered with same node hash. Tiles
+ * removed from disk by hand are rendered again only when tiles.hash is
+ * removed too.
+ * \param input Input table
+ * \param error Returns error.
+ * \return True on success.
+ */
+bool Tiles::render(TablePtr input, QString *error)
+{
+    if (directory.isEmpty())
+    {
+        *error = "No tile directory";
+        return false;
+    }
+
+    QString nodeHash = getHash().toHex();
+    QHash<QString, QString> oldTiles;
+    QFile file(manifestFile());
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        QTextStream in(&file);
+        if (in.readLine().trimmed() == nodeHash)
+            return true;
+        while (!in.atEnd())
+        {
+            QStringList fields = in.readLine().split(' ', QString::SkipEmptyParts);
+            if (fields.count() == 2)
+                oldTiles.insert(fields.at(0), fields.at(1));
+        }
+        file.close();
+    }
+
+    TileStyle style;
+    QColor fillColor(fill);
+    style.line = QColor(line);
+    style.lineWidth = qMax(0, lineWidth);
+    style.symbolSize = qMax(1, symbolSize);
+    if (!fillColor.isValid() || !style.line.isValid())
+    {
+        *error = "Bad fill or line color";
+        return false;
+    }
+    int n = input->rowCount();
+    QVector<QRgb> fills(n, fillColor.rgba());
+    if (!classColumn.isEmpty())
+    {
+        int c = input->columnIndex(classColumn);
+        if (c < 0 || input->column(c).type != COLUMN_TYPE_INTEGER)
+        {
+            *error = "No integer column " + classColumn;
+            return false;
+        }
+        QVector<QRgb> palette;
+        foreach (QString name, classColors.split(',', QString::SkipEmptyParts)) {
+            QColor color(name.trimmed());
+            if (!color.isValid())
+            {
+                *error = "Bad class color " + name;
+                return false;
+            }
+            palette << color.rgba();
+        }
+        for (int r = 0; r < n; r++)
+        {
+            qint64 k = input->column(c).integers.at(r);
+            if (k >= 1 && k <= palette.count())
+                fills[r] = palette.at(k - 1);
+        }
+    }
+
+    // Bounds and hashes of rows, empty rows have min above max
+    QVector<double> bounds(4 * n);
+    QVector<Hash128> rowHashes(n);
+    double minX = DBL_MAX, minY = DBL_MAX, maxX = -DBL_MAX, maxY = -DBL_MAX;
+    QVarLengthArray<double, 512> xs;
+    QVarLengthArray<double, 512> ys;
+    for (int r = 0; r < n; r++)
+    {
+        double *b = bounds.data() + 4 * r;
+        b[0] = b[1] = DBL_MAX;
+        b[2] = b[3] = -DBL_MAX;
+        if (input->geometryType(r) == GEOMETRY_TYPE_NONE)
+            continue;
+        Hasher rowHasher;
+        rowHasher.addInt(input->geometryType(r));
+        rowHasher.addInt(fills.at(r));
+        rowHasher.addInt(input->partCount(r));
+        for (int p = 0; p < input->partCount(r); p++)
+        {
+            int count = input->pointCount(r, p);
+            rowHasher.addInt(count);
+            rowHasher.addBytes(input->partData(r, p), input->partBytes(r, p));
+            xs.resize(count);
+            ys.resize(count);
+            input->points(r, p, xs.data(), ys.data());
+            for (int i = 0; i < count; i++)
+            {
+                b[0] = qMin(b[0], xs[i]);
+                b[1] = qMin(b[1], ys[i]);
+                b[2] = qMax(b[2], xs[i]);
+                b[3] = qMax(b[3], ys[i]);
+            }
+        }
+        rowHashes[r] = rowHasher.result();
+        minX = qMin(minX, b[0]);
+        minY = qMin(minY, b[1]);
+        maxX = qMax(maxX, b[2]);
+        maxY = qMax(maxY, b[3]);
+    }
+
+    // Coordinates are not reprojected, Web Mercator tiles need Web Mercator data
+    if (grid == TILE_GRID_WEBMERCATOR)
+    {
+        if (!isWebMercator(coordSys))
+        {
+            *error = "Web Mercator grid needs data in " TILE_WEBMERCATOR_COORDSYS ", use Data bounds grid";
+            return false;
+        }
+        if (minX <= maxX && (minX < -TILE_WEBMERCATOR_EXTENT || maxX > TILE_WEBMERCATOR_EXTENT
+                             || minY < -TILE_WEBMERCATOR_EXTENT || maxY > TILE_WEBMERCATOR_EXTENT))
+        {
+            *error = "Data is outside Web Mercator grid";
+            return false;
+        }
+    }
+
+    TileGrid tileGrid;
+    if (grid == TILE_GRID_DATA)
+    {
+        tileGrid.size = minX <= maxX ? qMax(maxX - minX, maxY - minY) : 0.0;
+        if (tileGrid.size <= 0.0)
+            tileGrid.size = 1.0;
+        tileGrid.left = minX <= maxX ? minX : 0.0;
+        tileGrid.top = minX <= maxX ? minY + tileGrid.size : tileGrid.size;
+    } else {
+        tileGrid.left = -TILE_WEBMERCATOR_EXTENT;
+        tileGrid.top = TILE_WEBMERCATOR_EXTENT;
+        tileGrid.size = 2 * TILE_WEBMERCATOR_EXTENT;
+    }
+
+    // Row hashes are of stored coordinates, so transform is part of style
+    CoordTransform transform = input->getTransform();
+    Hasher hasher;
+    hasher.addInt(TILE_SIZE);
+    hasher.addDouble(tileGrid.left);
+    hasher.addDouble(tileGrid.top);
+    hasher.addDouble(tileGrid.size);
+    hasher.addDouble(transform.originX);
+    hasher.addDouble(transform.originY);
+    hasher.addDouble(transform.resolutionX);
+    hasher.addDouble(transform.resolutionY);
+    hasher.addInt(style.line.rgba());
+    hasher.addInt(style.lineWidth);
+    hasher.addInt(style.symbolSize);
+    style.hash = hasher.result();
+
+    TilePyramid pyramid;
+    pyramid.table = input.data();
+    pyramid.fills = &fills;
+    pyramid.rowHashes = &rowHashes;
+    pyramid.bounds = &bounds;
+    pyramid.oldTiles = &oldTiles;
+    pyramid.style = &style;
+    pyramid.grid = tileGrid;
+    pyramid.directory = directory;
+    pyramid.z0 = qBound(0, minZoom, TILE_MAX_ZOOM);
+    pyramid.z1 = qBound(pyramid.z0, maxZoom, TILE_MAX_ZOOM);
+
+    QStringList manifest;
+    manifest << nodeHash;
+    QSet<QString> skipped;
+    QVector<TileTask> frontier;
+    TileTask first;
+    first.node = pyramid.root();
+    if (!first.node.candidates.isEmpty())
+        frontier << first;
+
+    VisitTile visit;
+    visit.pyramid = &pyramid;
+    visit.descend = false;
+    int threads = qMax(1, QThread::idealThreadCount());
+    while (!frontier.isEmpty())
+    {
+        visit.descend = frontier.count() >= 4 * threads;
+        QtConcurrent::blockingMap(frontier, visit);
+        QVector<TileTask> next;
+        foreach (const TileTask &task, frontier) {
+            if (!task.error.isEmpty())
+            {
+                *error = task.error;
+                return false;
+            }
+            manifest << task.lines;
+            foreach (const QString &tile, task.skipped)
+                skipped.insert(tile);
+            foreach (const TileNode &node, task.children) {
+                TileTask child;
+                child.node = node;
+                next << child;
+            }
+        }
+        frontier = next;
+    }
+
+    // Tiles below unchanged tiles were not visited, they are kept
+    QSet<QString> tiles;
+    for (int i = 1; i < manifest.count(); i++)
+        tiles.insert(manifest.at(i).section(' ', 0, 0));
+    QHashIterator<QString, QString> it(oldTiles);
+    while (it.hasNext())
+    {
+        it.next();
+        if (tiles.contains(it.key()))
+            continue;
+        QStringList zxy = it.key().split('/');
+        int z = zxy.value(0).toInt();
+        int x = zxy.value(1).toInt();
+        int y = zxy.value(2).toInt();
+        bool keep = false;
+        if (zxy.count() == 3 && z <= pyramid.z1)
+        {
+            while (!keep && z > 0)
+            {
+                z--;
+                x /= 2;
+                y /= 2;
+                keep = skipped.contains(QString("%1/%2/%3").arg(z).arg(x).arg(y));
+            }
+        }
+        if (keep)
+            manifest << it.key() + " " + it.value();
+        else
+            QFile::remove(directory + "/" + it.key() + ".png");
+    }
+
+    QDir().mkpath(directory);
+    file.setFileName(manifestFile());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)
+            || file.write(manifest.join("\n").toLatin1() + "\n") < 0)
+    {
+        *error = "Can not write " + manifestFile();
+        return false;
+    }
+    return true;
+}
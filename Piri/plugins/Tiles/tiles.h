@@ -0,0 +1,44 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include <QObject>
+#include <QtPlugin>
+
+#include "pirilib.h"
+#include "interfaces.h"
+#include "knobcallback.h"
+#include "op.h"
+
+class Tiles : public QObject, public OpInterfaceMI, public OpInterfaceNative, public Op
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID "Kaldera.Piri.v03.OpInterfaceMI")
+    Q_INTERFACES(OpInterfaceMI OpInterfaceNative)
+
+public:
+    Tiles();
+    OpInterfaceMI* create();
+    void setup();
+    const OpDescriptor* descriptor();
+    void knobs(KnobCallback *f);
+    QString engine();
+    TablePtr run(QList<TablePtr> inputs);
+
+private:
+    QString manifestFile();
+    bool render(TablePtr input, QString *error);
+
+    QString directory; /*!< Directory of tile pyramid, tiles are z/x/y.png */
+    int grid; /*!< Tile grid, see TILE_GRID_* in pirilib.h */
+    QString coordSys; /*!< MapBasic CoordSys clause of input, coordinates are not reprojected. */
+    int minZoom;
+    int maxZoom;
+    QString fill; /*!< Fill color of regions and symbols. */
+    QString line; /*!< Color of lines and borders. */
+    int lineWidth; /*!< Line width in pixels, 0 draws no borders. */
+    int symbolSize; /*!< Symbol diameter in pixels. */
+    QString classColumn; /*!< Integer column with class from 1, empty for one fill color. */
+    QString classColors; /*!< Comma separated fill colors of classes. */
+};
+
+#endif // TILES_H
@@ -1,14 +1,25 @@
 #include "viewer.h"
 
+static constexpr OpDescriptor viewerDescriptor = { "Viewer", "Viewer", "Viewer process.", 1, 1, OP_SCHEMA_INPUT, 0, 0 };
+
+Viewer::Viewer()
+{
+    setup();
+}
+
+OpInterfaceMI* Viewer::create()
+{
+    return new Viewer();
+}
+
 void Viewer::setup()
 {
 
 }
 
-QString Viewer::description()
+const OpDescriptor* Viewer::descriptor()
 {
-    setup();
-    return QString("Viewer/Viewer;Viewer process./1");
+    return &viewerDescriptor;
 }
 
 void Viewer::knobs(KnobCallback* f)
@@ -16,10 +27,23 @@ void Viewer::knobs(KnobCallback* f)
 
 }
 
+TablePtr Viewer::run(QList<TablePtr> inputs)
+{
+    return inputs.value(0);
+}
+
+TableStreamPtr Viewer::stream(QList<TableStreamPtr> inputs, int batchRows)
+{
+    Q_UNUSED(batchRows);
+    return inputs.value(0);
+}
+
 QString Viewer::engine()
 {
     QString command;
-    command = QString("Select * From _%1 Into _%2 ").arg(getInput(0)->getHash()).arg(getHash());
+    if (!hasInput(0))
+        return " ";
+    command = QString("Select * From _%1 Into _%2 ").arg(getInputHash(0).toHex()).arg(getHash().toHex());
     //command = QString("Browse * From _%1 ").arg(getInput(0)->getHash());
 
     return command;
@@ -0,0 +1,29 @@
+#-------------------------------------------------
+#
+# Headless graph runner. Runs saved graph with native
+# backend, does not need MapInfo or display.
+#
+#-------------------------------------------------
+
+# Runner makes only QCoreApplication and no widgets. Widgets module is
+# still needed to compile, as pirilib.h includes node.h and edge.h, which
+# are graphics items, and PiriLib itself links QtWidgets. gui is needed
+# for QPolygonF geometry of tables.
+QT       += core gui widgets
+
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+
+TARGET = PiriRunner
+TEMPLATE = app
+
+SOURCES += main.cpp
+
+INCLUDEPATH = $$PWD/../libs/PiriLib/source
+
+win32:CONFIG(release, debug|release): LIBS += -L$$PWD/../libs/PiriLib/libs/ -lPiriLib
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$PWD/../libs/PiriLib/libs/ -lPiriLibd
+else:unix: LIBS += -L$$PWD/../libs/PiriLib/libs/ -lPiriLib
+
+INCLUDEPATH += $$PWD/../libs/PiriLib/libs
+DEPENDPATH += $$PWD/../libs/PiriLib/libs
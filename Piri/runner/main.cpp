@@ -0,0 +1,161 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QScopedPointer>
+
+#include "graphfile.h"
+#include "graphmodel.h"
+#include "pluginmanifest.h"
+#include "nativebackend.h"
+#include "csvwriter.h"
+#include "resultcache.h"
+#include "evalprofiler.h"
+
+/*
+ * Headless graph runner.
+ *
+ * Loads graph saved from Piri, evaluates one node with native backend and
+ * writes result to disk. No widgets are created, knob values are kept only
+ * in ops. Row-wise ops are streamed in batches from source to output file,
+ * so tables do not have to fit in memory. Whole results of other ops are
+ * kept in result cache, so running same graph again loads results instead
+ * of running ops.
+ */
+
+static QTextStream err(stderr);
+
+static int usage()
+{
+    err << "Usage: PiriRunner [-plugins <dir>] [-cache <dir>] [-cachesize <MB>] [-nocache]" << endl
+        << "                  [-batch <rows>] [-profile <trace.json>] [-v]" << endl
+        << "                  <graph file> <node id or name> <output.csv>" << endl
+        << "       PiriRunner [-plugins <dir>] [-cache <dir>] [-nocache] [-batch <rows>] -plan" << endl
+        << "                  <graph file> <node id or name>" << endl
+        << "       -plan prints execution plan without running anything, with node" << endl
+        << "             times of earlier runs as estimated cost" << endl
+        << "       -batch 0 runs every op on whole table" << endl
+        << "       -profile writes node timing as Chrome trace, -v prints it" << endl;
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QString pluginsPath = app.applicationDirPath() + "/plugins";
+    QString cachePath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/results";
+    qint64 cacheSize = RESULT_CACHE_SIZE;
+    bool useCache = true;
+    int batchRows = STREAM_BATCH_ROWS;
+    bool verbose = false;
+    QString profilePath;
+    bool dryRun = false;
+    QStringList args;
+    QStringList all = app.arguments();
+    for (int i = 1; i < all.count(); i++)
+    {
+        if (all.at(i) == "-plugins" && i + 1 < all.count())
+            pluginsPath = all.at(++i);
+        else if (all.at(i) == "-cache" && i + 1 < all.count())
+            cachePath = all.at(++i);
+        else if (all.at(i) == "-cachesize" && i + 1 < all.count())
+            cacheSize = all.at(++i).toLongLong() * 1024 * 1024;
+        else if (all.at(i) == "-nocache")
+            useCache = false;
+        else if (all.at(i) == "-batch" && i + 1 < all.count())
+            batchRows = all.at(++i).toInt();
+        else if (all.at(i) == "-profile" && i + 1 < all.count())
+            profilePath = all.at(++i);
+        else if (all.at(i) == "-plan")
+            dryRun = true;
+        else if (all.at(i) == "-v")
+            verbose = true;
+        else
+            args << all.at(i);
+    }
+    if (args.count() != (dryRun ? 2 : 3))
+        return usage();
+
+    GraphFile graph;
+    if (!graph.read(args.at(0)))
+    {
+        err << graph.getError() << endl;
+        return 2;
+    }
+    int index = graph.findNode(args.at(1));
+    if (index < 0)
+    {
+        err << "No node " << args.at(1) << " in " << args.at(0) << endl;
+        return 2;
+    }
+
+    QString manifestFile = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/plugins.manifest";
+    PluginManifest manifest(QDir(pluginsPath), manifestFile);
+    manifest.load();
+    if (manifest.scan() || manifest.getRemoved())
+        manifest.save();
+
+    // Nodes get model ids in file order
+    GraphModel model;
+    if (!model.load(graph, &manifest))
+    {
+        err << model.getError() << endl;
+        return 2;
+    }
+
+    // Every run is profiled, node times are kept for estimates of -plan
+    QString timesFile = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/node.times";
+    QString graphPath = QFileInfo(args.at(0)).absoluteFilePath();
+    EvalProfiler profiler;
+    model.setProfiler(&profiler);
+
+    QScopedPointer<ResultCache> cache(useCache ? new ResultCache(cachePath, cacheSize) : 0);
+    if (dryRun)
+    {
+        profiler.loadTimes(timesFile, graphPath);
+        QTextStream(stdout) << GraphModel::planText(model.plan(index, cache.data(), batchRows)) << endl;
+        return 0;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    NativeBackend backend;
+    TableStreamPtr result;
+    if (batchRows > 0)
+    {
+        result = model.evaluateStream(index, &backend, cache.data(), batchRows);
+    } else {
+        TablePtr table = model.evaluate(index, &backend, cache.data());
+        if (table)
+            result = TableStreamPtr(new TableSliceStream(table, qMax(1, table->rowCount())));
+    }
+    if (!result)
+    {
+        err << model.getError() << endl;
+        return 2;
+    }
+
+    // Streamed ops run while result is written
+    CsvWriter writer(args.at(2));
+    if (!writer.write(result))
+    {
+        err << writer.getError() << endl;
+        return 2;
+    }
+    if (verbose)
+    {
+        err << profiler.summary() << endl;
+        err << graph.nodes.at(index).name << ": " << writer.getRowCount() << " rows, " << timer.elapsed() << " ms" << endl;
+    }
+    if (!profilePath.isEmpty() && !profiler.writeChromeTrace(profilePath))
+    {
+        err << profiler.getError() << endl;
+        return 2;
+    }
+    if (!profiler.saveTimes(timesFile, graphPath))
+        err << profiler.getError() << endl;
+    return 0;
+}